@@ -0,0 +1,120 @@
+//========================================================================
+//
+// GooArena.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "GooArena.h"
+
+//------------------------------------------------------------------------
+
+struct GooArenaChunk {
+  GooArenaChunk *next;
+  size_t size;			// bytes of data following the header
+  // the header is a multiple of 8 bytes, so the data is aligned
+  char *data() { return (char *)(this + 1); }
+};
+
+static GooArenaChunk *newChunk(size_t size) {
+  GooArenaChunk *chunk;
+
+  chunk = (GooArenaChunk *)gmalloc(sizeof(GooArenaChunk) + size);
+  chunk->next = NULL;
+  chunk->size = size;
+  return chunk;
+}
+
+static void freeChunks(GooArenaChunk *chunk) {
+  GooArenaChunk *next;
+
+  while (chunk) {
+    next = chunk->next;
+    gfree(chunk);
+    chunk = next;
+  }
+}
+
+//------------------------------------------------------------------------
+// GooArena
+//------------------------------------------------------------------------
+
+GooArena::GooArena(size_t chunkSizeA, size_t maxSizeA) {
+  chunkSize = chunkSizeA < 256 ? 256 : chunkSizeA;
+  maxSize = maxSizeA;
+  chunks = curChunk = bigChunks = NULL;
+  ptr = end = NULL;
+  used = 0;
+  numChunkAllocs = 0;
+}
+
+GooArena::~GooArena() {
+  freeChunks(chunks);
+  freeChunks(bigChunks);
+}
+
+void *GooArena::allocChunk(size_t size) {
+  GooArenaChunk *chunk;
+
+  // big requests get their own chunk, so they don't waste the rest of
+  // the current one
+  if (size > chunkSize / 4) {
+    chunk = newChunk(size);
+    ++numChunkAllocs;
+    chunk->next = bigChunks;
+    bigChunks = chunk;
+    return chunk->data();
+  }
+
+  // move on to the next chunk, reusing the ones kept by reset()
+  if (curChunk && curChunk->next) {
+    curChunk = curChunk->next;
+  } else {
+    chunk = newChunk(chunkSize);
+    ++numChunkAllocs;
+    if (curChunk) {
+      curChunk->next = chunk;
+    } else {
+      chunks = chunk;
+    }
+    curChunk = chunk;
+  }
+  ptr = curChunk->data() + size;
+  end = curChunk->data() + curChunk->size;
+  return curChunk->data();
+}
+
+char *GooArena::copyString(const char *s) {
+  return copyString(s, strlen(s));
+}
+
+char *GooArena::copyString(const char *s, size_t n) {
+  char *s1;
+
+  s1 = (char *)alloc(n + 1);
+  memcpy(s1, s, n);
+  s1[n] = '\0';
+  return s1;
+}
+
+void GooArena::reset() {
+  freeChunks(bigChunks);
+  bigChunks = NULL;
+  curChunk = chunks;
+  if (curChunk) {
+    ptr = curChunk->data();
+    end = ptr + curChunk->size;
+  } else {
+    ptr = end = NULL;
+  }
+  used = 0;
+}
@@ -0,0 +1,94 @@
+//========================================================================
+//
+// GooArena.h
+//
+// Bump allocator for short-lived objects that are all released at once.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef GOOARENA_H
+#define GOOARENA_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stddef.h>
+#include "gtypes.h"
+
+struct GooArenaChunk;
+
+//------------------------------------------------------------------------
+// GooArena
+//
+// Memory is handed out from chunks of <chunkSize> bytes, and is only
+// given back by reset(), which releases everything allocated since the
+// previous reset.  The chunks themselves are kept for reuse until the
+// arena is deleted; requests bigger than a quarter of a chunk get a
+// chunk of their own, which reset() frees.  Nothing allocated in the
+// arena has its destructor run by the arena.
+//
+// <maxSize> is only advisory: alloc() never fails, but isFull() tells
+// callers that can fall back to the heap to do so.
+//
+// The arena does no locking of its own.
+//------------------------------------------------------------------------
+
+class GooArena {
+public:
+
+  GooArena(size_t chunkSizeA = 8192, size_t maxSizeA = 0);
+  ~GooArena();
+
+  // Allocate <size> bytes, aligned for any basic type.
+  void *alloc(size_t size) {
+    size = (size + (alignment - 1)) & ~(size_t)(alignment - 1);
+    used += size;
+    if (fits(size)) {
+      char *p = ptr;
+      ptr += size;
+      return p;
+    }
+    return allocChunk(size);
+  }
+
+  // Copy a string into the arena.
+  char *copyString(const char *s);
+  char *copyString(const char *s, size_t n);
+
+  // Release everything allocated since the last reset.
+  void reset();
+
+  // Number of bytes allocated since the last reset.
+  size_t getUsed() { return used; }
+
+  // Has more than <maxSize> bytes been allocated since the last reset?
+  GBool isFull() { return maxSize > 0 && used > maxSize; }
+
+  // Number of chunks allocated from the heap over the arena's life.
+  unsigned long getNumChunkAllocs() { return numChunkAllocs; }
+
+private:
+
+  GooArena(const GooArena &arena); // not allowed
+  GooArena& operator=(const GooArena &other); // not allowed
+
+  static const size_t alignment = 8;
+
+  GBool fits(size_t size) { return size <= (size_t)(end - ptr); }
+  void *allocChunk(size_t size);
+
+  size_t chunkSize;
+  size_t maxSize;
+  GooArenaChunk *chunks;	// regular chunks, in use order
+  GooArenaChunk *curChunk;	// chunk <ptr> points into
+  GooArenaChunk *bigChunks;	// oversized chunks, freed by reset()
+  char *ptr;			// next free byte in <curChunk>
+  char *end;			// end of <curChunk>
+  size_t used;
+  unsigned long numChunkAllocs;
+};
+
+#endif
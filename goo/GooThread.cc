@@ -0,0 +1,135 @@
+//========================================================================
+//
+// GooThread.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "GooMutex.h"
+#include "GooThread.h"
+
+// max number of threads started by gRunJobs
+#define maxJobThreads 64
+
+//------------------------------------------------------------------------
+
+struct GooJobQueue {
+  GooJobFunc func;
+  void *data;
+  int nJobs;
+  int nextJob;
+  GooMutex mutex;
+};
+
+static void runQueuedJobs(GooJobQueue *queue) {
+  int job;
+
+  while (1) {
+    gLockMutex(&queue->mutex);
+    job = queue->nextJob++;
+    gUnlockMutex(&queue->mutex);
+    if (job >= queue->nJobs) {
+      break;
+    }
+    (*queue->func)(job, queue->data);
+  }
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI jobThread(LPVOID arg) {
+  runQueuedJobs((GooJobQueue *)arg);
+  return 0;
+}
+
+#else
+
+static void *jobThread(void *arg) {
+  runQueuedJobs((GooJobQueue *)arg);
+  return NULL;
+}
+
+#endif
+
+int gGetNumProcessors() {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long n;
+
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#else
+  return 1;
+#endif
+}
+
+void gRunJobs(int nJobs, int nThreads, GooJobFunc func, void *data) {
+  GooJobQueue queue;
+  int nStarted, i;
+
+  if (nThreads > nJobs) {
+    nThreads = nJobs;
+  }
+  if (nThreads > maxJobThreads) {
+    nThreads = maxJobThreads;
+  }
+  if (nThreads <= 1) {
+    for (i = 0; i < nJobs; ++i) {
+      (*func)(i, data);
+    }
+    return;
+  }
+
+  queue.func = func;
+  queue.data = data;
+  queue.nJobs = nJobs;
+  queue.nextJob = 0;
+  gInitMutex(&queue.mutex);
+
+#ifdef _WIN32
+  HANDLE threads[maxJobThreads];
+  for (nStarted = 0; nStarted < nThreads - 1; ++nStarted) {
+    threads[nStarted] = CreateThread(NULL, 0, &jobThread, &queue, 0, NULL);
+    if (!threads[nStarted]) {
+      break;
+    }
+  }
+  runQueuedJobs(&queue);
+  for (i = 0; i < nStarted; ++i) {
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+  }
+#else
+  pthread_t threads[maxJobThreads];
+  for (nStarted = 0; nStarted < nThreads - 1; ++nStarted) {
+    if (pthread_create(&threads[nStarted], NULL, &jobThread, &queue) != 0) {
+      break;
+    }
+  }
+  runQueuedJobs(&queue);
+  for (i = 0; i < nStarted; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+#endif
+
+  gDestroyMutex(&queue.mutex);
+}
@@ -0,0 +1,35 @@
+//========================================================================
+//
+// GooThread.h
+//
+// Portable helpers to spread work over several threads.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef GOOTHREAD_H
+#define GOOTHREAD_H
+
+// Usage:
+//
+// static void doJob(int job, void *data) {
+//   ... work on part <job> of <data> ...
+// }
+// ...
+// gRunJobs(nJobs, gGetNumProcessors(), &doJob, data);
+
+typedef void (*GooJobFunc)(int job, void *data);
+
+// Returns the number of processors available, at least 1.
+int gGetNumProcessors();
+
+// Calls func(job, data) for each job in 0 .. nJobs - 1, using up to
+// <nThreads> threads, the calling thread included.  Jobs are handed
+// out in increasing order to whichever thread is free, so <func> must
+// not depend on the thread it runs on.  Returns once all the jobs are
+// done.  If threads can't be created, the remaining jobs run on the
+// calling thread.
+void gRunJobs(int nJobs, int nThreads, GooJobFunc func, void *data);
+
+#endif
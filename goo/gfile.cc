@@ -52,6 +52,9 @@
 #  if defined(VMS) && (__DECCXX_VER < 50200000)
 #    include <unixlib.h>
 #  endif
+#  ifdef HAVE_SYS_MMAN_H
+#    include <sys/mman.h>
+#  endif
 #endif // _WIN32
 #include <stdio.h>
 #include <limits>
@@ -641,6 +644,41 @@ GooFile* GooFile::open(const wchar_t *fileName) {
   return handle == INVALID_HANDLE_VALUE ? NULL : new GooFile(handle);
 }
 
+const char *GooFile::map(Goffset *len) const {
+  HANDLE mapping;
+  void *data;
+
+  *len = size();
+  if (*len <= 0 || (Goffset)(size_t)*len != *len) {
+    return NULL;
+  }
+  mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    return NULL;
+  }
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  // the view keeps the mapping object alive
+  CloseHandle(mapping);
+  return (const char *)data;
+}
+
+void GooFile::unmap(const char *data, Goffset /*len*/) {
+  UnmapViewOfFile(data);
+}
+
+Goffset GooFile::modificationTime() const {
+  FILETIME lastWrite;
+  LARGE_INTEGER t;
+
+  if (!GetFileTime(handle, NULL, NULL, &lastWrite)) {
+    return -1;
+  }
+  t.LowPart = lastWrite.dwLowDateTime;
+  t.HighPart = lastWrite.dwHighDateTime;
+  // FILETIME counts 100ns intervals since 1601-01-01
+  return t.QuadPart / 10000000 - 11644473600LL;
+}
+
 #else
 
 int GooFile::read(char *buf, int n, Goffset offset) const {
@@ -669,6 +707,39 @@ GooFile* GooFile::open(const GooString *fileName) {
   return fd < 0 ? NULL : new GooFile(fd);
 }
 
+const char *GooFile::map(Goffset *len) const {
+#ifdef HAVE_SYS_MMAN_H
+  void *data;
+
+  *len = size();
+  if (*len <= 0 || (Goffset)(size_t)*len != *len) {
+    return NULL;
+  }
+  data = mmap(NULL, (size_t)*len, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  return (const char *)data;
+#else
+  return NULL;
+#endif
+}
+
+void GooFile::unmap(const char *data, Goffset len) {
+#ifdef HAVE_SYS_MMAN_H
+  munmap((void *)data, (size_t)len);
+#endif
+}
+
+Goffset GooFile::modificationTime() const {
+  struct stat st;
+
+  if (fstat(fd, &st) != 0) {
+    return -1;
+  }
+  return (Goffset)st.st_mtime;
+}
+
 #endif // _WIN32
 
 //------------------------------------------------------------------------
@@ -137,6 +137,17 @@ class GooFile
 public:
   int read(char *buf, int n, Goffset offset) const;
   Goffset size() const;
+
+  // Map the whole file read-only into memory and return a pointer to
+  // it, with its length in <len>.  Returns NULL if the file can't be
+  // mapped.  The mapping stays valid after the GooFile is deleted and
+  // must be released with unmap().
+  const char *map(Goffset *len) const;
+  static void unmap(const char *data, Goffset len);
+
+  // Last modification time of the file, in seconds since the epoch,
+  // or -1 if it isn't known.
+  Goffset modificationTime() const;
   
   static GooFile *open(const GooString *fileName);
   
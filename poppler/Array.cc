@@ -46,6 +46,18 @@
 
 Array::Array(XRef *xrefA) {
   xref = xrefA;
+  arena = NULL;
+  elems = NULL;
+  size = length = 0;
+  ref = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+Array::Array(XRef *xrefA, GooArena *arenaA) {
+  xref = xrefA;
+  arena = arenaA;
   elems = NULL;
   size = length = 0;
   ref = 1;
@@ -59,7 +71,9 @@ Array::~Array() {
 
   for (i = 0; i < length; ++i)
     elems[i].free();
-  gfree(elems);
+  if (!arena) {
+    gfree(elems);
+  }
 #if MULTITHREADED
   gDestroyMutex(&mutex);
 #endif
@@ -95,7 +109,15 @@ void Array::add(Object *elem) {
     } else {
       size *= 2;
     }
-    elems = (Object *)greallocn(elems, size, sizeof(Object));
+    if (arena) {
+      Object *newElems = (Object *)arena->alloc(size * sizeof(Object));
+      if (length > 0) {
+	memcpy(newElems, elems, length * sizeof(Object));
+      }
+      elems = newElems;
+    } else {
+      elems = (Object *)greallocn(elems, size, sizeof(Object));
+    }
   }
   elems[length] = *elem;
   ++length;
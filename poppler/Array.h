@@ -45,6 +45,10 @@ public:
   // Constructor.
   Array(XRef *xrefA);
 
+  // Construct an array whose elements are allocated in <arenaA>.  The
+  // Array itself must be allocated there too, see Object::initArray.
+  Array(XRef *xrefA, GooArena *arenaA);
+
   // Destructor.
   ~Array();
 
@@ -55,6 +59,8 @@ public:
   // Get number of elements.
   int getLength() { return length; }
 
+  XRef *getXRef() { return xref; }
+
   // Copy array with new xref
   Object *copy(XRef *xrefA, Object *obj);
 
@@ -72,6 +78,7 @@ public:
 private:
 
   XRef *xref;			// the xref table for this PDF file
+  GooArena *arena;		// arena holding <elems>, or NULL
   Object *elems;		// array of elements
   int size;			// size of <elems> array
   int length;			// number of elements in array
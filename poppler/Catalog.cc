@@ -63,6 +63,7 @@
 #include "ViewerPreferences.h"
 #include "FileSpec.h"
 #include "StructTreeRoot.h"
+#include "DocIndex.h"
 
 #if MULTITHREADED
 #  define catalogLocker()   MutexLocker locker(&mutex)
@@ -104,6 +105,12 @@ Catalog::Catalog(PDFDoc *docA) {
   pagesRefList = NULL;
   attrsList = NULL;
   kidsIdxList = NULL;
+  nodeIdxList = NULL;
+  nodeRefs = NULL;
+  nodeParents = NULL;
+  pageNodes = NULL;
+  nodeAttrs = NULL;
+  recordPageTree = gFalse;
   lastCachedPage = 0;
   markInfo = markInfoNull;
 
@@ -149,6 +156,11 @@ Catalog::Catalog(PDFDoc *docA) {
 
 Catalog::~Catalog() {
   delete kidsIdxList;
+  dropPageTreeIndex();
+  delete nodeIdxList;
+  delete nodeRefs;
+  delete nodeParents;
+  delete pageNodes;
   if (attrsList) {
     std::vector<PageAttrs *>::iterator it;
     for (it = attrsList->begin() ; it != attrsList->end(); ++it ) {
@@ -237,6 +249,17 @@ Page *Catalog::getPage(int i)
   if (i < 1) return NULL;
 
   catalogLocker();
+  if (nodeAttrs) {
+    if (i > pagesSize) return NULL;
+    if (!pages[i-1]) {
+      pages[i-1] = makeIndexedPage(i);
+    }
+    if (pages[i-1]) {
+      return pages[i-1];
+    }
+    error(errSyntaxWarning, -1, "Page tree index doesn't match the file");
+    dropPageTreeIndex();
+  }
   if (i > lastCachedPage) {
      GBool cached = cachePageTree(i);
      if ( cached == gFalse) {
@@ -251,6 +274,9 @@ Ref *Catalog::getPageRef(int i)
   if (i < 1) return NULL;
 
   catalogLocker();
+  if (nodeAttrs) {
+    return i <= pagesSize ? &pageRefs[i-1] : NULL;
+  }
   if (i > lastCachedPage) {
      GBool cached = cachePageTree(i);
      if ( cached == gFalse) {
@@ -306,19 +332,26 @@ GBool Catalog::cachePageTree(int page)
       return gFalse;
     }
 
-    pagesSize = getNumPages();
-    pages = (Page **)gmallocn_checkoverflow(pagesSize, sizeof(Page *));
-    pageRefs = (Ref *)gmallocn_checkoverflow(pagesSize, sizeof(Ref));
-    if (pages == NULL || pageRefs == NULL ) {
-      error(errSyntaxError, -1, "Cannot allocate page cache");
-      pagesDict->decRef();
-      pagesSize = 0;
-      return gFalse;
-    }
-    for (int i = 0; i < pagesSize; ++i) {
-      pages[i] = NULL;
-      pageRefs[i].num = -1;
-      pageRefs[i].gen = -1;
+    // the arrays are already there if an index was dropped
+    if (!pages) {
+      pagesSize = getNumPages();
+      pages = (Page **)gmallocn_checkoverflow(pagesSize, sizeof(Page *));
+      pageRefs = (Ref *)gmallocn_checkoverflow(pagesSize, sizeof(Ref));
+      if (pages == NULL || pageRefs == NULL ) {
+        error(errSyntaxError, -1, "Cannot allocate page cache");
+        pagesDict->decRef();
+        gfree(pages);
+        gfree(pageRefs);
+        pages = NULL;
+        pageRefs = NULL;
+        pagesSize = 0;
+        return gFalse;
+      }
+      for (int i = 0; i < pagesSize; ++i) {
+        pages[i] = NULL;
+        pageRefs[i].num = -1;
+        pageRefs[i].gen = -1;
+      }
     }
 
     pagesList = new std::vector<Dict *>();
@@ -329,6 +362,15 @@ GBool Catalog::cachePageTree(int page)
     attrsList->push_back(new PageAttrs(NULL, pagesDict));
     kidsIdxList = new std::vector<int>();
     kidsIdxList->push_back(0);
+    if (recordPageTree) {
+      nodeIdxList = new std::vector<int>();
+      nodeIdxList->push_back(0);
+      nodeRefs = new std::vector<Ref>();
+      nodeRefs->push_back(pagesRef);
+      nodeParents = new std::vector<int>();
+      nodeParents->push_back(-1);
+      pageNodes = new std::vector<int>(pagesSize, -1);
+    }
     lastCachedPage = 0;
 
   }
@@ -359,6 +401,9 @@ GBool Catalog::cachePageTree(int page)
        delete attrsList->back();
        attrsList->pop_back();
        kidsIdxList->pop_back();
+       if (nodeIdxList) {
+         nodeIdxList->pop_back();
+       }
        if (!kidsIdxList->empty()) kidsIdxList->back()++;
        kids.free();
        continue;
@@ -411,9 +456,22 @@ GBool Catalog::cachePageTree(int page)
         return gFalse;
       }
 
+      if (pages[lastCachedPage]) {
+        // made from a dropped index
+        if (pageRefs[lastCachedPage].num == kidRef.getRefNum() &&
+            pageRefs[lastCachedPage].gen == kidRef.getRefGen()) {
+          delete p;
+          p = pages[lastCachedPage];
+        } else {
+          delete pages[lastCachedPage];
+        }
+      }
       pages[lastCachedPage] = p;
       pageRefs[lastCachedPage].num = kidRef.getRefNum();
       pageRefs[lastCachedPage].gen = kidRef.getRefGen();
+      if (pageNodes) {
+        (*pageNodes)[lastCachedPage] = nodeIdxList->back();
+      }
 
       lastCachedPage++;
       kidsIdxList->back()++;
@@ -426,6 +484,11 @@ GBool Catalog::cachePageTree(int page)
       kid.getDict()->incRef();
       pagesList->push_back(kid.getDict());
       kidsIdxList->push_back(0);
+      if (nodeRefs) {
+        nodeParents->push_back(nodeIdxList->back());
+        nodeIdxList->push_back((int)nodeRefs->size());
+        nodeRefs->push_back(kidRef.getRef());
+      }
     } else {
       error(errSyntaxError, -1, "Kid object (page {0:d}) is wrong type ({1:s})",
             lastCachedPage+1, kid.getTypeName());
@@ -439,6 +502,151 @@ GBool Catalog::cachePageTree(int page)
   return gFalse;
 }
 
+GBool Catalog::storePageTreeIndex(DocIndex *index)
+{
+  int n;
+
+  catalogLocker();
+  index->numPages = 0;
+  if (nodeAttrs) {
+    return gFalse;
+  }
+  // the Pages nodes are only recorded if the walk starts from here
+  if (!pagesList) {
+    recordPageTree = gTrue;
+  }
+  n = getNumPages();
+  if (n <= 0 || !cachePageTree(n) || !nodeRefs || lastCachedPage != n) {
+    return gFalse;
+  }
+  for (int i = 0; i < n; ++i) {
+    if ((*pageNodes)[i] < 0) {
+      return gFalse;
+    }
+  }
+  index->nodeRefs = *nodeRefs;
+  index->nodeParents = *nodeParents;
+  index->pageRefs.assign(pageRefs, pageRefs + n);
+  index->pageNodes.assign(pageNodes->begin(), pageNodes->begin() + n);
+  index->numPages = n;
+  return gTrue;
+}
+
+GBool Catalog::loadPageTreeIndex(DocIndex *index)
+{
+  Object catDict, pagesRef;
+  GBool match;
+
+  catalogLocker();
+  if (!index->hasPageTree() || pages || pagesList) {
+    return gFalse;
+  }
+
+  // the root of the tree has to be the catalog's Pages dict
+  xref->getCatalog(&catDict);
+  match = catDict.isDict() &&
+          catDict.dictLookupNF("Pages", &pagesRef)->isRef() &&
+          pagesRef.getRefNum() == index->nodeRefs[0].num &&
+          pagesRef.getRefGen() == index->nodeRefs[0].gen;
+  pagesRef.free();
+  catDict.free();
+  if (!match || getNumPages() != index->numPages || pages) {
+    return gFalse;
+  }
+
+  pagesSize = numPages;
+  pages = (Page **)gmallocn_checkoverflow(pagesSize, sizeof(Page *));
+  pageRefs = (Ref *)gmallocn_checkoverflow(pagesSize, sizeof(Ref));
+  if (pages == NULL || pageRefs == NULL) {
+    gfree(pages);
+    gfree(pageRefs);
+    pages = NULL;
+    pageRefs = NULL;
+    pagesSize = 0;
+    return gFalse;
+  }
+  for (int i = 0; i < pagesSize; ++i) {
+    pages[i] = NULL;
+    pageRefs[i] = index->pageRefs[i];
+  }
+  nodeRefs = new std::vector<Ref>(index->nodeRefs);
+  nodeParents = new std::vector<int>(index->nodeParents);
+  pageNodes = new std::vector<int>(index->pageNodes);
+  nodeAttrs = new std::vector<PageAttrs *>(nodeRefs->size(), (PageAttrs *)NULL);
+  return gTrue;
+}
+
+// Create page <i> of an indexed page tree, with the attributes it
+// would have inherited in a tree walk.
+Page *Catalog::makeIndexedPage(int i)
+{
+  PageAttrs *attrs;
+  Object kid;
+  Page *p;
+
+  if (!(attrs = getIndexedNodeAttrs((*pageNodes)[i-1]))) {
+    return NULL;
+  }
+  xref->fetch(pageRefs[i-1].num, pageRefs[i-1].gen, &kid);
+  if (!kid.isDict("Page") && !(kid.isDict() && !kid.getDict()->hasKey("Kids"))) {
+    kid.free();
+    return NULL;
+  }
+  p = new Page(doc, i, kid.getDict(), pageRefs[i-1],
+               new PageAttrs(attrs, kid.getDict()), form);
+  kid.free();
+  if (!p->isOk()) {
+    delete p;
+    return NULL;
+  }
+  return p;
+}
+
+PageAttrs *Catalog::getIndexedNodeAttrs(int node)
+{
+  std::vector<int> chain;
+  PageAttrs *attrs;
+  Object obj;
+
+  // parents come before their children, so this ends at the root
+  while (node >= 0 && !(*nodeAttrs)[node]) {
+    chain.push_back(node);
+    node = (*nodeParents)[node];
+  }
+  attrs = node >= 0 ? (*nodeAttrs)[node] : (PageAttrs *)NULL;
+  while (!chain.empty()) {
+    node = chain.back();
+    chain.pop_back();
+    xref->fetch((*nodeRefs)[node].num, (*nodeRefs)[node].gen, &obj);
+    if (!obj.isDict()) {
+      obj.free();
+      return NULL;
+    }
+    attrs = new PageAttrs(attrs, obj.getDict());
+    (*nodeAttrs)[node] = attrs;
+    obj.free();
+  }
+  return attrs;
+}
+
+void Catalog::dropPageTreeIndex()
+{
+  if (!nodeAttrs) {
+    return;
+  }
+  for (size_t i = 0; i < nodeAttrs->size(); ++i) {
+    delete (*nodeAttrs)[i];
+  }
+  delete nodeAttrs;
+  nodeAttrs = NULL;
+  delete nodeRefs;
+  nodeRefs = NULL;
+  delete nodeParents;
+  nodeParents = NULL;
+  delete pageNodes;
+  pageNodes = NULL;
+}
+
 int Catalog::findPage(int num, int gen) {
   int i;
 
@@ -59,6 +59,7 @@ class OCGs;
 class ViewerPreferences;
 class FileSpec;
 class StructTreeRoot;
+class DocIndex;
 
 //------------------------------------------------------------------------
 // NameTree
@@ -122,6 +123,19 @@ public:
   // Get the reference for a page object.
   Ref *getPageRef(int i);
 
+  // Walk the whole page tree and store it in <index>.  Returns false
+  // if the page tree can't be indexed, which includes the case where
+  // pages were already looked up (the walk doesn't record the tree
+  // unless it is started from here).
+  GBool storePageTreeIndex(DocIndex *index);
+
+  // Take the page tree from <index> instead of walking it.  Returns
+  // false if the index has no page tree or it doesn't match.
+  GBool loadPageTreeIndex(DocIndex *index);
+
+  // Was the page tree taken from an index?
+  GBool hasPageTreeIndex() { return nodeAttrs != NULL; }
+
   // Return base URI, or NULL if none.
   GooString *getBaseURI() { return baseURI; }
 
@@ -252,6 +266,15 @@ private:
   std::vector<Ref> *pagesRefList;
   std::vector<PageAttrs *> *attrsList;
   std::vector<int> *kidsIdxList;
+  std::vector<int> *nodeIdxList;	// Pages node of each pagesList entry
+  std::vector<Ref> *nodeRefs;	// Pages nodes seen, in tree walk order
+  std::vector<int> *nodeParents;	// parent node of each Pages node
+  std::vector<int> *pageNodes;	// parent node of each page
+  std::vector<PageAttrs *> *nodeAttrs; // attributes of each Pages node,
+				//   only when the tree came from an index
+  GBool recordPageTree;		// record nodeRefs, nodeParents and
+				//   pageNodes in the tree walk, to
+				//   store them in an index
   Form *form;
   ViewerPreferences *viewerPrefs;
   int numPages;			// number of pages
@@ -276,6 +299,9 @@ private:
   Object additionalActions;     // page additional actions
 
   GBool cachePageTree(int page); // Cache first <page> pages.
+  Page *makeIndexedPage(int i);
+  PageAttrs *getIndexedNodeAttrs(int node);
+  void dropPageTreeIndex();
   Object *findDestInTree(Object *tree, GooString *name, Object *obj);
 
   Object *getNames();
@@ -0,0 +1,129 @@
+//========================================================================
+//
+// ContentOps.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <string.h>
+#include "NameTable.h"
+#include "ContentOps.h"
+
+//------------------------------------------------------------------------
+// perfect hash
+//
+// Operator names are 1 to 3 bytes long, so a name is packed into an
+// integer (first byte in the low bits), and a multiplicative hash of
+// that maps every operator to its own slot of a 256-slot table.  A
+// lookup is a hash, a table load and an integer compare.
+//------------------------------------------------------------------------
+
+#define contentOpHashSlots 256
+#define contentOpHashMul 0xceaec73du
+
+static constexpr unsigned int packOpName(const char *s) {
+  return (unsigned char)s[0] |
+         (s[0] ? ((unsigned int)(unsigned char)s[1] << 8) |
+	         (s[1] ? (unsigned int)(unsigned char)s[2] << 16 : 0u)
+	       : 0u);
+}
+
+static constexpr unsigned int hashOp(unsigned int key) {
+  return ((key * contentOpHashMul) & 0xffffffffu) >> 24;
+}
+
+static constexpr unsigned int contentOpKeys[numContentOps] = {
+#define CONTENT_OP_KEY(id, str) packOpName(str),
+  CONTENT_OPS(CONTENT_OP_KEY)
+#undef CONTENT_OP_KEY
+};
+
+static constexpr const char *contentOpStrs[numContentOps] = {
+#define CONTENT_OP_STR(id, str) str,
+  CONTENT_OPS(CONTENT_OP_STR)
+#undef CONTENT_OP_STR
+};
+
+// Check the hash at compile time.
+static constexpr bool hashDiffers(int i, int j) {
+  return j >= numContentOps ||
+         (hashOp(contentOpKeys[i]) != hashOp(contentOpKeys[j]) &&
+	  hashDiffers(i, j + 1));
+}
+
+static constexpr bool hashIsPerfect(int i) {
+  return i >= numContentOps || (hashDiffers(i, i + 1) && hashIsPerfect(i + 1));
+}
+
+static_assert(hashIsPerfect(0), "content operator hash has collisions");
+
+// Check that the operators are in strcmp order, as Gfx::opTab is.
+static constexpr bool nameLess(const char *s1, const char *s2) {
+  return *s1 == *s2 ? *s1 && nameLess(s1 + 1, s2 + 1)
+                    : (unsigned char)*s1 < (unsigned char)*s2;
+}
+
+static constexpr bool opsSorted(int i) {
+  return i + 1 >= numContentOps ||
+         (nameLess(contentOpStrs[i], contentOpStrs[i + 1]) && opsSorted(i + 1));
+}
+
+static_assert(opsSorted(0), "content operators are not sorted");
+
+class ContentOpIndex {
+public:
+
+  ContentOpIndex() {
+    int i;
+
+    memset(slots, contentOpNone, sizeof(slots));
+    for (i = 0; i < numContentOps; ++i) {
+      slots[hashOp(contentOpKeys[i])] = (unsigned char)i;
+    }
+  }
+
+  unsigned char slots[contentOpHashSlots];
+};
+
+static_assert(numContentOps < 256, "too many content operators");
+
+//------------------------------------------------------------------------
+
+static const char *const contentOpNames[numContentOps] = {
+#define CONTENT_OP_NAME(id, str) knownNames.id,
+  CONTENT_OPS(CONTENT_OP_NAME)
+#undef CONTENT_OP_NAME
+};
+
+ContentOp lookupContentOp(const char *s, int length) {
+  static ContentOpIndex index;
+  unsigned int key;
+  int op;
+
+  switch (length) {
+  case 1:
+    key = (unsigned char)s[0];
+    break;
+  case 2:
+    key = (unsigned char)s[0] | ((unsigned char)s[1] << 8);
+    break;
+  case 3:
+    key = (unsigned char)s[0] | ((unsigned char)s[1] << 8) |
+          ((unsigned int)(unsigned char)s[2] << 16);
+    break;
+  default:
+    return contentOpNone;
+  }
+  op = index.slots[hashOp(key)];
+  if (op == contentOpNone || contentOpKeys[op] != key) {
+    return contentOpNone;
+  }
+  return (ContentOp)op;
+}
+
+const char *getContentOpName(ContentOp op) {
+  return contentOpNames[op];
+}
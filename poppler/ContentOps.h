@@ -0,0 +1,54 @@
+//========================================================================
+//
+// ContentOps.h
+//
+// Content stream operators.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef CONTENTOPS_H
+#define CONTENTOPS_H
+
+//------------------------------------------------------------------------
+// ContentOp
+//
+// The Lexer classifies the command tokens it reads, so Gfx can index
+// its operator table with the ContentOp of a command instead of looking
+// the command up by name.  The operators are listed in strcmp order of
+// their names, which is the order of Gfx::opTab; the ids are those of
+// the operators in KNOWN_NAMES (NameTable.h).
+//------------------------------------------------------------------------
+
+#define CONTENT_OPS(X)							\
+  X(doubleQuote, "\"") X(quote, "'") X(B, "B") X(BStar, "B*")		\
+  X(BDC, "BDC") X(BI, "BI") X(BMC, "BMC") X(BT, "BT") X(BX, "BX")	\
+  X(CS, "CS") X(DP, "DP") X(Do, "Do") X(EI, "EI") X(EMC, "EMC")		\
+  X(ET, "ET") X(EX, "EX") X(F, "F") X(G, "G") X(ID, "ID") X(J, "J")	\
+  X(K, "K") X(M, "M") X(MP, "MP") X(Q, "Q") X(RG, "RG") X(S, "S")	\
+  X(SC, "SC") X(SCN, "SCN") X(TStar, "T*") X(TD, "TD") X(TJ, "TJ")	\
+  X(TL, "TL") X(Tc, "Tc") X(Td, "Td") X(Tf, "Tf") X(Tj, "Tj")		\
+  X(Tm, "Tm") X(Tr, "Tr") X(Ts, "Ts") X(Tw, "Tw") X(Tz, "Tz")		\
+  X(W, "W") X(WStar, "W*") X(b, "b") X(bStar, "b*") X(c, "c")		\
+  X(cm, "cm") X(cs, "cs") X(d, "d") X(d0, "d0") X(d1, "d1") X(f, "f")	\
+  X(fStar, "f*") X(g, "g") X(gs, "gs") X(h, "h") X(i, "i") X(j, "j")	\
+  X(k, "k") X(l, "l") X(m, "m") X(n, "n") X(q, "q") X(re, "re")		\
+  X(rg, "rg") X(ri, "ri") X(s, "s") X(sc, "sc") X(scn, "scn")		\
+  X(sh, "sh") X(v, "v") X(w, "w") X(y, "y")
+
+enum ContentOp {
+#define CONTENT_OP_ENUM(id, str) contentOp_##id,
+  CONTENT_OPS(CONTENT_OP_ENUM)
+#undef CONTENT_OP_ENUM
+  numContentOps,
+  contentOpNone = numContentOps	// not a content stream operator
+};
+
+// Classify the command token <s>, of <length> bytes.
+ContentOp lookupContentOp(const char *s, int length);
+
+// The name of <op>, which is an interned known name.
+const char *getContentOpName(ContentOp op);
+
+#endif
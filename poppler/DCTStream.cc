@@ -63,6 +63,7 @@ static void str_term_source(j_decompress_ptr cinfo)
 DCTStream::DCTStream(Stream *strA, int colorXformA, Object *dict, int recursion) :
   FilterStream(strA) {
   colorXform = colorXformA;
+  decodeScale = 1;
   if (dict != NULL) {
     Object obj;
 
@@ -191,6 +192,9 @@ void DCTStream::reset() {
 	break;
       }
 
+      cinfo.scale_num = 1;
+      cinfo.scale_denom = decodeScale;
+
       jpeg_start_decompress(&cinfo);
 
       row_stride = cinfo.output_width * cinfo.output_components;
@@ -248,6 +252,20 @@ int DCTStream::lookChar() {
   return *current;
 }
 
+int DCTStream::setDecodeScale(int scale) {
+  // libjpeg can scale by 1/2, 1/4, and 1/8 (as part of the IDCT)
+  if (scale >= 8) {
+    decodeScale = 8;
+  } else if (scale >= 4) {
+    decodeScale = 4;
+  } else if (scale >= 2) {
+    decodeScale = 2;
+  } else {
+    decodeScale = 1;
+  }
+  return decodeScale;
+}
+
 GooString *DCTStream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
 
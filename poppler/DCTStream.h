@@ -72,6 +72,7 @@ public:
   virtual int lookChar();
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
+  virtual int setDecodeScale(int scale);
 
 private:
   void init();
@@ -80,6 +81,7 @@ private:
   virtual int getChars(int nChars, Guchar *buffer);
 
   int colorXform;
+  int decodeScale;
   JSAMPLE *current;
   JSAMPLE *limit;
   struct jpeg_decompress_struct cinfo;
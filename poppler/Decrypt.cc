@@ -568,6 +568,35 @@ int DecryptStream::lookChar() {
   return (nextCharBuff = c);
 }
 
+int DecryptStream::getChars(int nChars, Guchar *buffer) {
+  int n, m, c;
+
+  n = 0;
+  if (algo == cryptRC4) {
+    if (nextCharBuff != EOF && nChars > 0) {
+      buffer[n++] = (Guchar)nextCharBuff;
+      nextCharBuff = EOF;
+    }
+    // RC4 works a byte at a time, so the block can be read straight
+    // from the underlying stream and decrypted in place
+    m = str->doGetChars(nChars - n, buffer + n);
+    for (; m > 0; --m, ++n) {
+      buffer[n] = rc4DecryptByte(state.rc4.state, &state.rc4.x, &state.rc4.y,
+				 buffer[n]);
+    }
+  } else {
+    for (; n < nChars; ++n) {
+      if ((c = DecryptStream::lookChar()) == EOF) {
+	break;
+      }
+      nextCharBuff = EOF;
+      buffer[n] = (Guchar)c;
+    }
+  }
+  charactersRead += n;
+  return n;
+}
+
 //------------------------------------------------------------------------
 // RC4-compatible decryption
 //------------------------------------------------------------------------
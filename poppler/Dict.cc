@@ -33,7 +33,6 @@
 #pragma implementation
 #endif
 
-#include <algorithm>
 #include <stddef.h>
 #include <string.h>
 #include "goo/gmem.h"
@@ -50,37 +49,53 @@
 // Dict
 //------------------------------------------------------------------------
 
-static const int SORT_LENGTH_LOWER_LIMIT = 32;
+// Dictionaries with at least this many entries get a hash index.
+static const int HASH_LENGTH_LOWER_LIMIT = 32;
 
-static inline bool cmpDictEntries(const DictEntry &e1, const DictEntry &e2)
-{
-  return strcmp(e1.key, e2.key) < 0;
+static inline unsigned int hashKey(const char *key) {
+  unsigned int h;
+
+  h = 2166136261u;
+  for (; *key; ++key) {
+    h ^= (unsigned char)*key;
+    h *= 16777619u;
+  }
+  return h;
 }
 
-static int binarySearch(const char *key, DictEntry *entries, int length)
-{
-  int first = 0;
-  int end = length - 1;
-  while (first <= end) {
-    const int middle = (first + end) / 2;
-    const int res = strcmp(key, entries[middle].key);
-    if (res == 0) {
-      return middle;
-    } else if (res < 0) {
-      end = middle - 1;
-    } else {
-      first = middle + 1;
-    }
+// Smallest hash index size that keeps the load factor of a dictionary
+// with <length> entries at or below 1/2.
+static inline int hashSizeFor(int length) {
+  int hashSizeA;
+
+  hashSizeA = 2 * HASH_LENGTH_LOWER_LIMIT;
+  while (hashSizeA < 2 * length) {
+    hashSizeA *= 2;
   }
-  return -1;
+  return hashSizeA;
 }
 
 Dict::Dict(XRef *xrefA) {
   xref = xrefA;
+  arena = NULL;
+  entries = NULL;
+  size = length = 0;
+  ref = 1;
+  hashTab = NULL;
+  hashSize = 0;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+Dict::Dict(XRef *xrefA, GooArena *arenaA) {
+  xref = xrefA;
+  arena = arenaA;
   entries = NULL;
   size = length = 0;
   ref = 1;
-  sorted = gFalse;
+  hashTab = NULL;
+  hashSize = 0;
 #if MULTITHREADED
   gInitMutex(&mutex);
 #endif
@@ -88,18 +103,25 @@ Dict::Dict(XRef *xrefA) {
 
 Dict::Dict(Dict* dictA) {
   xref = dictA->xref;
+  arena = NULL;
   size = length = dictA->length;
   ref = 1;
+  hashTab = NULL;
+  hashSize = 0;
 #if MULTITHREADED
   gInitMutex(&mutex);
 #endif
 
-  sorted = dictA->sorted;
   entries = (DictEntry *)gmallocn(size, sizeof(DictEntry));
   for (int i=0; i<length; i++) {
-    entries[i].key = copyString(dictA->entries[i].key);
+    entries[i].key = isInternedName(dictA->entries[i].key)
+                       ? dictA->entries[i].key
+                       : copyString(dictA->entries[i].key);
     dictA->entries[i].val.copy(&entries[i].val);
   }
+  if (length >= HASH_LENGTH_LOWER_LIMIT) {
+    buildHashTab(hashSizeFor(length));
+  }
 }
 
 Dict *Dict::copy(XRef *xrefA) {
@@ -123,10 +145,15 @@ Dict::~Dict() {
   int i;
 
   for (i = 0; i < length; ++i) {
-    gfree(entries[i].key);
+    if (!arena) {
+      freeName(entries[i].key);
+    }
     entries[i].val.free();
   }
-  gfree(entries);
+  if (!arena) {
+    gfree(entries);
+    gfree(hashTab);
+  }
 #if MULTITHREADED
   gDestroyMutex(&mutex);
 #endif
@@ -144,46 +171,100 @@ int Dict::decRef() {
   return ref;
 }
 
-void Dict::add(char *key, Object *val) {
-  dictLocker();
-  if (sorted) {
-    // We use add on very few occasions so
-    // virtually this will never be hit
-    sorted = gFalse;
+// Rebuild the hash index with <hashSizeA> slots.
+void Dict::buildHashTab(int hashSizeA) {
+  int i;
+
+  if (arena) {
+    // the old index stays in the arena until it is reset
+    hashTab = (int *)arena->alloc(hashSizeA * sizeof(int));
+  } else {
+    gfree(hashTab);
+    hashTab = (int *)gmallocn(hashSizeA, sizeof(int));
+  }
+  hashSize = hashSizeA;
+  memset(hashTab, 0xff, hashSize * sizeof(int));
+  for (i = 0; i < length; ++i) {
+    hashInsert(i);
+  }
+}
+
+// Add entry <i> to the hash index.  If the key is already there, the
+// slot is taken over by the new entry, so that, as with the linear
+// search, the last of several entries with the same key wins.
+void Dict::hashInsert(int i) {
+  int h;
+
+  for (h = hashKey(entries[i].key) & (hashSize - 1);
+       hashTab[h] >= 0;
+       h = (h + 1) & (hashSize - 1)) {
+    if (equalNames(entries[i].key, entries[hashTab[h]].key)) {
+      break;
+    }
   }
+  hashTab[h] = i;
+}
 
+void Dict::add(char *key, Object *val) {
+  dictLocker();
   if (length == size) {
     if (length == 0) {
       size = 8;
     } else {
       size *= 2;
     }
-    entries = (DictEntry *)greallocn(entries, size, sizeof(DictEntry));
+    if (arena) {
+      DictEntry *newEntries =
+	  (DictEntry *)arena->alloc(size * sizeof(DictEntry));
+      if (length > 0) {
+	memcpy(newEntries, entries, length * sizeof(DictEntry));
+      }
+      entries = newEntries;
+    } else {
+      entries = (DictEntry *)greallocn(entries, size, sizeof(DictEntry));
+    }
   }
   entries[length].key = key;
   entries[length].val = *val;
   ++length;
-}
 
-inline DictEntry *Dict::find(const char *key) {
-  if (!sorted && length >= SORT_LENGTH_LOWER_LIMIT)
-  {
-      dictLocker();
-      sorted = gTrue;
-      std::sort(entries, entries+length, cmpDictEntries);
+  // keep the hash index up to date
+  if (hashTab) {
+    if (2 * length > hashSize) {
+      buildHashTab(2 * hashSize);
+    } else {
+      hashInsert(length - 1);
+    }
+  } else if (length >= HASH_LENGTH_LOWER_LIMIT) {
+    buildHashTab(hashSizeFor(length));
   }
+}
 
-  if (sorted) {
-    const int pos = binarySearch(key, entries, length);
-    if (pos != -1) {
-      return &entries[pos];
+inline DictEntry *Dict::find(const char *key) {
+  int h, i;
+
+  if (hashTab) {
+    for (h = hashKey(key) & (hashSize - 1);
+	 (i = hashTab[h]) >= 0;
+	 h = (h + 1) & (hashSize - 1)) {
+      if (equalNames(key, entries[i].key)) {
+	return &entries[i];
+      }
     }
   } else {
-    int i;
-
-    for (i = length - 1; i >=0; --i) {
-      if (!strcmp(key, entries[i].key))
-        return &entries[i];
+    // with an interned key, an interned entry key can only match by
+    // pointer
+    if (isInternedName(key)) {
+      for (i = length - 1; i >=0; --i) {
+        if (key == entries[i].key ||
+            (!isInternedName(entries[i].key) && !strcmp(key, entries[i].key)))
+          return &entries[i];
+      }
+    } else {
+      for (i = length - 1; i >=0; --i) {
+        if (!strcmp(key, entries[i].key))
+          return &entries[i];
+      }
     }
   }
   return NULL;
@@ -195,40 +276,35 @@ GBool Dict::hasKey(const char *key) {
 
 void Dict::remove(const char *key) {
   dictLocker();
-  if (sorted) {
-    const int pos = binarySearch(key, entries, length);
-    if (pos != -1) {
-      length -= 1;
-      gfree(entries[pos].key);
-      entries[pos].val.free();
-      if (pos != length) {
-        memmove(&entries[pos], &entries[pos + 1], (length - pos) * sizeof(DictEntry));
-      }
-    }
-  } else {
-    int i; 
-    bool found = false;
-    DictEntry tmp;
-    if(length == 0) {
-      return;
-    }
+  int i; 
+  bool found = false;
+  DictEntry tmp;
+  if(length == 0) {
+    return;
+  }
 
-    for(i=0; i<length; i++) {
-      if (!strcmp(key, entries[i].key)) {
-        found = true;
-        break;
-      }
-    }
-    if(!found) {
-      return;
+  for(i=0; i<length; i++) {
+    if (equalNames(key, entries[i].key)) {
+      found = true;
+      break;
     }
-    //replace the deleted entry with the last entry
-    gfree(entries[i].key);
-    entries[i].val.free();
-    length -= 1;
-    tmp = entries[length];
-    if (i!=length) //don't copy the last entry if it is deleted 
-      entries[i] = tmp;
+  }
+  if(!found) {
+    return;
+  }
+  //replace the deleted entry with the last entry
+  if (!arena) {
+    freeName(entries[i].key);
+  }
+  entries[i].val.free();
+  length -= 1;
+  tmp = entries[length];
+  if (i!=length) //don't copy the last entry if it is deleted 
+    entries[i] = tmp;
+
+  // entries have moved, so the hash index has to be rebuilt
+  if (hashTab) {
+    buildHashTab(hashSize);
   }
 }
 
@@ -244,7 +320,8 @@ void Dict::set(const char *key, Object *val) {
     e->val.free();
     e->val = *val;
   } else {
-    add (copyString(key), val);
+    const char *p = internName(key);
+    add (p ? (char *)p : arena ? arena->copyString(key) : copyString(key), val);
   }
 }
 
@@ -252,7 +329,7 @@ void Dict::set(const char *key, Object *val) {
 GBool Dict::is(const char *type) {
   DictEntry *e;
 
-  return (e = find("Type")) && e->val.isName(type);
+  return (e = find(knownNames.Type)) && e->val.isName(type);
 }
 
 Object *Dict::lookup(const char *key, Object *obj, int recursion) {
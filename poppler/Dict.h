@@ -51,6 +51,11 @@ public:
   // Constructor.
   Dict(XRef *xrefA);
   Dict(Dict* dictA);
+
+  // Construct a dictionary whose entries and keys are allocated in
+  // <arenaA>.  The Dict itself must be allocated there too, see
+  // Object::initDict.
+  Dict(XRef *xrefA, GooArena *arenaA);
   Dict *copy(XRef *xrefA);
 
   // Destructor.
@@ -63,7 +68,9 @@ public:
   // Get number of entries.
   int getLength() { return length; }
 
-  // Add an entry.  NB: does not copy key.
+  // Add an entry.  NB: does not copy key, which must be an interned
+  // name (see NameTable.h) or have been allocated in the dictionary's
+  // arena, if it has one, or on the heap otherwise.
   void add(char *key, Object *val);
 
   // Update the value of an existing entry, otherwise create it
@@ -91,22 +98,31 @@ public:
   void setXRef(XRef *xrefA) { xref = xrefA; }
   
   XRef *getXRef() { return xref; }
+
+  // Arena holding the entries, or NULL.
+  GooArena *getArena() { return arena; }
   
   GBool hasKey(const char *key);
 
 private:
 
-  GBool sorted;
   XRef *xref;			// the xref table for this PDF file
+  GooArena *arena;		// arena holding <entries> and the keys,
+				//   or NULL
   DictEntry *entries;		// array of entries
   int size;			// size of <entries> array
   int length;			// number of entries in dictionary
   int ref;			// reference count
+  int *hashTab;			// hash index of <entries>, or NULL
+				//   while the dictionary is small
+  int hashSize;			// size of <hashTab> (a power of 2)
 #if MULTITHREADED
   GooMutex mutex;
 #endif
 
   DictEntry *find(const char *key);
+  void buildHashTab(int hashSizeA);
+  void hashInsert(int i);
 };
 
 #endif
@@ -0,0 +1,2022 @@
+//========================================================================
+//
+// DisplayListOutputDev.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "Error.h"
+#include "Object.h"
+#include "Stream.h"
+#include "Function.h"
+#include "GfxState.h"
+#include "GfxFont.h"
+#include "Gfx.h"
+#include "Page.h"
+#include "PDFDoc.h"
+#include "DisplayListOutputDev.h"
+
+//------------------------------------------------------------------------
+// operations
+//------------------------------------------------------------------------
+
+enum DisplayListOp {
+  dlSaveState,
+  dlRestoreState,
+  dlUpdateCTM,			// ctm[6], concat[6]
+  dlUpdateLineDash,		// start, length, dash[length]
+  dlUpdateFlatness,		// flatness
+  dlUpdateLineJoin,		// lineJoin
+  dlUpdateLineCap,		// lineCap
+  dlUpdateMiterLimit,		// miterLimit
+  dlUpdateLineWidth,		// lineWidth
+  dlUpdateStrokeAdjust,		// strokeAdjust
+  dlUpdateAlphaIsShape,		// alphaIsShape
+  dlUpdateTextKnockout,		// textKnockout
+  dlUpdateFillColorSpace,	// colorSpace
+  dlUpdateStrokeColorSpace,	// colorSpace
+  dlUpdateFillColor,		// color
+  dlUpdateStrokeColor,		// color
+  dlUpdateBlendMode,		// groupSetup, blendMode
+  dlUpdateFillOpacity,		// groupSetup, opacity
+  dlUpdateStrokeOpacity,	// groupSetup, opacity
+  dlUpdatePatternOpacity,
+  dlClearPatternOpacity,
+  dlUpdateFillOverprint,	// overprint
+  dlUpdateStrokeOverprint,	// overprint
+  dlUpdateOverprintMode,	// overprintMode
+  dlUpdateTransfer,		// function[4]
+  dlUpdateFillColorStop,	// color, offset
+  dlUpdateFont,			// font, fontSize
+  dlUpdateTextMat,		// textMat[6]
+  dlUpdateCharSpace,		// charSpace
+  dlUpdateRender,		// render
+  dlUpdateRise,			// rise
+  dlUpdateWordSpace,		// wordSpace
+  dlUpdateHorizScaling,		// horizScaling
+  dlUpdateTextPos,		// lineX, lineY
+  dlUpdateTextShift,		// shift
+  dlSaveTextPos,
+  dlRestoreTextPos,
+  dlStroke,			// path
+  dlFill,			// path
+  dlEOFill,			// path
+  dlTilingPatternFill,		// pattern, pmat[6], paintType, tilingType,
+				//   mat[6], bbox[4], x0, y0, x1, y1,
+				//   xStep, yStep
+  dlFunctionShadedFill,		// shading
+  dlAxialShadedFill,		// shading, tMin, tMax
+  dlRadialShadedFill,		// shading, sMin, sMax
+  dlGouraudTriangleShadedFill,	// shading
+  dlPatchMeshShadedFill,	// shading
+  dlClip,			// path
+  dlEOClip,			// path
+  dlClipToStrokePath,		// path
+  dlBeginStringOp,
+  dlEndStringOp,
+  dlBeginString,		// string
+  dlEndString,
+  dlDrawChar,			// x, y, dx, dy, originX, originY, code,
+				//   nBytes, uLen, u[uLen]
+  dlDrawString,			// string
+  dlBeginType3Char,		// x, y, dx, dy, code, uLen, u[uLen]
+  dlEndType3Char,
+  dlBeginTextObject,
+  dlEndTextObject,
+  dlIncCharCount,		// nChars
+  dlBeginActualText,		// string
+  dlEndActualText,
+  dlDrawImageMask,		// image, width, height, invert,
+				//   interpolate, inlineImg
+  dlSetSoftMaskFromImageMask,	// image, width, height, invert,
+				//   inlineImg, baseMatrix[6]
+  dlUnsetSoftMaskFromImageMask,	// baseMatrix[6]
+  dlDrawImage,			// image, width, height, colorMap,
+				//   interpolate, nMaskColors,
+				//   maskColors[nMaskColors], inlineImg
+  dlDrawMaskedImage,		// image, width, height, colorMap,
+				//   interpolate, maskImage, maskWidth,
+				//   maskHeight, maskInvert, maskInterpolate
+  dlDrawSoftMaskedImage,	// image, width, height, colorMap,
+				//   interpolate, maskImage, maskWidth,
+				//   maskHeight, maskColorMap, maskInterpolate
+  dlType3D0,			// wx, wy
+  dlType3D1,			// wx, wy, llx, lly, urx, ury
+  dlCheckTransparencyGroup,	// knockout
+  dlBeginTransparencyGroup,	// bbox[4], blendingColorSpace, isolated,
+				//   knockout, forSoftMask
+  dlEndTransparencyGroup,
+  dlPaintTransparencyGroup,	// bbox[4]
+  dlSetSoftMask,		// bbox[4], alpha, transferFunc,
+				//   hasBackdropColor, backdropColor
+  dlClearSoftMask,		// groupSetup
+  dlSetVectorAntialias,		// vaa
+  dlDump
+};
+
+// Indexes of objects (color spaces, functions, etc.) are ints, with -1
+// for NULL.  Colors are stored without their trailing zero components.
+
+//------------------------------------------------------------------------
+// reading the list
+//------------------------------------------------------------------------
+
+static inline int getByte(Guchar *&p) {
+  return *p++;
+}
+
+static inline int getInt(Guchar *&p) {
+  int x;
+
+  memcpy(&x, p, sizeof(int));
+  p += sizeof(int);
+  return x;
+}
+
+static inline double getDouble(Guchar *&p) {
+  double x;
+
+  memcpy(&x, p, sizeof(double));
+  p += sizeof(double);
+  return x;
+}
+
+static inline void getDoubles(Guchar *&p, double *x, int n) {
+  memcpy(x, p, n * sizeof(double));
+  p += n * sizeof(double);
+}
+
+static inline void getColor(Guchar *&p, GfxColor *color) {
+  int n;
+
+  n = getByte(p);
+  memcpy(color->c, p, n * sizeof(GfxColorComp));
+  memset(color->c + n, 0, (gfxColorMaxComps - n) * sizeof(GfxColorComp));
+  p += n * sizeof(GfxColorComp);
+}
+
+static inline void getUnicode(Guchar *&p, std::vector<Unicode> &u, int uLen) {
+  if ((int)u.size() < uLen) {
+    u.resize(uLen);
+  }
+  if (uLen > 0) {
+    memcpy(&u[0], p, uLen * sizeof(Unicode));
+  }
+  p += uLen * sizeof(Unicode);
+}
+
+// <c> = <a> * <b>
+static void concatMatrices(double *a, double *b, double *c) {
+  c[0] = a[0] * b[0] + a[1] * b[2];
+  c[1] = a[0] * b[1] + a[1] * b[3];
+  c[2] = a[2] * b[0] + a[3] * b[2];
+  c[3] = a[2] * b[1] + a[3] * b[3];
+  c[4] = a[4] * b[0] + a[5] * b[2] + b[4];
+  c[5] = a[4] * b[1] + a[5] * b[3] + b[5];
+}
+
+static GBool invertMatrix(double *m, double *im) {
+  double det;
+
+  det = m[0] * m[3] - m[1] * m[2];
+  if (fabs(det) < 0.000001) {
+    return gFalse;
+  }
+  det = 1 / det;
+  im[0] = m[3] * det;
+  im[1] = -m[1] * det;
+  im[2] = -m[2] * det;
+  im[3] = m[0] * det;
+  im[4] = (m[2] * m[5] - m[3] * m[4]) * det;
+  im[5] = (m[1] * m[4] - m[0] * m[5]) * det;
+  return gTrue;
+}
+
+// Transform <m>, which was recorded with the default CTM of the
+// recording, to the default CTM of the playing Gfx (<toPlay> is the
+// matrix from one to the other).
+static inline void mapMatrix(double *m, GBool map, double *toPlay) {
+  double m1[6];
+
+  if (map) {
+    concatMatrices(m, toPlay, m1);
+    memcpy(m, m1, sizeof(m1));
+  }
+}
+
+// Compute the range of cells of a tiling pattern that cover the clip
+// region of <state>, as Gfx::doTilingPatternFill does.  <mat> is the
+// matrix from pattern space to user space.  Returns false if the clip
+// region is empty.
+static GBool getTilingRange(GfxState *state, double *mat, double *bbox,
+			    double xStep, double yStep,
+			    int *x0, int *y0, int *x1, int *y1) {
+  double m1[6], imb[6];
+  double cxMin, cyMin, cxMax, cyMax, xMin, yMin, xMax, yMax, cx, cy, x, y;
+  int i;
+
+  concatMatrices(mat, state->getCTM(), m1);
+  if (!invertMatrix(m1, imb)) {
+    return gFalse;
+  }
+  state->getClipBBox(&cxMin, &cyMin, &cxMax, &cyMax);
+  if (cxMin > cxMax || cyMin > cyMax) {
+    return gFalse;
+  }
+  xMin = yMin = xMax = yMax = 0; // make gcc happy
+  for (i = 0; i < 4; ++i) {
+    cx = (i & 1) ? cxMax : cxMin;
+    cy = (i & 2) ? cyMax : cyMin;
+    x = cx * imb[0] + cy * imb[2] + imb[4];
+    y = cx * imb[1] + cy * imb[3] + imb[5];
+    if (i == 0) {
+      xMin = xMax = x;
+      yMin = yMax = y;
+    } else {
+      if (x < xMin) {
+	xMin = x;
+      } else if (x > xMax) {
+	xMax = x;
+      }
+      if (y < yMin) {
+	yMin = y;
+      } else if (y > yMax) {
+	yMax = y;
+      }
+    }
+  }
+  if (bbox[0] < bbox[2]) {
+    *x0 = (int)ceil((xMin - bbox[2]) / xStep);
+    *x1 = (int)floor((xMax - bbox[0]) / xStep) + 1;
+  } else {
+    *x0 = (int)ceil((xMin - bbox[0]) / xStep);
+    *x1 = (int)floor((xMax - bbox[2]) / xStep) + 1;
+  }
+  if (bbox[1] < bbox[3]) {
+    *y0 = (int)ceil((yMin - bbox[3]) / yStep);
+    *y1 = (int)floor((yMax - bbox[1]) / yStep) + 1;
+  } else {
+    *y0 = (int)ceil((yMin - bbox[1]) / yStep);
+    *y1 = (int)floor((yMax - bbox[3]) / yStep) + 1;
+  }
+  return gTrue;
+}
+
+// Size of the data of an image, as read by ImageStream, or -1 if it is
+// too big.
+static int getImageSize(int width, int height, int nComps, int nBits) {
+  long long lineSize, size;
+
+  if (width <= 0 || height <= 0) {
+    return 0;
+  }
+  lineSize = ((long long)width * nComps * nBits + 7) / 8;
+  size = lineSize * height;
+  if (size > INT_MAX) {
+    return -1;
+  }
+  return (int)size;
+}
+
+static Stream *makeImageStream(DisplayListImage *image, XRef *xref) {
+  Object dictObj;
+
+  dictObj.initDict(xref);
+  return new MemStream((char *)image->data, 0, image->size, &dictObj);
+}
+
+//------------------------------------------------------------------------
+// DisplayList
+//------------------------------------------------------------------------
+
+DisplayList::DisplayList(PDFDoc *docA, int pageNumA, double *baseCTMA) {
+  int i;
+
+  doc = docA;
+  pageNum = pageNumA;
+  for (i = 0; i < 6; ++i) {
+    baseCTM[i] = baseCTMA[i];
+  }
+  nOps = 0;
+  for (i = 0; i < 3; ++i) {
+    deviceColorSpaces[i] = -1;
+  }
+}
+
+DisplayList::~DisplayList() {
+  size_t i;
+
+  for (i = 0; i < paths.size(); ++i) {
+    delete paths[i];
+  }
+  for (i = 0; i < colorSpaces.size(); ++i) {
+    delete colorSpaces[i];
+  }
+  for (i = 0; i < colorMaps.size(); ++i) {
+    delete colorMaps[i];
+  }
+  for (i = 0; i < shadings.size(); ++i) {
+    delete shadings[i];
+  }
+  for (i = 0; i < fonts.size(); ++i) {
+    fonts[i]->decRefCnt();
+  }
+  for (i = 0; i < strings.size(); ++i) {
+    delete strings[i];
+  }
+  for (i = 0; i < functions.size(); ++i) {
+    delete functions[i];
+  }
+  for (i = 0; i < images.size(); ++i) {
+    gfree(images[i].data);
+  }
+  for (i = 0; i < patterns.size(); ++i) {
+    patterns[i].str.free();
+    if (patterns[i].resDict && !patterns[i].resDict->decRef()) {
+      delete patterns[i].resDict;
+    }
+  }
+}
+
+long DisplayList::getSize() {
+  long size;
+  size_t i;
+
+  size = sizeof(DisplayList) + code.capacity();
+  for (i = 0; i < paths.size(); ++i) {
+    size += sizeof(GfxPath);
+    for (int j = 0; j < paths[i]->getNumSubpaths(); ++j) {
+      size += sizeof(GfxSubpath) +
+	      paths[i]->getSubpath(j)->getNumPoints() *
+	        (2 * sizeof(double) + sizeof(GBool));
+    }
+  }
+  for (i = 0; i < images.size(); ++i) {
+    size += images[i].size;
+  }
+  size += strings.size() * sizeof(GooString) +
+	  colorSpaces.size() * sizeof(GfxColorSpace) +
+	  colorMaps.size() * sizeof(GfxImageColorMap);
+  return size;
+}
+
+void DisplayList::putOp(int op) {
+  code.push_back((Guchar)op);
+  ++nOps;
+}
+
+void DisplayList::putInt(int x) {
+  Guchar buf[sizeof(int)];
+
+  memcpy(buf, &x, sizeof(int));
+  code.insert(code.end(), buf, buf + sizeof(int));
+}
+
+void DisplayList::putDouble(double x) {
+  Guchar buf[sizeof(double)];
+
+  memcpy(buf, &x, sizeof(double));
+  code.insert(code.end(), buf, buf + sizeof(double));
+}
+
+void DisplayList::putDoubles(double *x, int n) {
+  code.insert(code.end(), (Guchar *)x, (Guchar *)(x + n));
+}
+
+void DisplayList::putColor(GfxColor *color) {
+  int n;
+
+  n = gfxColorMaxComps;
+  while (n > 0 && color->c[n - 1] == 0) {
+    --n;
+  }
+  putByte(n);
+  code.insert(code.end(), (Guchar *)color->c, (Guchar *)(color->c + n));
+}
+
+int DisplayList::addPath(GfxPath *path) {
+  paths.push_back(path->copy());
+  return (int)paths.size() - 1;
+}
+
+int DisplayList::addColorSpace(GfxColorSpace *colorSpace) {
+  int mode, *idx;
+
+  if (!colorSpace) {
+    return -1;
+  }
+  // the device color spaces have no parameters, so one of each will do
+  mode = colorSpace->getMode();
+  idx = NULL;
+  if (mode == csDeviceGray || mode == csDeviceRGB || mode == csDeviceCMYK) {
+    idx = &deviceColorSpaces[mode == csDeviceGray ? 0 :
+			     mode == csDeviceRGB ? 1 : 2];
+    if (*idx >= 0) {
+      return *idx;
+    }
+  }
+  colorSpaces.push_back(colorSpace->copy());
+  if (idx) {
+    *idx = (int)colorSpaces.size() - 1;
+  }
+  return (int)colorSpaces.size() - 1;
+}
+
+int DisplayList::addColorMap(GfxImageColorMap *colorMap) {
+  colorMaps.push_back(colorMap->copy());
+  return (int)colorMaps.size() - 1;
+}
+
+int DisplayList::addShading(GfxShading *shading) {
+  shadings.push_back(shading->copy());
+  return (int)shadings.size() - 1;
+}
+
+int DisplayList::addFont(GfxFont *font) {
+  if (!font) {
+    return -1;
+  }
+  // fonts are usually set again and again
+  if (!fonts.empty() && fonts.back() == font) {
+    return (int)fonts.size() - 1;
+  }
+  font->incRefCnt();
+  fonts.push_back(font);
+  return (int)fonts.size() - 1;
+}
+
+int DisplayList::addString(GooString *s) {
+  strings.push_back(s ? s->copy() : new GooString());
+  return (int)strings.size() - 1;
+}
+
+int DisplayList::addFunction(Function *func) {
+  if (!func) {
+    return -1;
+  }
+  functions.push_back(func->copy());
+  return (int)functions.size() - 1;
+}
+
+int DisplayList::addImage(Stream *str, int size) {
+  DisplayListImage image;
+  int n;
+
+  image.data = (Guchar *)gmalloc(size > 0 ? size : 1);
+  image.size = size;
+  str->reset();
+  n = size > 0 ? str->doGetChars(size, image.data) : 0;
+  // ImageStream reads EOF past the end of the data
+  if (n < size) {
+    memset(image.data + n, EOF & 0xff, size - n);
+  }
+  str->close();
+  images.push_back(image);
+  return (int)images.size() - 1;
+}
+
+int DisplayList::addPattern(Object *str, Dict *resDict) {
+  DisplayListPattern pattern;
+
+  str->copy(&pattern.str);
+  pattern.resDict = resDict;
+  if (resDict) {
+    resDict->incRef();
+  }
+  patterns.push_back(pattern);
+  return (int)patterns.size() - 1;
+}
+
+void DisplayList::play(OutputDev *out, double hDPI, double vDPI, int rotate,
+		       GBool useMediaBox, GBool crop,
+		       int sliceX, int sliceY, int sliceW, int sliceH,
+		       GBool printing,
+		       GBool (*abortCheckCbk)(void *data),
+		       void *abortCheckCbkData) {
+  Page *page;
+  Gfx *gfx;
+  GfxState *state;
+  XRef *xref;
+  Guchar *p, *end;
+  double toPlay[6], ibase[6], m[6], m1[6], concat[6], bbox[4];
+  double x, y, dx, dy, originX, originY, d;
+  double *dash;
+  std::vector<Unicode> u;
+  std::vector<GBool> groups, vaas;
+  Function *funcs[4];
+  GfxColor color;
+  GfxFont *font;
+  GfxShading *shading;
+  DisplayListPattern *pattern;
+  Stream *str, *maskStr;
+  int maskColors[2 * gfxColorMaxComps];
+  int op, groupSetup, groupCheck, t3Skip, t3Saves, skipRestores;
+  int n, i, j, k, idx, maskIdx, width, height, maskWidth, maskHeight;
+  int paintType, tilingType, x0, y0, x1, y1, xi, yi;
+  GBool mapCTM, fallbackSkip, skip, invert, interpolate, inlineImg, b;
+  CharCode c;
+
+  if (!(page = doc->getPage(pageNum))) {
+    return;
+  }
+  xref = doc->getXRef();
+  gfx = page->createGfx(out, hDPI, vDPI, rotate, useMediaBox, crop,
+			sliceX, sliceY, sliceW, sliceH, printing,
+			abortCheckCbk, abortCheckCbkData, xref);
+  state = gfx->getState();
+
+  // matrix from the default CTM of the recording to that of the page
+  // (if they are the same, recorded CTMs are used unchanged)
+  mapCTM = memcmp(baseCTM, state->getCTM(), sizeof(baseCTM)) != 0;
+  if (mapCTM) {
+    if (!invertMatrix(baseCTM, ibase)) {
+      delete gfx;
+      return;
+    }
+    concatMatrices(ibase, state->getCTM(), toPlay);
+  }
+
+  groupCheck = -1;		// result of the pending group check
+  t3Skip = 0;			// depth of the Type 3 glyph being skipped
+  t3Saves = 0;			// saves in the skipped Type 3 glyph
+  skipRestores = 0;		// restores to skip after that glyph
+  fallbackSkip = gFalse;	// skipping the fallback of a shaded fill
+
+  p = code.empty() ? NULL : &code[0];
+  end = p + code.size();
+  for (n = 0; p < end; ++n) {
+    if (abortCheckCbk && !(n & 255) && (*abortCheckCbk)(abortCheckCbkData)) {
+      break;
+    }
+    skip = t3Skip > 0 || fallbackSkip;
+    op = getByte(p);
+    switch (op) {
+
+    case dlSaveState:
+      if (t3Skip) {
+	++t3Saves;
+      } else if (!skip) {
+	gfx->saveState();
+	state = gfx->getState();
+      }
+      break;
+    case dlRestoreState:
+      if (t3Skip) {
+	--t3Saves;
+      } else if (skipRestores > 0) {
+	--skipRestores;
+      } else if (!skip) {
+	gfx->restoreState();
+	state = gfx->getState();
+      }
+      break;
+
+    case dlUpdateCTM:
+      getDoubles(p, m, 6);
+      getDoubles(p, concat, 6);
+      if (!skip) {
+	mapMatrix(m, mapCTM, toPlay);
+	state->setCTM(m[0], m[1], m[2], m[3], m[4], m[5]);
+	out->updateCTM(state, concat[0], concat[1], concat[2],
+		       concat[3], concat[4], concat[5]);
+      }
+      break;
+    case dlUpdateLineDash:
+      d = getDouble(p);
+      i = getInt(p);
+      if (skip) {
+	p += i * sizeof(double);
+      } else {
+	dash = (double *)gmallocn(i, sizeof(double));
+	getDoubles(p, dash, i);
+	state->setLineDash(dash, i, d);
+	out->updateLineDash(state);
+      }
+      break;
+    case dlUpdateFlatness:
+      i = getInt(p);
+      if (!skip) {
+	state->setFlatness(i);
+	out->updateFlatness(state);
+      }
+      break;
+    case dlUpdateLineJoin:
+      i = getInt(p);
+      if (!skip) {
+	state->setLineJoin(i);
+	out->updateLineJoin(state);
+      }
+      break;
+    case dlUpdateLineCap:
+      i = getInt(p);
+      if (!skip) {
+	state->setLineCap(i);
+	out->updateLineCap(state);
+      }
+      break;
+    case dlUpdateMiterLimit:
+      d = getDouble(p);
+      if (!skip) {
+	state->setMiterLimit(d);
+	out->updateMiterLimit(state);
+      }
+      break;
+    case dlUpdateLineWidth:
+      d = getDouble(p);
+      if (!skip) {
+	state->setLineWidth(d);
+	out->updateLineWidth(state);
+      }
+      break;
+    case dlUpdateStrokeAdjust:
+      b = getByte(p);
+      if (!skip) {
+	state->setStrokeAdjust(b);
+	out->updateStrokeAdjust(state);
+      }
+      break;
+    case dlUpdateAlphaIsShape:
+      b = getByte(p);
+      if (!skip) {
+	state->setAlphaIsShape(b);
+	out->updateAlphaIsShape(state);
+      }
+      break;
+    case dlUpdateTextKnockout:
+      b = getByte(p);
+      if (!skip) {
+	state->setTextKnockout(b);
+	out->updateTextKnockout(state);
+      }
+      break;
+    case dlUpdateFillColorSpace:
+      idx = getInt(p);
+      if (!skip) {
+	state->setFillColorSpace(colorSpaces[idx]->copy());
+	out->updateFillColorSpace(state);
+      }
+      break;
+    case dlUpdateStrokeColorSpace:
+      idx = getInt(p);
+      if (!skip) {
+	state->setStrokeColorSpace(colorSpaces[idx]->copy());
+	out->updateStrokeColorSpace(state);
+      }
+      break;
+    case dlUpdateFillColor:
+      getColor(p, &color);
+      if (!skip) {
+	state->setFillColor(&color);
+	out->updateFillColor(state);
+      }
+      break;
+    case dlUpdateStrokeColor:
+      getColor(p, &color);
+      if (!skip) {
+	state->setStrokeColor(&color);
+	out->updateStrokeColor(state);
+      }
+      break;
+
+    // the blend mode and opacities are reset, and the soft mask is
+    // cleared, before a transparency group is drawn; this isn't done
+    // if the device decides not to draw the group
+    case dlUpdateBlendMode:
+      groupSetup = getByte(p);
+      i = getInt(p);
+      if (!skip && !(groupSetup && groupCheck == 0)) {
+	state->setBlendMode((GfxBlendMode)i);
+	out->updateBlendMode(state);
+      }
+      break;
+    case dlUpdateFillOpacity:
+      groupSetup = getByte(p);
+      d = getDouble(p);
+      if (!skip && !(groupSetup && groupCheck == 0)) {
+	state->setFillOpacity(d);
+	out->updateFillOpacity(state);
+      }
+      break;
+    case dlUpdateStrokeOpacity:
+      groupSetup = getByte(p);
+      d = getDouble(p);
+      if (!skip && !(groupSetup && groupCheck == 0)) {
+	state->setStrokeOpacity(d);
+	out->updateStrokeOpacity(state);
+      }
+      break;
+    case dlUpdatePatternOpacity:
+      if (!skip) {
+	out->updatePatternOpacity(state);
+      }
+      break;
+    case dlClearPatternOpacity:
+      if (!skip) {
+	out->clearPatternOpacity(state);
+      }
+      break;
+    case dlUpdateFillOverprint:
+      b = getByte(p);
+      if (!skip) {
+	state->setFillOverprint(b);
+	out->updateFillOverprint(state);
+      }
+      break;
+    case dlUpdateStrokeOverprint:
+      b = getByte(p);
+      if (!skip) {
+	state->setStrokeOverprint(b);
+	out->updateStrokeOverprint(state);
+      }
+      break;
+    case dlUpdateOverprintMode:
+      i = getInt(p);
+      if (!skip) {
+	state->setOverprintMode(i);
+	out->updateOverprintMode(state);
+      }
+      break;
+    case dlUpdateTransfer:
+      for (i = 0; i < 4; ++i) {
+	idx = getInt(p);
+	funcs[i] = (skip || idx < 0) ? (Function *)NULL
+				     : functions[idx]->copy();
+      }
+      if (!skip) {
+	state->setTransfer(funcs);
+	out->updateTransfer(state);
+      }
+      break;
+    case dlUpdateFillColorStop:
+      getColor(p, &color);
+      d = getDouble(p);
+      if (!skip) {
+	state->setFillColor(&color);
+	out->updateFillColorStop(state, d);
+      }
+      break;
+
+    case dlUpdateFont:
+      idx = getInt(p);
+      d = getDouble(p);
+      if (!skip) {
+	font = idx < 0 ? (GfxFont *)NULL : fonts[idx];
+	if (font) {
+	  font->incRefCnt();
+	}
+	state->setFont(font, d);
+	out->updateFont(state);
+      }
+      break;
+    case dlUpdateTextMat:
+      getDoubles(p, m, 6);
+      if (!skip) {
+	state->setTextMat(m[0], m[1], m[2], m[3], m[4], m[5]);
+	out->updateTextMat(state);
+      }
+      break;
+    case dlUpdateCharSpace:
+      d = getDouble(p);
+      if (!skip) {
+	state->setCharSpace(d);
+	out->updateCharSpace(state);
+      }
+      break;
+    case dlUpdateRender:
+      i = getInt(p);
+      if (!skip) {
+	state->setRender(i);
+	out->updateRender(state);
+      }
+      break;
+    case dlUpdateRise:
+      d = getDouble(p);
+      if (!skip) {
+	state->setRise(d);
+	out->updateRise(state);
+      }
+      break;
+    case dlUpdateWordSpace:
+      d = getDouble(p);
+      if (!skip) {
+	state->setWordSpace(d);
+	out->updateWordSpace(state);
+      }
+      break;
+    case dlUpdateHorizScaling:
+      d = getDouble(p);
+      if (!skip) {
+	state->setHorizScaling(d);
+	out->updateHorizScaling(state);
+      }
+      break;
+    case dlUpdateTextPos:
+      x = getDouble(p);
+      y = getDouble(p);
+      if (!skip) {
+	state->textMoveTo(x, y);
+	out->updateTextPos(state);
+      }
+      break;
+    case dlUpdateTextShift:
+      d = getDouble(p);
+      if (!skip) {
+	out->updateTextShift(state, d);
+      }
+      break;
+    case dlSaveTextPos:
+      if (!skip) {
+	out->saveTextPos(state);
+      }
+      break;
+    case dlRestoreTextPos:
+      if (!skip) {
+	out->restoreTextPos(state);
+      }
+      break;
+
+    case dlStroke:
+    case dlFill:
+    case dlEOFill:
+    case dlClip:
+    case dlEOClip:
+    case dlClipToStrokePath:
+      idx = getInt(p);
+      if (skip) {
+	break;
+      }
+      state->setPath(paths[idx]->copy());
+      switch (op) {
+      case dlStroke:
+	out->stroke(state);
+	break;
+      case dlFill:
+	out->fill(state);
+	break;
+      case dlEOFill:
+	out->eoFill(state);
+	break;
+      case dlClip:
+	state->clip();
+	out->clip(state);
+	break;
+      case dlEOClip:
+	state->clip();
+	out->eoClip(state);
+	break;
+      case dlClipToStrokePath:
+	state->clipToStrokePath();
+	out->clipToStrokePath(state);
+	break;
+      }
+      state->clearPath();
+      break;
+
+    case dlTilingPatternFill:
+      pattern = &patterns[getInt(p)];
+      getDoubles(p, m1, 6);
+      paintType = getInt(p);
+      tilingType = getInt(p);
+      getDoubles(p, m, 6);
+      getDoubles(p, bbox, 4);
+      x0 = getInt(p);
+      y0 = getInt(p);
+      x1 = getInt(p);
+      y1 = getInt(p);
+      dx = getDouble(p);
+      dy = getDouble(p);
+      if (skip) {
+	break;
+      }
+      // the cells to draw depend on the clip region in device space
+      if (mapCTM &&
+	  !getTilingRange(state, m, bbox, dx, dy, &x0, &y0, &x1, &y1)) {
+	break;
+      }
+      memcpy(concat, m, sizeof(concat));
+      if (out->useTilingPatternFill() &&
+	  out->tilingPatternFill(state, gfx, doc->getCatalog(), &pattern->str,
+				 m1, paintType, tilingType, pattern->resDict,
+				 concat, bbox, x0, y0, x1, y1, dx, dy)) {
+	break;
+      }
+      out->updatePatternOpacity(state);
+      for (yi = y0; yi < y1; ++yi) {
+	for (xi = x0; xi < x1; ++xi) {
+	  x = xi * dx;
+	  y = yi * dy;
+	  concat[4] = x * m[0] + y * m[2] + m[4];
+	  concat[5] = x * m[1] + y * m[3] + m[5];
+	  gfx->drawForm(&pattern->str, pattern->resDict, concat, bbox);
+	}
+      }
+      out->clearPatternOpacity(state);
+      break;
+
+    // devices draw function, axial and radial shadings whenever they
+    // say they do; mesh shadings can be turned down, so they are
+    // followed by the fills Gfx draws instead, up to the end of the
+    // shaded fill (where vector antialiasing is set again)
+    case dlFunctionShadedFill:
+      shading = shadings[getInt(p)];
+      if (!skip && out->useShadedFills(shading->getType())) {
+	out->functionShadedFill(state, (GfxFunctionShading *)shading);
+      }
+      break;
+    case dlAxialShadedFill:
+      shading = shadings[getInt(p)];
+      x = getDouble(p);
+      y = getDouble(p);
+      if (!skip && out->useShadedFills(shading->getType())) {
+	out->axialShadedFill(state, (GfxAxialShading *)shading, x, y);
+      }
+      break;
+    case dlRadialShadedFill:
+      shading = shadings[getInt(p)];
+      x = getDouble(p);
+      y = getDouble(p);
+      if (!skip && out->useShadedFills(shading->getType())) {
+	out->radialShadedFill(state, (GfxRadialShading *)shading, x, y);
+      }
+      break;
+    case dlGouraudTriangleShadedFill:
+      shading = shadings[getInt(p)];
+      if (!skip && out->useShadedFills(shading->getType()) &&
+	  out->gouraudTriangleShadedFill(
+		   state, (GfxGouraudTriangleShading *)shading)) {
+	fallbackSkip = gTrue;
+      }
+      break;
+    case dlPatchMeshShadedFill:
+      shading = shadings[getInt(p)];
+      if (!skip && out->useShadedFills(shading->getType()) &&
+	  out->patchMeshShadedFill(state, (GfxPatchMeshShading *)shading)) {
+	fallbackSkip = gTrue;
+      }
+      break;
+
+    case dlBeginStringOp:
+      if (!skip) {
+	out->beginStringOp(state);
+      }
+      break;
+    case dlEndStringOp:
+      if (!skip) {
+	out->endStringOp(state);
+      }
+      break;
+    case dlBeginString:
+      idx = getInt(p);
+      if (!skip) {
+	out->beginString(state, strings[idx]);
+      }
+      break;
+    case dlEndString:
+      if (!skip) {
+	out->endString(state);
+      }
+      break;
+    case dlDrawChar:
+      x = getDouble(p);
+      y = getDouble(p);
+      dx = getDouble(p);
+      dy = getDouble(p);
+      originX = getDouble(p);
+      originY = getDouble(p);
+      c = (CharCode)getInt(p);
+      i = getInt(p);
+      j = getInt(p);
+      getUnicode(p, u, j);
+      if (!skip) {
+	out->drawChar(state, x, y, dx, dy, originX, originY, c, i,
+		      j > 0 ? &u[0] : (Unicode *)NULL, j);
+      }
+      break;
+    case dlDrawString:
+      idx = getInt(p);
+      if (!skip) {
+	out->drawString(state, strings[idx]);
+      }
+      break;
+
+    // if the device draws a Type 3 glyph itself (e.g., from its
+    // cache), the operations of the CharProc are skipped; the restores
+    // of the states the CharProc left saved come after its end
+    case dlBeginType3Char:
+      x = getDouble(p);
+      y = getDouble(p);
+      dx = getDouble(p);
+      dy = getDouble(p);
+      c = (CharCode)getInt(p);
+      j = getInt(p);
+      getUnicode(p, u, j);
+      if (t3Skip) {
+	++t3Skip;
+      } else if (!skip &&
+		 out->beginType3Char(state, x, y, dx, dy, c,
+				     j > 0 ? &u[0] : (Unicode *)NULL, j)) {
+	t3Skip = 1;
+	t3Saves = 0;
+      }
+      break;
+    case dlEndType3Char:
+      if (t3Skip) {
+	if (!--t3Skip) {
+	  skipRestores += t3Saves;
+	}
+      } else if (!skip) {
+	out->endType3Char(state);
+      }
+      break;
+    case dlType3D0:
+      x = getDouble(p);
+      y = getDouble(p);
+      if (!skip) {
+	out->type3D0(state, x, y);
+      }
+      break;
+    case dlType3D1:
+      getDoubles(p, m, 6);
+      if (!skip) {
+	out->type3D1(state, m[0], m[1], m[2], m[3], m[4], m[5]);
+      }
+      break;
+
+    case dlBeginTextObject:
+      if (!skip) {
+	out->beginTextObject(state);
+      }
+      break;
+    case dlEndTextObject:
+      if (!skip) {
+	out->endTextObject(state);
+      }
+      break;
+    case dlIncCharCount:
+      i = getInt(p);
+      if (!skip) {
+	out->incCharCount(i);
+      }
+      break;
+    case dlBeginActualText:
+      idx = getInt(p);
+      if (!skip) {
+	out->beginActualText(state, strings[idx]);
+      }
+      break;
+    case dlEndActualText:
+      if (!skip) {
+	out->endActualText(state);
+      }
+      break;
+
+    case dlDrawImageMask:
+      idx = getInt(p);
+      width = getInt(p);
+      height = getInt(p);
+      invert = getByte(p);
+      interpolate = getByte(p);
+      inlineImg = getByte(p);
+      if (!skip) {
+	str = makeImageStream(&images[idx], xref);
+	out->drawImageMask(state, NULL, str, width, height, invert,
+			   interpolate, inlineImg);
+	delete str;
+      }
+      break;
+    case dlSetSoftMaskFromImageMask:
+      idx = getInt(p);
+      width = getInt(p);
+      height = getInt(p);
+      invert = getByte(p);
+      inlineImg = getByte(p);
+      getDoubles(p, m, 6);
+      if (!skip) {
+	mapMatrix(m, mapCTM, toPlay);
+	str = makeImageStream(&images[idx], xref);
+	out->setSoftMaskFromImageMask(state, NULL, str, width, height, invert,
+				      inlineImg, m);
+	delete str;
+      }
+      break;
+    case dlUnsetSoftMaskFromImageMask:
+      getDoubles(p, m, 6);
+      if (!skip) {
+	mapMatrix(m, mapCTM, toPlay);
+	out->unsetSoftMaskFromImageMask(state, m);
+      }
+      break;
+    case dlDrawImage:
+      idx = getInt(p);
+      width = getInt(p);
+      height = getInt(p);
+      i = getInt(p);
+      interpolate = getByte(p);
+      j = getInt(p);
+      for (k = 0; k < j; ++k) {
+	maskColors[k] = getInt(p);
+      }
+      inlineImg = getByte(p);
+      if (!skip) {
+	str = makeImageStream(&images[idx], xref);
+	out->drawImage(state, NULL, str, width, height, colorMaps[i],
+		       interpolate, j > 0 ? maskColors : (int *)NULL,
+		       inlineImg);
+	delete str;
+      }
+      break;
+    case dlDrawMaskedImage:
+      idx = getInt(p);
+      width = getInt(p);
+      height = getInt(p);
+      i = getInt(p);
+      interpolate = getByte(p);
+      maskIdx = getInt(p);
+      maskWidth = getInt(p);
+      maskHeight = getInt(p);
+      invert = getByte(p);
+      b = getByte(p);
+      if (!skip) {
+	str = makeImageStream(&images[idx], xref);
+	maskStr = makeImageStream(&images[maskIdx], xref);
+	out->drawMaskedImage(state, NULL, str, width, height, colorMaps[i],
+			     interpolate, maskStr, maskWidth, maskHeight,
+			     invert, b);
+	delete maskStr;
+	delete str;
+      }
+      break;
+    case dlDrawSoftMaskedImage:
+      idx = getInt(p);
+      width = getInt(p);
+      height = getInt(p);
+      i = getInt(p);
+      interpolate = getByte(p);
+      maskIdx = getInt(p);
+      maskWidth = getInt(p);
+      maskHeight = getInt(p);
+      j = getInt(p);
+      b = getByte(p);
+      if (!skip) {
+	str = makeImageStream(&images[idx], xref);
+	maskStr = makeImageStream(&images[maskIdx], xref);
+	out->drawSoftMaskedImage(state, NULL, str, width, height,
+				 colorMaps[i], interpolate, maskStr,
+				 maskWidth, maskHeight, colorMaps[j], b);
+	delete maskStr;
+	delete str;
+      }
+      break;
+
+    // a group recorded after checkTransparencyGroup is only drawn as a
+    // group if the device wants it to be; <groups> has an entry for
+    // each group that has been begun and not yet painted, which says
+    // whether it is drawn
+    case dlCheckTransparencyGroup:
+      b = getByte(p);
+      if (!skip) {
+	groupCheck = out->checkTransparencyGroup(state, b) ? 1 : 0;
+      }
+      break;
+    case dlBeginTransparencyGroup:
+      getDoubles(p, bbox, 4);
+      idx = getInt(p);
+      i = getByte(p);
+      j = getByte(p);
+      b = getByte(p);
+      if (skip) {
+	break;
+      }
+      groups.push_back(groupCheck != 0);
+      groupCheck = -1;
+      if (groups.back()) {
+	out->beginTransparencyGroup(state, bbox,
+				    idx < 0 ? (GfxColorSpace *)NULL
+					    : colorSpaces[idx],
+				    i, j, b);
+      }
+      break;
+    case dlEndTransparencyGroup:
+      if (!skip && !groups.empty() && groups.back()) {
+	out->endTransparencyGroup(state);
+      }
+      break;
+    case dlPaintTransparencyGroup:
+      getDoubles(p, bbox, 4);
+      if (!skip && !groups.empty()) {
+	if (groups.back()) {
+	  out->paintTransparencyGroup(state, bbox);
+	}
+	groups.pop_back();
+      }
+      break;
+    case dlSetSoftMask:
+      getDoubles(p, bbox, 4);
+      b = getByte(p);
+      idx = getInt(p);
+      k = getByte(p);
+      getColor(p, &color);
+      if (!skip && !groups.empty()) {
+	groups.pop_back();
+	out->setSoftMask(state, bbox, b,
+			 idx < 0 ? (Function *)NULL : functions[idx],
+			 k ? &color : (GfxColor *)NULL);
+      }
+      break;
+    case dlClearSoftMask:
+      groupSetup = getByte(p);
+      if (!skip && !(groupSetup && groupCheck == 0)) {
+	out->clearSoftMask(state);
+      }
+      break;
+
+    // Gfx turns vector antialiasing off for shaded fills, and back on
+    // if it was on
+    case dlSetVectorAntialias:
+      b = getByte(p);
+      if (b) {
+	fallbackSkip = gFalse;
+      }
+      if (t3Skip) {
+	break;
+      }
+      if (!b) {
+	vaas.push_back(out->getVectorAntialias());
+	if (vaas.back()) {
+	  out->setVectorAntialias(gFalse);
+	}
+      } else if (!vaas.empty()) {
+	if (vaas.back()) {
+	  out->setVectorAntialias(gTrue);
+	}
+	vaas.pop_back();
+      }
+      break;
+
+    case dlDump:
+      if (!skip) {
+	out->dump();
+      }
+      break;
+
+    default:
+      error(errInternal, -1, "Bad display list operation");
+      p = end;
+      break;
+    }
+  }
+
+  delete gfx;
+}
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//------------------------------------------------------------------------
+
+DisplayListOutputDev::DisplayListOutputDev(PDFDoc *docA, OutputDev *protoA) {
+  doc = docA;
+  proto = protoA;
+  list = NULL;
+  lastList = NULL;
+  inPageSetup = gFalse;
+  inGroupSetup = gFalse;
+}
+
+DisplayListOutputDev::~DisplayListOutputDev() {
+  delete list;
+  delete lastList;
+}
+
+DisplayList *DisplayListOutputDev::takeDisplayList() {
+  DisplayList *l;
+
+  l = lastList;
+  lastList = NULL;
+  return l;
+}
+
+// Start an operation.
+DisplayList *DisplayListOutputDev::rec(int op) {
+  double ctm[6] = { 1, 0, 0, 1, 0, 0 };
+
+  inPageSetup = gFalse;
+  // operations outside of a page go to a list of their own
+  if (!list) {
+    list = new DisplayList(doc, 0, ctm);
+  }
+  list->putOp(op);
+  return list;
+}
+
+void DisplayListOutputDev::recordPathOp(int op, GfxState *state) {
+  DisplayList *l;
+
+  l = rec(op);
+  l->putInt(l->addPath(state->getPath()));
+}
+
+// Record the data of an image.  The images drawn from XObjects are
+// only stored once per page.
+int DisplayListOutputDev::recordImage(Object *ref, Stream *str, int size) {
+  std::pair<std::pair<int, int>, int> key;
+  std::map<std::pair<std::pair<int, int>, int>, int>::iterator it;
+  int idx;
+
+  if (!ref || !ref->isRef()) {
+    return list->addImage(str, size);
+  }
+  key = std::make_pair(std::make_pair(ref->getRefNum(), ref->getRefGen()),
+		       size);
+  if ((it = imageRefs.find(key)) != imageRefs.end()) {
+    return it->second;
+  }
+  idx = list->addImage(str, size);
+  imageRefs[key] = idx;
+  return idx;
+}
+
+void DisplayListOutputDev::startPage(int pageNum, GfxState *state,
+				     XRef *xref) {
+  delete list;
+  list = new DisplayList(doc, pageNum, state->getCTM());
+  imageRefs.clear();
+  // the Gfx playing the list sets up the state of its page (and clips
+  // to its crop box) itself
+  inPageSetup = gTrue;
+  inGroupSetup = gFalse;
+}
+
+void DisplayListOutputDev::endPage() {
+  delete lastList;
+  lastList = list;
+  list = NULL;
+  imageRefs.clear();
+}
+
+void DisplayListOutputDev::dump() {
+  rec(dlDump);
+}
+
+void DisplayListOutputDev::saveState(GfxState *state) {
+  rec(dlSaveState);
+}
+
+void DisplayListOutputDev::restoreState(GfxState *state) {
+  rec(dlRestoreState);
+}
+
+void DisplayListOutputDev::updateAll(GfxState *state) {
+  if (inPageSetup) {
+    return;
+  }
+  OutputDev::updateAll(state);
+}
+
+void DisplayListOutputDev::updateCTM(GfxState *state, double m11, double m12,
+				     double m21, double m22,
+				     double m31, double m32) {
+  DisplayList *l;
+
+  l = rec(dlUpdateCTM);
+  l->putDoubles(state->getCTM(), 6);
+  l->putDouble(m11);
+  l->putDouble(m12);
+  l->putDouble(m21);
+  l->putDouble(m22);
+  l->putDouble(m31);
+  l->putDouble(m32);
+}
+
+void DisplayListOutputDev::updateLineDash(GfxState *state) {
+  DisplayList *l;
+  double *dash;
+  double start;
+  int length;
+
+  state->getLineDash(&dash, &length, &start);
+  l = rec(dlUpdateLineDash);
+  l->putDouble(start);
+  l->putInt(length);
+  l->putDoubles(dash, length);
+}
+
+void DisplayListOutputDev::updateFlatness(GfxState *state) {
+  rec(dlUpdateFlatness)->putInt(state->getFlatness());
+}
+
+void DisplayListOutputDev::updateLineJoin(GfxState *state) {
+  rec(dlUpdateLineJoin)->putInt(state->getLineJoin());
+}
+
+void DisplayListOutputDev::updateLineCap(GfxState *state) {
+  rec(dlUpdateLineCap)->putInt(state->getLineCap());
+}
+
+void DisplayListOutputDev::updateMiterLimit(GfxState *state) {
+  rec(dlUpdateMiterLimit)->putDouble(state->getMiterLimit());
+}
+
+void DisplayListOutputDev::updateLineWidth(GfxState *state) {
+  rec(dlUpdateLineWidth)->putDouble(state->getLineWidth());
+}
+
+void DisplayListOutputDev::updateStrokeAdjust(GfxState *state) {
+  rec(dlUpdateStrokeAdjust)->putByte(state->getStrokeAdjust());
+}
+
+void DisplayListOutputDev::updateAlphaIsShape(GfxState *state) {
+  rec(dlUpdateAlphaIsShape)->putByte(state->getAlphaIsShape());
+}
+
+void DisplayListOutputDev::updateTextKnockout(GfxState *state) {
+  rec(dlUpdateTextKnockout)->putByte(state->getTextKnockout());
+}
+
+void DisplayListOutputDev::updateFillColorSpace(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateFillColorSpace);
+  l->putInt(l->addColorSpace(state->getFillColorSpace()));
+}
+
+void DisplayListOutputDev::updateStrokeColorSpace(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateStrokeColorSpace);
+  l->putInt(l->addColorSpace(state->getStrokeColorSpace()));
+}
+
+void DisplayListOutputDev::updateFillColor(GfxState *state) {
+  rec(dlUpdateFillColor)->putColor(state->getFillColor());
+}
+
+void DisplayListOutputDev::updateStrokeColor(GfxState *state) {
+  rec(dlUpdateStrokeColor)->putColor(state->getStrokeColor());
+}
+
+void DisplayListOutputDev::updateBlendMode(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateBlendMode);
+  l->putByte(inGroupSetup);
+  l->putInt(state->getBlendMode());
+}
+
+void DisplayListOutputDev::updateFillOpacity(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateFillOpacity);
+  l->putByte(inGroupSetup);
+  l->putDouble(state->getFillOpacity());
+}
+
+void DisplayListOutputDev::updateStrokeOpacity(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateStrokeOpacity);
+  l->putByte(inGroupSetup);
+  l->putDouble(state->getStrokeOpacity());
+}
+
+void DisplayListOutputDev::updatePatternOpacity(GfxState *state) {
+  rec(dlUpdatePatternOpacity);
+}
+
+void DisplayListOutputDev::clearPatternOpacity(GfxState *state) {
+  rec(dlClearPatternOpacity);
+}
+
+void DisplayListOutputDev::updateFillOverprint(GfxState *state) {
+  rec(dlUpdateFillOverprint)->putByte(state->getFillOverprint());
+}
+
+void DisplayListOutputDev::updateStrokeOverprint(GfxState *state) {
+  rec(dlUpdateStrokeOverprint)->putByte(state->getStrokeOverprint());
+}
+
+void DisplayListOutputDev::updateOverprintMode(GfxState *state) {
+  rec(dlUpdateOverprintMode)->putInt(state->getOverprintMode());
+}
+
+void DisplayListOutputDev::updateTransfer(GfxState *state) {
+  DisplayList *l;
+  Function **funcs;
+  int i;
+
+  funcs = state->getTransfer();
+  l = rec(dlUpdateTransfer);
+  for (i = 0; i < 4; ++i) {
+    l->putInt(l->addFunction(funcs[i]));
+  }
+}
+
+void DisplayListOutputDev::updateFillColorStop(GfxState *state,
+					       double offset) {
+  DisplayList *l;
+
+  l = rec(dlUpdateFillColorStop);
+  l->putColor(state->getFillColor());
+  l->putDouble(offset);
+}
+
+void DisplayListOutputDev::updateFont(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateFont);
+  l->putInt(l->addFont(state->getFont()));
+  l->putDouble(state->getFontSize());
+}
+
+void DisplayListOutputDev::updateTextMat(GfxState *state) {
+  rec(dlUpdateTextMat)->putDoubles(state->getTextMat(), 6);
+}
+
+void DisplayListOutputDev::updateCharSpace(GfxState *state) {
+  rec(dlUpdateCharSpace)->putDouble(state->getCharSpace());
+}
+
+void DisplayListOutputDev::updateRender(GfxState *state) {
+  rec(dlUpdateRender)->putInt(state->getRender());
+}
+
+void DisplayListOutputDev::updateRise(GfxState *state) {
+  rec(dlUpdateRise)->putDouble(state->getRise());
+}
+
+void DisplayListOutputDev::updateWordSpace(GfxState *state) {
+  rec(dlUpdateWordSpace)->putDouble(state->getWordSpace());
+}
+
+void DisplayListOutputDev::updateHorizScaling(GfxState *state) {
+  // GfxState::setHorizScaling takes a percentage
+  rec(dlUpdateHorizScaling)->putDouble(state->getHorizScaling() * 100);
+}
+
+void DisplayListOutputDev::updateTextPos(GfxState *state) {
+  DisplayList *l;
+
+  l = rec(dlUpdateTextPos);
+  l->putDouble(state->getLineX());
+  l->putDouble(state->getLineY());
+}
+
+void DisplayListOutputDev::updateTextShift(GfxState *state, double shift) {
+  rec(dlUpdateTextShift)->putDouble(shift);
+}
+
+void DisplayListOutputDev::saveTextPos(GfxState *state) {
+  rec(dlSaveTextPos);
+}
+
+void DisplayListOutputDev::restoreTextPos(GfxState *state) {
+  rec(dlRestoreTextPos);
+}
+
+void DisplayListOutputDev::stroke(GfxState *state) {
+  recordPathOp(dlStroke, state);
+}
+
+void DisplayListOutputDev::fill(GfxState *state) {
+  recordPathOp(dlFill, state);
+}
+
+void DisplayListOutputDev::eoFill(GfxState *state) {
+  recordPathOp(dlEOFill, state);
+}
+
+GBool DisplayListOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
+					      Catalog *cat, Object *str,
+					      double *pmat, int paintType,
+					      int tilingType, Dict *resDict,
+					      double *mat, double *bbox,
+					      int x0, int y0, int x1, int y1,
+					      double xStep, double yStep) {
+  DisplayList *l;
+
+  l = rec(dlTilingPatternFill);
+  l->putInt(l->addPattern(str, resDict));
+  l->putDoubles(pmat, 6);
+  l->putInt(paintType);
+  l->putInt(tilingType);
+  l->putDoubles(mat, 6);
+  l->putDoubles(bbox, 4);
+  l->putInt(x0);
+  l->putInt(y0);
+  l->putInt(x1);
+  l->putInt(y1);
+  l->putDouble(xStep);
+  l->putDouble(yStep);
+  return gTrue;
+}
+
+GBool DisplayListOutputDev::functionShadedFill(GfxState *state,
+					       GfxFunctionShading *shading) {
+  DisplayList *l;
+
+  l = rec(dlFunctionShadedFill);
+  l->putInt(l->addShading(shading));
+  return gTrue;
+}
+
+GBool DisplayListOutputDev::axialShadedFill(GfxState *state,
+					    GfxAxialShading *shading,
+					    double tMin, double tMax) {
+  DisplayList *l;
+
+  l = rec(dlAxialShadedFill);
+  l->putInt(l->addShading(shading));
+  l->putDouble(tMin);
+  l->putDouble(tMax);
+  return gTrue;
+}
+
+GBool DisplayListOutputDev::radialShadedFill(GfxState *state,
+					     GfxRadialShading *shading,
+					     double sMin, double sMax) {
+  DisplayList *l;
+
+  l = rec(dlRadialShadedFill);
+  l->putInt(l->addShading(shading));
+  l->putDouble(sMin);
+  l->putDouble(sMax);
+  return gTrue;
+}
+
+// Gfx goes on to draw the shading with fills, which are played if the
+// device turns the shading down.
+GBool DisplayListOutputDev::gouraudTriangleShadedFill(
+				GfxState *state,
+				GfxGouraudTriangleShading *shading) {
+  DisplayList *l;
+
+  l = rec(dlGouraudTriangleShadedFill);
+  l->putInt(l->addShading(shading));
+  return gFalse;
+}
+
+GBool DisplayListOutputDev::patchMeshShadedFill(GfxState *state,
+						GfxPatchMeshShading *shading) {
+  DisplayList *l;
+
+  l = rec(dlPatchMeshShadedFill);
+  l->putInt(l->addShading(shading));
+  return gFalse;
+}
+
+void DisplayListOutputDev::clip(GfxState *state) {
+  if (inPageSetup) {
+    return;
+  }
+  recordPathOp(dlClip, state);
+}
+
+void DisplayListOutputDev::eoClip(GfxState *state) {
+  recordPathOp(dlEOClip, state);
+}
+
+void DisplayListOutputDev::clipToStrokePath(GfxState *state) {
+  recordPathOp(dlClipToStrokePath, state);
+}
+
+void DisplayListOutputDev::beginStringOp(GfxState *state) {
+  rec(dlBeginStringOp);
+}
+
+void DisplayListOutputDev::endStringOp(GfxState *state) {
+  rec(dlEndStringOp);
+}
+
+void DisplayListOutputDev::beginString(GfxState *state, GooString *s) {
+  DisplayList *l;
+
+  l = rec(dlBeginString);
+  l->putInt(l->addString(s));
+}
+
+void DisplayListOutputDev::endString(GfxState *state) {
+  rec(dlEndString);
+}
+
+void DisplayListOutputDev::drawChar(GfxState *state, double x, double y,
+				    double dx, double dy,
+				    double originX, double originY,
+				    CharCode code, int nBytes,
+				    Unicode *u, int uLen) {
+  DisplayList *l;
+  int i;
+
+  l = rec(dlDrawChar);
+  l->putDouble(x);
+  l->putDouble(y);
+  l->putDouble(dx);
+  l->putDouble(dy);
+  l->putDouble(originX);
+  l->putDouble(originY);
+  l->putInt((int)code);
+  l->putInt(nBytes);
+  if (!u) {
+    uLen = 0;
+  }
+  l->putInt(uLen);
+  for (i = 0; i < uLen; ++i) {
+    l->putInt((int)u[i]);
+  }
+}
+
+void DisplayListOutputDev::drawString(GfxState *state, GooString *s) {
+  DisplayList *l;
+
+  l = rec(dlDrawString);
+  l->putInt(l->addString(s));
+}
+
+// The CharProcs of Type 3 glyphs are always recorded: the device can
+// still skip them when the list is played.
+GBool DisplayListOutputDev::beginType3Char(GfxState *state,
+					   double x, double y,
+					   double dx, double dy,
+					   CharCode code, Unicode *u,
+					   int uLen) {
+  DisplayList *l;
+  int i;
+
+  l = rec(dlBeginType3Char);
+  l->putDouble(x);
+  l->putDouble(y);
+  l->putDouble(dx);
+  l->putDouble(dy);
+  l->putInt((int)code);
+  if (!u) {
+    uLen = 0;
+  }
+  l->putInt(uLen);
+  for (i = 0; i < uLen; ++i) {
+    l->putInt((int)u[i]);
+  }
+  return gFalse;
+}
+
+void DisplayListOutputDev::endType3Char(GfxState *state) {
+  rec(dlEndType3Char);
+}
+
+void DisplayListOutputDev::beginTextObject(GfxState *state) {
+  rec(dlBeginTextObject);
+}
+
+void DisplayListOutputDev::endTextObject(GfxState *state) {
+  rec(dlEndTextObject);
+}
+
+void DisplayListOutputDev::incCharCount(int nChars) {
+  rec(dlIncCharCount)->putInt(nChars);
+}
+
+void DisplayListOutputDev::beginActualText(GfxState *state, GooString *text) {
+  DisplayList *l;
+
+  l = rec(dlBeginActualText);
+  l->putInt(l->addString(text));
+}
+
+void DisplayListOutputDev::endActualText(GfxState *state) {
+  rec(dlEndActualText);
+}
+
+void DisplayListOutputDev::drawImageMask(GfxState *state, Object *ref,
+					 Stream *str,
+					 int width, int height, GBool invert,
+					 GBool interpolate, GBool inlineImg) {
+  DisplayList *l;
+  int size;
+
+  if ((size = getImageSize(width, height, 1, 1)) < 0) {
+    error(errSyntaxError, -1, "Image mask is too big to record");
+    OutputDev::drawImageMask(state, ref, str, width, height, invert,
+			     interpolate, inlineImg);
+    return;
+  }
+  l = rec(dlDrawImageMask);
+  l->putInt(recordImage(ref, str, size));
+  l->putInt(width);
+  l->putInt(height);
+  l->putByte(invert);
+  l->putByte(interpolate);
+  l->putByte(inlineImg);
+}
+
+void DisplayListOutputDev::setSoftMaskFromImageMask(GfxState *state,
+						    Object *ref, Stream *str,
+						    int width, int height,
+						    GBool invert,
+						    GBool inlineImg,
+						    double *baseMatrix) {
+  DisplayList *l;
+  int size;
+
+  if ((size = getImageSize(width, height, 1, 1)) < 0) {
+    error(errSyntaxError, -1, "Image mask is too big to record");
+    OutputDev::setSoftMaskFromImageMask(state, ref, str, width, height,
+					invert, inlineImg, baseMatrix);
+    return;
+  }
+  l = rec(dlSetSoftMaskFromImageMask);
+  l->putInt(recordImage(ref, str, size));
+  l->putInt(width);
+  l->putInt(height);
+  l->putByte(invert);
+  l->putByte(inlineImg);
+  l->putDoubles(baseMatrix, 6);
+}
+
+void DisplayListOutputDev::unsetSoftMaskFromImageMask(GfxState *state,
+						      double *baseMatrix) {
+  rec(dlUnsetSoftMaskFromImageMask)->putDoubles(baseMatrix, 6);
+}
+
+void DisplayListOutputDev::drawImage(GfxState *state, Object *ref,
+				     Stream *str,
+				     int width, int height,
+				     GfxImageColorMap *colorMap,
+				     GBool interpolate, int *maskColors,
+				     GBool inlineImg) {
+  DisplayList *l;
+  int size, n, i;
+
+  if ((size = getImageSize(width, height, colorMap->getNumPixelComps(),
+			   colorMap->getBits())) < 0) {
+    error(errSyntaxError, -1, "Image is too big to record");
+    OutputDev::drawImage(state, ref, str, width, height, colorMap,
+			 interpolate, maskColors, inlineImg);
+    return;
+  }
+  l = rec(dlDrawImage);
+  l->putInt(recordImage(ref, str, size));
+  l->putInt(width);
+  l->putInt(height);
+  l->putInt(l->addColorMap(colorMap));
+  l->putByte(interpolate);
+  n = maskColors ? 2 * colorMap->getNumPixelComps() : 0;
+  l->putInt(n);
+  for (i = 0; i < n; ++i) {
+    l->putInt(maskColors[i]);
+  }
+  l->putByte(inlineImg);
+}
+
+void DisplayListOutputDev::drawMaskedImage(GfxState *state, Object *ref,
+					   Stream *str,
+					   int width, int height,
+					   GfxImageColorMap *colorMap,
+					   GBool interpolate,
+					   Stream *maskStr,
+					   int maskWidth, int maskHeight,
+					   GBool maskInvert,
+					   GBool maskInterpolate) {
+  DisplayList *l;
+  int size, maskSize;
+
+  if ((size = getImageSize(width, height, colorMap->getNumPixelComps(),
+			   colorMap->getBits())) < 0 ||
+      (maskSize = getImageSize(maskWidth, maskHeight, 1, 1)) < 0) {
+    error(errSyntaxError, -1, "Image is too big to record");
+    return;
+  }
+  l = rec(dlDrawMaskedImage);
+  l->putInt(recordImage(ref, str, size));
+  l->putInt(width);
+  l->putInt(height);
+  l->putInt(l->addColorMap(colorMap));
+  l->putByte(interpolate);
+  l->putInt(l->addImage(maskStr, maskSize));
+  l->putInt(maskWidth);
+  l->putInt(maskHeight);
+  l->putByte(maskInvert);
+  l->putByte(maskInterpolate);
+}
+
+void DisplayListOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
+					       Stream *str,
+					       int width, int height,
+					       GfxImageColorMap *colorMap,
+					       GBool interpolate,
+					       Stream *maskStr,
+					       int maskWidth, int maskHeight,
+					       GfxImageColorMap *maskColorMap,
+					       GBool maskInterpolate) {
+  DisplayList *l;
+  int size, maskSize;
+
+  if ((size = getImageSize(width, height, colorMap->getNumPixelComps(),
+			   colorMap->getBits())) < 0 ||
+      (maskSize = getImageSize(maskWidth, maskHeight,
+			       maskColorMap->getNumPixelComps(),
+			       maskColorMap->getBits())) < 0) {
+    error(errSyntaxError, -1, "Image is too big to record");
+    return;
+  }
+  l = rec(dlDrawSoftMaskedImage);
+  l->putInt(recordImage(ref, str, size));
+  l->putInt(width);
+  l->putInt(height);
+  l->putInt(l->addColorMap(colorMap));
+  l->putByte(interpolate);
+  l->putInt(l->addImage(maskStr, maskSize));
+  l->putInt(maskWidth);
+  l->putInt(maskHeight);
+  l->putInt(l->addColorMap(maskColorMap));
+  l->putByte(maskInterpolate);
+}
+
+void DisplayListOutputDev::type3D0(GfxState *state, double wx, double wy) {
+  DisplayList *l;
+
+  l = rec(dlType3D0);
+  l->putDouble(wx);
+  l->putDouble(wy);
+}
+
+void DisplayListOutputDev::type3D1(GfxState *state, double wx, double wy,
+				   double llx, double lly,
+				   double urx, double ury) {
+  DisplayList *l;
+
+  l = rec(dlType3D1);
+  l->putDouble(wx);
+  l->putDouble(wy);
+  l->putDouble(llx);
+  l->putDouble(lly);
+  l->putDouble(urx);
+  l->putDouble(ury);
+}
+
+// The group is recorded; whether it is drawn as a group is up to the
+// device the list is played on.
+GBool DisplayListOutputDev::checkTransparencyGroup(GfxState *state,
+						   GBool knockout) {
+  rec(dlCheckTransparencyGroup)->putByte(knockout);
+  inGroupSetup = gTrue;
+  return gTrue;
+}
+
+void DisplayListOutputDev::beginTransparencyGroup(
+				GfxState *state, double *bbox,
+				GfxColorSpace *blendingColorSpace,
+				GBool isolated, GBool knockout,
+				GBool forSoftMask) {
+  DisplayList *l;
+
+  l = rec(dlBeginTransparencyGroup);
+  l->putDoubles(bbox, 4);
+  l->putInt(l->addColorSpace(blendingColorSpace));
+  l->putByte(isolated);
+  l->putByte(knockout);
+  l->putByte(forSoftMask);
+  inGroupSetup = gFalse;
+}
+
+void DisplayListOutputDev::endTransparencyGroup(GfxState *state) {
+  rec(dlEndTransparencyGroup);
+}
+
+void DisplayListOutputDev::paintTransparencyGroup(GfxState *state,
+						  double *bbox) {
+  rec(dlPaintTransparencyGroup)->putDoubles(bbox, 4);
+}
+
+void DisplayListOutputDev::setSoftMask(GfxState *state, double *bbox,
+				       GBool alpha, Function *transferFunc,
+				       GfxColor *backdropColor) {
+  DisplayList *l;
+
+  l = rec(dlSetSoftMask);
+  l->putDoubles(bbox, 4);
+  l->putByte(alpha);
+  l->putInt(l->addFunction(transferFunc));
+  l->putByte(backdropColor != NULL);
+  if (backdropColor) {
+    l->putColor(backdropColor);
+  } else {
+    l->putByte(0);
+  }
+}
+
+void DisplayListOutputDev::clearSoftMask(GfxState *state) {
+  rec(dlClearSoftMask)->putByte(inGroupSetup);
+}
+
+void DisplayListOutputDev::setVectorAntialias(GBool vaa) {
+  rec(dlSetVectorAntialias)->putByte(vaa);
+}
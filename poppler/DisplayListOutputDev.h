@@ -0,0 +1,319 @@
+//========================================================================
+//
+// DisplayListOutputDev.h
+//
+// Records the output device operations of a page, so the page can be
+// drawn again, at any resolution, rotation or slice, without running
+// its content streams through Gfx.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef DISPLAYLISTOUTPUTDEV_H
+#define DISPLAYLISTOUTPUTDEV_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "goo/gtypes.h"
+#include "Object.h"
+#include "OutputDev.h"
+
+class GfxFont;
+class GfxPath;
+class GfxShading;
+class PDFDoc;
+
+//------------------------------------------------------------------------
+// DisplayList
+//
+// The output device operations of one page, with the state each of
+// them needs: paths, colors, fonts, text positions and the decoded
+// samples of images.  CTMs are stored relative to the page's default
+// CTM, so the list can be played with a different one.
+//
+// Things Gfx decides from the device resolution (the cells of tiling
+// patterns, and the subdivision of shadings the device doesn't draw
+// itself) are decided when the page is recorded.  The cells of tiling
+// patterns are still content streams, which the device runs through
+// Gfx when the list is played.
+//------------------------------------------------------------------------
+
+struct DisplayListImage {
+  Guchar *data;
+  int size;
+};
+
+struct DisplayListPattern {
+  Object str;			// content stream of the cell
+  Dict *resDict;		// resources of the cell
+};
+
+class DisplayList {
+public:
+
+  ~DisplayList();
+
+  // Draw the page on <out>.  The arguments are those of
+  // PDFDoc::displayPageSlice.  The PDFDoc the page was recorded from
+  // must still be open.  Devices that draw pages in their own way
+  // from checkPageSlice (e.g., in bands) draw the list in one pass.
+  void play(OutputDev *out, double hDPI, double vDPI, int rotate,
+	    GBool useMediaBox, GBool crop,
+	    int sliceX = -1, int sliceY = -1, int sliceW = -1, int sliceH = -1,
+	    GBool printing = gFalse,
+	    GBool (*abortCheckCbk)(void *data) = NULL,
+	    void *abortCheckCbkData = NULL);
+
+  int getPageNum() { return pageNum; }
+
+  // Number of operations in the list.
+  int getNumOps() { return nOps; }
+
+  // Approximate amount of memory used by the list, in bytes.
+  long getSize();
+
+private:
+
+  DisplayList(PDFDoc *docA, int pageNumA, double *baseCTMA);
+
+  // Writing the list (see DisplayListOutputDev).
+  void putOp(int op);
+  void putByte(int x) { code.push_back((Guchar)x); }
+  void putInt(int x);
+  void putDouble(double x);
+  void putDoubles(double *x, int n);
+  void putColor(GfxColor *color);
+  int addPath(GfxPath *path);
+  int addColorSpace(GfxColorSpace *colorSpace);
+  int addColorMap(GfxImageColorMap *colorMap);
+  int addShading(GfxShading *shading);
+  int addFont(GfxFont *font);
+  int addString(GooString *s);
+  int addFunction(Function *func);
+  int addImage(Stream *str, int size);
+  int addPattern(Object *str, Dict *resDict);
+
+  PDFDoc *doc;
+  int pageNum;
+  double baseCTM[6];		// default CTM of the recording
+
+  std::vector<Guchar> code;	// the operations, with their arguments
+  int nOps;
+  std::vector<GfxPath *> paths;
+  std::vector<GfxColorSpace *> colorSpaces;
+  int deviceColorSpaces[3];	// index of the DeviceGray, RGB and CMYK
+				//   color spaces in <colorSpaces>, or -1
+  std::vector<GfxImageColorMap *> colorMaps;
+  std::vector<GfxShading *> shadings;
+  std::vector<GfxFont *> fonts;
+  std::vector<GooString *> strings;
+  std::vector<Function *> functions;
+  std::vector<DisplayListImage> images;
+  std::vector<DisplayListPattern> patterns;
+
+  friend class DisplayListOutputDev;
+};
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//
+// Records a DisplayList for each page drawn on it.  The device the
+// lists will be played on is given to the constructor: the recording
+// makes the same choices it does (e.g., whether Type 3 glyphs are
+// drawn by running their CharProcs).  Anything else the device
+// decides while drawing (e.g., to draw a transparency group directly,
+// or to take a Type 3 glyph from its cache) is decided when the list
+// is played.
+//------------------------------------------------------------------------
+
+class DisplayListOutputDev: public OutputDev {
+public:
+
+  // Record pages of <docA> to be played on devices like <protoA>.
+  DisplayListOutputDev(PDFDoc *docA, OutputDev *protoA);
+
+  // Destructor.
+  virtual ~DisplayListOutputDev();
+
+  // Return the list of the last page drawn, or NULL if there is none.
+  // The caller owns the list.
+  DisplayList *takeDisplayList();
+
+  //----- get info about output device
+
+  virtual GBool upsideDown() { return proto->upsideDown(); }
+  virtual GBool useDrawChar() { return proto->useDrawChar(); }
+  virtual GBool useTilingPatternFill() { return proto->useTilingPatternFill(); }
+  virtual GBool useShadedFills(int type) { return proto->useShadedFills(type); }
+  virtual GBool useFillColorStop() { return proto->useFillColorStop(); }
+  virtual GBool interpretType3Chars() { return proto->interpretType3Chars(); }
+  virtual GBool needNonText() { return proto->needNonText(); }
+  virtual GBool needCharCount() { return proto->needCharCount(); }
+
+  //----- initialization and control
+
+  virtual void startPage(int pageNum, GfxState *state, XRef *xref);
+  virtual void endPage();
+  virtual void dump();
+
+  //----- save/restore graphics state
+  virtual void saveState(GfxState *state);
+  virtual void restoreState(GfxState *state);
+
+  //----- update graphics state
+  virtual void updateAll(GfxState *state);
+  virtual void updateCTM(GfxState *state, double m11, double m12,
+			 double m21, double m22, double m31, double m32);
+  virtual void updateLineDash(GfxState *state);
+  virtual void updateFlatness(GfxState *state);
+  virtual void updateLineJoin(GfxState *state);
+  virtual void updateLineCap(GfxState *state);
+  virtual void updateMiterLimit(GfxState *state);
+  virtual void updateLineWidth(GfxState *state);
+  virtual void updateStrokeAdjust(GfxState *state);
+  virtual void updateAlphaIsShape(GfxState *state);
+  virtual void updateTextKnockout(GfxState *state);
+  virtual void updateFillColorSpace(GfxState *state);
+  virtual void updateStrokeColorSpace(GfxState *state);
+  virtual void updateFillColor(GfxState *state);
+  virtual void updateStrokeColor(GfxState *state);
+  virtual void updateBlendMode(GfxState *state);
+  virtual void updateFillOpacity(GfxState *state);
+  virtual void updateStrokeOpacity(GfxState *state);
+  virtual void updatePatternOpacity(GfxState *state);
+  virtual void clearPatternOpacity(GfxState *state);
+  virtual void updateFillOverprint(GfxState *state);
+  virtual void updateStrokeOverprint(GfxState *state);
+  virtual void updateOverprintMode(GfxState *state);
+  virtual void updateTransfer(GfxState *state);
+  virtual void updateFillColorStop(GfxState *state, double offset);
+
+  //----- update text state
+  virtual void updateFont(GfxState *state);
+  virtual void updateTextMat(GfxState *state);
+  virtual void updateCharSpace(GfxState *state);
+  virtual void updateRender(GfxState *state);
+  virtual void updateRise(GfxState *state);
+  virtual void updateWordSpace(GfxState *state);
+  virtual void updateHorizScaling(GfxState *state);
+  virtual void updateTextPos(GfxState *state);
+  virtual void updateTextShift(GfxState *state, double shift);
+  virtual void saveTextPos(GfxState *state);
+  virtual void restoreTextPos(GfxState *state);
+
+  //----- path painting
+  virtual void stroke(GfxState *state);
+  virtual void fill(GfxState *state);
+  virtual void eoFill(GfxState *state);
+  virtual GBool tilingPatternFill(GfxState *state, Gfx *gfx, Catalog *cat, Object *str,
+				  double *pmat, int paintType, int tilingType, Dict *resDict,
+				  double *mat, double *bbox,
+				  int x0, int y0, int x1, int y1,
+				  double xStep, double yStep);
+  virtual GBool functionShadedFill(GfxState *state,
+				   GfxFunctionShading *shading);
+  virtual GBool axialShadedFill(GfxState *state, GfxAxialShading *shading, double tMin, double tMax);
+  virtual GBool axialShadedSupportExtend(GfxState *state, GfxAxialShading *shading)
+    { return proto->axialShadedSupportExtend(state, shading); }
+  virtual GBool radialShadedFill(GfxState *state, GfxRadialShading *shading, double sMin, double sMax);
+  virtual GBool radialShadedSupportExtend(GfxState *state, GfxRadialShading *shading)
+    { return proto->radialShadedSupportExtend(state, shading); }
+  virtual GBool gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriangleShading *shading);
+  virtual GBool patchMeshShadedFill(GfxState *state, GfxPatchMeshShading *shading);
+
+  //----- path clipping
+  virtual void clip(GfxState *state);
+  virtual void eoClip(GfxState *state);
+  virtual void clipToStrokePath(GfxState *state);
+
+  //----- text drawing
+  virtual void beginStringOp(GfxState *state);
+  virtual void endStringOp(GfxState *state);
+  virtual void beginString(GfxState *state, GooString *s);
+  virtual void endString(GfxState *state);
+  virtual void drawChar(GfxState *state, double x, double y,
+			double dx, double dy,
+			double originX, double originY,
+			CharCode code, int nBytes, Unicode *u, int uLen);
+  virtual void drawString(GfxState *state, GooString *s);
+  virtual GBool beginType3Char(GfxState *state, double x, double y,
+			       double dx, double dy,
+			       CharCode code, Unicode *u, int uLen);
+  virtual void endType3Char(GfxState *state);
+  virtual void beginTextObject(GfxState *state);
+  virtual void endTextObject(GfxState *state);
+  virtual void incCharCount(int nChars);
+  virtual void beginActualText(GfxState *state, GooString *text);
+  virtual void endActualText(GfxState *state);
+
+  //----- image drawing
+  virtual void drawImageMask(GfxState *state, Object *ref, Stream *str,
+			     int width, int height, GBool invert,
+			     GBool interpolate, GBool inlineImg);
+  virtual void setSoftMaskFromImageMask(GfxState *state,
+					Object *ref, Stream *str,
+					int width, int height, GBool invert,
+					GBool inlineImg, double *baseMatrix);
+  virtual void unsetSoftMaskFromImageMask(GfxState *state, double *baseMatrix);
+  virtual void drawImage(GfxState *state, Object *ref, Stream *str,
+			 int width, int height, GfxImageColorMap *colorMap,
+			 GBool interpolate, int *maskColors, GBool inlineImg);
+  virtual void drawMaskedImage(GfxState *state, Object *ref, Stream *str,
+			       int width, int height,
+			       GfxImageColorMap *colorMap, GBool interpolate,
+			       Stream *maskStr, int maskWidth, int maskHeight,
+			       GBool maskInvert, GBool maskInterpolate);
+  virtual void drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str,
+				   int width, int height,
+				   GfxImageColorMap *colorMap,
+				   GBool interpolate,
+				   Stream *maskStr,
+				   int maskWidth, int maskHeight,
+				   GfxImageColorMap *maskColorMap,
+				   GBool maskInterpolate);
+
+  //----- Type 3 font operators
+  virtual void type3D0(GfxState *state, double wx, double wy);
+  virtual void type3D1(GfxState *state, double wx, double wy,
+		       double llx, double lly, double urx, double ury);
+
+  //----- transparency groups and soft masks
+  virtual GBool checkTransparencyGroup(GfxState *state, GBool knockout);
+  virtual void beginTransparencyGroup(GfxState *state, double *bbox,
+				      GfxColorSpace *blendingColorSpace,
+				      GBool isolated, GBool knockout,
+				      GBool forSoftMask);
+  virtual void endTransparencyGroup(GfxState *state);
+  virtual void paintTransparencyGroup(GfxState *state, double *bbox);
+  virtual void setSoftMask(GfxState *state, double *bbox, GBool alpha,
+			   Function *transferFunc, GfxColor *backdropColor);
+  virtual void clearSoftMask(GfxState *state);
+
+  virtual GBool getVectorAntialias() { return gTrue; }
+  virtual void setVectorAntialias(GBool vaa);
+
+private:
+
+  DisplayList *rec(int op);
+  void recordPathOp(int op, GfxState *state);
+  int recordImage(Object *ref, Stream *str, int size);
+
+  PDFDoc *doc;
+  OutputDev *proto;		// device the lists will be played on
+  DisplayList *list;		// list of the page being drawn
+  DisplayList *lastList;	// list of the last page drawn
+  GBool inPageSetup;		// set until the Gfx of a page has set up
+				//   its state
+  GBool inGroupSetup;		// set between checkTransparencyGroup and
+				//   beginTransparencyGroup
+  // images of the current page, by object and size of their data
+  std::map<std::pair<std::pair<int, int>, int>, int> imageRefs;
+};
+
+#endif
@@ -0,0 +1,479 @@
+//========================================================================
+//
+// DocIndex.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#ifdef _WIN32
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
+#include "goo/gfile.h"
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "Object.h"
+#include "Stream.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PDFDoc.h"
+#include "Error.h"
+#include "DocIndex.h"
+
+//------------------------------------------------------------------------
+
+#define docIndexMagic "PDFIDX01"
+#define docIndexMagicLen 8
+#define docIndexHeaderLen (docIndexMagicLen + 5 * 8)
+
+// number of bytes at the end of the file that go into the key
+#define docIndexTailLen 1024
+
+//------------------------------------------------------------------------
+
+// 64-bit FNV-1a hash.
+static unsigned long long hashBytes(unsigned long long h,
+				    const char *p, int len) {
+  for (int i = 0; i < len; ++i) {
+    h ^= (Guchar)p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+#define hashInit 14695981039346656037ULL
+
+static void putInt(GooString *s, int x) {
+  Guint u = (Guint)x;
+
+  s->append((char)(u & 0xff));
+  s->append((char)((u >> 8) & 0xff));
+  s->append((char)((u >> 16) & 0xff));
+  s->append((char)((u >> 24) & 0xff));
+}
+
+static void putOffset(GooString *s, unsigned long long x) {
+  putInt(s, (int)(Guint)(x & 0xffffffff));
+  putInt(s, (int)(Guint)(x >> 32));
+}
+
+//------------------------------------------------------------------------
+// DocIndexReader
+//------------------------------------------------------------------------
+
+class DocIndexReader {
+public:
+
+  DocIndexReader(const char *bufA, int lenA)
+    { p = bufA; end = bufA + lenA; ok = gTrue; }
+
+  GBool isOk() { return ok; }
+  int remaining() { return (int)(end - p); }
+
+  int getByte() {
+    if (end - p < 1) {
+      ok = gFalse;
+      return 0;
+    }
+    return (Guchar)*p++;
+  }
+
+  int getInt() {
+    Guint u;
+
+    if (end - p < 4) {
+      ok = gFalse;
+      return 0;
+    }
+    u = (Guint)(Guchar)p[0] | ((Guint)(Guchar)p[1] << 8) |
+        ((Guint)(Guchar)p[2] << 16) | ((Guint)(Guchar)p[3] << 24);
+    p += 4;
+    return (int)u;
+  }
+
+  unsigned long long getOffset() {
+    unsigned long long lo, hi;
+
+    lo = (Guint)getInt();
+    hi = (Guint)getInt();
+    return lo | (hi << 32);
+  }
+
+  const char *getBytes(int n) {
+    const char *q;
+
+    if (n < 0 || end - p < n) {
+      ok = gFalse;
+      return NULL;
+    }
+    q = p;
+    p += n;
+    return q;
+  }
+
+private:
+
+  const char *p, *end;
+  GBool ok;
+};
+
+//------------------------------------------------------------------------
+// DocIndexOutStream
+//------------------------------------------------------------------------
+
+class DocIndexOutStream: public OutStream {
+public:
+
+  DocIndexOutStream(GooString *sA) { s = sA; }
+  virtual void close() {}
+  virtual Goffset getPos() { return s->getLength(); }
+  virtual void put(char c) { s->append(c); }
+  virtual void printf(const char *format, ...);
+
+private:
+
+  GooString *s;
+};
+
+void DocIndexOutStream::printf(const char *format, ...) {
+  char buf[256];
+  char *p;
+  va_list args;
+  int n;
+
+  va_start(args, format);
+  n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) {
+    return;
+  }
+  if (n < (int)sizeof(buf)) {
+    s->append(buf, n);
+    return;
+  }
+  p = (char *)gmalloc(n + 1);
+  va_start(args, format);
+  vsnprintf(p, n + 1, format, args);
+  va_end(args);
+  s->append(p, n);
+  gfree(p);
+}
+
+//------------------------------------------------------------------------
+// DocIndex
+//------------------------------------------------------------------------
+
+DocIndex::DocIndex(GooFile *file) {
+  char buf[docIndexTailLen];
+  Goffset pos;
+  int n;
+
+  ok = gFalse;
+  trailer = NULL;
+  rootNum = rootGen = -1;
+  xRefStream = gFalse;
+  mainXRefOffset = 0;
+  mainXRefEntriesOffset = 0;
+  xrefReconstructed = gFalse;
+  numPages = 0;
+
+  fileSize = file->size();
+  modTime = file->modificationTime();
+  if (fileSize <= 0 || modTime < 0) {
+    return;
+  }
+  pos = fileSize > docIndexTailLen ? fileSize - docIndexTailLen : 0;
+  n = (int)(fileSize - pos);
+  if (file->read(buf, n, pos) != n) {
+    return;
+  }
+  tailHash = hashBytes(hashInit, buf, n);
+  ok = gTrue;
+}
+
+DocIndex::~DocIndex() {
+  delete trailer;
+}
+
+GooString *DocIndex::getPath(GooString *dir) {
+  GooString key, *path;
+  unsigned long long h;
+  char name[32];
+
+  putOffset(&key, fileSize);
+  putOffset(&key, modTime);
+  putOffset(&key, tailHash);
+  h = hashBytes(hashInit, key.getCString(), key.getLength());
+  snprintf(name, sizeof(name), "%08x%08x.pdfidx",
+	   (Guint)(h >> 32), (Guint)(h & 0xffffffff));
+  path = dir->copy();
+  appendToPath(path, name);
+  return path;
+}
+
+void DocIndex::setTrailer(Object *dict) {
+  DocIndexOutStream *out;
+
+  delete trailer;
+  trailer = new GooString();
+  out = new DocIndexOutStream(trailer);
+  PDFDoc::writeObject(dict, out, NULL, 0, NULL, cryptNone, 0, 0, 0);
+  delete out;
+}
+
+Object *DocIndex::getTrailer(XRef *xref, Object *obj) {
+  Parser *parser;
+  Object obj1;
+
+  if (!trailer) {
+    return obj->initNull();
+  }
+  obj1.initNull();
+  parser = new Parser(xref,
+	     new Lexer(xref,
+	       new MemStream(trailer->getCString(), 0, trailer->getLength(),
+			     &obj1)),
+	     gFalse);
+  parser->getObj(obj);
+  delete parser;
+  return obj;
+}
+
+GBool DocIndex::read(GooString *dir) {
+  GooString *path;
+  FILE *f;
+  char *buf;
+  Goffset len;
+  int n;
+
+  if (!ok) {
+    return gFalse;
+  }
+  path = getPath(dir);
+  f = openFile(path->getCString(), "rb");
+  delete path;
+  if (!f) {
+    return gFalse;
+  }
+  buf = NULL;
+  if (Gfseek(f, 0, SEEK_END) != 0 ||
+      (len = Gftell(f)) < docIndexHeaderLen || len > INT_MAX ||
+      Gfseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return gFalse;
+  }
+  buf = (char *)gmalloc((int)len);
+  n = (int)fread(buf, 1, (size_t)len, f);
+  fclose(f);
+  if (n != len) {
+    gfree(buf);
+    return gFalse;
+  }
+
+  // header
+  DocIndexReader hdr(buf, n);
+  const char *magic = hdr.getBytes(docIndexMagicLen);
+  Goffset fileSizeA = (Goffset)hdr.getOffset();
+  Goffset modTimeA = (Goffset)hdr.getOffset();
+  unsigned long long tailHashA = hdr.getOffset();
+  unsigned long long bodyLen = hdr.getOffset();
+  unsigned long long bodyHash = hdr.getOffset();
+  const char *body = buf + docIndexHeaderLen;
+  if (memcmp(magic, docIndexMagic, docIndexMagicLen) ||
+      fileSizeA != fileSize || modTimeA != modTime || tailHashA != tailHash ||
+      bodyLen != (unsigned long long)(n - docIndexHeaderLen) ||
+      hashBytes(hashInit, body, (int)bodyLen) != bodyHash) {
+    gfree(buf);
+    return gFalse;
+  }
+
+  // xref table
+  DocIndexReader r(body, (int)bodyLen);
+  int nEntries = r.getInt();
+  if (nEntries < 0 || nEntries > r.remaining() / 13) {
+    gfree(buf);
+    return gFalse;
+  }
+  entries.resize(nEntries);
+  for (int i = 0; i < nEntries; ++i) {
+    entries[i].offset = (Goffset)r.getOffset();
+    entries[i].gen = r.getInt();
+    entries[i].type = (XRefEntryType)r.getByte();
+    if (entries[i].type > xrefEntryNone) {
+      gfree(buf);
+      return gFalse;
+    }
+  }
+  int trailerLen = r.getInt();
+  const char *p = r.getBytes(trailerLen);
+  if (!p) {
+    gfree(buf);
+    return gFalse;
+  }
+  trailer = new GooString(p, trailerLen);
+  rootNum = r.getInt();
+  rootGen = r.getInt();
+  xRefStream = r.getByte() ? gTrue : gFalse;
+  mainXRefOffset = (Goffset)r.getOffset();
+  mainXRefEntriesOffset = (Goffset)r.getOffset();
+  xrefReconstructed = r.getByte() ? gTrue : gFalse;
+  int nStreamEnds = r.getInt();
+  if (nStreamEnds < 0 || nStreamEnds > r.remaining() / 8) {
+    gfree(buf);
+    return gFalse;
+  }
+  streamEnds.resize(nStreamEnds);
+  for (int i = 0; i < nStreamEnds; ++i) {
+    streamEnds[i] = (Goffset)r.getOffset();
+  }
+
+  // page tree
+  numPages = r.getInt();
+  if (numPages > 0) {
+    int nNodes = r.getInt();
+    if (nNodes <= 0 || nNodes > r.remaining() / 12 ||
+	numPages > (r.remaining() - nNodes * 12) / 12) {
+      gfree(buf);
+      return gFalse;
+    }
+    nodeRefs.resize(nNodes);
+    nodeParents.resize(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+      nodeRefs[i].num = r.getInt();
+      nodeRefs[i].gen = r.getInt();
+      nodeParents[i] = r.getInt();
+      // parents come before their children in the walk
+      if (i == 0 ? nodeParents[i] != -1
+	         : (nodeParents[i] < 0 || nodeParents[i] >= i)) {
+	gfree(buf);
+	return gFalse;
+      }
+    }
+    pageRefs.resize(numPages);
+    pageNodes.resize(numPages);
+    for (int i = 0; i < numPages; ++i) {
+      pageRefs[i].num = r.getInt();
+      pageRefs[i].gen = r.getInt();
+      pageNodes[i] = r.getInt();
+      if (pageNodes[i] < 0 || pageNodes[i] >= nNodes) {
+	gfree(buf);
+	return gFalse;
+      }
+    }
+  } else {
+    numPages = 0;
+  }
+  gfree(buf);
+
+  return r.isOk() && r.remaining() == 0;
+}
+
+// Create a new file next to <path> to write its contents to, with a
+// name no other writer uses, and return its name in <tmpPath>.
+static FILE *openTempIndexFile(GooString *path, GooString **tmpPath) {
+#if HAVE_MKSTEMP
+  int fd;
+  FILE *f;
+
+  *tmpPath = path->copy()->append(".XXXXXX");
+  if ((fd = mkstemp((*tmpPath)->getCString())) < 0) {
+    return NULL;
+  }
+  if (!(f = fdopen(fd, "wb"))) {
+    close(fd);
+    remove((*tmpPath)->getCString());
+  }
+  return f;
+#else
+  *tmpPath = GooString::format("{0:t}.{1:d}.tmp", path, (int)getpid());
+  return openFile((*tmpPath)->getCString(), "wb");
+#endif
+}
+
+GBool DocIndex::write(GooString *dir) {
+  GooString *path, *tmpPath;
+  GooString hdr, body;
+  FILE *f;
+  GBool written;
+
+  if (!ok || !trailer) {
+    return gFalse;
+  }
+
+  putInt(&body, (int)entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    putOffset(&body, entries[i].offset);
+    putInt(&body, entries[i].gen);
+    body.append((char)entries[i].type);
+  }
+  putInt(&body, trailer->getLength());
+  body.append(trailer);
+  putInt(&body, rootNum);
+  putInt(&body, rootGen);
+  body.append((char)(xRefStream ? 1 : 0));
+  putOffset(&body, mainXRefOffset);
+  putOffset(&body, mainXRefEntriesOffset);
+  body.append((char)(xrefReconstructed ? 1 : 0));
+  putInt(&body, (int)streamEnds.size());
+  for (size_t i = 0; i < streamEnds.size(); ++i) {
+    putOffset(&body, streamEnds[i]);
+  }
+  putInt(&body, numPages);
+  if (numPages > 0) {
+    putInt(&body, (int)nodeRefs.size());
+    for (size_t i = 0; i < nodeRefs.size(); ++i) {
+      putInt(&body, nodeRefs[i].num);
+      putInt(&body, nodeRefs[i].gen);
+      putInt(&body, nodeParents[i]);
+    }
+    for (int i = 0; i < numPages; ++i) {
+      putInt(&body, pageRefs[i].num);
+      putInt(&body, pageRefs[i].gen);
+      putInt(&body, pageNodes[i]);
+    }
+  }
+
+  hdr.append(docIndexMagic, docIndexMagicLen);
+  putOffset(&hdr, fileSize);
+  putOffset(&hdr, modTime);
+  putOffset(&hdr, tailHash);
+  putOffset(&hdr, body.getLength());
+  putOffset(&hdr, hashBytes(hashInit, body.getCString(), body.getLength()));
+
+  // write to a temporary file first, so that readers never see a
+  // partial index, and processes indexing the same file at the same
+  // time don't write to the same file
+  path = getPath(dir);
+  written = gFalse;
+  if ((f = openTempIndexFile(path, &tmpPath))) {
+    written = fwrite(hdr.getCString(), 1, hdr.getLength(), f) ==
+                (size_t)hdr.getLength() &&
+              fwrite(body.getCString(), 1, body.getLength(), f) ==
+                (size_t)body.getLength();
+    written = (fclose(f) == 0) && written;
+    if (written && rename(tmpPath->getCString(), path->getCString()) != 0) {
+      // rename doesn't replace existing files on Windows
+      remove(path->getCString());
+      written = rename(tmpPath->getCString(), path->getCString()) == 0;
+    }
+    if (!written) {
+      remove(tmpPath->getCString());
+    }
+  }
+  if (!written) {
+    error(errIO, -1, "Couldn't write document index '{0:t}'", path);
+  }
+  delete tmpPath;
+  delete path;
+  return written;
+}
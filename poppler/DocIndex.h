@@ -0,0 +1,94 @@
+//========================================================================
+//
+// DocIndex.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef DOCINDEX_H
+#define DOCINDEX_H
+
+#include <vector>
+#include "goo/gtypes.h"
+#include "Object.h"
+#include "XRef.h"
+
+class GooFile;
+class GooString;
+
+//------------------------------------------------------------------------
+// DocIndex
+//
+// Sidecar file holding the parsed xref table and page tree of a PDF
+// file, so that reopening the file doesn't have to read all the xref
+// sections or walk the page tree again.  Index files are kept in the
+// directory set with GlobalParams::setDocIndexDir, named after the key
+// of the PDF file: its size, its modification time and a hash of its
+// last kilobyte, which holds 'startxref' and, usually, the trailer
+// with the document /ID.
+//------------------------------------------------------------------------
+
+struct DocIndexEntry {
+  Goffset offset;
+  int gen;
+  XRefEntryType type;
+};
+
+class DocIndex {
+public:
+
+  // Compute the key of <file>.
+  DocIndex(GooFile *file);
+  ~DocIndex();
+
+  // Was the key computed?
+  GBool isOk() { return ok; }
+
+  // Read the index matching the key from <dir>.  Returns false if
+  // there is none, or if it is damaged or stale.
+  GBool read(GooString *dir);
+
+  // Write the index to <dir>, replacing any previous index of the
+  // same file.
+  GBool write(GooString *dir);
+
+  // Does the index hold the page tree?
+  GBool hasPageTree() { return numPages > 0; }
+
+private:
+
+  friend class XRef;
+  friend class Catalog;
+
+  GooString *getPath(GooString *dir);
+  void setTrailer(Object *dict);
+  Object *getTrailer(XRef *xref, Object *obj);
+
+  GBool ok;
+
+  // key
+  Goffset fileSize;
+  Goffset modTime;
+  unsigned long long tailHash;
+
+  // xref table
+  std::vector<DocIndexEntry> entries;
+  GooString *trailer;		// trailer dict, in PDF syntax
+  int rootNum, rootGen;
+  GBool xRefStream;
+  Goffset mainXRefOffset;
+  Goffset mainXRefEntriesOffset;
+  GBool xrefReconstructed;
+  std::vector<Goffset> streamEnds;
+
+  // page tree
+  int numPages;			// 0 if the page tree isn't indexed
+  std::vector<Ref> nodeRefs;	// Pages nodes, in tree walk order
+  std::vector<int> nodeParents;	// parent node of each Pages node,
+				//   -1 for the root
+  std::vector<Ref> pageRefs;	// object ID for each page
+  std::vector<int> pageNodes;	// parent node of each page
+};
+
+#endif
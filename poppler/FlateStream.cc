@@ -83,6 +83,32 @@ int FlateStream::lookChar() {
   return out_buf[out_pos];
 }
 
+int FlateStream::getChars(int nChars, Guchar *buffer) {
+  int n, m;
+
+  if (pred)
+    return pred->getChars(nChars, buffer);
+
+  n = 0;
+  while (n < nChars && !fill_buffer()) {
+    m = out_buf_len - out_pos;
+    if (m > nChars - n)
+      m = nChars - n;
+    memcpy(buffer + n, out_buf + out_pos, m);
+    out_pos += m;
+    n += m;
+  }
+  return n;
+}
+
+int FlateStream::lookBufferedChars(const Guchar **chars) {
+  if (pred || out_pos >= out_buf_len)
+    return 0;
+
+  *chars = out_buf + out_pos;
+  return out_buf_len - out_pos;
+}
+
 int FlateStream::fill_buffer() {
   /* only fill the buffer if it has all been used */
   if (out_pos >= out_buf_len) {
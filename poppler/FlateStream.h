@@ -50,6 +50,8 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int lookBufferedChars(const Guchar **chars);
+  virtual void skipBufferedChars(int n) { out_pos += n; }
   virtual int getRawChar();
   virtual void getRawChars(int nChars, int *buffer);
   virtual GooString *getPSFilter(int psLevel, const char *indent);
@@ -63,6 +65,9 @@ private:
     return out_buf[out_pos++];
   }
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   int fill_buffer(void);
   z_stream d_stream;
   StreamPredictor *pred;
@@ -128,6 +128,17 @@
 // fill.
 #define patchColorDelta (dblToCol((3. / 256.0)))
 
+// Size of the chunks of the content stream object arena.
+#define contentArenaChunkSize 8192
+
+// Once the objects of the top level content stream take more than
+// this, the arena is reset between operators.
+#define contentArenaResetSize 32768
+
+// Objects are allocated on the heap while the arena holds more than
+// this, which only happens in big nested content streams.
+#define contentArenaMaxSize (1024 * 1024)
+
 //------------------------------------------------------------------------
 // Operator table
 //------------------------------------------------------------------------
@@ -334,7 +345,7 @@ GfxResources::GfxResources(XRef *xref, Dict *resDictA, GfxResources *nextA) :
     // build font dictionary
     Dict *resDict = resDictA->copy(xref);
     fonts = NULL;
-    resDict->lookupNF("Font", &obj1);
+    resDict->lookupNF(knownNames.Font, &obj1);
     if (obj1.isRef()) {
       obj1.fetch(xref, &obj2);
       if (obj2.isDict()) {
@@ -348,22 +359,22 @@ GfxResources::GfxResources(XRef *xref, Dict *resDictA, GfxResources *nextA) :
     obj1.free();
 
     // get XObject dictionary
-    resDict->lookup("XObject", &xObjDict);
+    resDict->lookup(knownNames.XObject, &xObjDict);
 
     // get color space dictionary
-    resDict->lookup("ColorSpace", &colorSpaceDict);
+    resDict->lookup(knownNames.ColorSpace, &colorSpaceDict);
 
     // get pattern dictionary
-    resDict->lookup("Pattern", &patternDict);
+    resDict->lookup(knownNames.Pattern, &patternDict);
 
     // get shading dictionary
-    resDict->lookup("Shading", &shadingDict);
+    resDict->lookup(knownNames.Shading, &shadingDict);
 
     // get graphics state parameter dictionary
-    resDict->lookup("ExtGState", &gStateDict);
+    resDict->lookup(knownNames.ExtGState, &gStateDict);
 
     // get properties dictionary
-    resDict->lookup("Properties", &propertiesDict);
+    resDict->lookup(knownNames.Properties, &propertiesDict);
 
     delete resDict;
   } else {
@@ -571,6 +582,12 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   formDepth = 0;
   ocState = gTrue;
   parser = NULL;
+  if (globalParams->getContentArena()) {
+    arena = new GooArena(contentArenaChunkSize, contentArenaMaxSize);
+  } else {
+    arena = NULL;
+  }
+  displayDepth = 0;
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
 
@@ -623,6 +640,12 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   formDepth = 0;
   ocState = gTrue;
   parser = NULL;
+  if (globalParams->getContentArena()) {
+    arena = new GooArena(contentArenaChunkSize, contentArenaMaxSize);
+  } else {
+    arena = NULL;
+  }
+  displayDepth = 0;
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
 
@@ -705,6 +728,7 @@ Gfx::~Gfx() {
   while (mcStack) {
     popMarkedContent();
   }
+  delete arena;
 }
 
 void Gfx::display(Object *obj, GBool topLevel) {
@@ -726,9 +750,15 @@ void Gfx::display(Object *obj, GBool topLevel) {
     return;
   }
   parser = new Parser(xref, new Lexer(xref, obj), gFalse);
+  parser->setArena(arena);
+  ++displayDepth;
   go(topLevel);
+  --displayDepth;
   delete parser;
   parser = NULL;
+  if (arena && displayDepth == 0) {
+    arena->reset();
+  }
 }
 
 void Gfx::go(GBool topLevel) {
@@ -786,6 +816,15 @@ void Gfx::go(GBool topLevel) {
 	args[i].free();
       numArgs = 0;
 
+      // in the top level content stream, only the objects the parser
+      // read ahead are still in the arena at this point, so it can be
+      // reset once they are moved out
+      if (arena && displayDepth == 1 &&
+	  arena->getUsed() > contentArenaResetSize) {
+	parser->moveLookaheadToHeap();
+	arena->reset();
+      }
+
       // periodically update display
       if (++updateLevel >= 20000) {
 	out->dump();
@@ -857,17 +896,27 @@ void Gfx::go(GBool topLevel) {
 
 void Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   Operator *op;
+  ContentOp opIdx;
   char *name;
   Object *argPtr;
   int i;
 
-  // find operator
+  static_assert(numOps == numContentOps,
+		"opTab doesn't match the content operators");
+
+  // find operator -- the Lexer has classified the command already,
+  // unless it is not an operator
   name = cmd->getCmd();
-  if (!(op = findOp(name))) {
+  opIdx = cmd->getCmdOp();
+  if (opIdx == contentOpNone) {
+    opIdx = lookupContentOp(name, strlen(name));
+  }
+  if (opIdx == contentOpNone) {
     if (ignoreUndef == 0)
       error(errSyntaxError, getPos(), "Unknown operator '{0:s}'", name);
     return;
   }
+  op = &opTab[opIdx];
 
   // type check args
   argPtr = args;
@@ -904,28 +953,6 @@ void Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   (this->*op->func)(argPtr, numArgs);
 }
 
-Operator *Gfx::findOp(char *name) {
-  int a, b, m, cmp;
-
-  a = -1;
-  b = numOps;
-  cmp = 0; // make gcc happy
-  // invariant: opTab[a] < name < opTab[b]
-  while (b - a > 1) {
-    m = (a + b) / 2;
-    cmp = strcmp(opTab[m].name, name);
-    if (cmp < 0)
-      a = m;
-    else if (cmp > 0)
-      b = m;
-    else
-      a = b = m;
-  }
-  if (cmp != 0)
-    return NULL;
-  return &opTab[a];
-}
-
 GBool Gfx::checkArg(Object *arg, TchkType type) {
   switch (type) {
   case tchkBool:   return arg->isBool();
@@ -4200,15 +4227,19 @@ void Gfx::opXObject(Object args[], int numArgs) {
     out->opiBegin(state, opiDict.getDict());
   }
 #endif
-  obj1.streamGetDict()->lookup("Subtype", &obj2);
-  if (obj2.isName("Image")) {
+  obj1.streamGetDict()->lookup(knownNames.Subtype, &obj2);
+  if (obj2.isName(knownNames.Image)) {
     if (out->needNonText()) {
       res->lookupXObjectNF(name, &refObj);
+      useDecodedStream(&refObj, &obj1);
       doImage(&refObj, obj1.getStream(), gFalse);
       refObj.free();
     }
-  } else if (obj2.isName("Form")) {
+  } else if (obj2.isName(knownNames.Form)) {
     res->lookupXObjectNF(name, &refObj);
+    if (!out->useDrawForm()) {
+      useDecodedStream(&refObj, &obj1);
+    }
     GBool shouldDoForm = gTrue;
     std::set<int>::iterator drawingFormIt;
     if (refObj.isRef()) {
@@ -4230,7 +4261,7 @@ void Gfx::opXObject(Object args[], int numArgs) {
       formsDrawing.erase(drawingFormIt);
     }
     refObj.free();
-  } else if (obj2.isName("PS")) {
+  } else if (obj2.isName(knownNames.PS)) {
     obj1.streamGetDict()->lookup("Level1", &obj3);
     out->psXObject(obj1.getStream(),
 		   obj3.isStream() ? obj3.getStream() : (Stream *)NULL);
@@ -4249,6 +4280,15 @@ void Gfx::opXObject(Object args[], int numArgs) {
   obj1.free();
 }
 
+// If the stream <obj>, fetched from <ref>, is drawn over and over (a
+// logo, a letterhead form, ...), read its decoded data from the
+// document's decoded stream cache instead of decoding it again.
+void Gfx::useDecodedStream(Object *ref, Object *obj) {
+  if (ref->isRef() && obj->isStream() && out->useDecodedStreamCache()) {
+    xref->getDecodedStream(ref->getRef(), obj);
+  }
+}
+
 void Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
   Dict *dict, *maskDict;
   int width, height;
@@ -4492,6 +4532,14 @@ void Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
     maskColorMap = NULL; // make gcc happy
     dict->lookup("Mask", &maskObj);
     dict->lookup("SMask", &smaskObj);
+    if (!inlineImg) {
+      dict->lookupNF("Mask", &obj1);
+      useDecodedStream(&obj1, &maskObj);
+      obj1.free();
+      dict->lookupNF("SMask", &obj1);
+      useDecodedStream(&obj1, &smaskObj);
+      obj1.free();
+    }
     if (smaskObj.isStream()) {
       // soft mask
       if (inlineImg) {
@@ -4887,7 +4935,9 @@ void Gfx::doForm(Object *str) {
 	knockout = obj3.getBool();
       }
       obj3.free();
-      transpGroup = isolated || out->checkTransparencyGroup(state, knockout) || checkTransparencyGroup(resDict);
+      // the output device is asked last, so it is only asked about the
+      // groups that are up to it (see DisplayListOutputDev)
+      transpGroup = isolated || checkTransparencyGroup(resDict) || out->checkTransparencyGroup(state, knockout);
     }
     obj2.free();
   }
@@ -5045,22 +5095,29 @@ void Gfx::opBeginImage(Object args[], int numArgs) {
 Stream *Gfx::buildImageStream() {
   Object dict;
   Object obj;
+  GooArena *dictArena;
   char *key;
   Stream *str;
 
   // build dictionary
-  dict.initDict(xref);
+  dictArena = arena && !arena->isFull() ? arena : (GooArena *)NULL;
+  dict.initDict(xref, dictArena);
   parser->getObj(&obj);
   while (!obj.isCmd("ID") && !obj.isEOF()) {
     if (!obj.isName()) {
       error(errSyntaxError, getPos(), "Inline image dictionary key must be a name object");
       obj.free();
     } else {
-      key = copyString(obj.getName());
+      key = obj.getName();
+      if (!isInternedName(key)) {
+	key = dictArena ? dictArena->copyString(key) : copyString(key);
+      }
       obj.free();
       parser->getObj(&obj);
       if (obj.isEOF() || obj.isError()) {
-	gfree(key);
+	if (!dictArena) {
+	  freeName(key);
+	}
 	break;
       }
       dict.dictAdd(key, &obj);
@@ -226,6 +226,9 @@ private:
   MarkedContentStack *mcStack;	// current BMC/EMC stack
 
   Parser *parser;		// parser for page content stream(s)
+  GooArena *arena;		// arena for the objects parsed from the
+				//   content streams, or NULL
+  int displayDepth;		// nesting level of display()
   
   std::set<int> formsDrawing;	// the forms that are being drawn
 
@@ -233,11 +236,11 @@ private:
     (*abortCheckCbk)(void *data);
   void *abortCheckCbkData;
 
-  static Operator opTab[];	// table of operators
+  static Operator opTab[];	// table of operators, indexed by
+				//   ContentOp
 
   void go(GBool topLevel);
   void execOp(Object *cmd, Object args[], int numArgs);
-  Operator *findOp(char *name);
   GBool checkArg(Object *arg, TchkType type);
   Goffset getPos();
 
@@ -356,6 +359,7 @@ private:
 
   // XObject operators
   void opXObject(Object args[], int numArgs);
+  void useDecodedStream(Object *ref, Object *obj);
   void doImage(Object *ref, Stream *str, GBool inlineImg);
   void doForm(Object *str);
 
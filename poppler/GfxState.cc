@@ -1847,38 +1847,6 @@ void GfxLabColorSpace::getDefaultRanges(double *decodeLow, double *decodeRange,
 // GfxICCBasedColorSpace
 //------------------------------------------------------------------------
 
-class GfxICCBasedColorSpaceKey : public PopplerCacheKey
-{
-  public:
-    GfxICCBasedColorSpaceKey(int numA, int genA) : num(numA), gen(genA)
-    {
-    }
-    
-    bool operator==(const PopplerCacheKey &key) const
-    {
-      const GfxICCBasedColorSpaceKey *k = static_cast<const GfxICCBasedColorSpaceKey*>(&key);
-      return k->num == num && k->gen == gen;
-    }
-    
-    int num, gen;
-};
-
-class GfxICCBasedColorSpaceItem : public PopplerCacheItem
-{
-  public:
-    GfxICCBasedColorSpaceItem(GfxICCBasedColorSpace *csA)
-    {
-      cs = static_cast<GfxICCBasedColorSpace*>(csA->copy());
-    }
-    
-    ~GfxICCBasedColorSpaceItem()
-    {
-      delete cs;
-    }
-    
-    GfxICCBasedColorSpace *cs;
-};
-
 GfxICCBasedColorSpace::GfxICCBasedColorSpace(int nCompsA, GfxColorSpace *altA,
 					     Ref *iccProfileStreamA) {
   nComps = nCompsA;
@@ -1946,11 +1914,10 @@ GfxColorSpace *GfxICCBasedColorSpace::parse(Array *arr, OutputDev *out, GfxState
 #ifdef USE_CMS
   // check cache
   if (out && iccProfileStreamA.num > 0) {
-    GfxICCBasedColorSpaceKey k(iccProfileStreamA.num, iccProfileStreamA.gen);
-    GfxICCBasedColorSpaceItem *item = static_cast<GfxICCBasedColorSpaceItem *>(out->getIccColorSpaceCache()->lookup(k));
+    GfxICCBasedColorSpace *item = out->getIccColorSpaceCache()->lookup(iccProfileStreamA);
     if (item != NULL)
     {
-      cs = static_cast<GfxICCBasedColorSpace*>(item->cs->copy());
+      cs = static_cast<GfxICCBasedColorSpace*>(item->copy());
       int transformIntent = cs->getIntent();
       int cmsIntent = INTENT_RELATIVE_COLORIMETRIC;
       if (state != NULL) {
@@ -2096,9 +2063,7 @@ GfxColorSpace *GfxICCBasedColorSpace::parse(Array *arr, OutputDev *out, GfxState
   obj1.free();
   // put this colorSpace into cache
   if (out && iccProfileStreamA.num > 0) {
-    GfxICCBasedColorSpaceKey *k = new GfxICCBasedColorSpaceKey(iccProfileStreamA.num, iccProfileStreamA.gen);
-    GfxICCBasedColorSpaceItem *item = new GfxICCBasedColorSpaceItem(cs);
-    out->getIccColorSpaceCache()->put(k, item);
+    out->getIccColorSpaceCache()->put(iccProfileStreamA, static_cast<GfxICCBasedColorSpace*>(cs->copy()));
   }
 #endif
   return cs;
@@ -5989,7 +5954,7 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
 }
 
 GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
-  int n, i, k;
+  int n, nc, i, k;
 
   colorSpace = colorMap->colorSpace->copy();
   bits = colorMap->bits;
@@ -6000,29 +5965,31 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
   colorSpace2 = NULL;
   for (k = 0; k < gfxColorMaxComps; ++k) {
     lookup[k] = NULL;
+    lookup2[k] = NULL;
   }
+  byte_lookup = NULL;
+  // the lookup tables have (at most) 256 entries, see above
   n = 1 << bits;
+  if (n > 256) {
+    n = 256;
+  }
   if (colorSpace->getMode() == csIndexed) {
     colorSpace2 = ((GfxIndexedColorSpace *)colorSpace)->getBase();
-    for (k = 0; k < nComps2; ++k) {
-      lookup[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
-      memcpy(lookup[k], colorMap->lookup[k], n * sizeof(GfxColorComp));
-    }
   } else if (colorSpace->getMode() == csSeparation) {
     colorSpace2 = ((GfxSeparationColorSpace *)colorSpace)->getAlt();
-    for (k = 0; k < nComps2; ++k) {
-      lookup[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
-      memcpy(lookup[k], colorMap->lookup[k], n * sizeof(GfxColorComp));
-    }
-  } else {
-    for (k = 0; k < nComps; ++k) {
-      lookup[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
-      memcpy(lookup[k], colorMap->lookup[k], n * sizeof(GfxColorComp));
+  }
+  for (k = 0; k < nComps; ++k) {
+    lookup[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
+    memcpy(lookup[k], colorMap->lookup[k], n * sizeof(GfxColorComp));
+  }
+  nc = colorSpace2 ? nComps2 : nComps;
+  for (k = 0; k < nc; ++k) {
+    if (colorMap->lookup2[k]) {
+      lookup2[k] = (GfxColorComp *)gmallocn(n, sizeof(GfxColorComp));
+      memcpy(lookup2[k], colorMap->lookup2[k], n * sizeof(GfxColorComp));
     }
   }
   if (colorMap->byte_lookup) {
-    int nc = colorSpace2 ? nComps2 : nComps;
-
     byte_lookup = (Guchar *)gmallocn (n, nc);
     memcpy(byte_lookup, colorMap->byte_lookup, n * nc);
   }
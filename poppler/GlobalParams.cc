@@ -64,6 +64,7 @@
 #include "goo/GooList.h"
 #include "goo/GooHash.h"
 #include "goo/gfile.h"
+#include "goo/GooThread.h"
 #include "Error.h"
 #include "NameToCharCode.h"
 #include "CharCodeToUnicode.h"
@@ -622,6 +623,16 @@ GlobalParams::GlobalParams(const char *customPopplerDataDir)
   printCommands = gFalse;
   profileCommands = gFalse;
   errQuiet = gFalse;
+  objectCacheSize = 4096;
+  objStreamCacheSize = 16;
+  glyphCacheSize = 16 * 1024 * 1024;
+  type3CacheSize = 4 * 1024 * 1024;
+  objStreamCacheBytes = 32 * 1024 * 1024;
+  decodedStreamCacheBytes = 16 * 1024 * 1024;
+  mmapFiles = gFalse;
+  numThreads = 0;
+  docIndexDir = NULL;
+  contentArena = gFalse;
 
   cidToUnicodeCache = new CharCodeToUnicodeCache(cidToUnicodeCacheSize);
   unicodeToUnicodeCache =
@@ -796,6 +807,7 @@ GlobalParams::~GlobalParams() {
   deleteGooList(toUnicodeDirs, GooString);
   deleteGooHash(fontFiles, GooString);
   deleteGooList(fontDirs, GooString);
+  delete docIndexDir;
   deleteGooHash(ccFontFiles, GooString);
 #ifdef _WIN32
   deleteGooHash(substFiles, GooString);
@@ -1692,6 +1704,96 @@ GBool GlobalParams::getErrQuiet() {
   return errQuiet;
 }
 
+int GlobalParams::getObjectCacheSize() {
+  int size;
+
+  lockGlobalParams;
+  size = objectCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+int GlobalParams::getObjStreamCacheSize() {
+  int size;
+
+  lockGlobalParams;
+  size = objStreamCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+long GlobalParams::getGlyphCacheSize() {
+  long size;
+
+  lockGlobalParams;
+  size = glyphCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+long GlobalParams::getType3CacheSize() {
+  long size;
+
+  lockGlobalParams;
+  size = type3CacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+size_t GlobalParams::getObjStreamCacheBytes() {
+  size_t bytes;
+
+  lockGlobalParams;
+  bytes = objStreamCacheBytes;
+  unlockGlobalParams;
+  return bytes;
+}
+
+size_t GlobalParams::getDecodedStreamCacheBytes() {
+  size_t bytes;
+
+  lockGlobalParams;
+  bytes = decodedStreamCacheBytes;
+  unlockGlobalParams;
+  return bytes;
+}
+
+GBool GlobalParams::getMMapFiles() {
+  GBool mmapFilesA;
+
+  lockGlobalParams;
+  mmapFilesA = mmapFiles;
+  unlockGlobalParams;
+  return mmapFilesA;
+}
+
+int GlobalParams::getNumThreads() {
+  int n;
+
+  lockGlobalParams;
+  n = numThreads;
+  unlockGlobalParams;
+  return n > 0 ? n : gGetNumProcessors();
+}
+
+GooString *GlobalParams::getDocIndexDir() {
+  GooString *s;
+
+  lockGlobalParams;
+  s = docIndexDir ? docIndexDir->copy() : (GooString *)NULL;
+  unlockGlobalParams;
+  return s;
+}
+
+GBool GlobalParams::getContentArena() {
+  GBool contentArenaA;
+
+  lockGlobalParams;
+  contentArenaA = contentArena;
+  unlockGlobalParams;
+  return contentArenaA;
+}
+
 CharCodeToUnicode *GlobalParams::getCIDToUnicode(GooString *collection) {
   GooString *fileName;
   CharCodeToUnicode *ctu;
@@ -1968,6 +2070,67 @@ void GlobalParams::setErrQuiet(GBool errQuietA) {
   unlockGlobalParams;
 }
 
+void GlobalParams::setObjectCacheSize(int size) {
+  lockGlobalParams;
+  objectCacheSize = size;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setObjStreamCacheSize(int size) {
+  lockGlobalParams;
+  objStreamCacheSize = size > 0 ? size : 1;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setGlyphCacheSize(long size) {
+  lockGlobalParams;
+  glyphCacheSize = size > 0 ? size : 0;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setType3CacheSize(long size) {
+  lockGlobalParams;
+  type3CacheSize = size > 0 ? size : 0;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setObjStreamCacheBytes(size_t bytes) {
+  lockGlobalParams;
+  objStreamCacheBytes = bytes;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setDecodedStreamCacheBytes(size_t bytes) {
+  lockGlobalParams;
+  decodedStreamCacheBytes = bytes;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setMMapFiles(GBool mmapFilesA) {
+  lockGlobalParams;
+  mmapFiles = mmapFilesA;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setNumThreads(int numThreadsA) {
+  lockGlobalParams;
+  numThreads = numThreadsA > 0 ? numThreadsA : 0;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setDocIndexDir(const char *dir) {
+  lockGlobalParams;
+  delete docIndexDir;
+  docIndexDir = dir ? new GooString(dir) : (GooString *)NULL;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setContentArena(GBool contentArenaA) {
+  lockGlobalParams;
+  contentArena = contentArenaA;
+  unlockGlobalParams;
+}
+
 void GlobalParams::addSecurityHandler(XpdfSecurityHandler *handler) {
 #ifdef ENABLE_PLUGINS
   lockGlobalParams;
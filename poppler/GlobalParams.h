@@ -185,6 +185,16 @@ public:
   GBool getPrintCommands();
   GBool getProfileCommands();
   GBool getErrQuiet();
+  int getObjectCacheSize();
+  int getObjStreamCacheSize();
+  long getGlyphCacheSize();
+  long getType3CacheSize();
+  size_t getObjStreamCacheBytes();
+  size_t getDecodedStreamCacheBytes();
+  GBool getMMapFiles();
+  int getNumThreads();
+  GooString *getDocIndexDir();
+  GBool getContentArena();
 
   CharCodeToUnicode *getCIDToUnicode(GooString *collection);
   CharCodeToUnicode *getUnicodeToUnicode(GooString *fontName);
@@ -224,6 +234,16 @@ public:
   void setPrintCommands(GBool printCommandsA);
   void setProfileCommands(GBool profileCommandsA);
   void setErrQuiet(GBool errQuietA);
+  void setObjectCacheSize(int size);
+  void setObjStreamCacheSize(int size);
+  void setGlyphCacheSize(long size);
+  void setType3CacheSize(long size);
+  void setObjStreamCacheBytes(size_t bytes);
+  void setDecodedStreamCacheBytes(size_t bytes);
+  void setMMapFiles(GBool mmapFilesA);
+  void setNumThreads(int numThreadsA);
+  void setDocIndexDir(const char *dir);
+  void setContentArena(GBool contentArenaA);
 
   static GBool parseYesNo2(const char *token, GBool *flag);
 
@@ -311,6 +331,29 @@ private:
   GBool printCommands;		// print the drawing commands
   GBool profileCommands;	// profile the drawing commands
   GBool errQuiet;		// suppress error messages?
+  int objectCacheSize;		// max number of resolved objects cached
+				//   per XRef
+  int objStreamCacheSize;	// max number of decoded object streams
+				//   cached per XRef
+  long glyphCacheSize;		// max size of the glyph bitmaps shared by
+				//   SplashOutputDevs, in bytes (0 to
+				//   not share them)
+  long type3CacheSize;		// max size of the Type 3 fonts cached by
+				//   each SplashOutputDev, in bytes
+  size_t objStreamCacheBytes;	// max memory used by the cached object
+				//   streams of an XRef (0 = unbounded)
+  size_t decodedStreamCacheBytes; // max memory used by the decoded image
+				//   and form streams cached per XRef
+				//   (0 = no cache)
+  GBool mmapFiles;		// read local files through a memory
+				//   mapping instead of read calls
+  int numThreads;		// max number of threads used for work
+				//   that can be split up (0 = one per
+				//   processor)
+  GooString *docIndexDir;	// directory of the document index files
+				//   (NULL = no indexes)
+  GBool contentArena;		// allocate the objects parsed from content
+				//   streams in an arena
   double splashResolution;	// resolution when rasterizing images
 
   CharCodeToUnicodeCache *cidToUnicodeCache;
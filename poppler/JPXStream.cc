@@ -30,7 +30,9 @@
 
 #include <limits.h>
 #include "gmem.h"
+#include "goo/GooThread.h"
 #include "Error.h"
+#include "GlobalParams.h"
 #include "JArithmeticDecoder.h"
 #include "JPXStream.h"
 
@@ -70,6 +72,14 @@
 
 //------------------------------------------------------------------------
 
+// max number of resolution levels discarded by setDecodeScale
+#define jpxMaxReduce 5
+
+// max number of bytes read at once into a code-block's buffer
+#define jpxSegDataChunk 65536
+
+//------------------------------------------------------------------------
+
 // arithmetic decoder context for the significance propagation and
 // cleanup passes:
 //     [horiz][vert][diag][subband]
@@ -260,6 +270,9 @@ JPXStream::JPXStream(Stream *strA):
   bitBufSkip = gFalse;
   byteCount = 0;
 
+  reduce = 0;
+  regionX0 = regionY0 = regionX1 = regionY1 = 0;
+
   curX = curY = 0;
   curComp = 0;
   readBufLen = 0;
@@ -336,6 +349,8 @@ void JPXStream::close() {
 			for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
 			  cb = &subband->cbs[k];
 			  gfree(cb->dataLen);
+			  gfree(cb->segData);
+			  gfree(cb->segInfo);
 			  gfree(cb->touched);
 			  if (cb->arithDecoder) {
 			    delete cb->arithDecoder;
@@ -405,8 +420,9 @@ int JPXStream::lookChar() {
 }
 
 void JPXStream::fillReadBuf() {
+  JPXTile *tile;
   JPXTileComp *tileComp;
-  Guint tileIdx, tx, ty;
+  Guint tileIdx, tx, ty, tw, th;
   int pix, pixBits;
 
   do {
@@ -420,21 +436,39 @@ void JPXStream::fillReadBuf() {
       error(errSyntaxError, getPos(), "Unexpected tileIdx in fillReadBuf in JPX stream");
       return;
     } 
-    tileComp = &img.tiles[tileIdx].tileComps[curComp];
+    tile = &img.tiles[tileIdx];
+    tileComp = &tile->tileComps[curComp];
 #else
-    tileComp = &img.tiles[tileIdx].tileComps[havePalette ? 0 : curComp];
+    tile = &img.tiles[tileIdx];
+    tileComp = &tile->tileComps[havePalette ? 0 : curComp];
 #endif
-    tx = jpxCeilDiv((curX - img.xTileOffset) % img.xTileSize, tileComp->hSep);
-    ty = jpxCeilDiv((curY - img.yTileOffset) % img.yTileSize, tileComp->vSep);
-    if (unlikely(ty >= (tileComp->y1 - tileComp->y0))) {
-      error(errSyntaxError, getPos(), "Unexpected ty in fillReadBuf in JPX stream");
-      return;
-    }
-    if (unlikely(tx >= (tileComp->x1 - tileComp->x0))) {
-      error(errSyntaxError, getPos(), "Unexpected tx in fillReadBuf in JPX stream");
-      return;
+    if (tile->skip) {
+      pix = 0;
+    } else {
+      // the tile-component is decoded at 1/2^tile->reduce resolution,
+      // into the upper-left corner of its data array -- if the tile
+      // has fewer resolution levels than the stream's scale, this
+      // picks every 2^(reduce - tile->reduce)-th sample
+      tw = jpxCeilDivPow2(tileComp->x1, tile->reduce)
+	   - jpxCeilDivPow2(tileComp->x0, tile->reduce);
+      th = jpxCeilDivPow2(tileComp->y1, tile->reduce)
+	   - jpxCeilDivPow2(tileComp->y0, tile->reduce);
+      if (unlikely(tw == 0 || th == 0)) {
+	error(errSyntaxError, getPos(), "Empty tile-component in fillReadBuf in JPX stream");
+	return;
+      }
+      tx = jpxCeilDivPow2(jpxCeilDiv(curX, tileComp->hSep), tile->reduce)
+	   - jpxCeilDivPow2(tileComp->x0, tile->reduce);
+      ty = jpxCeilDivPow2(jpxCeilDiv(curY, tileComp->vSep), tile->reduce)
+	   - jpxCeilDivPow2(tileComp->y0, tile->reduce);
+      if (tx >= tw) {
+	tx = tw - 1;
+      }
+      if (ty >= th) {
+	ty = th - 1;
+      }
+      pix = (int)tileComp->data[ty * tileComp->w + tx];
     }
-    pix = (int)tileComp->data[ty * (tileComp->x1 - tileComp->x0) + tx];
     pixBits = tileComp->prec;
 #if 1 //~ ignore the palette, assume the PDF ColorSpace object is valid
     if (++curComp == img.nComps) {
@@ -450,9 +484,9 @@ void JPXStream::fillReadBuf() {
     if (++curComp == (Guint)(havePalette ? palette.nComps : img.nComps)) {
 #endif
       curComp = 0;
-      if (++curX == img.xSize) {
+      if ((curX += 1 << reduce) >= img.xSize) {
 	curX = img.xOffset;
-	++curY;
+	curY += 1 << reduce;
 	if (pixBits < 8) {
 	  pix <<= 8 - pixBits;
 	  pixBits = 8;
@@ -472,6 +506,18 @@ GooString *JPXStream::getPSFilter(int psLevel, const char *indent) {
   return NULL;
 }
 
+int JPXStream::setDecodeScale(int scale) {
+  for (reduce = 0; reduce < jpxMaxReduce && (2 << reduce) <= scale; ++reduce) ;
+  return 1 << reduce;
+}
+
+void JPXStream::setDecodeRegion(int x0, int y0, int x1, int y1) {
+  regionX0 = x0;
+  regionY0 = y0;
+  regionX1 = x1;
+  regionY1 = y1;
+}
+
 GBool JPXStream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
@@ -922,7 +968,6 @@ GBool JPXStream::readColorSpecBox(Guint dataLen) {
 
 GBool JPXStream::readCodestream(Guint len) {
   JPXTile *tile;
-  JPXTileComp *tileComp;
   int segType;
   GBool haveSIZ, haveCOD, haveQCD, haveSOT;
   Guint precinctSize, style, nDecompLevels;
@@ -990,6 +1035,8 @@ GBool JPXStream::readCodestream(Guint len) {
 				      sizeof(JPXTile));
       for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
 	img.tiles[i].init = gFalse;
+	img.tiles[i].skip = gFalse;
+	img.tiles[i].reduce = 0;
 	img.tiles[i].tileComps = (JPXTileComp *)gmallocn(img.nComps,
 							 sizeof(JPXTileComp));
 	for (comp = 0; comp < img.nComps; ++comp) {
@@ -1509,13 +1556,9 @@ GBool JPXStream::readCodestream(Guint len) {
       error(errSyntaxError, getPos(), "Uninitialized tile in JPX codestream");
       return gFalse;
     }
-    for (comp = 0; comp < img.nComps; ++comp) {
-      tileComp = &tile->tileComps[comp];
-      inverseTransform(tileComp);
-    }
-    if (!inverseMultiCompAndDC(tile)) {
-      return gFalse;
-    }
+  }
+  if (!decodeTiles()) {
+    return gFalse;
   }
 
   //~ can free memory below tileComps here, and also tileComp.buf
@@ -1557,6 +1600,20 @@ GBool JPXStream::readTilePart() {
   tilePartToEOC = tilePartLen == 0;
   tilePartLen -= 12; // subtract size of SOT segment
 
+  // skip the tile-parts of tiles outside the decode region
+  if (tilePartIdx == 0 && !tilePartToEOC && !tileInRegion(tileIdx)) {
+    img.tiles[tileIdx].init = gTrue;
+    img.tiles[tileIdx].skip = gTrue;
+  }
+  if (img.tiles[tileIdx].skip) {
+    if (tilePartToEOC) {
+      error(errSyntaxError, getPos(),
+	    "Unknown length of a skipped JPX tile-part");
+      return gFalse;
+    }
+    return skipBytes(tilePartLen);
+  }
+
   haveSOD = gFalse;
   do {
     if (!readMarkerHdr(&segType, &segLen)) {
@@ -1937,11 +1994,15 @@ GBool JPXStream::readTilePart() {
     tile->precinct = 0;
     tile->layer = 0;
     tile->maxNDecompLevels = 0;
+    tile->reduce = reduce;
     for (comp = 0; comp < img.nComps; ++comp) {
       tileComp = &tile->tileComps[comp];
       if (tileComp->nDecompLevels > tile->maxNDecompLevels) {
 	tile->maxNDecompLevels = tileComp->nDecompLevels;
       }
+      if (tileComp->nDecompLevels < tile->reduce) {
+	tile->reduce = tileComp->nDecompLevels;
+      }
       tileComp->x0 = jpxCeilDiv(tile->x0, tileComp->hSep);
       tileComp->y0 = jpxCeilDiv(tile->y0, tileComp->vSep);
       tileComp->x1 = jpxCeilDiv(tile->x1, tileComp->hSep);
@@ -2073,6 +2134,10 @@ GBool JPXStream::readTilePart() {
 		cb->nZeroBitPlanes = 0;
 		cb->dataLenSize = 1;
 		cb->dataLen = (Guint *)gmalloc(sizeof(Guint));
+		cb->segData = NULL;
+		cb->segDataLen = cb->segDataSize = 0;
+		cb->segInfo = NULL;
+		cb->segInfoLen = cb->segInfoSize = 0;
 		cb->coeffs = sbCoeffs
 		             + (cb->y0 - subband->y0) * tileComp->w
 		             + (cb->x0 - subband->x0);
@@ -2337,10 +2402,10 @@ GBool JPXStream::readTilePartData(Guint tileIdx,
 	for (cbX = 0; cbX < subband->nXCBs; ++cbX) {
 	  cb = &subband->cbs[cbY * subband->nXCBs + cbX];
 	  if (cb->included) {
-	    if (!readCodeBlockData(tileComp, resLevel, precinct, subband,
-				   tile->res, sb, cb)) {
-	      return gFalse;
-	    }
+	    // the data of discarded resolution levels is skipped
+	    readCodeBlockSegments(tileComp, cb,
+				  tile->res + tile->reduce
+				    <= tileComp->nDecompLevels);
 	    if (tileComp->codeBlockStyle & 0x04) {
 	      for (i = 0; i < cb->nCodingPasses; ++i) {
 		tilePartLen -= cb->dataLen[i];
@@ -2436,12 +2501,273 @@ GBool JPXStream::readTilePartData(Guint tileIdx,
   return gFalse;
 }
 
+// Read the data of a code-block's codeword segments in the current
+// packet into the code-block's buffer, or skip it if <keep> is false.
+// The buffer only grows with the data actually read: past the end of
+// the stream, the arithmetic decoder gets 0xff bytes, as it would if
+// it read the stream directly.
+void JPXStream::readCodeBlockSegments(JPXTileComp *tileComp,
+				      JPXCodeBlock *cb, GBool keep) {
+  Guint nSegs, len, n, i;
+  int got;
+
+  nSegs = (tileComp->codeBlockStyle & 0x04) ? cb->nCodingPasses : 1;
+  len = 0;
+  for (i = 0; i < nSegs; ++i) {
+    if (cb->dataLen[i] > UINT_MAX - len) {
+      len = UINT_MAX;
+      break;
+    }
+    len += cb->dataLen[i];
+  }
+  if (!keep) {
+    skipBytes(len);
+    return;
+  }
+
+  if (cb->segInfoLen + 1 + nSegs > cb->segInfoSize) {
+    cb->segInfoSize = 2 * cb->segInfoSize + 1 + nSegs;
+    cb->segInfo = (Guint *)greallocn(cb->segInfo, cb->segInfoSize,
+				     sizeof(Guint));
+  }
+  cb->segInfo[cb->segInfoLen++] = cb->nCodingPasses;
+  for (i = 0; i < nSegs; ++i) {
+    cb->segInfo[cb->segInfoLen++] = cb->dataLen[i];
+  }
+
+  while (len > 0) {
+    n = len < jpxSegDataChunk ? len : jpxSegDataChunk;
+    if (cb->segDataLen + n > cb->segDataSize) {
+      cb->segDataSize = 2 * cb->segDataSize;
+      if (cb->segDataSize < cb->segDataLen + n) {
+	cb->segDataSize = cb->segDataLen + n;
+      }
+      cb->segData = (Guchar *)grealloc(cb->segData, cb->segDataSize);
+    }
+    if ((got = bufStr->doGetChars(n, cb->segData + cb->segDataLen)) <= 0) {
+      break;
+    }
+    cb->segDataLen += got;
+    len -= got;
+  }
+}
+
+// Skip <n> bytes of the codestream.  Returns false at EOF.
+GBool JPXStream::skipBytes(Guint n) {
+  Guchar buf[4096];
+  int got;
+
+  while (n > 0) {
+    if ((got = bufStr->doGetChars(n < sizeof(buf) ? n : sizeof(buf),
+				  buf)) <= 0) {
+      error(errSyntaxError, getPos(), "Unexpected EOF in JPX stream");
+      return gFalse;
+    }
+    n -= got;
+  }
+  return gTrue;
+}
+
+// Returns true if the tile intersects the decode region (see
+// setDecodeRegion), or if there is no region.
+GBool JPXStream::tileInRegion(Guint tileIdx) {
+  Guint tx0, ty0, tx1, ty1, rx0, ry0, rx1, ry1;
+
+  if (regionX1 <= regionX0 || regionY1 <= regionY0) {
+    return gTrue;
+  }
+  tx0 = img.xTileOffset + (tileIdx % img.nXTiles) * img.xTileSize;
+  ty0 = img.yTileOffset + (tileIdx / img.nXTiles) * img.yTileSize;
+  tx1 = tx0 + img.xTileSize;
+  ty1 = ty0 + img.yTileSize;
+  rx0 = img.xOffset + (regionX0 > 0 ? regionX0 : 0);
+  ry0 = img.yOffset + (regionY0 > 0 ? regionY0 : 0);
+  rx1 = img.xOffset + regionX1;
+  ry1 = img.yOffset + regionY1;
+  return tx0 < rx1 && tx1 > rx0 && ty0 < ry1 && ty1 > ry0;
+}
+
+struct JPXCodeBlockJob {
+  JPXTileComp *tileComp;
+  JPXResLevel *resLevel;
+  JPXPrecinct *precinct;
+  JPXSubband *subband;
+  Guint res, sb;
+  JPXCodeBlock *cb;
+};
+
+struct JPXDecodeJobs {
+  JPXStream *str;
+  int phase;			// 0 = code-blocks, 1 = tile-components,
+				//   2 = tiles
+  JPXCodeBlockJob *cbs;		// the code-blocks that have data
+  int nCBs;
+  int nCBJobs;			// number of jobs the code-blocks are
+				//   split into
+  JPXTile **tiles;		// the tiles that aren't skipped
+  int nTiles;
+  Guint nComps;
+  GBool *tileOk;		// false if the tile couldn't be finished
+};
+
+// Decode the tiles (that aren't skipped) from the buffered code-block
+// data: first all the code-blocks, then the inverse wavelet transform
+// of each tile-component, then the inverse multi-component transform
+// and DC level shift of each tile.  In each phase, the pieces are
+// independent of each other, so they are spread over several threads.
+GBool JPXStream::decodeTiles() {
+  JPXDecodeJobs jobs;
+  JPXTile *tile;
+  JPXTileComp *tileComp;
+  JPXResLevel *resLevel;
+  JPXPrecinct *precinct;
+  JPXSubband *subband;
+  JPXCodeBlockJob *cbJob;
+  GBool ok;
+  Guint i, comp, r, sb, k;
+  int size, nThreads;
+
+  jobs.str = this;
+  jobs.cbs = NULL;
+  jobs.nCBs = size = 0;
+  jobs.tiles = (JPXTile **)gmallocn(img.nXTiles * img.nYTiles,
+				    sizeof(JPXTile *));
+  jobs.nTiles = 0;
+  jobs.nComps = img.nComps;
+  for (i = 0; i < img.nXTiles * img.nYTiles; ++i) {
+    tile = &img.tiles[i];
+    if (tile->skip) {
+      continue;
+    }
+    jobs.tiles[jobs.nTiles++] = tile;
+    for (comp = 0; comp < img.nComps; ++comp) {
+      tileComp = &tile->tileComps[comp];
+      for (r = 0; r + tile->reduce <= tileComp->nDecompLevels; ++r) {
+	resLevel = &tileComp->resLevels[r];
+	precinct = &resLevel->precincts[0];
+	for (sb = 0; sb < (Guint)(r == 0 ? 1 : 3); ++sb) {
+	  subband = &precinct->subbands[sb];
+	  for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
+	    if (subband->cbs[k].segInfoLen == 0) {
+	      continue;
+	    }
+	    if (jobs.nCBs == size) {
+	      size = size ? 2 * size : 64;
+	      jobs.cbs = (JPXCodeBlockJob *)greallocn(jobs.cbs, size,
+						      sizeof(JPXCodeBlockJob));
+	    }
+	    cbJob = &jobs.cbs[jobs.nCBs++];
+	    cbJob->tileComp = tileComp;
+	    cbJob->resLevel = resLevel;
+	    cbJob->precinct = precinct;
+	    cbJob->subband = subband;
+	    cbJob->res = r;
+	    cbJob->sb = sb;
+	    cbJob->cb = &subband->cbs[k];
+	  }
+	}
+      }
+    }
+  }
+  jobs.tileOk = (GBool *)gmallocn(jobs.nTiles > 0 ? jobs.nTiles : 1,
+				  sizeof(GBool));
+
+  // code-blocks take very different times to decode, so they are
+  // handed out in many small groups
+  nThreads = globalParams ? globalParams->getNumThreads() : 1;
+  jobs.nCBJobs = jobs.nCBs < 16 * nThreads ? jobs.nCBs : 16 * nThreads;
+  jobs.phase = 0;
+  gRunJobs(jobs.nCBJobs, nThreads, &decodeTilesJob, &jobs);
+  jobs.phase = 1;
+  gRunJobs(jobs.nTiles * img.nComps, nThreads, &decodeTilesJob, &jobs);
+  jobs.phase = 2;
+  gRunJobs(jobs.nTiles, nThreads, &decodeTilesJob, &jobs);
+
+  ok = gTrue;
+  for (i = 0; i < (Guint)jobs.nTiles; ++i) {
+    if (!jobs.tileOk[i]) {
+      ok = gFalse;
+    }
+  }
+  gfree(jobs.cbs);
+  gfree(jobs.tiles);
+  gfree(jobs.tileOk);
+  return ok;
+}
+
+void JPXStream::decodeTilesJob(int job, void *data) {
+  JPXDecodeJobs *jobs = (JPXDecodeJobs *)data;
+  JPXCodeBlockJob *cbJob;
+  JPXTile *tile;
+  int i, i0, i1;
+
+  switch (jobs->phase) {
+  case 0:
+    i0 = (int)((long long)job * jobs->nCBs / jobs->nCBJobs);
+    i1 = (int)((long long)(job + 1) * jobs->nCBs / jobs->nCBJobs);
+    for (i = i0; i < i1; ++i) {
+      cbJob = &jobs->cbs[i];
+      jobs->str->decodeCodeBlock(cbJob->tileComp, cbJob->resLevel,
+				 cbJob->precinct, cbJob->subband,
+				 cbJob->res, cbJob->sb, cbJob->cb);
+    }
+    break;
+  case 1:
+    tile = jobs->tiles[job / jobs->nComps];
+    jobs->str->inverseTransform(&tile->tileComps[job % jobs->nComps],
+				tile->reduce);
+    break;
+  case 2:
+    jobs->tileOk[job] = jobs->str->inverseMultiCompAndDC(jobs->tiles[job]);
+    break;
+  }
+}
+
+// Decode a code-block from the data buffered by readCodeBlockSegments,
+// a packet at a time, as if it was read from the codestream.
+void JPXStream::decodeCodeBlock(JPXTileComp *tileComp,
+				JPXResLevel *resLevel,
+				JPXPrecinct *precinct,
+				JPXSubband *subband,
+				Guint res, Guint sb,
+				JPXCodeBlock *cb) {
+  MemStream *dataStr;
+  Object dict;
+  Guint nSegs, i;
+
+  dict.initNull();
+  dataStr = new MemStream((char *)cb->segData, 0, cb->segDataLen, &dict);
+  for (i = 0; i < cb->segInfoLen; i += 1 + nSegs) {
+    cb->nCodingPasses = cb->segInfo[i];
+    nSegs = (tileComp->codeBlockStyle & 0x04) ? cb->nCodingPasses : 1;
+    if (nSegs > cb->segInfoLen - i - 1) {
+      break;
+    }
+    readCodeBlockData(tileComp, resLevel, precinct, subband, res, sb, cb,
+		      dataStr, cb->segInfo + i + 1);
+  }
+
+  // only the coefficients are needed from now on
+  delete cb->arithDecoder;
+  cb->arithDecoder = NULL;
+  delete cb->stats;
+  cb->stats = NULL;
+  delete dataStr;
+  gfree(cb->segData);
+  cb->segData = NULL;
+  cb->segDataLen = cb->segDataSize = 0;
+  gfree(cb->segInfo);
+  cb->segInfo = NULL;
+  cb->segInfoLen = cb->segInfoSize = 0;
+}
+
 GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 				   JPXResLevel *resLevel,
 				   JPXPrecinct *precinct,
 				   JPXSubband *subband,
 				   Guint res, Guint sb,
-				   JPXCodeBlock *cb) {
+				   JPXCodeBlock *cb, Stream *dataStr,
+				   Guint *dataLen) {
   int *coeff0, *coeff1, *coeff;
   char *touched0, *touched1, *touched;
   Guint horiz, vert, diag, all, cx, xorBit;
@@ -2451,11 +2777,11 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 
   if (cb->arithDecoder) {
     cover(63);
-    cb->arithDecoder->restart(cb->dataLen[0]);
+    cb->arithDecoder->restart(dataLen[0]);
   } else {
     cover(64);
     cb->arithDecoder = new JArithmeticDecoder();
-    cb->arithDecoder->setStream(bufStr, cb->dataLen[0]);
+    cb->arithDecoder->setStream(dataStr, dataLen[0]);
     cb->arithDecoder->start();
     cb->stats = new JArithmeticDecoderStats(jpxNContexts);
     cb->stats->setEntry(jpxContextSigProp, 4, 0);
@@ -2465,7 +2791,7 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 
   for (i = 0; i < cb->nCodingPasses; ++i) {
     if ((tileComp->codeBlockStyle & 0x04) && i > 0) {
-      cb->arithDecoder->setStream(bufStr, cb->dataLen[i]);
+      cb->arithDecoder->setStream(dataStr, dataLen[i]);
       cb->arithDecoder->start();
     }
 
@@ -2764,8 +3090,10 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 }
 
 // Inverse quantization, and wavelet transform (IDWT).  This also does
-// the initial shift to convert to fixed point format.
-void JPXStream::inverseTransform(JPXTileComp *tileComp) {
+// the initial shift to convert to fixed point format.  The last
+// <reduce> levels aren't transformed, which leaves the image at
+// 1/2^reduce resolution.
+void JPXStream::inverseTransform(JPXTileComp *tileComp, Guint reduce) {
   JPXResLevel *resLevel;
   JPXPrecinct *precinct;
   JPXSubband *subband;
@@ -2848,7 +3176,7 @@ void JPXStream::inverseTransform(JPXTileComp *tileComp) {
 
   //----- IDWT for each level
 
-  for (r = 1; r <= tileComp->nDecompLevels; ++r) {
+  for (r = 1; r + reduce <= tileComp->nDecompLevels; ++r) {
     resLevel = &tileComp->resLevels[r];
 
     // (n)LL is already in the upper-left corner of the
@@ -3178,12 +3506,13 @@ void JPXStream::inverseTransform1D(JPXTileComp *tileComp, int *data,
 }
 
 // Inverse multi-component transform and DC level shift.  This also
-// converts fixed point samples back to integers.
+// converts fixed point samples back to integers.  The tile-components
+// are at 1/2^tile->reduce resolution (see inverseTransform).
 GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
   JPXTileComp *tileComp;
   int coeff, d0, d1, d2, t, minVal, maxVal, zeroVal;
   int *dataPtr;
-  Guint j, comp, x, y;
+  Guint j, comp, x, y, w, h;
 
   //----- inverse multi-component transform
 
@@ -3196,13 +3525,18 @@ GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
 	tile->tileComps[1].vSep != tile->tileComps[2].vSep) {
       return gFalse;
     }
+    tileComp = &tile->tileComps[0];
+    w = jpxCeilDivPow2(tileComp->x1, tile->reduce)
+	- jpxCeilDivPow2(tileComp->x0, tile->reduce);
+    h = jpxCeilDivPow2(tileComp->y1, tile->reduce)
+	- jpxCeilDivPow2(tileComp->y0, tile->reduce);
 
     // inverse irreversible multiple component transform
     if (tile->tileComps[0].transform == 0) {
       cover(87);
-      j = 0;
-      for (y = 0; y < tile->tileComps[0].y1 - tile->tileComps[0].y0; ++y) {
-	for (x = 0; x < tile->tileComps[0].x1 - tile->tileComps[0].x0; ++x) {
+      for (y = 0; y < h; ++y) {
+	j = y * tileComp->w;
+	for (x = 0; x < w; ++x) {
 	  d0 = tile->tileComps[0].data[j];
 	  d1 = tile->tileComps[1].data[j];
 	  d2 = tile->tileComps[2].data[j];
@@ -3217,9 +3551,9 @@ GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
     // inverse reversible multiple component transform
     } else {
       cover(88);
-      j = 0;
-      for (y = 0; y < tile->tileComps[0].y1 - tile->tileComps[0].y0; ++y) {
-	for (x = 0; x < tile->tileComps[0].x1 - tile->tileComps[0].x0; ++x) {
+      for (y = 0; y < h; ++y) {
+	j = y * tileComp->w;
+	for (x = 0; x < w; ++x) {
 	  d0 = tile->tileComps[0].data[j];
 	  d1 = tile->tileComps[1].data[j];
 	  d2 = tile->tileComps[2].data[j];
@@ -3235,15 +3569,19 @@ GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
   //----- DC level shift
   for (comp = 0; comp < img.nComps; ++comp) {
     tileComp = &tile->tileComps[comp];
+    w = jpxCeilDivPow2(tileComp->x1, tile->reduce)
+	- jpxCeilDivPow2(tileComp->x0, tile->reduce);
+    h = jpxCeilDivPow2(tileComp->y1, tile->reduce)
+	- jpxCeilDivPow2(tileComp->y0, tile->reduce);
 
     // signed: clip
     if (tileComp->sgned) {
       cover(89);
       minVal = -(1 << (tileComp->prec - 1));
       maxVal = (1 << (tileComp->prec - 1)) - 1;
-      dataPtr = tileComp->data;
-      for (y = 0; y < tileComp->y1 - tileComp->y0; ++y) {
-	for (x = 0; x < tileComp->x1 - tileComp->x0; ++x) {
+      for (y = 0; y < h; ++y) {
+	dataPtr = tileComp->data + y * tileComp->w;
+	for (x = 0; x < w; ++x) {
 	  coeff = *dataPtr;
 	  if (tileComp->transform == 0) {
 	    cover(109);
@@ -3265,9 +3603,9 @@ GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
       cover(90);
       maxVal = (1 << tileComp->prec) - 1;
       zeroVal = 1 << (tileComp->prec - 1);
-      dataPtr = tileComp->data;
-      for (y = 0; y < tileComp->y1 - tileComp->y0; ++y) {
-	for (x = 0; x < tileComp->x1 - tileComp->x0; ++x) {
+      for (y = 0; y < h; ++y) {
+	dataPtr = tileComp->data + y * tileComp->w;
+	for (x = 0; x < w; ++x) {
 	  coeff = *dataPtr;
 	  if (tileComp->transform == 0) {
 	    cover(112);
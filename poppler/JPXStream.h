@@ -119,6 +119,15 @@ struct JPXCodeBlock {
   Guint *dataLen;		// data lengths (one per codeword segment)
   Guint dataLenSize;		// size of the dataLen array
 
+  //----- buffered data (decoded once the whole codestream is read)
+  Guchar *segData;		// data of all the codeword segments
+  Guint segDataLen;		// number of bytes in segData
+  Guint segDataSize;		// size of the segData array
+  Guint *segInfo;		// for each packet: the number of coding
+				//   passes, then the data length(s)
+  Guint segInfoLen;		// number of entries in segInfo
+  Guint segInfoSize;		// size of the segInfo array
+
   //----- coefficient data
   int *coeffs;
   char *touched;		// coefficient 'touched' flags
@@ -215,6 +224,8 @@ struct JPXTileComp {
 
 struct JPXTile {
   GBool init;
+  GBool skip;			// true if the tile is outside the decode
+				//   region, and isn't decoded
 
   //----- from the COD segments (main and tile)
   Guint progOrder;		// progression order
@@ -225,6 +236,8 @@ struct JPXTile {
   Guint x0, y0, x1, y1;		// bounds of the tile, in ref coords
   Guint maxNDecompLevels;	// max number of decomposition levels used
 				//   in any component in this tile
+  Guint reduce;			// number of resolution levels discarded
+				//   in every component of this tile
 
   //----- progression order loop counters
   Guint comp;			//   component
@@ -272,6 +285,14 @@ public:
   virtual void getImageParams(int *bitsPerComponent,
 			      StreamColorSpaceMode *csMode);
 
+  // Scales by powers of 2, down to 1/32, by discarding resolution
+  // levels (or, past the levels in the codestream, samples).
+  virtual int setDecodeScale(int scale);
+
+  // Tiles outside the region are skipped (if their tile-parts have a
+  // known length).
+  virtual void setDecodeRegion(int x0, int y0, int x1, int y1);
+
 private:
 
   void fillReadBuf();
@@ -282,13 +303,26 @@ private:
   GBool readTilePart();
   GBool readTilePartData(Guint tileIdx,
 			 Guint tilePartLen, GBool tilePartToEOC);
+  void readCodeBlockSegments(JPXTileComp *tileComp, JPXCodeBlock *cb,
+			     GBool keep);
+  GBool skipBytes(Guint n);
+  GBool tileInRegion(Guint tileIdx);
+  GBool decodeTiles();
+  static void decodeTilesJob(int job, void *data);
+  void decodeCodeBlock(JPXTileComp *tileComp,
+		       JPXResLevel *resLevel,
+		       JPXPrecinct *precinct,
+		       JPXSubband *subband,
+		       Guint res, Guint sb,
+		       JPXCodeBlock *cb);
   GBool readCodeBlockData(JPXTileComp *tileComp,
 			  JPXResLevel *resLevel,
 			  JPXPrecinct *precinct,
 			  JPXSubband *subband,
 			  Guint res, Guint sb,
-			  JPXCodeBlock *cb);
-  void inverseTransform(JPXTileComp *tileComp);
+			  JPXCodeBlock *cb, Stream *dataStr,
+			  Guint *dataLen);
+  void inverseTransform(JPXTileComp *tileComp, Guint reduce);
   void inverseTransformLevel(JPXTileComp *tileComp,
 			     Guint r, JPXResLevel *resLevel);
   void inverseTransform1D(JPXTileComp *tileComp, int *data,
@@ -330,6 +364,10 @@ private:
 				//   (for bit stuffing)
   Guint byteCount;		// number of available bytes left
 
+  Guint reduce;			// log2 of the decode scale
+  int regionX0, regionY0,	// decode region (see setDecodeRegion)
+      regionX1, regionY1;
+
   Guint curX, curY, curComp;	// current position for lookChar/getChar
   Guint readBuf;		// read buffer
   Guint readBufLen;		// number of valid bits in readBuf
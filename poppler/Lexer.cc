@@ -74,6 +74,8 @@ Lexer::Lexer(XRef *xrefA, Stream *str) {
 
   lookCharLastValueCached = LOOK_VALUE_NOT_CACHED;
   xref = xrefA;
+  arena = NULL;
+  bufStart = bufPtr = bufEnd = NULL;
 
   curStr.initStream(str);
   streams = new Array(xref);
@@ -88,6 +90,8 @@ Lexer::Lexer(XRef *xrefA, Object *obj) {
 
   lookCharLastValueCached = LOOK_VALUE_NOT_CACHED;
   xref = xrefA;
+  arena = NULL;
+  bufStart = bufPtr = bufEnd = NULL;
 
   if (obj->isStream()) {
     streams = new Array(xref);
@@ -106,6 +110,7 @@ Lexer::Lexer(XRef *xrefA, Object *obj) {
 
 Lexer::~Lexer() {
   if (!curStr.isNone()) {
+    syncStream();
     curStr.streamClose();
     curStr.free();
   }
@@ -123,8 +128,32 @@ int Lexer::getChar(GBool comesFromLook) {
     return c;
   }
 
+  if (likely(bufPtr < bufEnd)) {
+    return *bufPtr++;
+  }
+  return fillBuf(comesFromLook);
+}
+
+// Called when the chars borrowed from the current stream's buffer are
+// used up: borrow the next ones, or fall back to getChar, which also
+// refills the stream's buffer.
+int Lexer::fillBuf(GBool comesFromLook) {
+  Stream *str;
+  int c, n;
+
   c = EOF;
-  while (!curStr.isNone() && (c = curStr.streamGetChar()) == EOF) {
+  while (!curStr.isNone()) {
+    syncStream();
+    str = curStr.getStream();
+    if ((n = str->lookBufferedChars(&bufStart)) > 0) {
+      bufPtr = bufStart;
+      bufEnd = bufStart + n;
+      return *bufPtr++;
+    }
+    bufStart = NULL;
+    if ((c = str->getChar()) != EOF) {
+      break;
+    }
     if (comesFromLook == gTrue) {
       return EOF;
     } else {
@@ -164,6 +193,7 @@ Object *Lexer::getObj(Object *obj, int objNum) {
   double xf = 0, scale;
   GooString *s;
   int n, m;
+  ContentOp op;
 
   // skip whitespace and comments
   comment = gFalse;
@@ -382,7 +412,7 @@ Object *Lexer::getObj(Object *obj, int objNum) {
 	  // we are growing see if the document is not malformed and we are growing too much
 	  if (objNum > 0 && xref != NULL)
 	  {
-	    int newObjNum = xref->getNumEntry(curStr.streamGetPos());
+	    int newObjNum = xref->getNumEntry(getPos());
 	    if (newObjNum != objNum)
 	    {
 	      error(errSyntaxError, getPos(), "Unterminated string");
@@ -397,11 +427,12 @@ Object *Lexer::getObj(Object *obj, int objNum) {
       }
     } while (!done);
     if (n >= 0) {
-      if (!s)
-        s = new GooString(tokBuf, n);
-      else
+      if (!s) {
+        obj->initString(tokBuf, n, objArena());
+      } else {
         s->append(tokBuf, n);
-      obj->initString(s);
+        obj->initString(s);
+      }
     } else {
       obj->initEOF();
     }
@@ -455,9 +486,9 @@ Object *Lexer::getObj(Object *obj, int objNum) {
     }
     if (n < tokBufSize) {
       *p = '\0';
-      obj->initName(tokBuf);
+      obj->initName(tokBuf, objArena());
     } else {
-      obj->initName(s->getCString());
+      obj->initName(s->getCString(), objArena());
       delete s;
     }
     break;
@@ -467,7 +498,7 @@ Object *Lexer::getObj(Object *obj, int objNum) {
   case ']':
     tokBuf[0] = c;
     tokBuf[1] = '\0';
-    obj->initCmd(tokBuf);
+    obj->initCmd(tokBuf, objArena());
     break;
 
   // hex string or dict punctuation
@@ -479,7 +510,7 @@ Object *Lexer::getObj(Object *obj, int objNum) {
       getChar();
       tokBuf[0] = tokBuf[1] = '<';
       tokBuf[2] = '\0';
-      obj->initCmd(tokBuf);
+      obj->initCmd(tokBuf, objArena());
 
     // hex string
     } else {
@@ -520,13 +551,17 @@ Object *Lexer::getObj(Object *obj, int objNum) {
 	  }
 	}
       }
-      if (!s)
-	s = new GooString(tokBuf, n);
-      else
-	s->append(tokBuf, n);
-      if (m == 1)
-	s->append((char)(c2 << 4));
-      obj->initString(s);
+      if (!s && m == 0) {
+	obj->initString(tokBuf, n, objArena());
+      } else {
+	if (!s)
+	  s = new GooString(tokBuf, n);
+	else
+	  s->append(tokBuf, n);
+	if (m == 1)
+	  s->append((char)(c2 << 4));
+	obj->initString(s);
+      }
     }
     break;
 
@@ -537,7 +572,7 @@ Object *Lexer::getObj(Object *obj, int objNum) {
       getChar();
       tokBuf[0] = tokBuf[1] = '>';
       tokBuf[2] = '\0';
-      obj->initCmd(tokBuf);
+      obj->initCmd(tokBuf, objArena());
     } else {
       error(errSyntaxError, getPos(), "Illegal character '>'");
       obj->initError();
@@ -566,14 +601,16 @@ Object *Lexer::getObj(Object *obj, int objNum) {
       *p++ = c;
     }
     *p = '\0';
-    if (tokBuf[0] == 't' && !strcmp(tokBuf, "true")) {
+    if ((op = lookupContentOp(tokBuf, n)) != contentOpNone) {
+      obj->initCmd(op);
+    } else if (tokBuf[0] == 't' && !strcmp(tokBuf, "true")) {
       obj->initBool(gTrue);
     } else if (tokBuf[0] == 'f' && !strcmp(tokBuf, "false")) {
       obj->initBool(gFalse);
     } else if (tokBuf[0] == 'n' && !strcmp(tokBuf, "null")) {
       obj->initNull();
     } else {
-      obj->initCmd(tokBuf);
+      obj->initCmd(tokBuf, objArena());
     }
     break;
   }
@@ -618,7 +655,7 @@ Object *Lexer::getObj(Object *obj, const char *cmdA, int objNum) {
     }
     *p = '\0';
   }
-  obj->initCmd(tokBuf);
+  obj->initCmd(tokBuf, objArena());
   
   return obj;
 }
@@ -67,20 +67,25 @@ public:
 
   // Get stream.
   Stream *getStream()
-    { return curStr.isStream() ? curStr.getStream() : (Stream *)NULL; }
+    { syncStream();
+      return curStr.isStream() ? curStr.getStream() : (Stream *)NULL; }
 
   // Get current position in file.  This is only used for error
   // messages.
   Goffset getPos()
-    { return curStr.isStream() ? curStr.streamGetPos() : -1; }
+    { syncStream(); return curStr.isStream() ? curStr.streamGetPos() : -1; }
 
   // Set position in file.
   void setPos(Goffset pos, int dir = 0)
-    { if (curStr.isStream()) curStr.streamSetPos(pos, dir); }
+    { syncStream(); if (curStr.isStream()) curStr.streamSetPos(pos, dir); }
 
   // Returns true if <c> is a whitespace character.
   static GBool isSpace(int c);
 
+  // Allocate the strings, names and commands returned by getObj in
+  // <arenaA>, until it is full.  NULL allocates them on the heap.
+  void setArena(GooArena *arenaA) { arena = arenaA; }
+
 
   // often (e.g. ~30% on PDF Refernce 1.6 pdf file from Adobe site) getChar
   // is called right after lookChar. In order to avoid expensive re-doing
@@ -95,14 +100,28 @@ private:
 
   int getChar(GBool comesFromLook = gFalse);
   int lookChar();
+  int fillBuf(GBool comesFromLook);
+
+  // Consume the chars read from the current stream's buffer, so that
+  // the stream is positioned right after the last char the lexer got.
+  GooArena *objArena()
+    { return arena && !arena->isFull() ? arena : (GooArena *)NULL; }
+
+  void syncStream()
+    { if (bufPtr != bufStart) curStr.getStream()->skipBufferedChars(bufPtr - bufStart);
+      bufStart = bufPtr = bufEnd = NULL; }
 
   Array *streams;		// array of input streams
   int strPtr;			// index of current stream
   Object curStr;		// current stream
   GBool freeArray;		// should lexer free the streams array?
   char tokBuf[tokBufSize];	// temporary token buffer
+  const Guchar *bufStart;	// chars borrowed from the current
+  const Guchar *bufPtr;		//   stream's buffer, see
+  const Guchar *bufEnd;		//   Stream::lookBufferedChars
 
   XRef *xref;
+  GooArena *arena;		// arena for the objects, or NULL
 };
 
 #endif
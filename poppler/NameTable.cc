@@ -0,0 +1,177 @@
+//========================================================================
+//
+// NameTable.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <atomic>
+#include <string.h>
+#include "NameTable.h"
+
+// Longest name that gets interned.
+#define maxInternedNameLength 63
+
+// Number of slots in the table of interned names (a power of 2), and
+// max number of names interned, to keep probe sequences short.
+#define internedNameSlots 32768
+#define maxInternedNames 24576
+
+//------------------------------------------------------------------------
+// known names
+//------------------------------------------------------------------------
+
+const KnownNames knownNames = {
+#define KNOWN_NAME_INIT(id, str) str,
+  KNOWN_NAMES(KNOWN_NAME_INIT)
+#undef KNOWN_NAME_INIT
+};
+
+#define knownNameSlots 1024
+
+static unsigned int hashName(const char *s, int length) {
+  unsigned int h;
+  int i;
+
+  h = 2166136261u;
+  for (i = 0; i < length; ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static inline GBool nameEquals(const char *name, const char *s, int length) {
+  return !memcmp(name, s, length) && name[length] == '\0';
+}
+
+// Open hash table of the known names, built on first use.
+class KnownNameIndex {
+public:
+
+  KnownNameIndex() {
+    const char *p, *end;
+    unsigned int h;
+    int length;
+
+    memset(slots, 0, sizeof(slots));
+    p = (const char *)&knownNames;
+    end = p + sizeof(knownNames);
+    while (p < end) {
+      length = strlen(p);
+      h = hashName(p, length) & (knownNameSlots - 1);
+      while (slots[h]) {
+	h = (h + 1) & (knownNameSlots - 1);
+      }
+      slots[h] = p;
+      p += length + 1;
+    }
+  }
+
+  const char *lookup(const char *s, int length, unsigned int hash) {
+    const char *p;
+    unsigned int h;
+
+    for (h = hash & (knownNameSlots - 1);
+	 (p = slots[h]);
+	 h = (h + 1) & (knownNameSlots - 1)) {
+      if (nameEquals(p, s, length)) {
+	return p;
+      }
+    }
+    return NULL;
+  }
+
+private:
+
+  const char *slots[knownNameSlots];
+};
+
+static KnownNameIndex *getKnownNameIndex() {
+  static KnownNameIndex index;
+
+  return &index;
+}
+
+//------------------------------------------------------------------------
+// interned names
+//
+// The table only ever grows, so it is lock free: a name is written to
+// the storage before its pointer is published in a slot, and a thread
+// that loses the race for a slot just leaves its copy unused.
+//------------------------------------------------------------------------
+
+static std::atomic<const char *> internedNames[internedNameSlots];
+static std::atomic<int> numInternedNames(0);
+char internedNameStorage[internedNameStorageSize];
+static std::atomic<size_t> internedNameStorageUsed(0);
+
+static const char *lookupOrIntern(const char *s, int length,
+				  unsigned int hash) {
+  const char *p, *expected;
+  char *copy;
+  unsigned int h;
+  size_t offset;
+
+  copy = NULL;
+  h = hash & (internedNameSlots - 1);
+  while (1) {
+    p = internedNames[h].load(std::memory_order_acquire);
+    if (!p) {
+      if (!copy) {
+	if (numInternedNames.load(std::memory_order_relaxed) >=
+	      maxInternedNames) {
+	  return NULL;
+	}
+	offset = internedNameStorageUsed.fetch_add(length + 1);
+	if (offset + length + 1 > internedNameStorageSize) {
+	  return NULL;
+	}
+	copy = internedNameStorage + offset;
+	memcpy(copy, s, length);
+	copy[length] = '\0';
+      }
+      expected = NULL;
+      if (internedNames[h].compare_exchange_strong(expected, copy,
+						   std::memory_order_acq_rel)) {
+	++numInternedNames;
+	return copy;
+      }
+      p = expected;
+    }
+    if (nameEquals(p, s, length)) {
+      return p;
+    }
+    h = (h + 1) & (internedNameSlots - 1);
+  }
+}
+
+//------------------------------------------------------------------------
+
+const char *internName(const char *s) {
+  return internName(s, strlen(s));
+}
+
+const char *internName(const char *s, int length) {
+  const char *p;
+  unsigned int hash;
+
+  if (length > maxInternedNameLength || memchr(s, '\0', length)) {
+    return NULL;
+  }
+  hash = hashName(s, length);
+  if ((p = getKnownNameIndex()->lookup(s, length, hash))) {
+    return p;
+  }
+  return lookupOrIntern(s, length, hash);
+}
+
+const char *lookupKnownName(const char *s) {
+  int length;
+
+  length = strlen(s);
+  return getKnownNameIndex()->lookup(s, length, hashName(s, length));
+}
@@ -0,0 +1,217 @@
+//========================================================================
+//
+// NameTable.h
+//
+// Interned PDF names.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <string.h>
+#include "goo/gtypes.h"
+#include "goo/gmem.h"
+
+//------------------------------------------------------------------------
+// Known names
+//
+// Names, dictionary keys and content stream operators that show up in
+// nearly every file.  They are interned from the start, so
+// knownNames.Type, for instance, is the interned copy of "Type": code
+// that passes it to Dict::lookup or Object::isName gets a pointer
+// compare instead of a strcmp.
+//------------------------------------------------------------------------
+
+#define KNOWN_NAMES(X)							\
+  /* structure */							\
+  X(Type, "Type") X(Subtype, "Subtype") X(Length, "Length")		\
+  X(Filter, "Filter") X(DecodeParms, "DecodeParms") X(DL, "DL")		\
+  X(N, "N") X(First, "First") X(Extends, "Extends") X(Prev, "Prev")	\
+  X(Size, "Size") X(Index, "Index") X(Root, "Root") X(Info, "Info")	\
+  X(ID, "ID") X(Encrypt, "Encrypt") X(XRefStm, "XRefStm")		\
+  X(XRef, "XRef") X(ObjStm, "ObjStm") X(Catalog, "Catalog")		\
+  X(Pages, "Pages") X(Page, "Page") X(Parent, "Parent") X(Kids, "Kids")	\
+  X(Count, "Count") X(Resources, "Resources") X(Contents, "Contents")	\
+  X(MediaBox, "MediaBox") X(CropBox, "CropBox") X(BleedBox, "BleedBox")	\
+  X(TrimBox, "TrimBox") X(ArtBox, "ArtBox") X(Rotate, "Rotate")		\
+  X(Annots, "Annots") X(Group, "Group") X(Metadata, "Metadata")		\
+  X(StructParents, "StructParents") X(Names, "Names") X(Dests, "Dests")	\
+  X(Outlines, "Outlines") X(Title, "Title") X(Next, "Next")		\
+  X(Dest, "Dest") X(A, "A") X(Rect, "Rect") X(P, "P") X(AP, "AP")	\
+  X(AS, "AS") X(Border, "Border") X(C, "C") X(Annot, "Annot")		\
+  X(Link, "Link") X(Widget, "Widget") X(Action, "Action")		\
+  X(URI, "URI") X(GoTo, "GoTo") X(Limits, "Limits") X(Nums, "Nums")	\
+  X(StructTreeRoot, "StructTreeRoot") X(MarkInfo, "MarkInfo")		\
+  X(Lang, "Lang") X(Producer, "Producer") X(Creator, "Creator")		\
+  X(CreationDate, "CreationDate") X(ModDate, "ModDate")			\
+  X(OCProperties, "OCProperties") X(OCG, "OCG") X(OCMD, "OCMD")		\
+  /* resources */							\
+  X(Font, "Font") X(XObject, "XObject") X(ExtGState, "ExtGState")	\
+  X(ColorSpace, "ColorSpace") X(Pattern, "Pattern")			\
+  X(Shading, "Shading") X(Properties, "Properties")			\
+  X(ProcSet, "ProcSet") X(PDF, "PDF") X(Text, "Text")			\
+  X(ImageB, "ImageB") X(ImageC, "ImageC") X(ImageI, "ImageI")		\
+  /* XObjects and images */						\
+  X(Image, "Image") X(Form, "Form") X(PS, "PS") X(BBox, "BBox")		\
+  X(Matrix, "Matrix") X(FormType, "FormType") X(Width, "Width")		\
+  X(Height, "Height") X(BitsPerComponent, "BitsPerComponent")		\
+  X(ImageMask, "ImageMask") X(Mask, "Mask") X(SMask, "SMask")		\
+  X(SMaskInData, "SMaskInData") X(Decode, "Decode")			\
+  X(Interpolate, "Interpolate") X(Intent, "Intent") X(OC, "OC")		\
+  X(Name, "Name") X(BPC, "BPC") X(IM, "IM") X(H, "H") X(I, "I")		\
+  X(D, "D") X(Transparency, "Transparency") X(Alpha, "Alpha")		\
+  X(Luminosity, "Luminosity") X(Backdrop, "Backdrop") X(TR, "TR")	\
+  X(TR2, "TR2") X(Isolated, "Isolated") X(Knockout, "Knockout")		\
+  X(MCID, "MCID") X(ActualText, "ActualText") X(Alt, "Alt")		\
+  X(Span, "Span") X(Artifact, "Artifact")				\
+  /* filters */								\
+  X(FlateDecode, "FlateDecode") X(Fl, "Fl") X(LZWDecode, "LZWDecode")	\
+  X(LZW, "LZW") X(ASCIIHexDecode, "ASCIIHexDecode") X(AHx, "AHx")	\
+  X(ASCII85Decode, "ASCII85Decode") X(A85, "A85")			\
+  X(RunLengthDecode, "RunLengthDecode") X(RL, "RL")			\
+  X(CCITTFaxDecode, "CCITTFaxDecode") X(CCF, "CCF")			\
+  X(DCTDecode, "DCTDecode") X(DCT, "DCT") X(JPXDecode, "JPXDecode")	\
+  X(JBIG2Decode, "JBIG2Decode") X(JBIG2Globals, "JBIG2Globals")		\
+  X(Crypt, "Crypt") X(Predictor, "Predictor") X(Colors, "Colors")	\
+  X(Columns, "Columns") X(EarlyChange, "EarlyChange") X(K, "K")		\
+  X(EncodedByteAlign, "EncodedByteAlign") X(Rows, "Rows")		\
+  X(EndOfBlock, "EndOfBlock") X(BlackIs1, "BlackIs1")			\
+  X(ColorTransform, "ColorTransform") X(DP, "DP") X(F, "F")		\
+  /* color spaces */							\
+  X(DeviceGray, "DeviceGray") X(DeviceRGB, "DeviceRGB")			\
+  X(DeviceCMYK, "DeviceCMYK") X(CalGray, "CalGray") X(CalRGB, "CalRGB")	\
+  X(Lab, "Lab") X(ICCBased, "ICCBased") X(Indexed, "Indexed")		\
+  X(Separation, "Separation") X(DeviceN, "DeviceN") X(G, "G")		\
+  X(RGB, "RGB") X(CMYK, "CMYK") X(Alternate, "Alternate")		\
+  X(Range, "Range") X(WhitePoint, "WhitePoint") X(All, "All")		\
+  X(CS, "CS") X(PatternType, "PatternType")		\
+  X(PaintType, "PaintType") X(TilingType, "TilingType")			\
+  X(XStep, "XStep") X(YStep, "YStep") X(ShadingType, "ShadingType")	\
+  X(Coords, "Coords") X(Domain, "Domain") X(Function, "Function")	\
+  X(FunctionType, "FunctionType") X(Background, "Background")		\
+  X(AntiAlias, "AntiAlias") X(C0, "C0") X(C1, "C1")			\
+  /* graphics states */							\
+  X(LW, "LW") X(LC, "LC") X(LJ, "LJ") X(ML, "ML") X(RI, "RI")		\
+  X(OP, "OP") X(op, "op") X(OPM, "OPM") X(FL, "FL") X(SM, "SM")		\
+  X(SA, "SA") X(BM, "BM") X(CA, "CA") X(ca, "ca") X(AIS, "AIS")		\
+  X(TK, "TK") X(Normal, "Normal") X(Compatible, "Compatible")		\
+  X(Multiply, "Multiply")						\
+  /* fonts */								\
+  X(BaseFont, "BaseFont") X(FirstChar, "FirstChar")			\
+  X(LastChar, "LastChar") X(Widths, "Widths")				\
+  X(FontDescriptor, "FontDescriptor") X(Encoding, "Encoding")		\
+  X(ToUnicode, "ToUnicode") X(DescendantFonts, "DescendantFonts")	\
+  X(CIDSystemInfo, "CIDSystemInfo") X(CIDToGIDMap, "CIDToGIDMap")	\
+  X(DW, "DW") X(W, "W") X(DW2, "DW2") X(W2, "W2")			\
+  X(FontName, "FontName") X(FontFamily, "FontFamily")			\
+  X(FontFile, "FontFile") X(FontFile2, "FontFile2")			\
+  X(FontFile3, "FontFile3") X(Flags, "Flags") X(FontBBox, "FontBBox")	\
+  X(FontMatrix, "FontMatrix") X(ItalicAngle, "ItalicAngle")		\
+  X(Ascent, "Ascent") X(Descent, "Descent") X(CapHeight, "CapHeight")	\
+  X(StemV, "StemV") X(MissingWidth, "MissingWidth")			\
+  X(Differences, "Differences") X(BaseEncoding, "BaseEncoding")		\
+  X(CharProcs, "CharProcs") X(Type0, "Type0") X(Type1, "Type1")		\
+  X(MMType1, "MMType1") X(Type3, "Type3") X(TrueType, "TrueType")	\
+  X(CIDFontType0, "CIDFontType0") X(CIDFontType2, "CIDFontType2")	\
+  X(Registry, "Registry") X(Ordering, "Ordering")			\
+  X(Supplement, "Supplement") X(Identity, "Identity")			\
+  X(IdentityH, "Identity-H") X(IdentityV, "Identity-V")			\
+  X(WinAnsiEncoding, "WinAnsiEncoding")					\
+  X(MacRomanEncoding, "MacRomanEncoding")				\
+  X(StandardEncoding, "StandardEncoding")				\
+  /* content stream operators */					\
+  X(quote, "'") X(doubleQuote, "\"") X(b, "b") X(B, "B")		\
+  X(bStar, "b*") X(BStar, "B*") X(BDC, "BDC") X(BI, "BI")		\
+  X(BMC, "BMC") X(BT, "BT") X(BX, "BX") X(c, "c") X(cm, "cm")		\
+  X(cs, "cs") X(d, "d") X(d0, "d0") X(d1, "d1") X(Do, "Do")		\
+  X(EI, "EI") X(EMC, "EMC") X(ET, "ET") X(EX, "EX") X(f, "f")		\
+  X(fStar, "f*") X(g, "g") X(gs, "gs") X(h, "h") X(i, "i") X(j, "j")	\
+  X(J, "J") X(k, "k") X(l, "l") X(m, "m") X(M, "M") X(MP, "MP")		\
+  X(n, "n") X(q, "q") X(Q, "Q") X(re, "re") X(RG, "RG") X(rg, "rg")	\
+  X(ri, "ri") X(s, "s") X(S, "S") X(SC, "SC") X(sc, "sc")		\
+  X(SCN, "SCN") X(scn, "scn") X(sh, "sh") X(TStar, "T*") X(Tc, "Tc")	\
+  X(Td, "Td") X(TD, "TD") X(Tf, "Tf") X(Tj, "Tj") X(TJ, "TJ")		\
+  X(TL, "TL") X(Tm, "Tm") X(Tr, "Tr") X(Ts, "Ts") X(Tw, "Tw")		\
+  X(Tz, "Tz") X(v, "v") X(w, "w") X(WStar, "W*") X(y, "y")		\
+  /* other commands */							\
+  X(arrayStart, "[") X(arrayEnd, "]") X(dictStart, "<<")		\
+  X(dictEnd, ">>") X(R, "R") X(obj, "obj") X(endobj, "endobj")		\
+  X(stream, "stream") X(endstream, "endstream") X(xref, "xref")		\
+  X(trailer, "trailer") X(startxref, "startxref")
+
+struct KnownNames {
+#define KNOWN_NAME_FIELD(id, str) char id[sizeof(str)];
+  KNOWN_NAMES(KNOWN_NAME_FIELD)
+#undef KNOWN_NAME_FIELD
+};
+
+extern const KnownNames knownNames;
+
+//------------------------------------------------------------------------
+// Interning
+//
+// Other names are interned as they are parsed, up to a fixed number of
+// names and bytes for the whole process, so that a stream of files
+// with made-up names can't make the table grow without bound.  Once
+// the table is full, names are copied to the heap as before.  Interned
+// names are never freed, and are shared by all threads.
+//------------------------------------------------------------------------
+
+// Get the interned copy of the name <s>, interning it if needed.
+// Returns NULL if <s> can't be interned.
+const char *internName(const char *s);
+const char *internName(const char *s, int length);
+
+// Get the interned copy of <s> if it is one of the known names, else
+// NULL.
+const char *lookupKnownName(const char *s);
+
+#define internedNameStorageSize (512 * 1024)
+extern char internedNameStorage[internedNameStorageSize];
+
+// Is <s> an interned name?  Two interned names are equal if and only
+// if they are the same pointer.
+inline GBool isInternedName(const char *s) {
+  return (s >= (const char *)&knownNames &&
+	  s < (const char *)&knownNames + sizeof(knownNames)) ||
+         (s >= internedNameStorage &&
+	  s < internedNameStorage + internedNameStorageSize);
+}
+
+// Compare two names, by pointer if both are interned.
+inline GBool equalNames(const char *s1, const char *s2) {
+  if (s1 == s2) {
+    return gTrue;
+  }
+  if (isInternedName(s1) && isInternedName(s2)) {
+    return gFalse;
+  }
+  return !strcmp(s1, s2);
+}
+
+// Get the interned copy of <s>, or a heap copy if it can't be
+// interned.  Free it with freeName.
+inline char *copyName(const char *s) {
+  const char *p = internName(s);
+  return p ? (char *)p : copyString(s);
+}
+
+// Get the known name <s>, or a heap copy if it isn't one.  Commands
+// are only looked up in the known names, so that the junk found in
+// damaged content streams doesn't fill the table.  Free it with
+// freeName.
+inline char *copyKnownName(const char *s) {
+  const char *p = lookupKnownName(s);
+  return p ? (char *)p : copyString(s);
+}
+
+inline void freeName(char *s) {
+  if (!isInternedName(s)) {
+    gfree(s);
+  }
+}
+
+#endif
@@ -28,6 +28,7 @@
 #endif
 
 #include <stddef.h>
+#include <new>
 #include "Object.h"
 #include "Array.h"
 #include "Dict.h"
@@ -81,6 +82,67 @@ Object *Object::initDict(Dict *dictA) {
   return this;
 }
 
+Object *Object::initName(const char *nameA, GooArena *arena) {
+  const char *p;
+
+  initObj(objName);
+  if ((p = internName(nameA))) {
+    name = (char *)p;
+  } else if (arena) {
+    inArena = gTrue;
+    name = arena->copyString(nameA);
+  } else {
+    name = copyString(nameA);
+  }
+  return this;
+}
+
+Object *Object::initCmd(const char *cmdA, GooArena *arena) {
+  const char *p;
+
+  initObj(objCmd);
+  cmdOp = contentOpNone;
+  if ((p = lookupKnownName(cmdA))) {
+    cmd = (char *)p;
+  } else if (arena) {
+    inArena = gTrue;
+    cmd = arena->copyString(cmdA);
+  } else {
+    cmd = copyString(cmdA);
+  }
+  return this;
+}
+
+Object *Object::initString(const char *sA, int lengthA, GooArena *arena) {
+  if (!arena) {
+    return initString(new GooString(sA, lengthA));
+  }
+  initObj(objString);
+  inArena = gTrue;
+  string = new (arena->alloc(sizeof(GooString))) GooString(sA, lengthA);
+  return this;
+}
+
+Object *Object::initArray(XRef *xref, GooArena *arena) {
+  if (!arena) {
+    return initArray(xref);
+  }
+  initObj(objArray);
+  inArena = gTrue;
+  array = new (arena->alloc(sizeof(Array))) Array(xref, arena);
+  return this;
+}
+
+Object *Object::initDict(XRef *xref, GooArena *arena) {
+  if (!arena) {
+    return initDict(xref);
+  }
+  initObj(objDict);
+  inArena = gTrue;
+  dict = new (arena->alloc(sizeof(Dict))) Dict(xref, arena);
+  return this;
+}
+
 Object *Object::initStream(Stream *streamA) {
   initObj(objStream);
   stream = streamA;
@@ -88,13 +150,28 @@ Object *Object::initStream(Stream *streamA) {
 }
 
 Object *Object::copy(Object *obj) {
+  // arena arrays and dicts are copied deeply, since they can't be
+  // shared with an object that outlives the arena
+  if (inArena) {
+    if (type == objArray) {
+      return array->copy(array->getXRef(), obj);
+    } else if (type == objDict) {
+      Dict *dictA = new Dict(dict);
+      obj->initDict(dictA);
+      dictA->decRef();
+      return obj;
+    }
+  }
   *obj = *this;
+  obj->inArena = gFalse;
   switch (type) {
   case objString:
     obj->string = string->copy();
     break;
   case objName:
-    obj->name = copyString(name);
+    if (!isInternedName(name)) {
+      obj->name = copyString(name);
+    }
     break;
   case objArray:
     array->incRef();
@@ -106,7 +183,9 @@ Object *Object::copy(Object *obj) {
     stream->incRef();
     break;
   case objCmd:
-    obj->cmd = copyString(cmd);
+    if (!isInternedName(cmd)) {
+      obj->cmd = copyString(cmd);
+    }
     break;
   default:
     break;
@@ -123,12 +202,16 @@ Object *Object::fetch(XRef *xref, Object *obj, int recursion) {
 }
 
 void Object::free() {
+  if (inArena) {
+    freeArena();
+    return;
+  }
   switch (type) {
   case objString:
     delete string;
     break;
   case objName:
-    gfree(name);
+    freeName(name);
     break;
   case objArray:
     if (!array->decRef()) {
@@ -146,7 +229,33 @@ void Object::free() {
     }
     break;
   case objCmd:
-    gfree(cmd);
+    freeName(cmd);
+    break;
+  default:
+    break;
+  }
+#ifdef DEBUG_MEM
+  --numAlloc[type];
+#endif
+  type = objNone;
+}
+
+// Destroy the contents of an arena object, leaving their memory to
+// the arena.
+void Object::freeArena() {
+  switch (type) {
+  case objString:
+    string->~GooString();
+    break;
+  case objArray:
+    if (!array->decRef()) {
+      array->~Array();
+    }
+    break;
+  case objDict:
+    if (!dict->decRef()) {
+      dict->~Dict();
+    }
     break;
   default:
     break;
@@ -155,6 +264,22 @@ void Object::free() {
   --numAlloc[type];
 #endif
   type = objNone;
+  inArena = gFalse;
+}
+
+GooString *Object::takeString() {
+  GooString *s;
+
+  OBJECT_TYPE_CHECK(objString);
+  if (inArena) {
+    s = string->copy();
+    string->~GooString();
+    inArena = gFalse;
+  } else {
+    s = string;
+  }
+  string = NULL;
+  return s;
 }
 
 const char *Object::getTypeName() {
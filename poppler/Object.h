@@ -42,6 +42,9 @@
 #include "goo/gmem.h"
 #include "goo/GooString.h"
 #include "goo/GooLikely.h"
+#include "goo/GooArena.h"
+#include "NameTable.h"
+#include "ContentOps.h"
 #include "Error.h"
 
 #define OBJECT_TYPE_CHECK(wanted_type) \
@@ -115,9 +118,9 @@ enum ObjType {
 //------------------------------------------------------------------------
 
 #ifdef DEBUG_MEM
-#define initObj(t) zeroUnion(); ++numAlloc[type = t]
+#define initObj(t) zeroUnion(); inArena = gFalse; ++numAlloc[type = t]
 #else
-#define initObj(t) zeroUnion(); type = t
+#define initObj(t) zeroUnion(); inArena = gFalse; type = t
 #endif
 
 class Object {
@@ -127,7 +130,7 @@ public:
 
   // Default constructor.
   Object():
-    type(objNone) { zeroUnion(); }
+    type(objNone), inArena(gFalse) { zeroUnion(); }
 
   // Initialize an object.
   Object *initBool(GBool boolnA)
@@ -139,7 +142,7 @@ public:
   Object *initString(GooString *stringA)
     { initObj(objString); string = stringA; return this; }
   Object *initName(const char *nameA)
-    { initObj(objName); name = copyString(nameA); return this; }
+    { initObj(objName); name = copyName(nameA); return this; }
   Object *initNull()
     { initObj(objNull); return this; }
   Object *initArray(XRef *xref);
@@ -149,7 +152,11 @@ public:
   Object *initRef(int numA, int genA)
     { initObj(objRef); ref.num = numA; ref.gen = genA; return this; }
   Object *initCmd(char *cmdA)
-    { initObj(objCmd); cmd = copyString(cmdA); return this; }
+    { initObj(objCmd); cmd = copyKnownName(cmdA); cmdOp = contentOpNone;
+      return this; }
+  Object *initCmd(ContentOp opA)
+    { initObj(objCmd); cmd = (char *)getContentOpName(opA); cmdOp = opA;
+      return this; }
   Object *initError()
     { initObj(objError); return this; }
   Object *initEOF()
@@ -157,6 +164,17 @@ public:
   Object *initInt64(long long int64gA)
     { initObj(objInt64); int64g = int64gA; return this; }
 
+  // Initialize an object whose contents are allocated in <arena>, or
+  // on the heap if <arena> is NULL.  The contents of an arena object
+  // are destroyed by free(), but their memory is only released when
+  // the arena is reset, so the object must be freed before that.
+  // copy() always makes a heap object, which may outlive the arena.
+  Object *initString(const char *sA, int lengthA, GooArena *arena);
+  Object *initName(const char *nameA, GooArena *arena);
+  Object *initCmd(const char *cmdA, GooArena *arena);
+  Object *initArray(XRef *xref, GooArena *arena);
+  Object *initDict(XRef *xref, GooArena *arena);
+
   // Copy an object.
   Object *copy(Object *obj);
   Object *shallowCopy(Object *obj) {
@@ -193,11 +211,11 @@ public:
 
   // Special type checking.
   GBool isName(const char *nameA)
-    { return type == objName && !strcmp(name, nameA); }
+    { return type == objName && equalNames(name, nameA); }
   GBool isDict(const char *dictType);
   GBool isStream(char *dictType);
   GBool isCmd(const char *cmdA)
-    { return type == objCmd && !strcmp(cmd, cmdA); }
+    { return type == objCmd && equalNames(cmd, cmdA); }
 
   // Accessors.
   GBool getBool() { OBJECT_TYPE_CHECK(objBool); return booln; }
@@ -211,8 +229,7 @@ public:
   GooString *getString() { OBJECT_TYPE_CHECK(objString); return string; }
   // After takeString() the only method that should be called for the object is free()
   // because the object it's not expected to have a NULL string.
-  GooString *takeString() {
-    OBJECT_TYPE_CHECK(objString); GooString *s = string; string = NULL; return s; }
+  GooString *takeString();
   char *getName() { OBJECT_TYPE_CHECK(objName); return name; }
   Array *getArray() { OBJECT_TYPE_CHECK(objArray); return array; }
   Dict *getDict() { OBJECT_TYPE_CHECK(objDict); return dict; }
@@ -221,6 +238,8 @@ public:
   int getRefNum() { OBJECT_TYPE_CHECK(objRef); return ref.num; }
   int getRefGen() { OBJECT_TYPE_CHECK(objRef); return ref.gen; }
   char *getCmd() { OBJECT_TYPE_CHECK(objCmd); return cmd; }
+  ContentOp getCmdOp()
+    { OBJECT_TYPE_CHECK(objCmd); return (ContentOp)cmdOp; }
   long long getInt64() { OBJECT_TYPE_CHECK(objInt64); return int64g; }
   long long getIntOrInt64() { OBJECT_2TYPES_CHECK(objInt, objInt64);
     return type == objInt ? intg : int64g; }
@@ -265,7 +284,11 @@ public:
 
 private:
 
+  void freeArena();
+
   ObjType type;			// object type
+  GBool inArena;		// contents allocated in a GooArena
+  unsigned char cmdOp;		// ContentOp of a command
   union {			// value for each type:
     GBool booln;		//   boolean
     int intg;			//   integer
@@ -42,6 +42,9 @@
 // OutputDev
 //------------------------------------------------------------------------
 
+OutputDev::~OutputDev() {
+}
+
 void OutputDev::setDefaultCTM(double *ctm) {
   int i;
   double det;
@@ -194,7 +197,7 @@ GooHash *OutputDev::endProfile() {
 }
 
 #ifdef USE_CMS
-PopplerCache *OutputDev::getIccColorSpaceCache()
+PopplerCache<Ref, GfxICCBasedColorSpace, PopplerRefHash, PopplerRefEqual> *OutputDev::getIccColorSpaceCache()
 {
   return &iccColorSpaceCache;
 }
@@ -50,6 +50,7 @@ class GfxState;
 class Gfx;
 struct GfxColor;
 class GfxColorSpace;
+class GfxICCBasedColorSpace;
 class GfxImageColorMap;
 class GfxFunctionShading;
 class GfxAxialShading;
@@ -82,7 +83,7 @@ public:
   }
 
   // Destructor.
-  virtual ~OutputDev() {}
+  virtual ~OutputDev();
 
   //----- get info about output device
 
@@ -109,6 +110,11 @@ public:
   // form-type XObjects will be interpreted (i.e., unrolled).
   virtual GBool useDrawForm() { return gFalse; }
 
+  // Can images and forms that are drawn repeatedly be read from the
+  // document's decoded stream cache?  Devices that look at the
+  // encoded data (e.g., to pass it through) should return false.
+  virtual GBool useDecodedStreamCache() { return gTrue; }
+
   // Does this device use beginType3Char/endType3Char?  Otherwise,
   // text in Type 3 fonts will be drawn with drawChar/drawString.
   virtual GBool interpretType3Chars() = 0;
@@ -335,7 +341,7 @@ public:
 #endif
 
 #ifdef USE_CMS
-  PopplerCache *getIccColorSpaceCache();
+  PopplerCache<Ref, GfxICCBasedColorSpace, PopplerRefHash, PopplerRefEqual> *getIccColorSpaceCache();
 #endif
 
 private:
@@ -345,7 +351,7 @@ private:
   GooHash *profileHash;
 
 #ifdef USE_CMS
-  PopplerCache iccColorSpaceCache;
+  PopplerCache<Ref, GfxICCBasedColorSpace, PopplerRefHash, PopplerRefEqual> iccColorSpaceCache;
 #endif
 };
 
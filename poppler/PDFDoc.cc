@@ -56,6 +56,7 @@
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <atomic>
 #include "goo/gstrtod.h"
 #include "goo/GooString.h"
 #include "goo/gfile.h"
@@ -79,6 +80,7 @@
 #endif
 #include "PDFDoc.h"
 #include "Hints.h"
+#include "DocIndex.h"
 
 #if MULTITHREADED
 #  define pdfdocLocker()   MutexLocker locker(&mutex)
@@ -99,6 +101,9 @@
 #define xrefSearchSize 1024	// read this many bytes at end of file
 				//   to look for 'startxref'
 
+// Last serial number given to a document.
+static std::atomic<unsigned int> lastSerialNumber(0);
+
 //------------------------------------------------------------------------
 // PDFDoc
 //------------------------------------------------------------------------
@@ -123,6 +128,7 @@ void PDFDoc::init()
   startXRefPos = -1;
   secHdlr = NULL;
   pageCache = NULL;
+  serialNumber = ++lastSerialNumber;
 }
 
 PDFDoc::PDFDoc()
@@ -132,7 +138,6 @@ PDFDoc::PDFDoc()
 
 PDFDoc::PDFDoc(GooString *fileNameA, GooString *ownerPassword,
 	       GooString *userPassword, void *guiDataA) {
-  Object obj;
 #ifdef _WIN32
   int n, i;
 #endif
@@ -162,9 +167,7 @@ PDFDoc::PDFDoc(GooString *fileNameA, GooString *ownerPassword,
     return;
   }
 
-  // create stream
-  obj.initNull();
-  str = new FileStream(file, 0, gFalse, file->size(), &obj);
+  str = makeFileStream();
 
   ok = setup(ownerPassword, userPassword);
 }
@@ -173,7 +176,6 @@ PDFDoc::PDFDoc(GooString *fileNameA, GooString *ownerPassword,
 PDFDoc::PDFDoc(wchar_t *fileNameA, int fileNameLen, GooString *ownerPassword,
 	       GooString *userPassword, void *guiDataA) {
   OSVERSIONINFO version;
-  Object obj;
   int i;
 
   init();
@@ -204,9 +206,7 @@ PDFDoc::PDFDoc(wchar_t *fileNameA, int fileNameLen, GooString *ownerPassword,
     return;
   }
 
-  // create stream
-  obj.initNull();
-  str = new FileStream(file, 0, gFalse, file->size(), &obj);
+  str = makeFileStream();
 
   ok = setup(ownerPassword, userPassword);
 }
@@ -240,7 +240,28 @@ PDFDoc::PDFDoc(BaseStream *strA, GooString *ownerPassword,
   ok = setup(ownerPassword, userPassword);
 }
 
+// Create the base stream for <file>, memory mapped if enabled in
+// globalParams and supported by the platform.
+BaseStream *PDFDoc::makeFileStream() {
+  Object obj;
+
+  obj.initNull();
+  if (globalParams->getMMapFiles()) {
+    MMapStream *mmapStr = new MMapStream(file, &obj);
+    if (mmapStr->isOk()) {
+      return mmapStr;
+    }
+    delete mmapStr;
+    obj.initNull();
+  }
+  return new FileStream(file, 0, gFalse, file->size(), &obj);
+}
+
 GBool PDFDoc::setup(GooString *ownerPassword, GooString *userPassword) {
+  GooString *indexDir;
+  DocIndex *index;
+  GBool setupOk;
+
   pdfdocLocker();
   str->setPos(0, -1);
   if (str->getPos() < 0)
@@ -258,6 +279,29 @@ GBool PDFDoc::setup(GooString *ownerPassword, GooString *userPassword) {
   // check header
   checkHeader();
 
+  indexDir = file ? globalParams->getDocIndexDir() : (GooString *)NULL;
+  if (!indexDir) {
+    return parseDocument(ownerPassword, userPassword);
+  }
+
+  // use the document index if it matches the file, else parse the file
+  // and index it for the next time
+  index = new DocIndex(file);
+  if (!index->read(indexDir) ||
+      !setupFromIndex(index, ownerPassword, userPassword, &setupOk)) {
+    setupOk = parseDocument(ownerPassword, userPassword);
+    if (setupOk && index->isOk() && xref->storeIndex(index)) {
+      catalog->storePageTreeIndex(index);
+      index->write(indexDir);
+    }
+  }
+  delete index;
+  delete indexDir;
+  return setupOk;
+}
+
+// Read the xref table, check the encryption and read the catalog.
+GBool PDFDoc::parseDocument(GooString *ownerPassword, GooString *userPassword) {
   GBool wasReconstructed = false;
 
   // read xref table
@@ -304,6 +348,43 @@ GBool PDFDoc::setup(GooString *ownerPassword, GooString *userPassword) {
   return gTrue;
 }
 
+// Set up the document from <index>.  Returns false, leaving nothing
+// set up, if the index doesn't match the file.  Otherwise returns
+// true, with the result of the setup in <setupOk>.
+GBool PDFDoc::setupFromIndex(DocIndex *index, GooString *ownerPassword,
+			     GooString *userPassword, GBool *setupOk) {
+  xref = new XRef(str, index);
+  if (!xref->isOk()) {
+    delete xref;
+    xref = NULL;
+    return gFalse;
+  }
+
+  if (!checkEncryption(ownerPassword, userPassword)) {
+    errCode = errEncrypted;
+    *setupOk = gFalse;
+    return gTrue;
+  }
+
+  catalog = new Catalog(this);
+  if (!catalog->isOk()) {
+    delete catalog;
+    catalog = NULL;
+    delete secHdlr;
+    secHdlr = NULL;
+    delete xref;
+    xref = NULL;
+    return gFalse;
+  }
+  // if the page tree doesn't match, it is walked as usual
+  if (index->hasPageTree()) {
+    catalog->loadPageTreeIndex(index);
+  }
+
+  *setupOk = gTrue;
+  return gTrue;
+}
+
 PDFDoc::~PDFDoc() {
   if (pageCache) {
     for (int i = 0; i < getNumPages(); i++) {
@@ -2067,7 +2148,7 @@ Page *PDFDoc::getPage(int page)
 {
   if ((page < 1) || page > getNumPages()) return NULL;
 
-  if (isLinearized() && checkLinearization()) {
+  if (isLinearized() && !catalog->hasPageTreeIndex() && checkLinearization()) {
     pdfdocLocker();
     if (!pageCache) {
       pageCache = (Page **) gmallocn(getNumPages(), sizeof(Page *));
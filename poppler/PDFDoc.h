@@ -65,6 +65,7 @@ class Outline;
 class Linearization;
 class SecurityHandler;
 class Hints;
+class DocIndex;
 class StructTreeRoot;
 
 enum PDFWriteMode {
@@ -100,6 +101,11 @@ public:
   // Get the error code (if isOk() returns false).
   int getErrorCode() { return errCode; }
 
+  // Get a number that identifies this document among all the
+  // documents created by the process, even after it is deleted, so
+  // that caches shared between documents can tell them apart.
+  unsigned int getSerialNumber() { return serialNumber; }
+
   // Get the error code returned by fopen() (if getErrorCode() == 
   // errOpenFile).
   int getFopenErrno() { return fopenErrno; }
@@ -342,7 +348,11 @@ private:
 
   PDFDoc();
   void init();
+  BaseStream *makeFileStream();
   GBool setup(GooString *ownerPassword, GooString *userPassword);
+  GBool parseDocument(GooString *ownerPassword, GooString *userPassword);
+  GBool setupFromIndex(DocIndex *index, GooString *ownerPassword,
+		       GooString *userPassword, GBool *setupOk);
   GBool checkFooter();
   void checkHeader();
   GBool checkEncryption(GooString *ownerPassword, GooString *userPassword);
@@ -386,6 +396,7 @@ private:
   int fopenErrno;
 
   Goffset startXRefPos;		// offset of last xref table
+  unsigned int serialNumber;
 #if MULTITHREADED
   GooMutex mutex;
 #endif
@@ -154,6 +154,10 @@ public:
   // form-type XObjects will be interpreted (i.e., unrolled).
   virtual GBool useDrawForm() { return preloadImagesForms; }
 
+  // Can images and forms be read from the decoded stream cache?  No:
+  // images are embedded with their own filters where possible.
+  virtual GBool useDecodedStreamCache() { return gFalse; }
+
   // Does this device use beginType3Char/endType3Char?  Otherwise,
   // text in Type 3 fonts will be drawn with drawChar/drawString.
   virtual GBool interpretType3Chars() { return gFalse; }
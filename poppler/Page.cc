@@ -577,18 +577,25 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
   Annots *annotList;
   int i;
   
+  pageLocker();
+  XRef *localXRef = (copyXRef) ? xref->copy() : xref;
+  if (copyXRef) {
+    replaceXRef(localXRef);
+  }
+
+  // the lock and the XRef copy also cover an OutputDev that displays
+  // the page itself from checkPageSlice (SplashOutputDev in bands)
   if (!out->checkPageSlice(this, hDPI, vDPI, rotate, useMediaBox, crop,
 			   sliceX, sliceY, sliceW, sliceH,
 			   printing,
 			   abortCheckCbk, abortCheckCbkData,
 			   annotDisplayDecideCbk, annotDisplayDecideCbkData)) {
+    if (copyXRef) {
+      replaceXRef(doc->getXRef());
+      delete localXRef;
+    }
     return;
   }
-  pageLocker();
-  XRef *localXRef = (copyXRef) ? xref->copy() : xref;
-  if (copyXRef) {
-    replaceXRef(localXRef);
-  }
 
   gfx = createGfx(out, hDPI, vDPI, rotate, useMediaBox, crop,
 		  sliceX, sliceY, sliceW, sliceH,
@@ -173,6 +173,9 @@ public:
   Dict *getPieceInfo() { return attrs->getPieceInfo(); }
   Dict *getSeparationInfo() { return attrs->getSeparationInfo(); }
   PDFDoc *getDoc() { return doc; }
+  // The XRef the page is displayed with: a copy of the document's
+  // while displaySlice(copyXRef = true) runs.
+  XRef *getXRef() { return xref; }
   Ref getRef() { return pageRef; }
 
   // Get resource dictionary.
@@ -48,6 +48,7 @@
 Parser::Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA) {
   xref = xrefA;
   lexer = lexerA;
+  arena = NULL;
   inlineImg = 0;
   allowStreams = allowStreamsA;
   lexer->getObj(&buf1);
@@ -60,6 +61,22 @@ Parser::~Parser() {
   delete lexer;
 }
 
+void Parser::setArena(GooArena *arenaA) {
+  arena = arenaA;
+  lexer->setArena(arenaA);
+}
+
+void Parser::moveLookaheadToHeap() {
+  Object obj;
+
+  buf1.copy(&obj);
+  buf1.free();
+  buf1 = obj;
+  buf2.copy(&obj);
+  buf2.free();
+  buf2 = obj;
+}
+
 Object *Parser::getObj(Object *obj, int recursion)
 {
   return getObj(obj, gFalse, NULL, cryptRC4, 0, 0, 0, recursion);
@@ -71,6 +88,7 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
 		       int objNum, int objGen, int recursion,
 		       GBool strict) {
   char *key;
+  GooArena *dictArena;
   Stream *str;
   Object obj2;
   int num;
@@ -90,7 +108,7 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
   // array
   if (!simpleOnly && likely(recursion < recursionLimit) && buf1.isCmd("[")) {
     shift();
-    obj->initArray(xref);
+    obj->initArray(xref, objArena());
     while (!buf1.isCmd("]") && !buf1.isEOF())
       obj->arrayAdd(getObj(&obj2, gFalse, fileKey, encAlgorithm, keyLength,
 			   objNum, objGen, recursion + 1));
@@ -103,18 +121,25 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
   // dictionary or stream
   } else if (!simpleOnly && likely(recursion < recursionLimit) && buf1.isCmd("<<")) {
     shift(objNum);
-    obj->initDict(xref);
+    dictArena = objArena();
+    obj->initDict(xref, dictArena);
     while (!buf1.isCmd(">>") && !buf1.isEOF()) {
       if (!buf1.isName()) {
 	error(errSyntaxError, getPos(), "Dictionary key must be a name object");
 	if (strict) goto err;
 	shift();
       } else {
-	// buf1 might go away in shift(), so construct the key
-	key = copyString(buf1.getName());
+	// buf1 might go away in shift(), so construct the key, unless
+	// it is interned
+	key = buf1.getName();
+	if (!isInternedName(key)) {
+	  key = dictArena ? dictArena->copyString(key) : copyString(key);
+	}
 	shift();
 	if (buf1.isEOF() || buf1.isError()) {
-	  gfree(key);
+	  if (!dictArena) {
+	    freeName(key);
+	  }
 	  if (strict && buf1.isError()) goto err;
 	  break;
 	}
@@ -206,7 +231,7 @@ Stream *Parser::makeStream(Object *dict, Guchar *fileKey,
   pos = str->getPos();
 
   // get length
-  dict->dictLookup("Length", &obj, recursion);
+  dict->dictLookup(knownNames.Length, &obj, recursion);
   if (obj.isInt()) {
     length = obj.getInt();
     obj.free();
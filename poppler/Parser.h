@@ -62,10 +62,20 @@ public:
   // Get current position in file.
   Goffset getPos() { return lexer->getPos(); }
 
+  // Allocate the objects returned by getObj in <arenaA>, until it is
+  // full.  NULL allocates them on the heap.  The caller must free all
+  // the objects it got before resetting the arena.
+  void setArena(GooArena *arenaA);
+
+  // Move the objects read ahead out of the arena, so that the arena
+  // can be reset while the parser is still in use.
+  void moveLookaheadToHeap();
+
 private:
 
   XRef *xref;			// the xref table for this PDF file
   Lexer *lexer;			// input stream
+  GooArena *arena;		// arena for the objects, or NULL
   GBool allowStreams;		// parse stream objects?
   Object buf1, buf2;		// next two tokens
   int inlineImg;		// set when inline image data is encountered
@@ -74,6 +84,8 @@ private:
 		     CryptAlgorithm encAlgorithm, int keyLength,
 		     int objNum, int objGen, int recursion,
 		     GBool strict);
+  GooArena *objArena()
+    { return arena && !arena->isFull() ? arena : (GooArena *)NULL; }
   void shift(int objNum = -1);
   void shift(const char *cmdA, int objNum);
 };
@@ -13,54 +13,174 @@
 #ifndef POPPLER_CACHE_H
 #define POPPLER_CACHE_H
 
-#include "Object.h"
+#include <stddef.h>
+#include <functional>
+#include <list>
+#include <unordered_map>
 
-class PopplerCacheItem
-{
-  public:
-   virtual ~PopplerCacheItem();
-};
+#include "Object.h"
 
-class PopplerCacheKey
-{
-  public:
-    virtual ~PopplerCacheKey();
-    virtual bool operator==(const PopplerCacheKey &key) const = 0;
-};
+//------------------------------------------------------------------------
+// PopplerCache
+//
+// Maps keys to items owned by the cache.  Lookups are hashed and the
+// least recently used items are evicted once the cache holds more than
+// <cacheSize> items or, if <maxCost> is non-zero, once the total cost
+// of the items exceeds <maxCost>.  The cost of an item is given by the
+// caller when it is put in the cache, usually as its size in bytes.
+// The most recently put item is never evicted, so a pointer returned
+// by lookup or passed to put stays valid until the next put.
+//
+// The cache does no locking of its own.
+//------------------------------------------------------------------------
 
+template <typename Key, typename Item,
+	  typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key> >
 class PopplerCache
 {
   public:
-    PopplerCache(int cacheSizeA);
-    ~PopplerCache();
-    
+    PopplerCache(int cacheSizeA, size_t maxCostA = 0)
+      : cacheSize(cacheSizeA), maxCost(maxCostA), totalCost(0),
+        hits(0), misses(0)
+    {
+    }
+
+    ~PopplerCache()
+    {
+      clear();
+    }
+
     /* The item returned is owned by the cache */
-    PopplerCacheItem *lookup(const PopplerCacheKey &key);
-    
-    /* The key and item pointers ownership is taken by the cache */
-    void put(PopplerCacheKey *key, PopplerCacheItem *item);
-    
-    /* The max size of the cache */
-    int size();
-    
+    Item *lookup(const Key &key)
+    {
+      typename Index::iterator it = index.find(key);
+      if (it == index.end()) {
+        ++misses;
+        return NULL;
+      }
+      ++hits;
+      lru.splice(lru.begin(), lru, it->second);
+      return it->second->item;
+    }
+
+    /* The item pointer ownership is taken by the cache */
+    void put(const Key &key, Item *item, size_t cost = 0)
+    {
+      typename Index::iterator it = index.find(key);
+      if (it != index.end()) {
+        typename Entries::iterator entry = it->second;
+        totalCost -= entry->cost;
+        if (entry->item != item) {
+          delete entry->item;
+        }
+        entry->item = item;
+        entry->cost = cost;
+        lru.splice(lru.begin(), lru, entry);
+      } else {
+        Entry entry = { key, item, cost };
+        lru.push_front(entry);
+        index[key] = lru.begin();
+      }
+      totalCost += cost;
+      evict();
+    }
+
+    /* Delete the item for <key>, if any */
+    void remove(const Key &key)
+    {
+      typename Index::iterator it = index.find(key);
+      if (it != index.end()) {
+        totalCost -= it->second->cost;
+        delete it->second->item;
+        lru.erase(it->second);
+        index.erase(it);
+      }
+    }
+
+    /* Delete all the items */
+    void clear()
+    {
+      for (typename Entries::iterator it = lru.begin(); it != lru.end(); ++it) {
+        delete it->item;
+      }
+      lru.clear();
+      index.clear();
+      totalCost = 0;
+    }
+
+    /* The max number of items in the cache */
+    int size() const { return cacheSize; }
+
     /* The number of items in the cache */
-    int numberOfItems();
-    
-    /* The n-th item in the cache */
-    PopplerCacheItem *item(int index);
-    
-    /* The n-th key in the cache */
-    PopplerCacheKey *key(int index);
-  
+    int numberOfItems() const { return (int)index.size(); }
+
+    /* The max total cost of the items, 0 if unbounded */
+    size_t getMaxCost() const { return maxCost; }
+
+    /* The total cost of the items in the cache */
+    size_t getCost() const { return totalCost; }
+
+    /* Number of lookups that found / didn't find their key */
+    unsigned long getHits() const { return hits; }
+    unsigned long getMisses() const { return misses; }
+
   private:
     PopplerCache(const PopplerCache &cache); // not allowed
-  
-    PopplerCacheKey **keys;
-    PopplerCacheItem **items;
-    int lastValidCacheIndex;
+    PopplerCache& operator=(const PopplerCache &other); // not allowed
+
+    struct Entry {
+      Key key;
+      Item *item;
+      size_t cost;
+    };
+    typedef std::list<Entry> Entries;
+    typedef std::unordered_map<Key, typename Entries::iterator, Hash, Equal> Index;
+
+    void evict()
+    {
+      while ((int)index.size() > 1 &&
+	     ((int)index.size() > cacheSize || (maxCost > 0 && totalCost > maxCost))) {
+        Entry &entry = lru.back();
+        totalCost -= entry.cost;
+        delete entry.item;
+        index.erase(entry.key);
+        lru.pop_back();
+      }
+    }
+
+    Entries lru;		// most recently used first
+    Index index;
     int cacheSize;
+    size_t maxCost;
+    size_t totalCost;
+    unsigned long hits;
+    unsigned long misses;
 };
 
+//------------------------------------------------------------------------
+// Hashing of Ref keys
+//------------------------------------------------------------------------
+
+struct PopplerRefHash
+{
+  size_t operator()(const Ref &ref) const
+  {
+    return ((size_t)ref.num << 4) ^ (size_t)ref.gen;
+  }
+};
+
+struct PopplerRefEqual
+{
+  bool operator()(const Ref &ref1, const Ref &ref2) const
+  {
+    return ref1.num == ref2.num && ref1.gen == ref2.gen;
+  }
+};
+
+//------------------------------------------------------------------------
+// PopplerObjectCache
+//------------------------------------------------------------------------
+
 class PopplerObjectCache
 {
   public:
@@ -71,8 +191,12 @@ class PopplerObjectCache
     Object *lookup(const Ref &ref, Object *obj);
 
   private:
+    PopplerObjectCache(const PopplerObjectCache &cache); // not allowed
+
+    class ObjectItem;
+
     XRef *xref;
-    PopplerCache *cache;
+    PopplerCache<Ref, ObjectItem, PopplerRefHash, PopplerRefEqual> *cache;
 };
 
 #endif
@@ -51,7 +51,9 @@
 
 #include <string.h>
 #include <math.h>
+#include <unordered_map>
 #include "goo/gfile.h"
+#include "goo/GooThread.h"
 #include "GlobalParams.h"
 #include "Error.h"
 #include "Object.h"
@@ -60,6 +62,7 @@
 #include "Page.h"
 #include "PDFDoc.h"
 #include "Link.h"
+#include "Annot.h"
 #include "FontEncodingTables.h"
 #include "fofi/FoFiTrueType.h"
 #include "splash/SplashBitmap.h"
@@ -70,10 +73,12 @@
 #include "splash/SplashState.h"
 #include "splash/SplashErrorCodes.h"
 #include "splash/SplashFontEngine.h"
+#include "splash/SplashGlyphCache.h"
 #include "splash/SplashFont.h"
 #include "splash/SplashFontFile.h"
 #include "splash/SplashFontFileID.h"
 #include "splash/Splash.h"
+#include "splash/SplashMath.h"
 #include "SplashOutputDev.h"
 #include <algorithm>
 
@@ -499,12 +504,6 @@ GBool SplashAxialPattern::getParameter(double xc, double yc, double *t) {
   return gTrue;
 }
 
-//------------------------------------------------------------------------
-// Type 3 font cache size parameters
-#define type3FontCacheAssoc   8
-#define type3FontCacheMaxSets 8
-#define type3FontCacheSize    (128*1024)
-
 //------------------------------------------------------------------------
 // Divide a 16-bit value (in [0, 255*255]) by 255, returning an 8-bit result.
 static inline Guchar div255(int x) {
@@ -1184,6 +1183,424 @@ static void splashOutBlendLuminosity(SplashColorPtr src, SplashColorPtr dest,
   }
 }
 
+//------------------------------------------------------------------------
+// Row blend functions
+//------------------------------------------------------------------------
+
+// The separable blend modes are computed a byte at a time, on all the
+// bytes of a row, sixteen at a time with SSE2.  For the subtractive
+// modes, the inputs and the result are complemented (255 - x is
+// x ^ 0xff), as in the functions above.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define SPLASH_OUT_BLEND_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+enum SplashOutBlendOp {
+  splashOutBlendOpMultiply,
+  splashOutBlendOpScreen,
+  splashOutBlendOpOverlay,
+  splashOutBlendOpDarken,
+  splashOutBlendOpLighten,
+  splashOutBlendOpColorDodge,
+  splashOutBlendOpColorBurn,
+  splashOutBlendOpHardLight,
+  splashOutBlendOpSoftLight,
+  splashOutBlendOpDifference,
+  splashOutBlendOpExclusion
+};
+
+// Blend bytes <i>..<nBytes>-1 with <op>; <inv> is 0xff for the
+// subtractive modes, and 0 otherwise.
+static void splashOutBlendBytes(SplashOutBlendOp op, Guchar *src,
+				Guchar *dest, Guchar *blend,
+				int i, int nBytes, int inv) {
+  int s, d, x;
+
+  switch (op) {
+  case splashOutBlendOpMultiply:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)(((d * s) / 255) ^ inv);
+    }
+    break;
+  case splashOutBlendOpScreen:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)((d + s - (d * s) / 255) ^ inv);
+    }
+    break;
+  case splashOutBlendOpOverlay:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      x = d < 0x80 ? (s * 2 * d) / 255
+	           : 255 - 2 * ((255 - s) * (255 - d)) / 255;
+      blend[i] = (Guchar)(x ^ inv);
+    }
+    break;
+  case splashOutBlendOpDarken:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)((d < s ? d : s) ^ inv);
+    }
+    break;
+  case splashOutBlendOpLighten:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)((d > s ? d : s) ^ inv);
+    }
+    break;
+  case splashOutBlendOpColorDodge:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      if (s == 255) {
+	x = 255;
+      } else {
+	x = (d * 255) / (255 - s);
+	if (x > 255) {
+	  x = 255;
+	}
+      }
+      blend[i] = (Guchar)(x ^ inv);
+    }
+    break;
+  case splashOutBlendOpColorBurn:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      if (s == 0) {
+	x = 0;
+      } else {
+	x = ((255 - d) * 255) / s;
+	x = x <= 255 ? 255 - x : 0;
+      }
+      blend[i] = (Guchar)(x ^ inv);
+    }
+    break;
+  case splashOutBlendOpHardLight:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      x = s < 0x80 ? (d * 2 * s) / 255
+	           : 255 - 2 * ((255 - d) * (255 - s)) / 255;
+      blend[i] = (Guchar)(x ^ inv);
+    }
+    break;
+  case splashOutBlendOpSoftLight:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      if (s < 0x80) {
+	x = d - (255 - 2 * s) * d * (255 - d) / (255 * 255);
+      } else {
+	if (d < 0x40) {
+	  x = (((((16 * d - 12 * 255) * d) / 255) + 4 * 255) * d) / 255;
+	} else {
+	  x = (int)sqrt(255.0 * d);
+	}
+	x = d + (2 * s - 255) * (x - d) / 255;
+      }
+      blend[i] = (Guchar)(x ^ inv);
+    }
+    break;
+  case splashOutBlendOpDifference:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)((d < s ? s - d : d - s) ^ inv);
+    }
+    break;
+  case splashOutBlendOpExclusion:
+    for (; i < nBytes; ++i) {
+      s = src[i] ^ inv;
+      d = dest[i] ^ inv;
+      blend[i] = (Guchar)((d + s - (2 * d * s) / 255) ^ inv);
+    }
+    break;
+  }
+}
+
+#if SPLASH_OUT_BLEND_SSE2
+
+// x / 255, rounded down, for each 16-bit x in [0, 255*256].
+static inline __m128i splashOutDiv255Floor(__m128i x) {
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)),
+				      _mm_srli_epi16(x, 8)), 8);
+}
+
+// The 16-bit part of the SSE2 kernels, on eight bytes of src (<s>) and
+// dest (<d>).
+static inline __m128i splashOutBlend16(SplashOutBlendOp op,
+				       __m128i s, __m128i d) {
+  __m128i c255 = _mm_set1_epi16(255);
+  __m128i c127 = _mm_set1_epi16(127);
+  __m128i lo, hi, q, r, sel;
+
+  switch (op) {
+  case splashOutBlendOpMultiply:
+    return splashOutDiv255Floor(_mm_mullo_epi16(d, s));
+  case splashOutBlendOpScreen:
+    return _mm_sub_epi16(_mm_add_epi16(d, s),
+			 splashOutDiv255Floor(_mm_mullo_epi16(d, s)));
+  case splashOutBlendOpOverlay:
+  case splashOutBlendOpHardLight:
+    // (the products fit in 16 bits in the lanes where they are used)
+    lo = splashOutDiv255Floor(_mm_slli_epi16(_mm_mullo_epi16(d, s), 1));
+    hi = _mm_sub_epi16(c255, splashOutDiv255Floor(_mm_slli_epi16(
+	     _mm_mullo_epi16(_mm_sub_epi16(c255, d),
+			     _mm_sub_epi16(c255, s)), 1)));
+    sel = _mm_cmpgt_epi16(op == splashOutBlendOpOverlay ? d : s, c127);
+    return _mm_or_si128(_mm_and_si128(sel, hi), _mm_andnot_si128(sel, lo));
+  case splashOutBlendOpExclusion:
+  default:
+    // 2 * d * s doesn't fit in 16 bits: with d * s = 255 * q + r,
+    // (2 * d * s) / 255 = 2 * q + (r >= 128)
+    r = _mm_mullo_epi16(d, s);
+    q = splashOutDiv255Floor(r);
+    r = _mm_sub_epi16(r, _mm_sub_epi16(_mm_slli_epi16(q, 8), q));
+    q = _mm_sub_epi16(_mm_add_epi16(q, q), _mm_cmpgt_epi16(r, c127));
+    return _mm_sub_epi16(_mm_add_epi16(d, s), q);
+  }
+}
+
+// Blend the bytes with <op>, sixteen at a time, and return the number
+// of bytes done.  <op> must not be ColorDodge, ColorBurn or SoftLight.
+static int splashOutBlendBytesSSE2(SplashOutBlendOp op, Guchar *src,
+				   Guchar *dest, Guchar *blend,
+				   int nBytes, int inv) {
+  __m128i vInv, zero, s, d, r;
+  int i;
+
+  vInv = _mm_set1_epi8((char)inv);
+  zero = _mm_setzero_si128();
+  for (i = 0; i + 16 <= nBytes; i += 16) {
+    s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), vInv);
+    d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(dest + i)), vInv);
+    switch (op) {
+    case splashOutBlendOpDarken:
+      r = _mm_min_epu8(d, s);
+      break;
+    case splashOutBlendOpLighten:
+      r = _mm_max_epu8(d, s);
+      break;
+    case splashOutBlendOpDifference:
+      r = _mm_or_si128(_mm_subs_epu8(d, s), _mm_subs_epu8(s, d));
+      break;
+    default:
+      r = _mm_packus_epi16(
+	      splashOutBlend16(op, _mm_unpacklo_epi8(s, zero),
+			       _mm_unpacklo_epi8(d, zero)),
+	      splashOutBlend16(op, _mm_unpackhi_epi8(s, zero),
+			       _mm_unpackhi_epi8(d, zero)));
+      break;
+    }
+    _mm_storeu_si128((__m128i *)(blend + i), _mm_xor_si128(r, vInv));
+  }
+  return i;
+}
+
+#endif
+
+static void splashOutBlendRowSeparable(SplashOutBlendOp op,
+				       SplashColorPtr src,
+				       SplashColorPtr dest,
+				       SplashColorPtr blend, int n,
+				       SplashColorMode cm) {
+  int nComps, nBytes, inv, i;
+#if SPLASH_CMYK
+  int k;
+#endif
+
+  nComps = splashColorModeNComps[cm];
+  nBytes = n * nComps;
+  inv = 0;
+#if SPLASH_CMYK
+  if (cm == splashModeCMYK8 || cm == splashModeDeviceN8) {
+    inv = 0xff;
+  }
+#endif
+  i = 0;
+#if SPLASH_OUT_BLEND_SSE2
+  if (op != splashOutBlendOpColorDodge && op != splashOutBlendOpColorBurn &&
+      op != splashOutBlendOpSoftLight) {
+    i = splashOutBlendBytesSSE2(op, src, dest, blend, nBytes, inv);
+  }
+#endif
+  splashOutBlendBytes(op, src, dest, blend, i, nBytes, inv);
+#if SPLASH_CMYK
+  if (cm == splashModeDeviceN8 && (op == splashOutBlendOpDifference ||
+				   op == splashOutBlendOpExclusion)) {
+    for (i = 0; i < nBytes; i += nComps) {
+      for (k = 4; k < nComps; ++k) {
+	if (dest[i + k] == 0 && src[i + k] == 0) {
+	  blend[i + k] = 0;
+	}
+      }
+    }
+  }
+#endif
+}
+
+static void splashOutBlendMultiplyRow(SplashColorPtr src, SplashColorPtr dest,
+				      SplashColorPtr blend, int n,
+				      SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpMultiply, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendScreenRow(SplashColorPtr src, SplashColorPtr dest,
+				    SplashColorPtr blend, int n,
+				    SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpScreen, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendOverlayRow(SplashColorPtr src, SplashColorPtr dest,
+				     SplashColorPtr blend, int n,
+				     SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpOverlay, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendDarkenRow(SplashColorPtr src, SplashColorPtr dest,
+				    SplashColorPtr blend, int n,
+				    SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpDarken, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendLightenRow(SplashColorPtr src, SplashColorPtr dest,
+				     SplashColorPtr blend, int n,
+				     SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpLighten, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendColorDodgeRow(SplashColorPtr src,
+					SplashColorPtr dest,
+					SplashColorPtr blend, int n,
+					SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpColorDodge, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendColorBurnRow(SplashColorPtr src,
+				       SplashColorPtr dest,
+				       SplashColorPtr blend, int n,
+				       SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpColorBurn, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendHardLightRow(SplashColorPtr src,
+				       SplashColorPtr dest,
+				       SplashColorPtr blend, int n,
+				       SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpHardLight, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendSoftLightRow(SplashColorPtr src,
+				       SplashColorPtr dest,
+				       SplashColorPtr blend, int n,
+				       SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpSoftLight, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendDifferenceRow(SplashColorPtr src,
+					SplashColorPtr dest,
+					SplashColorPtr blend, int n,
+					SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpDifference, src, dest, blend,
+			     n, cm);
+}
+
+static void splashOutBlendExclusionRow(SplashColorPtr src,
+				       SplashColorPtr dest,
+				       SplashColorPtr blend, int n,
+				       SplashColorMode cm) {
+  splashOutBlendRowSeparable(splashOutBlendOpExclusion, src, dest, blend,
+			     n, cm);
+}
+
+// The non-separable modes leave gray unchanged, and are otherwise run
+// a pixel at a time, with the pixel functions inlined.
+static inline GBool splashOutBlendRowGray(SplashColorPtr dest,
+					  SplashColorPtr blend, int n,
+					  SplashColorMode cm) {
+  if (cm == splashModeMono1 || cm == splashModeMono8) {
+    memcpy(blend, dest, n);
+    return gTrue;
+  }
+  return gFalse;
+}
+
+static void splashOutBlendHueRow(SplashColorPtr src, SplashColorPtr dest,
+				 SplashColorPtr blend, int n,
+				 SplashColorMode cm) {
+  int nComps, i;
+
+  if (splashOutBlendRowGray(dest, blend, n, cm)) {
+    return;
+  }
+  nComps = splashColorModeNComps[cm];
+  for (i = 0; i < n * nComps; i += nComps) {
+    splashOutBlendHue(src + i, dest + i, blend + i, cm);
+  }
+}
+
+static void splashOutBlendSaturationRow(SplashColorPtr src,
+					SplashColorPtr dest,
+					SplashColorPtr blend, int n,
+					SplashColorMode cm) {
+  int nComps, i;
+
+  if (splashOutBlendRowGray(dest, blend, n, cm)) {
+    return;
+  }
+  nComps = splashColorModeNComps[cm];
+  for (i = 0; i < n * nComps; i += nComps) {
+    splashOutBlendSaturation(src + i, dest + i, blend + i, cm);
+  }
+}
+
+static void splashOutBlendColorRow(SplashColorPtr src, SplashColorPtr dest,
+				   SplashColorPtr blend, int n,
+				   SplashColorMode cm) {
+  int nComps, i;
+
+  if (splashOutBlendRowGray(dest, blend, n, cm)) {
+    return;
+  }
+  nComps = splashColorModeNComps[cm];
+  for (i = 0; i < n * nComps; i += nComps) {
+    splashOutBlendColor(src + i, dest + i, blend + i, cm);
+  }
+}
+
+static void splashOutBlendLuminosityRow(SplashColorPtr src,
+					SplashColorPtr dest,
+					SplashColorPtr blend, int n,
+					SplashColorMode cm) {
+  int nComps, i;
+
+  if (splashOutBlendRowGray(dest, blend, n, cm)) {
+    return;
+  }
+  nComps = splashColorModeNComps[cm];
+  for (i = 0; i < n * nComps; i += nComps) {
+    splashOutBlendLuminosity(src + i, dest + i, blend + i, cm);
+  }
+}
+
 // NB: This must match the GfxBlendMode enum defined in GfxState.h.
 static const SplashBlendFunc splashOutBlendFuncs[] = {
   NULL,
@@ -1204,6 +1621,26 @@ static const SplashBlendFunc splashOutBlendFuncs[] = {
   &splashOutBlendLuminosity
 };
 
+// NB: This must match the GfxBlendMode enum defined in GfxState.h.
+static const SplashBlendRowFunc splashOutBlendRowFuncs[] = {
+  NULL,
+  &splashOutBlendMultiplyRow,
+  &splashOutBlendScreenRow,
+  &splashOutBlendOverlayRow,
+  &splashOutBlendDarkenRow,
+  &splashOutBlendLightenRow,
+  &splashOutBlendColorDodgeRow,
+  &splashOutBlendColorBurnRow,
+  &splashOutBlendHardLightRow,
+  &splashOutBlendSoftLightRow,
+  &splashOutBlendDifferenceRow,
+  &splashOutBlendExclusionRow,
+  &splashOutBlendHueRow,
+  &splashOutBlendSaturationRow,
+  &splashOutBlendColorRow,
+  &splashOutBlendLuminosityRow
+};
+
 //------------------------------------------------------------------------
 // SplashOutFontFileID
 //------------------------------------------------------------------------
@@ -1211,7 +1648,8 @@ static const SplashBlendFunc splashOutBlendFuncs[] = {
 class SplashOutFontFileID: public SplashFontFileID {
 public:
 
-  SplashOutFontFileID(Ref *rA) { r = *rA; }
+  SplashOutFontFileID(Ref *rA, PDFDoc *doc)
+    { r = *rA; docSerial = doc ? doc->getSerialNumber() : 0; }
 
   ~SplashOutFontFileID() {}
 
@@ -1220,20 +1658,34 @@ public:
            ((SplashOutFontFileID *)id)->r.gen == r.gen;
   }
 
+  // The font is identified by its document and its object ID.
+  GooString *getSharedKey() {
+    if (!docSerial) {
+      return NULL;
+    }
+    return GooString::format("{0:ud} {1:d} {2:d}", docSerial, r.num, r.gen);
+  }
+
 private:
 
   Ref r;
+  unsigned int docSerial;	// serial number of the document, or 0
 };
 
 //------------------------------------------------------------------------
 // T3FontCache
 //------------------------------------------------------------------------
 
-struct T3FontCacheTag {
-  Gushort code;
-  Gushort mru;			// valid bit (0x8000) and MRU index
+// A cached Type 3 glyph.  The bitmap follows the structure in memory.
+struct T3CachedGlyph {
+  CharCode code;
+  T3CachedGlyph *prev, *next;	// LRU list of the font, most recently
+				//   used first
+
+  Guchar *getData() { return (Guchar *)(this + 1); }
 };
 
+// The glyphs of a Type 3 font drawn with a given transform.
 class T3FontCache {
 public:
 
@@ -1247,16 +1699,32 @@ public:
     { return fontID.num == idA->num && fontID.gen == idA->gen &&
 	     m11 == m11A && m12 == m12A && m21 == m21A && m22 == m22A; }
 
+  // Return the bitmap of glyph <code>, or NULL if it isn't cached.
+  Guchar *lookup(CharCode code);
+
+  // Add glyph <code>, and return its bitmap, to be filled in.
+  Guchar *add(CharCode code);
+
+  // Drop the least recently used glyph.
+  void evictGlyph();
+
+  // Memory charged to the cache for a glyph, and for the font itself.
+  long getGlyphCost() { return glyphSize + (long)sizeof(T3CachedGlyph) + 32; }
+  static long getFontCost() { return (long)sizeof(T3FontCache) + 64; }
+
   Ref fontID;			// PDF font ID
   double m11, m12, m21, m22;	// transform matrix
   int glyphX, glyphY;		// pixel offset of glyph bitmaps
   int glyphW, glyphH;		// size of glyph bitmaps, in pixels
   GBool validBBox;		// false if the bbox was [0 0 0 0]
   int glyphSize;		// size of glyph bitmaps, in bytes
-  int cacheSets;		// number of sets in cache
-  int cacheAssoc;		// cache associativity (glyphs per set)
-  Guchar *cacheData;		// glyph pixmap cache
-  T3FontCacheTag *cacheTags;	// cache tags, i.e., char codes
+  std::unordered_map<CharCode, T3CachedGlyph *> glyphs;
+  T3CachedGlyph *firstGlyph,	// LRU list of the cached glyphs
+                *lastGlyph;
+  long size;			// cost of the font and its glyphs
+  int refCnt;			// number of T3GlyphStack entries drawing
+				//   with this font
+  T3FontCache *prev, *next;	// LRU list of T3GlyphCache
 };
 
 T3FontCache::T3FontCache(Ref *fontIDA, double m11A, double m12A,
@@ -1287,46 +1755,278 @@ T3FontCache::T3FontCache(Ref *fontIDA, double m11A, double m12A,
   } else {
     glyphSize = ((glyphW + 7) >> 3) * glyphH;
   }
-  cacheAssoc = type3FontCacheAssoc;
-  for (cacheSets = type3FontCacheMaxSets;
-       cacheSets > 1 &&
-	 cacheSets * cacheAssoc * glyphSize > type3FontCacheSize;
-       cacheSets >>= 1) ;
-  if (glyphSize < 10485760 / cacheAssoc / cacheSets) {
-    cacheData = (Guchar *)gmallocn_checkoverflow(cacheSets * cacheAssoc, glyphSize);
+  firstGlyph = lastGlyph = NULL;
+  size = getFontCost();
+  refCnt = 0;
+  prev = next = NULL;
+}
+
+T3FontCache::~T3FontCache() {
+  T3CachedGlyph *glyph;
+
+  while ((glyph = firstGlyph)) {
+    firstGlyph = glyph->next;
+    gfree(glyph);
+  }
+}
+
+Guchar *T3FontCache::lookup(CharCode code) {
+  std::unordered_map<CharCode, T3CachedGlyph *>::iterator it;
+  T3CachedGlyph *glyph;
+
+  if (firstGlyph && firstGlyph->code == code) {
+    return firstGlyph->getData();
+  }
+  it = glyphs.find(code);
+  if (it == glyphs.end()) {
+    return NULL;
+  }
+  glyph = it->second;
+  glyph->prev->next = glyph->next;
+  if (glyph->next) {
+    glyph->next->prev = glyph->prev;
   } else {
-    error(errSyntaxWarning, -1, "Not creating cacheData for T3FontCache, it asked for too much memory.\n"
-              "       This could teoretically result in wrong rendering,\n"
-              "       but most probably the document is bogus.\n"
-              "       Please report a bug if you think the rendering may be wrong because of this.");
-    cacheData = NULL;
+    lastGlyph = glyph->prev;
   }
-  if (cacheData != NULL)
-  {
-    cacheTags = (T3FontCacheTag *)gmallocn(cacheSets * cacheAssoc,
-					 sizeof(T3FontCacheTag));
-    for (i = 0; i < cacheSets * cacheAssoc; ++i) {
-      cacheTags[i].mru = i & (cacheAssoc - 1);
+  glyph->prev = NULL;
+  glyph->next = firstGlyph;
+  firstGlyph->prev = glyph;
+  firstGlyph = glyph;
+  return glyph->getData();
+}
+
+Guchar *T3FontCache::add(CharCode code) {
+  T3CachedGlyph *glyph;
+
+  glyph = (T3CachedGlyph *)gmalloc(sizeof(T3CachedGlyph) + glyphSize);
+  glyph->code = code;
+  glyph->prev = NULL;
+  glyph->next = firstGlyph;
+  if (firstGlyph) {
+    firstGlyph->prev = glyph;
+  } else {
+    lastGlyph = glyph;
+  }
+  firstGlyph = glyph;
+  glyphs[code] = glyph;
+  size += getGlyphCost();
+  return glyph->getData();
+}
+
+void T3FontCache::evictGlyph() {
+  T3CachedGlyph *glyph;
+
+  if (!(glyph = lastGlyph)) {
+    return;
+  }
+  lastGlyph = glyph->prev;
+  if (lastGlyph) {
+    lastGlyph->next = NULL;
+  } else {
+    firstGlyph = NULL;
+  }
+  glyphs.erase(glyph->code);
+  size -= getGlyphCost();
+  gfree(glyph);
+}
+
+//------------------------------------------------------------------------
+// T3GlyphCache
+//------------------------------------------------------------------------
+
+struct T3FontKey {
+  Ref fontID;
+  double m11, m12, m21, m22;
+
+  bool operator==(const T3FontKey &key) const
+    { return fontID.num == key.fontID.num && fontID.gen == key.fontID.gen &&
+	     m11 == key.m11 && m12 == key.m12 &&
+	     m21 == key.m21 && m22 == key.m22; }
+};
+
+struct T3FontKeyHash {
+  size_t operator()(const T3FontKey &key) const {
+    unsigned long long h, bits[4];
+
+    // the matrix is hashed bit for bit: 0 and -0 may only end up in
+    // different buckets, which is harmless
+    memcpy(&bits[0], &key.m11, sizeof(double));
+    memcpy(&bits[1], &key.m12, sizeof(double));
+    memcpy(&bits[2], &key.m21, sizeof(double));
+    memcpy(&bits[3], &key.m22, sizeof(double));
+    h = ((unsigned long long)(unsigned int)key.fontID.num << 32) ^
+        (unsigned int)key.fontID.gen;
+    for (int i = 0; i < 4; ++i) {
+      h = (h ^ bits[i]) * 0x9e3779b97f4a7c15ULL;
+      h ^= h >> 29;
     }
+    return (size_t)h;
   }
-  else
-  {
-    cacheTags = NULL;
+};
+
+// The Type 3 fonts (and their glyphs) cached by a SplashOutputDev,
+// within a budget of <maxSize> bytes.  When it is exceeded, the least
+// recently used fonts are dropped, except those still being drawn with.
+// Fonts are kept across pages, until the next document is started.
+class T3GlyphCache {
+public:
+
+  T3GlyphCache(long maxSizeA);
+  ~T3GlyphCache();
+
+  // Return the font with the given ID and transform, or NULL if it
+  // isn't cached.
+  T3FontCache *getFont(Ref *fontID, double m11, double m12,
+		       double m21, double m22);
+
+  // Add a new font, which must not be cached yet.
+  void addFont(T3FontCache *font);
+
+  // Add glyph <code> of <font>, dropping other fonts or glyphs if
+  // needed, and return its bitmap, to be filled in.  Returns NULL if
+  // there isn't room for it.
+  Guchar *addGlyph(T3FontCache *font, CharCode code);
+
+private:
+
+  void unlink(T3FontCache *font);
+  void pushFront(T3FontCache *font);
+  void shrink(T3FontCache *keep, long limit);
+
+  std::unordered_map<T3FontKey, T3FontCache *, T3FontKeyHash> fonts;
+  T3FontCache *first,		// LRU list, most recently used first
+              *last;
+  long size;			// cost of the cached fonts
+  long maxSize;
+};
+
+T3GlyphCache::T3GlyphCache(long maxSizeA) {
+  first = last = NULL;
+  size = 0;
+  maxSize = maxSizeA;
+}
+
+T3GlyphCache::~T3GlyphCache() {
+  T3FontCache *font;
+
+  while ((font = first)) {
+    first = font->next;
+    delete font;
   }
 }
 
-T3FontCache::~T3FontCache() {
-  gfree(cacheData);
-  gfree(cacheTags);
+T3FontCache *T3GlyphCache::getFont(Ref *fontID, double m11, double m12,
+				   double m21, double m22) {
+  std::unordered_map<T3FontKey, T3FontCache *, T3FontKeyHash>::iterator it;
+  T3FontCache *font;
+  T3FontKey key;
+
+  // is it the first (MRU) font in the cache?
+  if (first && first->matches(fontID, m11, m12, m21, m22)) {
+    return first;
+  }
+
+  // is the font elsewhere in the cache?
+  key.fontID = *fontID;
+  key.m11 = m11;
+  key.m12 = m12;
+  key.m21 = m21;
+  key.m22 = m22;
+  it = fonts.find(key);
+  if (it == fonts.end()) {
+    return NULL;
+  }
+  font = it->second;
+  unlink(font);
+  pushFront(font);
+  return font;
+}
+
+void T3GlyphCache::addFont(T3FontCache *font) {
+  T3FontKey key;
+
+  key.fontID = font->fontID;
+  key.m11 = font->m11;
+  key.m12 = font->m12;
+  key.m21 = font->m21;
+  key.m22 = font->m22;
+  fonts[key] = font;
+  pushFront(font);
+  size += font->size;
+  shrink(font, maxSize);
+}
+
+Guchar *T3GlyphCache::addGlyph(T3FontCache *font, CharCode code) {
+  long cost;
+
+  cost = font->getGlyphCost();
+  shrink(font, maxSize - cost);
+  while (size + cost > maxSize && font->lastGlyph) {
+    size -= font->size;
+    font->evictGlyph();
+    size += font->size;
+  }
+  if (size + cost > maxSize) {
+    return NULL;
+  }
+  size += cost;
+  return font->add(code);
+}
+
+void T3GlyphCache::unlink(T3FontCache *font) {
+  if (font->prev) {
+    font->prev->next = font->next;
+  } else {
+    first = font->next;
+  }
+  if (font->next) {
+    font->next->prev = font->prev;
+  } else {
+    last = font->prev;
+  }
+}
+
+void T3GlyphCache::pushFront(T3FontCache *font) {
+  font->prev = NULL;
+  font->next = first;
+  if (first) {
+    first->prev = font;
+  } else {
+    last = font;
+  }
+  first = font;
+}
+
+// Drop the least recently used fonts, other than <keep> and the ones
+// in use, until the size is at most <limit>.
+void T3GlyphCache::shrink(T3FontCache *keep, long limit) {
+  T3FontCache *font, *prevFont;
+  T3FontKey key;
+
+  for (font = last; font && size > limit; font = prevFont) {
+    prevFont = font->prev;
+    if (font == keep || font->refCnt > 0) {
+      continue;
+    }
+    unlink(font);
+    key.fontID = font->fontID;
+    key.m11 = font->m11;
+    key.m12 = font->m12;
+    key.m21 = font->m21;
+    key.m22 = font->m22;
+    fonts.erase(key);
+    size -= font->size;
+    delete font;
+  }
 }
 
 struct T3GlyphStack {
-  Gushort code;			// character code
+  CharCode code;		// character code
 
   //----- cache info
   T3FontCache *cache;		// font cache for the current font
-  T3FontCacheTag *cacheTag;	// pointer to cache tag for the glyph
-  Guchar *cacheData;		// pointer to cache data for the glyph
+  GBool cacheGlyph;		// set if the glyph is drawn to a bitmap
+				//   to be cached
 
   //----- saved state
   SplashBitmap *origBitmap;
@@ -1377,6 +2077,7 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   bitmapUpsideDown = gFalse;
   fontAntialias = gTrue;
   vectorAntialias = gTrue;
+  aaMode = splashAASupersample;
   overprintPreview = overprintPreviewA;
   enableFreeTypeHinting = gFalse;
   enableSlightHinting = gFalse;
@@ -1402,7 +2103,7 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
 
   fontEngine = NULL;
 
-  nT3Fonts = 0;
+  t3GlyphCache = NULL;
   t3GlyphStack = NULL;
 
   font = NULL;
@@ -1411,6 +2112,13 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   transpGroupStack = NULL;
   nestCount = 0;
   xref = NULL;
+
+  nBands = 1;
+  reduceImageResolution = gFalse;
+  bandDev = gFalse;
+  bandYMin = bandYMax = 0;
+  bandDevs = NULL;
+  nBandDevs = 0;
 }
 
 void SplashOutputDev::setupScreenParams(double hDPI, double vDPI) {
@@ -1465,11 +2173,7 @@ void SplashOutputDev::setupScreenParams(double hDPI, double vDPI) {
 }
 
 SplashOutputDev::~SplashOutputDev() {
-  int i;
-
-  for (i = 0; i < nT3Fonts; ++i) {
-    delete t3FontCache[i];
-  }
+  delete t3GlyphCache;
   if (fontEngine) {
     delete fontEngine;
   }
@@ -1479,12 +2183,15 @@ SplashOutputDev::~SplashOutputDev() {
   if (bitmap) {
     delete bitmap;
   }
+  deleteBandDevs();
 }
 
 void SplashOutputDev::startDoc(PDFDoc *docA) {
-  int i;
+  SplashGlyphCache *glyphCache;
+  long glyphCacheSize;
 
   doc = docA;
+  deleteBandDevs();
   if (fontEngine) {
     delete fontEngine;
   }
@@ -1499,10 +2206,203 @@ void SplashOutputDev::startDoc(PDFDoc *docA) {
 #endif
 				      getFontAntialias() &&
 				      colorMode != splashModeMono1);
-  for (i = 0; i < nT3Fonts; ++i) {
-    delete t3FontCache[i];
+  glyphCacheSize = globalParams->getGlyphCacheSize();
+  if (glyphCacheSize > 0) {
+    glyphCache = SplashGlyphCache::getGlobal();
+    glyphCache->setMaxSize(glyphCacheSize);
+    fontEngine->setGlyphCache(glyphCache);
+  }
+  delete t3GlyphCache;
+  t3GlyphCache = NULL;
+}
+
+//------------------------------------------------------------------------
+// page bands
+//
+// The page is split into horizontal bands, each drawn by its own
+// SplashOutputDev, with its own Gfx and Splash, into the bitmap of this
+// device.  A band device runs all of the page's content, with a Splash
+// band (see SplashClip::setBand) that keeps it from drawing outside its
+// rows, so the bands can be drawn concurrently and the bitmap is the
+// same as when the page is drawn in one piece.  The annotations are
+// then drawn as usual.
+//------------------------------------------------------------------------
+
+struct SplashOutBands {
+  Page *page;
+  XRef *xref;
+  double hDPI, vDPI;
+  int rotate;
+  GBool useMediaBox, crop;
+  int sliceX, sliceY, sliceW, sliceH;
+  GBool printing;
+  GBool (*abortCheckCbk)(void *data);
+  void *abortCheckCbkData;
+  SplashOutputDev **devs;
+};
+
+GBool SplashOutputDev::checkPageSlice(Page *page, double hDPI, double vDPI,
+				      int rotate, GBool useMediaBox,
+				      GBool crop,
+				      int sliceX, int sliceY,
+				      int sliceW, int sliceH,
+				      GBool printing,
+				      GBool (*abortCheckCbk)(void *data),
+				      void *abortCheckCbkData,
+				      GBool (*annotDisplayDecideCbk)(Annot *annot, void *user_data),
+				      void *annotDisplayDecideCbkData) {
+  if (!canRenderBands()) {
+    return gTrue;
   }
-  nT3Fonts = 0;
+  displayPageBands(page, hDPI, vDPI, rotate, useMediaBox, crop,
+		   sliceX, sliceY, sliceW, sliceH, printing,
+		   abortCheckCbk, abortCheckCbkData,
+		   annotDisplayDecideCbk, annotDisplayDecideCbkData);
+  return gFalse;
+}
+
+GBool SplashOutputDev::canRenderBands() {
+  return nBands > 1 && !bandDev && doc && nestCount == 0 &&
+         !getProfileHash() &&
+         // CachedFile isn't thread safe
+         doc->getBaseStream()->getKind() != strCachedFile;
+}
+
+void SplashOutputDev::displayPageBands(Page *page, double hDPI, double vDPI,
+				       int rotate, GBool useMediaBox,
+				       GBool crop,
+				       int sliceX, int sliceY,
+				       int sliceW, int sliceH,
+				       GBool printing,
+				       GBool (*abortCheckCbk)(void *data),
+				       void *abortCheckCbkData,
+				       GBool (*annotDisplayDecideCbk)(Annot *annot, void *user_data),
+				       void *annotDisplayDecideCbkData) {
+  SplashOutBands bands;
+  SplashOutputDev *dev;
+  Gfx *gfx;
+  Annots *annotList;
+  Annot *annot;
+  int n, h, nThreads, i;
+
+  // this starts the page, which sets up and clears the bitmap; the
+  // caller (Page::displaySlice) holds the page lock, and the page's
+  // XRef is the private copy if it asked for one
+  gfx = page->createGfx(this, hDPI, vDPI, rotate, useMediaBox, crop,
+			sliceX, sliceY, sliceW, sliceH, printing,
+			abortCheckCbk, abortCheckCbkData, page->getXRef());
+
+  h = bitmap->getHeight();
+  n = nBands < h ? nBands : h;
+  bands.page = page;
+  bands.xref = page->getXRef();
+  bands.hDPI = hDPI;
+  bands.vDPI = vDPI;
+  bands.rotate = rotate;
+  bands.useMediaBox = useMediaBox;
+  bands.crop = crop;
+  bands.sliceX = sliceX;
+  bands.sliceY = sliceY;
+  bands.sliceW = sliceW;
+  bands.sliceH = sliceH;
+  bands.printing = printing;
+  bands.abortCheckCbk = abortCheckCbk;
+  bands.abortCheckCbkData = abortCheckCbkData;
+
+  // the band devices are kept from page to page, so they keep their
+  // fonts
+  if (nBandDevs != n) {
+    deleteBandDevs();
+    bandDevs = (SplashOutputDev **)gmallocn(n, sizeof(SplashOutputDev *));
+    for (i = 0; i < n; ++i) {
+      dev = new SplashOutputDev(colorMode, bitmapRowPad, reverseVideo,
+				keepAlphaChannel ? NULL : paperColor,
+				bitmapTopDown, splash->getThinLineMode(),
+				overprintPreview);
+      dev->fontAntialias = fontAntialias;
+      dev->enableFreeTypeHinting = enableFreeTypeHinting;
+      dev->enableSlightHinting = enableSlightHinting;
+      dev->startDoc(doc);
+      delete dev->bitmap;
+      dev->bitmap = NULL;
+      dev->bandDev = gTrue;
+      bandDevs[i] = dev;
+    }
+    nBandDevs = n;
+  }
+  for (i = 0; i < n; ++i) {
+    dev = bandDevs[i];
+    dev->reverseVideo = reverseVideo;
+    splashColorCopy(dev->paperColor, paperColor);
+    dev->bitmapUpsideDown = bitmapUpsideDown;
+    dev->vectorAntialias = vectorAntialias;
+    dev->aaMode = aaMode;
+    dev->reduceImageResolution = reduceImageResolution;
+    dev->skipHorizText = skipHorizText;
+    dev->skipRotatedText = skipRotatedText;
+    dev->splash->setThinLineMode(splash->getThinLineMode());
+    dev->bitmap = bitmap;
+    dev->bandYMin = (int)(((long long)h * i) / n);
+    dev->bandYMax = (int)(((long long)h * (i + 1)) / n) - 1;
+  }
+  bands.devs = bandDevs;
+
+#if MULTITHREADED
+  nThreads = globalParams->getNumThreads();
+#else
+  nThreads = 1;
+#endif
+  gRunJobs(n, nThreads, &displayBand, &bands);
+
+  for (i = 0; i < n; ++i) {
+    bandDevs[i]->bitmap = NULL;
+  }
+
+  // draw the annotations, as Page::displaySlice does
+  annotList = page->getAnnots();
+  if (annotList->getNumAnnots() > 0) {
+    if (globalParams->getPrintCommands()) {
+      printf("***** Annotations\n");
+    }
+    for (i = 0; i < annotList->getNumAnnots(); ++i) {
+      annot = annotList->getAnnot(i);
+      if (!annotDisplayDecideCbk ||
+	  (*annotDisplayDecideCbk)(annot, annotDisplayDecideCbkData)) {
+	annot->draw(gfx, printing);
+      }
+    }
+    dump();
+  }
+
+  // this ends the page
+  delete gfx;
+}
+
+void SplashOutputDev::deleteBandDevs() {
+  int i;
+
+  for (i = 0; i < nBandDevs; ++i) {
+    delete bandDevs[i];
+  }
+  gfree(bandDevs);
+  bandDevs = NULL;
+  nBandDevs = 0;
+}
+
+void SplashOutputDev::displayBand(int band, void *data) {
+  SplashOutBands *bands = (SplashOutBands *)data;
+  Gfx *gfx;
+
+  gfx = bands->page->createGfx(bands->devs[band],
+			       bands->hDPI, bands->vDPI, bands->rotate,
+			       bands->useMediaBox, bands->crop,
+			       bands->sliceX, bands->sliceY,
+			       bands->sliceW, bands->sliceH,
+			       bands->printing,
+			       bands->abortCheckCbk, bands->abortCheckCbkData,
+			       bands->xref);
+  bands->page->display(gfx);
+  delete gfx;
 }
 
 void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
@@ -1531,7 +2431,9 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
     delete splash;
     splash = NULL;
   }
-  if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
+  // a band device draws into the bitmap of the page it is a band of
+  if (!bandDev &&
+      (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight())) {
     if (bitmap) {
       delete bitmap;
       bitmap = NULL;
@@ -1546,8 +2448,15 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
     }
   }
   splash = new Splash(bitmap, vectorAntialias, &screenParams);
+  if (bandDev) {
+    splash->setBand(bandYMin, bandYMax);
+  }
   splash->setThinLineMode(thinLineMode);
+  splash->setAAMode(aaMode);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
+#if MULTITHREADED
+  splash->setNumThreads(bandDev ? 1 : globalParams->getNumThreads());
+#endif
   if (state) {
     ctm = state->getCTM();
     mat[0] = (SplashCoord)ctm[0];
@@ -1589,11 +2498,13 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
   // the SA parameter supposedly defaults to false, but Acrobat
   // apparently hardwires it to true
   splash->setStrokeAdjust(globalParams->getStrokeAdjust());
-  splash->clear(paperColor, 0);
+  if (!bandDev) {
+    splash->clear(paperColor, 0);
+  }
 }
 
 void SplashOutputDev::endPage() {
-  if (colorMode != splashModeMono1 && !keepAlphaChannel) {
+  if (colorMode != splashModeMono1 && !keepAlphaChannel && !bandDev) {
     splash->compositeBackground(paperColor);
   }
 }
@@ -1928,7 +2839,8 @@ void SplashOutputDev::setOverprintMask(GfxColorSpace *colorSpace,
 }
 
 void SplashOutputDev::updateBlendMode(GfxState *state) {
-  splash->setBlendFunc(splashOutBlendFuncs[state->getBlendMode()]);
+  splash->setBlendFunc(splashOutBlendFuncs[state->getBlendMode()],
+		       splashOutBlendRowFuncs[state->getBlendMode()]);
 }
 
 void SplashOutputDev::updateFillOpacity(GfxState *state) {
@@ -2064,7 +2976,7 @@ reload:
   if (fontsrc && !fontsrc->isFile)
       fontsrc->unref();
 
-  id = new SplashOutFontFileID(gfxFont->getID());
+  id = new SplashOutFontFileID(gfxFont->getID(), doc);
   if ((fontFile = fontEngine->getFontFile(id))) {
     delete id;
 
@@ -2533,11 +3445,11 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
   double *ctm, *bbox;
   T3FontCache *t3Font;
   T3GlyphStack *t3gs;
+  Guchar *data;
   GBool validBBox;
   double m[4];
   GBool horiz;
   double x1, y1, xMin, yMin, xMax, yMax, xt, yt;
-  int i, j;
 
   if (skipHorizText || skipRotatedText) {
     state->getFontTransMat(&m[0], &m[1], &m[2], &m[3]);
@@ -2555,109 +3467,72 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
   ctm = state->getCTM();
   state->transform(0, 0, &xt, &yt);
 
-  // is it the first (MRU) font in the cache?
-  if (!(nT3Fonts > 0 &&
-	t3FontCache[0]->matches(fontID, ctm[0], ctm[1], ctm[2], ctm[3]))) {
-
-    // is the font elsewhere in the cache?
-    for (i = 1; i < nT3Fonts; ++i) {
-      if (t3FontCache[i]->matches(fontID, ctm[0], ctm[1], ctm[2], ctm[3])) {
-	t3Font = t3FontCache[i];
-	for (j = i; j > 0; --j) {
-	  t3FontCache[j] = t3FontCache[j - 1];
-	}
-	t3FontCache[0] = t3Font;
-	break;
+  if (!t3GlyphCache) {
+    t3GlyphCache = new T3GlyphCache(globalParams->getType3CacheSize());
+  }
+  if (!(t3Font = t3GlyphCache->getFont(fontID, ctm[0], ctm[1],
+				       ctm[2], ctm[3]))) {
+    bbox = gfxFont->getFontBBox();
+    if (bbox[0] == 0 && bbox[1] == 0 && bbox[2] == 0 && bbox[3] == 0) {
+      // unspecified bounding box -- just take a guess
+      xMin = xt - 5;
+      xMax = xMin + 30;
+      yMax = yt + 15;
+      yMin = yMax - 45;
+      validBBox = gFalse;
+    } else {
+      state->transform(bbox[0], bbox[1], &x1, &y1);
+      xMin = xMax = x1;
+      yMin = yMax = y1;
+      state->transform(bbox[0], bbox[3], &x1, &y1);
+      if (x1 < xMin) {
+        xMin = x1;
+      } else if (x1 > xMax) {
+        xMax = x1;
       }
-    }
-    if (i >= nT3Fonts) {
-
-      // create new entry in the font cache
-      if (nT3Fonts == splashOutT3FontCacheSize) {
-	t3gs = t3GlyphStack;
-	while (t3gs != NULL) {
-	  if (t3gs->cache == t3FontCache[nT3Fonts - 1]) {
-	    error(errSyntaxWarning, -1, "t3FontCache reaches limit but font still on stack in SplashOutputDev::beginType3Char");
-	    return gTrue;
-	  }
-	  t3gs = t3gs->next;
-	}
-	delete t3FontCache[nT3Fonts - 1];
-	--nT3Fonts;
+      if (y1 < yMin) {
+        yMin = y1;
+      } else if (y1 > yMax) {
+        yMax = y1;
       }
-      for (j = nT3Fonts; j > 0; --j) {
-	t3FontCache[j] = t3FontCache[j - 1];
+      state->transform(bbox[2], bbox[1], &x1, &y1);
+      if (x1 < xMin) {
+        xMin = x1;
+      } else if (x1 > xMax) {
+        xMax = x1;
       }
-      ++nT3Fonts;
-      bbox = gfxFont->getFontBBox();
-      if (bbox[0] == 0 && bbox[1] == 0 && bbox[2] == 0 && bbox[3] == 0) {
-	// unspecified bounding box -- just take a guess
-	xMin = xt - 5;
-	xMax = xMin + 30;
-	yMax = yt + 15;
-	yMin = yMax - 45;
-	validBBox = gFalse;
-      } else {
-	state->transform(bbox[0], bbox[1], &x1, &y1);
-	xMin = xMax = x1;
-	yMin = yMax = y1;
-	state->transform(bbox[0], bbox[3], &x1, &y1);
-	if (x1 < xMin) {
-	  xMin = x1;
-	} else if (x1 > xMax) {
-	  xMax = x1;
-	}
-	if (y1 < yMin) {
-	  yMin = y1;
-	} else if (y1 > yMax) {
-	  yMax = y1;
-	}
-	state->transform(bbox[2], bbox[1], &x1, &y1);
-	if (x1 < xMin) {
-	  xMin = x1;
-	} else if (x1 > xMax) {
-	  xMax = x1;
-	}
-	if (y1 < yMin) {
-	  yMin = y1;
-	} else if (y1 > yMax) {
-	  yMax = y1;
-	}
-	state->transform(bbox[2], bbox[3], &x1, &y1);
-	if (x1 < xMin) {
-	  xMin = x1;
-	} else if (x1 > xMax) {
-	  xMax = x1;
-	}
-	if (y1 < yMin) {
-	  yMin = y1;
-	} else if (y1 > yMax) {
-	  yMax = y1;
-	}
-	validBBox = gTrue;
+      if (y1 < yMin) {
+        yMin = y1;
+      } else if (y1 > yMax) {
+        yMax = y1;
+      }
+      state->transform(bbox[2], bbox[3], &x1, &y1);
+      if (x1 < xMin) {
+        xMin = x1;
+      } else if (x1 > xMax) {
+        xMax = x1;
       }
-      t3FontCache[0] = new T3FontCache(fontID, ctm[0], ctm[1], ctm[2], ctm[3],
-	                               (int)floor(xMin - xt) - 2,
-				       (int)floor(yMin - yt) - 2,
-				       (int)ceil(xMax) - (int)floor(xMin) + 4,
-				       (int)ceil(yMax) - (int)floor(yMin) + 4,
-				       validBBox,
-				       colorMode != splashModeMono1);
+      if (y1 < yMin) {
+        yMin = y1;
+      } else if (y1 > yMax) {
+        yMax = y1;
+      }
+      validBBox = gTrue;
     }
+    t3Font = new T3FontCache(fontID, ctm[0], ctm[1], ctm[2], ctm[3],
+			     (int)floor(xMin - xt) - 2,
+			     (int)floor(yMin - yt) - 2,
+			     (int)ceil(xMax) - (int)floor(xMin) + 4,
+			     (int)ceil(yMax) - (int)floor(yMin) + 4,
+			     validBBox,
+			     colorMode != splashModeMono1);
+    t3GlyphCache->addFont(t3Font);
   }
-  t3Font = t3FontCache[0];
 
   // is the glyph in the cache?
-  i = (code & (t3Font->cacheSets - 1)) * t3Font->cacheAssoc;
-  for (j = 0; j < t3Font->cacheAssoc; ++j) {
-    if (t3Font->cacheTags != NULL) {
-      if ((t3Font->cacheTags[i+j].mru & 0x8000) &&
-	t3Font->cacheTags[i+j].code == code) {
-        drawType3Glyph(state, t3Font, &t3Font->cacheTags[i+j],
-		     t3Font->cacheData + (i+j) * t3Font->glyphSize);
-        return gTrue;
-      }
-    }
+  if ((data = t3Font->lookup(code))) {
+    drawType3Glyph(state, t3Font, data);
+    return gTrue;
   }
 
   // push a new Type 3 glyph record
@@ -2666,8 +3541,8 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
   t3GlyphStack = t3gs;
   t3GlyphStack->code = code;
   t3GlyphStack->cache = t3Font;
-  t3GlyphStack->cacheTag = NULL;
-  t3GlyphStack->cacheData = NULL;
+  t3GlyphStack->cacheGlyph = gFalse;
+  ++t3Font->refCnt;
 
   haveT3Dx = gFalse;
 
@@ -2676,13 +3551,15 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
 
 void SplashOutputDev::endType3Char(GfxState *state) {
   T3GlyphStack *t3gs;
+  T3FontCache *t3Font;
+  SplashBitmap *glyphBitmap;
+  Guchar *data;
   double *ctm;
 
-  if (t3GlyphStack->cacheTag) {
+  t3Font = t3GlyphStack->cache;
+  if (t3GlyphStack->cacheGlyph) {
     --nestCount;
-    memcpy(t3GlyphStack->cacheData, bitmap->getDataPtr(),
-	   t3GlyphStack->cache->glyphSize);
-    delete bitmap;
+    glyphBitmap = bitmap;
     delete splash;
     bitmap = t3GlyphStack->origBitmap;
     splash = t3GlyphStack->origSplash;
@@ -2690,9 +3567,17 @@ void SplashOutputDev::endType3Char(GfxState *state) {
     state->setCTM(ctm[0], ctm[1], ctm[2], ctm[3],
 		  t3GlyphStack->origCTM4, t3GlyphStack->origCTM5);
     updateCTM(state, 0, 0, 0, 0, 0, 0);
-    drawType3Glyph(state, t3GlyphStack->cache,
-		   t3GlyphStack->cacheTag, t3GlyphStack->cacheData);
+    // if there is no room for the glyph in the cache, draw it from its
+    // temporary bitmap
+    if ((data = t3GlyphCache->addGlyph(t3Font, t3GlyphStack->code))) {
+      memcpy(data, glyphBitmap->getDataPtr(), t3Font->glyphSize);
+    } else {
+      data = glyphBitmap->getDataPtr();
+    }
+    drawType3Glyph(state, t3Font, data);
+    delete glyphBitmap;
   }
+  --t3Font->refCnt;
   t3gs = t3GlyphStack;
   t3GlyphStack = t3gs->next;
   delete t3gs;
@@ -2708,7 +3593,6 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
   T3FontCache *t3Font;
   SplashColor color;
   double xt, yt, xMin, xMax, yMin, yMax, x1, y1;
-  int i, j;
 
   // ignore multiple d0/d1 operators
   if (haveT3Dx) {
@@ -2781,21 +3665,8 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
     return;
   }
 
-  if (t3Font->cacheTags == NULL)
-    return;
-
-  // allocate a cache entry
-  i = (t3GlyphStack->code & (t3Font->cacheSets - 1)) * t3Font->cacheAssoc;
-  for (j = 0; j < t3Font->cacheAssoc; ++j) {
-    if ((t3Font->cacheTags[i+j].mru & 0x7fff) == t3Font->cacheAssoc - 1) {
-      t3Font->cacheTags[i+j].mru = 0x8000;
-      t3Font->cacheTags[i+j].code = t3GlyphStack->code;
-      t3GlyphStack->cacheTag = &t3Font->cacheTags[i+j];
-      t3GlyphStack->cacheData = t3Font->cacheData + (i+j) * t3Font->glyphSize;
-    } else {
-      ++t3Font->cacheTags[i+j].mru;
-    }
-  }
+  // the glyph is drawn to a bitmap, which is cached in endType3Char
+  t3GlyphStack->cacheGlyph = gTrue;
 
   // save state
   t3GlyphStack->origBitmap = bitmap;
@@ -2824,6 +3695,7 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
   }
   splash->setMinLineWidth(globalParams->getMinLineWidth());
   splash->setThinLineMode(splashThinLineDefault);
+  splash->setAAMode(aaMode);
   splash->setFillPattern(new SplashSolidColor(color));
   splash->setStrokePattern(new SplashSolidColor(color));
   //~ this should copy other state from t3GlyphStack->origSplash?
@@ -2834,7 +3706,7 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
 }
 
 void SplashOutputDev::drawType3Glyph(GfxState *state, T3FontCache *t3Font,
-				     T3FontCacheTag * /*tag*/, Guchar *data) {
+				     Guchar *data) {
   SplashGlyphBitmap glyph;
 
   setOverprintMask(state->getFillColorSpace(), state->getFillOverprint(),
@@ -3519,7 +4391,9 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   GfxColor deviceN;
 #endif
   Guchar pix;
-  int n, i;
+  SplashCoord xSize, ySize;
+  GBool region;
+  int scale, n, i;
 
   ctm = state->getCTM();
   for (i = 0; i < 6; ++i) {
@@ -3532,6 +4406,32 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
 
+  // if only part of the image can be visible (in a page slice, a page
+  // band, or a clip rectangle), let the stream skip the rest
+  region = gFalse;
+  if (!inlineImg) {
+    region = setImageDecodeRegion(str, mat, width, height);
+  }
+
+  // decode the image at the lowest resolution (down to 1/32, as far as
+  // the stream goes) that is still at least the size it is drawn at
+  scale = 1;
+  if (reduceImageResolution && !inlineImg) {
+    xSize = splashSqrt(mat[0] * mat[0] + mat[1] * mat[1]);
+    ySize = splashSqrt(mat[2] * mat[2] + mat[3] * mat[3]);
+    for (scale = 32; scale > 1; scale >>= 1) {
+      if ((width + scale - 1) / scale >= xSize &&
+	  (height + scale - 1) / scale >= ySize) {
+	break;
+      }
+    }
+    if (scale > 1) {
+      scale = str->setDecodeScale(scale);
+      width = (width + scale - 1) / scale;
+      height = (height + scale - 1) / scale;
+    }
+  }
+
   imgData.imgStr = new ImageStream(str, width,
 				   colorMap->getNumPixelComps(),
 				   colorMap->getBits());
@@ -3649,6 +4549,84 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   gfree(imgData.lookup);
   delete imgData.imgStr;
   str->close();
+  if (scale > 1) {
+    str->setDecodeScale(1);
+  }
+  if (region) {
+    str->setDecodeRegion(0, 0, 0, 0);
+  }
+}
+
+// Map the clip rectangle (and band) back to the pixels of a <width> x
+// <height> image drawn with <mat>, and set that part of the image as
+// the stream's decode region (see Stream::setDecodeRegion), with a
+// margin for the image scaling filters: at least one device pixel,
+// since a downscaled image's edge pixels are averaged from a whole
+// device pixel's worth of image pixels.  Returns false if the whole
+// image may be visible.
+GBool SplashOutputDev::setImageDecodeRegion(Stream *str, SplashCoord *mat,
+					    int width, int height) {
+  SplashClip *clip;
+  SplashCoord det, xMin, yMin, xMax, yMax, x, y, u, v;
+  SplashCoord uMin, vMin, uMax, vMax, xSize, ySize;
+  int xMargin, yMargin, x0, y0, x1, y1, i;
+
+  det = mat[0] * mat[3] - mat[1] * mat[2];
+  if (splashAbs(det) < 0.000001) {
+    return gFalse;
+  }
+  clip = splash->getClip();
+  xMin = clip->getXMin();
+  xMax = clip->getXMax();
+  yMin = clip->getYMin();
+  yMax = clip->getYMax();
+  if (yMin < clip->getBandYMin()) {
+    yMin = clip->getBandYMin();
+  }
+  if (yMax > (SplashCoord)clip->getBandYMax() + 1) {
+    yMax = (SplashCoord)clip->getBandYMax() + 1;
+  }
+  if (xMin >= xMax || yMin >= yMax) {
+    return gFalse;
+  }
+  uMin = vMin = uMax = vMax = 0; // make gcc happy
+  for (i = 0; i < 4; ++i) {
+    x = ((i & 1) ? xMax : xMin) - mat[4];
+    y = ((i & 2) ? yMax : yMin) - mat[5];
+    u = (mat[3] * x - mat[2] * y) / det;
+    v = (mat[0] * y - mat[1] * x) / det;
+    if (i == 0 || u < uMin) {
+      uMin = u;
+    }
+    if (i == 0 || u > uMax) {
+      uMax = u;
+    }
+    if (i == 0 || v < vMin) {
+      vMin = v;
+    }
+    if (i == 0 || v > vMax) {
+      vMax = v;
+    }
+  }
+  // (an image drawn smaller than a device pixel is read whole)
+  xSize = splashSqrt(mat[0] * mat[0] + mat[1] * mat[1]);
+  ySize = splashSqrt(mat[2] * mat[2] + mat[3] * mat[3]);
+  if (xSize < 1 || ySize < 1) {
+    return gFalse;
+  }
+  xMargin = splashCeil(width / xSize) + 16;
+  yMargin = splashCeil(height / ySize) + 16;
+  x0 = uMin > 0 ? splashFloor((uMin < 1 ? uMin : 1) * width) - xMargin : 0;
+  y0 = vMin > 0 ? splashFloor((vMin < 1 ? vMin : 1) * height) - yMargin : 0;
+  x1 = uMax < 1 ? splashCeil((uMax > 0 ? uMax : 0) * width) + xMargin
+                : width;
+  y1 = vMax < 1 ? splashCeil((vMax > 0 ? vMax : 0) * height) + yMargin
+                : height;
+  if (x0 <= 0 && y0 <= 0 && x1 >= width && y1 >= height) {
+    return gFalse;
+  }
+  str->setDecodeRegion(x0, y0, x1, y1);
+  return gTrue;
 }
 
 struct SplashOutMaskedImageData {
@@ -4145,7 +5123,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
   SplashTransparencyGroup *transpGroup;
   SplashColor color;
   double xMin, yMin, xMax, yMax, x, y;
-  int tx, ty, w, h, i;
+  int tx, ty, w, h, yMinB, yMaxB, i;
 
   // transform the bbox
   state->transform(bbox[0], bbox[1], &x, &y);
@@ -4218,6 +5196,8 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
   transpGroup->ty = ty;
   transpGroup->blendingColorSpace = blendingColorSpace;
   transpGroup->isolated = isolated;
+  //~ in a band device, this reads rows that other bands may be drawing,
+  //~   but only the rows of this band are used
   transpGroup->shape = (knockout && !isolated) ? SplashBitmap::copy(bitmap) : NULL;
   transpGroup->knockout = (knockout && isolated);
   transpGroup->knockoutOpacity = 1.0;
@@ -4271,8 +5251,17 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
     fontEngine->setAA(gFalse);
 #endif
   }
+  if (bandDev) {
+    bandYMin -= ty;
+    bandYMax -= ty;
+    splash->setBand(bandYMin, bandYMax);
+  }
   splash->setThinLineMode(transpGroup->origSplash->getThinLineMode());
+  splash->setAAMode(aaMode);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
+#if MULTITHREADED
+  splash->setNumThreads(bandDev ? 1 : globalParams->getNumThreads());
+#endif
   //~ Acrobat apparently copies at least the fill and stroke colors, and
   //~ maybe other state(?) -- but not the clipping path (and not sure
   //~ what else)
@@ -4293,7 +5282,23 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
       (transpGroup->next != NULL && transpGroup->next->shape != NULL) ? transpGroup->next->tx + tx : tx;
     int shapeTy = (knockout) ? ty :
       (transpGroup->next != NULL && transpGroup->next->shape != NULL) ? transpGroup->next->ty + ty : ty;
-    splash->blitTransparent(transpGroup->origBitmap, tx, ty, 0, 0, w, h);
+    if (bandDev) {
+      // the other bands are being drawn into the parent bitmap: only
+      // copy the rows of this one
+      for (i = 0; i < splashMaxColorComps; ++i) {
+	color[i] = 0;
+      }
+      if (colorMode == splashModeXBGR8) color[3] = 255;
+      splash->clear(color, 0);
+      yMinB = bandYMin < 0 ? 0 : bandYMin;
+      yMaxB = bandYMax >= h ? h - 1 : bandYMax;
+      if (yMinB <= yMaxB) {
+	splash->blitTransparent(transpGroup->origBitmap, tx, ty + yMinB,
+				0, yMinB, w, yMaxB - yMinB + 1);
+      }
+    } else {
+      splash->blitTransparent(transpGroup->origBitmap, tx, ty, 0, 0, w, h);
+    }
     splash->setInNonIsolatedGroup(shape, shapeTx, shapeTy);
   }
   transpGroup->tBitmap = bitmap;
@@ -4309,6 +5314,10 @@ void SplashOutputDev::endTransparencyGroup(GfxState *state) {
   bitmap = transpGroupStack->origBitmap;
   colorMode = bitmap->getMode();
   splash = transpGroupStack->origSplash;
+  if (bandDev) {
+    bandYMin += transpGroupStack->ty;
+    bandYMax += transpGroupStack->ty;
+  }
   state->shiftCTMAndClip(transpGroupStack->tx, transpGroupStack->ty);
   updateCTM(state, 0, 0, 0, 0, 0, 0);
 }
@@ -4360,7 +5369,7 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   Splash *tSplash;
   SplashTransparencyGroup *transpGroup;
   SplashColor color;
-  SplashColorPtr p;
+  SplashColorPtr p, q;
   GfxGray gray;
   GfxRGB rgb;
 #if SPLASH_CMYK
@@ -4368,7 +5377,11 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   GfxColor deviceN;
 #endif
   double lum, lum2;
-  int tx, ty, x, y;
+  Guchar lut[256];
+  Guchar lastVal;
+  Guint c, lastColor;
+  GBool haveLast;
+  int tx, ty, x, y, i, nComps, iR;
 
   tx = transpGroupStack->tx;
   ty = transpGroupStack->ty;
@@ -4430,57 +5443,113 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   }
   memset(softMask->getDataPtr(), fill,
 	 softMask->getRowSize() * softMask->getHeight());
-  p = softMask->getDataPtr() + ty * softMask->getRowSize() + tx;
   int xMax = tBitmap->getWidth();
   int yMax = tBitmap->getHeight();
   if (xMax > bitmap->getWidth() - tx) xMax = bitmap->getWidth() - tx;
   if (yMax > bitmap->getHeight() - ty) yMax = bitmap->getHeight() - ty;
-  for (y = 0; y < yMax; ++y) {
-    for (x = 0; x < xMax; ++x) {
-      if (alpha) {
-	if (transferFunc) {
-	  lum = tBitmap->getAlpha(x, y) / 255.0;
-	  transferFunc->transform(&lum, &lum2);
-	  p[x] = (int)(lum2 * 255.0 + 0.5);
-	} else 
-	  p[x] = tBitmap->getAlpha(x, y);
+  // a band device only draws, and uses the soft mask in, its rows
+  int yMin = 0;
+  if (bandDev) {
+    if (yMin < bandYMin - ty) yMin = bandYMin - ty;
+    if (yMax > bandYMax - ty + 1) yMax = bandYMax - ty + 1;
+  }
+  // the soft mask values of the 256 alpha (or gray) levels, so that the
+  // transfer function is run once per level instead of once per pixel
+  for (i = 0; i < 256; ++i) {
+    if (alpha && !transferFunc) {
+      lut[i] = (Guchar)i;
+    } else {
+      lum = i / 255.0;
+      if (transferFunc) {
+	transferFunc->transform(&lum, &lum2);
       } else {
-	  tBitmap->getPixel(x, y, color);
-	  // convert to luminosity
-	  switch (tBitmap->getMode()) {
-	  case splashModeMono1:
-	  case splashModeMono8:
-	    lum = color[0] / 255.0;
-	    break;
-	  case splashModeXBGR8:
-	  case splashModeRGB8:
-	  case splashModeBGR8:
+	lum2 = lum;
+      }
+      lut[i] = (Guchar)(int)(lum2 * 255.0 + 0.5);
+    }
+  }
+  // the other colors are converted to luminosity a row at a time; the
+  // last color converted is kept, since groups often have long runs of
+  // the same color
+  haveLast = gFalse;
+  lastColor = 0;
+  lastVal = 0;
+  p = softMask->getDataPtr() + (ty + yMin) * softMask->getRowSize() + tx;
+  for (y = yMin; y < yMax; ++y) {
+    if (alpha) {
+      q = tBitmap->getAlphaPtr() + y * tBitmap->getWidth();
+      for (x = 0; x < xMax; ++x) {
+	p[x] = lut[q[x]];
+      }
+    } else {
+      q = tBitmap->getDataPtr() + y * tBitmap->getRowSize();
+      switch (tBitmap->getMode()) {
+      case splashModeMono1:
+	for (x = 0; x < xMax; ++x) {
+	  p[x] = lut[(q[x >> 3] & (0x80 >> (x & 7))) ? 0xff : 0x00];
+	}
+	break;
+      case splashModeMono8:
+	for (x = 0; x < xMax; ++x) {
+	  p[x] = lut[q[x]];
+	}
+	break;
+      case splashModeXBGR8:
+      case splashModeRGB8:
+      case splashModeBGR8:
+	nComps = splashColorModeNComps[tBitmap->getMode()];
+	iR = tBitmap->getMode() == splashModeRGB8 ? 0 : 2;
+	for (x = 0; x < xMax; ++x, q += nComps) {
+	  color[0] = q[iR];
+	  color[1] = q[1];
+	  color[2] = q[2 - iR];
+	  c = (color[0] << 16) | (color[1] << 8) | color[2];
+	  if (!haveLast || c != lastColor) {
 	    lum = (0.3 / 255.0) * color[0] +
 	          (0.59 / 255.0) * color[1] +
 	          (0.11 / 255.0) * color[2];
-	    break;
+	    if (transferFunc) {
+	      transferFunc->transform(&lum, &lum2);
+	    } else {
+	      lum2 = lum;
+	    }
+	    lastVal = (Guchar)(int)(lum2 * 255.0 + 0.5);
+	    lastColor = c;
+	    haveLast = gTrue;
+	  }
+	  p[x] = lastVal;
+	}
+	break;
 #if SPLASH_CMYK
-	  case splashModeCMYK8:
-    case splashModeDeviceN8:
-	    lum = (1 - color[3] / 255.0)
-	          - (0.3 / 255.0) * color[0]
-	          - (0.59 / 255.0) * color[1]
-	          - (0.11 / 255.0) * color[2];
+      case splashModeCMYK8:
+      case splashModeDeviceN8:
+	nComps = splashColorModeNComps[tBitmap->getMode()];
+	for (x = 0; x < xMax; ++x, q += nComps) {
+	  c = (q[0] << 24) | (q[1] << 16) | (q[2] << 8) | q[3];
+	  if (!haveLast || c != lastColor) {
+	    lum = (1 - q[3] / 255.0)
+	          - (0.3 / 255.0) * q[0]
+	          - (0.59 / 255.0) * q[1]
+	          - (0.11 / 255.0) * q[2];
 	    if (lum < 0) {
 	      lum = 0;
 	    }
-	    break;
-#endif
-	}
-	if (transferFunc) {
-	  transferFunc->transform(&lum, &lum2);
-	} else {
-	  lum2 = lum;
+	    if (transferFunc) {
+	      transferFunc->transform(&lum, &lum2);
+	    } else {
+	      lum2 = lum;
+	    }
+	    lastVal = (Guchar)(int)(lum2 * 255.0 + 0.5);
+	    lastColor = c;
+	    haveLast = gTrue;
+	  }
+	  p[x] = lastVal;
 	}
-	p[x] = (int)(lum2 * 255.0 + 0.5);
+	break;
+#endif
       }
     }
-	p += softMask->getRowSize();
+    p += softMask->getRowSize();
   }
   splash->setSoftMask(softMask);
 
@@ -4538,6 +5607,11 @@ void SplashOutputDev::setVectorAntialias(GBool vaa) {
 }
 #endif
 
+void SplashOutputDev::setAAMode(SplashAAMode aaModeA) {
+  aaMode = aaModeA;
+  splash->setAAMode(aaMode);
+}
+
 void SplashOutputDev::setFreeTypeHinting(GBool enable, GBool enableSlightHintingA)
 {
   enableFreeTypeHinting = enable;
@@ -4687,7 +5761,11 @@ GBool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog *ca
     splash->clear(paperColor, 0);
   }
   splash->setThinLineMode(formerSplash->getThinLineMode());
+  splash->setAAMode(aaMode);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
+#if MULTITHREADED
+  splash->setNumThreads(bandDev ? 1 : globalParams->getNumThreads());
+#endif
 
   box.x1 = bbox[0]; box.y1 = bbox[1];
   box.x2 = bbox[2]; box.y2 = bbox[3];
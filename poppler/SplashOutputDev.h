@@ -51,7 +51,7 @@ class SplashPath;
 class SplashFontEngine;
 class SplashFont;
 class T3FontCache;
-struct T3FontCacheTag;
+class T3GlyphCache;
 struct T3GlyphStack;
 struct SplashTransparencyGroup;
 
@@ -183,11 +183,6 @@ private:
   double a, inva;
 };
 
-//------------------------------------------------------------------------
-
-// number of Type 3 fonts to cache
-#define splashOutT3FontCacheSize 8
-
 //------------------------------------------------------------------------
 // SplashOutputDev
 //------------------------------------------------------------------------
@@ -231,6 +226,18 @@ public:
 
   //----- initialization and control
 
+  // Check to see if a page slice should be displayed.  When pages are
+  // rendered in bands (see setNumBands), this renders the page and
+  // returns false.
+  virtual GBool checkPageSlice(Page *page, double hDPI, double vDPI,
+			       int rotate, GBool useMediaBox, GBool crop,
+			       int sliceX, int sliceY, int sliceW, int sliceH,
+			       GBool printing,
+			       GBool (* abortCheckCbk)(void *data) = NULL,
+			       void * abortCheckCbkData = NULL,
+			       GBool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = NULL,
+			       void *annotDisplayDecideCbkData = NULL);
+
   // Start a page.
   virtual void startPage(int pageNum, GfxState *state, XRef *xref);
 
@@ -393,8 +400,30 @@ public:
   GBool getFontAntialias() { return fontAntialias; }
   void setFontAntialias(GBool anti) { fontAntialias = anti; }
 
+  // Set the anti-aliasing method for vector graphics (see
+  // Splash::setAAMode).
+  void setAAMode(SplashAAMode aaModeA);
+  SplashAAMode getAAMode() { return aaMode; }
+
   void setFreeTypeHinting(GBool enable, GBool enableSlightHinting);
 
+  // Render each page in <nBandsA> horizontal bands, which are drawn
+  // concurrently, by up to GlobalParams::getNumThreads() threads, into
+  // the same bitmap.  The bitmap is the same as with a single band (the
+  // default).
+  void setNumBands(int nBandsA) { nBands = nBandsA; }
+  int getNumBands() { return nBands; }
+
+  // If <reduceA> is true, images drawn at half their resolution or
+  // less are decoded at 1/2, 1/4, ... down to 1/32 of their
+  // resolution, if the stream can do that (see
+  // Stream::setDecodeScale).  This makes
+  // drawing large JPEG images into thumbnails much faster, but the
+  // result isn't exactly the same as downsampling the full image.
+  void setReduceImageResolution(GBool reduceA)
+    { reduceImageResolution = reduceA; }
+  GBool getReduceImageResolution() { return reduceImageResolution; }
+
 protected:
   void doUpdateFont(GfxState *state);
 
@@ -409,12 +438,13 @@ private:
   SplashPattern *getColor(GfxColor *deviceN);
 #endif
   void getMatteColor( SplashColorMode colorMode, GfxImageColorMap *colorMap, GfxColor * matteColor, SplashColor splashMatteColor);
+  GBool setImageDecodeRegion(Stream *str, SplashCoord *mat,
+			     int width, int height);
   void setOverprintMask(GfxColorSpace *colorSpace, GBool overprintFlag,
 			int overprintMode, GfxColor *singleColor, GBool grayIndexed = gFalse);
   SplashPath *convertPath(GfxState *state, GfxPath *path,
 			  GBool dropEmptySubpaths);
-  void drawType3Glyph(GfxState *state, T3FontCache *t3Font,
-		      T3FontCacheTag *tag, Guchar *data);
+  void drawType3Glyph(GfxState *state, T3FontCache *t3Font, Guchar *data);
 #ifdef USE_CMS
   GBool useIccImageSrc(void *data);
   static void iccTransform(void *data, SplashBitmap *bitmap);
@@ -430,6 +460,18 @@ private:
 			      Guchar *alphaLine);
   static GBool tilingBitmapSrc(void *data, SplashColorPtr line,
 			     Guchar *alphaLine);
+  GBool canRenderBands();
+  void displayPageBands(Page *page, double hDPI, double vDPI,
+			int rotate, GBool useMediaBox, GBool crop,
+			int sliceX, int sliceY, int sliceW, int sliceH,
+			GBool printing,
+			GBool (*abortCheckCbk)(void *data),
+			void *abortCheckCbkData,
+			GBool (*annotDisplayDecideCbk)(Annot *annot,
+						       void *user_data),
+			void *annotDisplayDecideCbkData);
+  void deleteBandDevs();
+  static void displayBand(int band, void *data);
 
   GBool keepAlphaChannel;	// don't fill with paper color, keep alpha channel
 
@@ -439,6 +481,7 @@ private:
   GBool bitmapUpsideDown;
   GBool fontAntialias;
   GBool vectorAntialias;
+  SplashAAMode aaMode;
   GBool overprintPreview;
   GBool enableFreeTypeHinting;
   GBool enableSlightHinting;
@@ -455,9 +498,7 @@ private:
   Splash *splash;
   SplashFontEngine *fontEngine;
 
-  T3FontCache *			// Type 3 font cache
-    t3FontCache[splashOutT3FontCacheSize];
-  int nT3Fonts;			// number of valid entries in t3FontCache
+  T3GlyphCache *t3GlyphCache;	// Type 3 font cache
   T3GlyphStack *t3GlyphStack;	// Type 3 glyph context stack
   GBool haveT3Dx;		// set after seeing a d0/d1 operator
 
@@ -469,6 +510,15 @@ private:
     transpGroupStack;
   SplashBitmap *maskBitmap; // for image masks in pattern colorspace
   int nestCount;
+
+  int nBands;			// number of bands pages are rendered in
+  GBool reduceImageResolution;	// set to decode images drawn at a
+				//   reduced size at a reduced resolution
+  GBool bandDev;		// set if this device draws one band of the
+				//   bitmap of another SplashOutputDev
+  int bandYMin, bandYMax;	// rows of <bitmap> drawn by a band device
+  SplashOutputDev **bandDevs;	// band devices of this device
+  int nBandDevs;
 };
 
 #endif
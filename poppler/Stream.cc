@@ -62,6 +62,7 @@
 #include "GfxState.h"
 #include "Stream.h"
 #include "XRef.h"
+#include "GlobalParams.h"
 #include "JBIG2Stream.h"
 #include "Stream-CCITT.h"
 #include "CachedFile.h"
@@ -143,6 +144,31 @@ void Stream::getRawChars(int nChars, int *buffer) {
   error(errInternal, -1, "Internal: called getRawChars() on non-predictor stream");
 }
 
+// Shared getChars of the streams that decode into a [bufPtr, bufEnd)
+// buffer: copy up to <nChars> chars out of it into <buffer>, refilling
+// it with str->fillBuf() until that returns false.
+template <class T>
+static int getBufferedChars(T *str, GBool (T::*fillBuf)(),
+			    char **bufPtr, char **bufEnd,
+			    int nChars, Guchar *buffer) {
+  int n, m;
+
+  n = 0;
+  while (n < nChars) {
+    if (*bufPtr >= *bufEnd && !(str->*fillBuf)()) {
+      break;
+    }
+    m = (int)(*bufEnd - *bufPtr);
+    if (m > nChars - n) {
+      m = nChars - n;
+    }
+    memcpy(buffer + n, *bufPtr, m);
+    *bufPtr += m;
+    n += m;
+  }
+  return n;
+}
+
 char *Stream::getLine(char *buf, int size) {
   int i;
   int c;
@@ -175,15 +201,15 @@ Stream *Stream::addFilters(Object *dict, int recursion) {
   int i;
 
   str = this;
-  dict->dictLookup("Filter", &obj, recursion);
+  dict->dictLookup(knownNames.Filter, &obj, recursion);
   if (obj.isNull()) {
     obj.free();
-    dict->dictLookup("F", &obj, recursion);
+    dict->dictLookup(knownNames.F, &obj, recursion);
   }
-  dict->dictLookup("DecodeParms", &params, recursion);
+  dict->dictLookup(knownNames.DecodeParms, &params, recursion);
   if (params.isNull()) {
     params.free();
-    dict->dictLookup("DP", &params, recursion);
+    dict->dictLookup(knownNames.DP, &params, recursion);
   }
   if (obj.isName()) {
     str = makeFilter(obj.getName(), str, &params, recursion, dict);
@@ -781,10 +807,15 @@ FileStream::FileStream(GooFile* fileA, Goffset startA, GBool limitedA,
   bufPos = start;
   savePos = 0;
   saved = gFalse;
+  map = NULL;
+  mapLength = 0;
 }
 
 FileStream::~FileStream() {
   close();
+  if (map) {
+    GooFile::unmap(map, mapLength);
+  }
 }
 
 BaseStream *FileStream::copy() {
@@ -804,6 +835,21 @@ void FileStream::reset() {
   bufPos = start;
 }
 
+const char *FileStream::getData(Goffset *startA, Goffset *endA) {
+  // mapping is opt-in: a file truncated while it is mapped makes the
+  // next access to the missing pages raise SIGBUS
+  if (!map && (!globalParams || !globalParams->getMMapFiles() ||
+	       !(map = file->map(&mapLength)))) {
+    return NULL;
+  }
+  *startA = start < mapLength ? start : mapLength;
+  *endA = mapLength;
+  if (limited && length >= 0 && length < mapLength - *startA) {
+    *endA = *startA + length;
+  }
+  return map;
+}
+
 void FileStream::close() {
   if (saved) {
     offset = savePos;
@@ -857,6 +903,109 @@ void FileStream::moveStart(Goffset delta) {
   bufPos = start;
 }
 
+//------------------------------------------------------------------------
+// MMapStream
+//------------------------------------------------------------------------
+
+MMapStream::MMapStream(GooFile *fileA, Object *dictA):
+    BaseStream(dictA, 0) {
+  map = fileA->map(&mapLength);
+  if (!map) {
+    mapLength = 0;
+  }
+  mapOwner = map != NULL;
+  start = 0;
+  limited = gFalse;
+  length = mapLength;
+  setBounds();
+}
+
+MMapStream::MMapStream(const char *mapA, Goffset mapLengthA, Goffset startA,
+		       GBool limitedA, Goffset lengthA, Object *dictA):
+    BaseStream(dictA, lengthA) {
+  map = mapA;
+  mapLength = mapLengthA;
+  mapOwner = gFalse;
+  start = startA;
+  limited = limitedA;
+  length = lengthA;
+  setBounds();
+}
+
+MMapStream::~MMapStream() {
+  if (mapOwner) {
+    GooFile::unmap(map, mapLength);
+  }
+}
+
+BaseStream *MMapStream::copy() {
+  return new MMapStream(map, mapLength, start, limited, length, &dict);
+}
+
+Stream *MMapStream::makeSubStream(Goffset startA, GBool limitedA,
+				  Goffset lengthA, Object *dictA) {
+  return new MMapStream(map, mapLength, startA, limitedA, lengthA, dictA);
+}
+
+void MMapStream::setBounds() {
+  Goffset end;
+
+  if (start < 0) {
+    start = 0;
+  } else if (start > mapLength) {
+    start = mapLength;
+  }
+  end = mapLength;
+  if (limited && length >= 0 && length < mapLength - start) {
+    end = start + length;
+  }
+  bufPtr = map + start;
+  bufEnd = map + end;
+}
+
+void MMapStream::reset() {
+  bufPtr = map + start;
+}
+
+void MMapStream::close() {
+}
+
+int MMapStream::getChars(int nChars, Guchar *buffer) {
+  int n;
+
+  if (nChars <= 0 || bufPtr >= bufEnd) {
+    return 0;
+  }
+  if (bufEnd - bufPtr < nChars) {
+    n = (int)(bufEnd - bufPtr);
+  } else {
+    n = nChars;
+  }
+  memcpy(buffer, bufPtr, n);
+  bufPtr += n;
+  return n;
+}
+
+void MMapStream::setPos(Goffset pos, int dir) {
+  if (dir < 0) {
+    if (pos > mapLength) {
+      pos = mapLength;
+    }
+    pos = mapLength - pos;
+  }
+  if (pos < 0) {
+    pos = 0;
+  } else if (pos > mapLength) {
+    pos = mapLength;
+  }
+  bufPtr = map + pos;
+}
+
+void MMapStream::moveStart(Goffset delta) {
+  start += delta;
+  setBounds();
+}
+
 //------------------------------------------------------------------------
 // CachedFileStream
 //------------------------------------------------------------------------
@@ -933,6 +1082,12 @@ GBool CachedFileStream::fillBuf()
   return gTrue;
 }
 
+int CachedFileStream::getChars(int nChars, Guchar *buffer)
+{
+  return getBufferedChars(this, &CachedFileStream::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 void CachedFileStream::setPos(Goffset pos, int dir)
 {
   Guint size;
@@ -1183,6 +1338,19 @@ int ASCIIHexStream::lookChar() {
   return buf;
 }
 
+int ASCIIHexStream::getChars(int nChars, Guchar *buffer) {
+  int n, c;
+
+  for (n = 0; n < nChars; ++n) {
+    if ((c = ASCIIHexStream::lookChar()) == EOF) {
+      break;
+    }
+    buf = EOF;
+    buffer[n] = (Guchar)c;
+  }
+  return n;
+}
+
 GooString *ASCIIHexStream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
 
@@ -1264,6 +1432,22 @@ int ASCII85Stream::lookChar() {
   return b[index];
 }
 
+int ASCII85Stream::getChars(int nChars, Guchar *buffer) {
+  int m, i;
+
+  m = 0;
+  while (m < nChars) {
+    if (index >= n && ASCII85Stream::lookChar() == EOF) {
+      break;
+    }
+    for (i = index; i < n && m < nChars; ++i) {
+      buffer[m++] = (Guchar)b[i];
+    }
+    index = i;
+  }
+  return m;
+}
+
 GooString *ASCII85Stream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
 
@@ -1475,6 +1659,14 @@ int LZWStream::getCode() {
   return code;
 }
 
+int LZWStream::lookBufferedChars(const Guchar **chars) {
+  if (pred || eof) {
+    return 0;
+  }
+  *chars = seqBuf + seqIndex;
+  return seqLength - seqIndex;
+}
+
 GooString *LZWStream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
 
@@ -2347,6 +2539,19 @@ short CCITTFaxStream::lookBits(int n) {
   return (inputBuf >> (inputBits - n)) & (0xffffffff >> (32 - n));
 }
 
+int CCITTFaxStream::getChars(int nChars, Guchar *buffer) {
+  int n, c;
+
+  for (n = 0; n < nChars; ++n) {
+    if ((c = CCITTFaxStream::lookChar()) == EOF) {
+      break;
+    }
+    buf = EOF;
+    buffer[n] = (Guchar)c;
+  }
+  return n;
+}
+
 GooString *CCITTFaxStream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
   char s1[50];
@@ -2435,11 +2640,208 @@ static const int dctZigZag[64] = {
   63
 };
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define DCT_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+#if DCT_SSE2
+
+// Multiply the 32-bit lanes of <a> by the constant in all the lanes of
+// <c>, keeping the low 32 bits of the products (SSE2 has no pmulld).
+static inline __m128i dctMul(__m128i a, __m128i c) {
+  __m128i lo = _mm_mul_epu32(a, c);
+  __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), c);
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(lo, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Multiply the 32-bit lanes of <a> and <b>, keeping the low 32 bits of
+// the products.
+static inline __m128i dctMul2(__m128i a, __m128i b) {
+  __m128i lo = _mm_mul_epu32(a, b);
+  __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(lo, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// (<a> * <c> + <b> * <d> + round) >> shift, in the 32-bit lanes.
+static inline __m128i dctRot(__m128i a, __m128i c, __m128i b, __m128i d,
+			     __m128i round, __m128i shift) {
+  return _mm_sra_epi32(_mm_add_epi32(_mm_add_epi32(dctMul(a, c),
+						   dctMul(b, d)),
+				     round),
+		       shift);
+}
+
+// Transpose the 8x8 matrix of 32-bit values held in <m>, two vectors
+// per row.
+static inline void dctTranspose(__m128i m[16]) {
+  __m128i t[16];
+  __m128i u0, u1, u2, u3;
+  int rb, cb, i;
+
+  for (rb = 0; rb < 2; ++rb) {
+    for (cb = 0; cb < 2; ++cb) {
+      i = rb * 8 + cb;
+      u0 = _mm_unpacklo_epi32(m[i], m[i + 2]);
+      u1 = _mm_unpacklo_epi32(m[i + 4], m[i + 6]);
+      u2 = _mm_unpackhi_epi32(m[i], m[i + 2]);
+      u3 = _mm_unpackhi_epi32(m[i + 4], m[i + 6]);
+      i = cb * 8 + rb;
+      t[i] = _mm_unpacklo_epi64(u0, u1);
+      t[i + 2] = _mm_unpackhi_epi64(u0, u1);
+      t[i + 4] = _mm_unpacklo_epi64(u2, u3);
+      t[i + 6] = _mm_unpackhi_epi64(u2, u3);
+    }
+  }
+  for (i = 0; i < 16; ++i) {
+    m[i] = t[i];
+  }
+}
+
+// One pass of the IDCT in DCTStream::transformDataUnit, on four rows
+// (or columns) at once: p[k] holds coefficient k of each of them.  The
+// row and column passes differ only in their rounding: <shift> is 8
+// for rows and 12 for columns, <dcShift> is the shift of the all-zero
+// AC shortcut, and <oddShift> the scaling of coefficients 3 and 5.
+static inline void dctIDCT4(__m128i p[8], int shift, int dcShift,
+			    int oddShift) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i sqrt2 = _mm_set1_epi32(dctSqrt2);
+  const __m128i sqrt1d2 = _mm_set1_epi32(dctSqrt1d2);
+  const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+  const __m128i shiftV = _mm_cvtsi32_si128(shift);
+  const __m128i round12 = _mm_set1_epi32(2048);
+  const __m128i shift12 = _mm_cvtsi32_si128(12);
+  __m128i v0, v1, v2, v3, v4, v5, v6, v7, t, dc, ac;
+
+  // check for all-zero AC coefficients
+  ac = _mm_or_si128(_mm_or_si128(_mm_or_si128(p[1], p[2]),
+				 _mm_or_si128(p[3], p[4])),
+		    _mm_or_si128(_mm_or_si128(p[5], p[6]), p[7]));
+  ac = _mm_cmpeq_epi32(ac, zero);
+  dc = _mm_sra_epi32(_mm_add_epi32(dctMul(p[0], sqrt2),
+				   _mm_set1_epi32(1 << (dcShift - 1))),
+		     _mm_cvtsi32_si128(dcShift));
+
+  // stage 4
+  v0 = _mm_sra_epi32(_mm_add_epi32(dctMul(p[0], sqrt2), round), shiftV);
+  v1 = _mm_sra_epi32(_mm_add_epi32(dctMul(p[4], sqrt2), round), shiftV);
+  v2 = p[2];
+  v3 = p[6];
+  v4 = _mm_sra_epi32(_mm_add_epi32(dctMul(_mm_sub_epi32(p[1], p[7]), sqrt1d2),
+				   round), shiftV);
+  v7 = _mm_sra_epi32(_mm_add_epi32(dctMul(_mm_add_epi32(p[1], p[7]), sqrt1d2),
+				   round), shiftV);
+  v5 = _mm_sll_epi32(p[3], _mm_cvtsi32_si128(oddShift));
+  v6 = _mm_sll_epi32(p[5], _mm_cvtsi32_si128(oddShift));
+
+  // stage 3
+  t = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(v0, v1), one), 1);
+  v0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v0, v1), one), 1);
+  v1 = t;
+  t = dctRot(v2, _mm_set1_epi32(dctSin6), v3, _mm_set1_epi32(dctCos6),
+	     round, shiftV);
+  v2 = dctRot(v2, _mm_set1_epi32(dctCos6), v3, _mm_set1_epi32(-dctSin6),
+	      round, shiftV);
+  v3 = t;
+  t = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(v4, v6), one), 1);
+  v4 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v4, v6), one), 1);
+  v6 = t;
+  t = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v7, v5), one), 1);
+  v5 = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(v7, v5), one), 1);
+  v7 = t;
+
+  // stage 2
+  t = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(v0, v3), one), 1);
+  v0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v0, v3), one), 1);
+  v3 = t;
+  t = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(v1, v2), one), 1);
+  v1 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v1, v2), one), 1);
+  v2 = t;
+  t = dctRot(v4, _mm_set1_epi32(dctSin3), v7, _mm_set1_epi32(dctCos3),
+	     round12, shift12);
+  v4 = dctRot(v4, _mm_set1_epi32(dctCos3), v7, _mm_set1_epi32(-dctSin3),
+	      round12, shift12);
+  v7 = t;
+  t = dctRot(v5, _mm_set1_epi32(dctSin1), v6, _mm_set1_epi32(dctCos1),
+	     round12, shift12);
+  v5 = dctRot(v5, _mm_set1_epi32(dctCos1), v6, _mm_set1_epi32(-dctSin1),
+	      round12, shift12);
+  v6 = t;
+
+  // stage 1, or the DC value where all AC coefficients are zero
+#define dctSelect(x) \
+  _mm_or_si128(_mm_and_si128(ac, dc), _mm_andnot_si128(ac, x))
+  p[0] = dctSelect(_mm_add_epi32(v0, v7));
+  p[7] = dctSelect(_mm_sub_epi32(v0, v7));
+  p[1] = dctSelect(_mm_add_epi32(v1, v6));
+  p[6] = dctSelect(_mm_sub_epi32(v1, v6));
+  p[2] = dctSelect(_mm_add_epi32(v2, v5));
+  p[5] = dctSelect(_mm_sub_epi32(v2, v5));
+  p[3] = dctSelect(_mm_add_epi32(v3, v4));
+  p[4] = dctSelect(_mm_sub_epi32(v3, v4));
+#undef dctSelect
+}
+
+// Convert 8 pixels from YCbCr to RGB, in 16-bit lanes.  This computes
+// exactly what the scalar code does, with the 16.16 constants split so
+// that the multiplies fit in pmaddwd: e.g., ((y << 16) + dctCrToR * cr
+// + 32768) >> 16 = y + cr + ((26345 * cr + 32768) >> 16).
+static inline void dctYCbCrToRGB(__m128i y, __m128i cb, __m128i cr,
+				 __m128i *r, __m128i *g, __m128i *b) {
+  const __m128i c128 = _mm_set1_epi16(128);
+  const __m128i two = _mm_set1_epi16(2);
+  const __m128i rMul = _mm_set_epi16(16384, 26345, 16384, 26345,
+				     16384, 26345, 16384, 26345);
+  const __m128i gMul = _mm_set_epi16(18734, -22553, 18734, -22553,
+				     18734, -22553, 18734, -22553);
+  const __m128i bMul = _mm_set_epi16(16384, -14942, 16384, -14942,
+				     16384, -14942, 16384, -14942);
+  const __m128i round = _mm_set1_epi32(32768);
+  __m128i lo, hi;
+
+  cb = _mm_sub_epi16(cb, c128);
+  cr = _mm_sub_epi16(cr, c128);
+  lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cr, two), rMul), 16);
+  hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cr, two), rMul), 16);
+  *r = _mm_add_epi16(_mm_add_epi16(y, cr), _mm_packs_epi32(lo, hi));
+  lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, cr),
+						   gMul), round), 16);
+  hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb, cr),
+						   gMul), round), 16);
+  *g = _mm_add_epi16(_mm_sub_epi16(y, cr), _mm_packs_epi32(lo, hi));
+  lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb, two), bMul), 16);
+  hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb, two), bMul), 16);
+  *b = _mm_add_epi16(_mm_add_epi16(y, _mm_add_epi16(cb, cb)),
+		     _mm_packs_epi32(lo, hi));
+}
+
+#endif // DCT_SSE2
+
+// Returns the value of all the pixels of a data unit whose AC
+// coefficients are all zero (as transformDataUnit computes it), given
+// its DC coefficient.
+static inline Guchar dctDCPixel(Gushort *quantTable, int dc) {
+  int t, ix;
+
+  t = (dctSqrt2 * (dc * quantTable[0]) + 512) >> 10;
+  t = (dctSqrt2 * t + 8192) >> 14;
+  ix = dctClipOffset + 128 + ((t + 8) >> 4);
+  if (unlikely(ix < 0 || ix >= dctClipLength)) {
+    return 0;
+  }
+  return dctClip[ix];
+}
+
 DCTStream::DCTStream(Stream *strA, int colorXformA, Object *dict, int recursion):
     FilterStream(strA) {
   int i, j;
 
   colorXform = colorXformA;
+  dcOnly = gFalse;
   progressive = interleaved = gFalse;
   width = height = 0;
   mcuWidth = mcuHeight = 0;
@@ -2452,6 +2854,10 @@ DCTStream::DCTStream(Stream *strA, int colorXformA, Object *dict, int recursion)
     }
     frameBuf[i] = NULL;
   }
+  for (i = 0; i < 4; ++i) {
+    memset(dcHuffTables[i].lookLen, 0, sizeof(dcHuffTables[i].lookLen));
+    memset(acHuffTables[i].lookLen, 0, sizeof(acHuffTables[i].lookLen));
+  }
 
   if (!dctClipInit) {
     for (i = -256; i < 0; ++i)
@@ -2484,14 +2890,23 @@ void DCTStream::dctReset(GBool unfiltered) {
   gotJFIFMarker = gFalse;
   gotAdobeMarker = gFalse;
   restartInterval = 0;
+  inputBuf = 0;
+  inputBits = 0;
+  inputEnd = gFalse;
+  inputMarker = 0;
 }
 
 void DCTStream::unfilteredReset() {
   dctReset(gTrue);
 }
 
+int DCTStream::setDecodeScale(int scale) {
+  dcOnly = scale >= 8;
+  return dcOnly ? 8 : 1;
+}
+
 void DCTStream::reset() {
-  int i, j;
+  int w, h, i, j;
 
   dctReset(gFalse);
 
@@ -2517,6 +2932,15 @@ void DCTStream::reset() {
   mcuWidth *= 8;
   mcuHeight *= 8;
 
+  // when decoding only the DC coefficients, each data unit gives one
+  // pixel, so the image, and the MCUs, are 1/8 of the size
+  if (dcOnly) {
+    mcuWidth /= 8;
+    mcuHeight /= 8;
+    width = (width + 7) / 8;
+    height = (height + 7) / 8;
+  }
+
   // figure out color transform
   if (colorXform == -1) {
     if (numComps == 3) {
@@ -2549,12 +2973,17 @@ void DCTStream::reset() {
       memset(frameBuf[i], 0, bufWidth * bufHeight * sizeof(int));
     }
 
-    // read the image data
+    // read the image data -- stop if a (bad) frame header between the
+    // scans changes the image size
+    w = width;
+    h = height;
     do {
       restartMarker = 0xd0;
       restart();
       readScan();
-    } while (readHeader());
+    } while (readHeader() && width == w && height == h);
+    width = w;
+    height = h;
 
     // decode
     decodeImage();
@@ -2568,6 +2997,11 @@ void DCTStream::reset() {
 
     // allocate a buffer for one row of MCUs
     bufWidth = ((width + mcuWidth - 1) / mcuWidth) * mcuWidth;
+    if (bufWidth <= 0) {
+      error(errSyntaxError, getPos(), "Invalid image size in DCT stream");
+      y = height;
+      return;
+    }
     for (i = 0; i < numComps; ++i) {
       for (j = 0; j < mcuHeight; ++j) {
 	rowBuf[i][j] = (Guchar *)gmallocn(bufWidth, sizeof(Guchar));
@@ -2660,10 +3094,130 @@ int DCTStream::lookChar() {
   }
 }
 
+int DCTStream::getChars(int nChars, Guchar *buffer) {
+  Guchar *p0, *p1, *p2, *p3;
+  int *q0, *q1, *q2, *q3;
+  Guchar *out;
+  int n, m, c, i, cc;
+
+  n = 0;
+  while (n < nChars) {
+
+    // partial pixels are read one byte at a time
+    if (comp != 0 || nChars - n < numComps || y >= height) {
+      if ((c = DCTStream::getChar()) == EOF) {
+	break;
+      }
+      buffer[n++] = (Guchar)c;
+      continue;
+    }
+
+    if (!progressive && interleaved && dy >= mcuHeight) {
+      if (!readMCURow()) {
+	y = height;
+	break;
+      }
+      comp = 0;
+      x = 0;
+      dy = 0;
+    }
+
+    // copy (and interleave) as many whole pixels of the current row as
+    // fit in the buffer
+    m = (nChars - n) / numComps;
+    if (m > width - x) {
+      m = width - x;
+    }
+    out = buffer + n;
+    if (progressive || !interleaved) {
+      i = y * bufWidth + x;
+      q0 = frameBuf[0] + i;
+      if (numComps == 1) {
+	for (i = 0; i < m; ++i) {
+	  out[i] = (Guchar)q0[i];
+	}
+      } else if (numComps == 3) {
+	q1 = frameBuf[1] + y * bufWidth + x;
+	q2 = frameBuf[2] + y * bufWidth + x;
+	for (i = 0; i < m; ++i) {
+	  out[0] = (Guchar)q0[i];
+	  out[1] = (Guchar)q1[i];
+	  out[2] = (Guchar)q2[i];
+	  out += 3;
+	}
+      } else if (numComps == 4) {
+	q1 = frameBuf[1] + y * bufWidth + x;
+	q2 = frameBuf[2] + y * bufWidth + x;
+	q3 = frameBuf[3] + y * bufWidth + x;
+	for (i = 0; i < m; ++i) {
+	  out[0] = (Guchar)q0[i];
+	  out[1] = (Guchar)q1[i];
+	  out[2] = (Guchar)q2[i];
+	  out[3] = (Guchar)q3[i];
+	  out += 4;
+	}
+      } else {
+	for (i = 0; i < m; ++i) {
+	  for (cc = 0; cc < numComps; ++cc) {
+	    *out++ = (Guchar)frameBuf[cc][y * bufWidth + x + i];
+	  }
+	}
+      }
+    } else {
+      p0 = rowBuf[0][dy] + x;
+      if (numComps == 1) {
+	memcpy(out, p0, m);
+      } else if (numComps == 3) {
+	p1 = rowBuf[1][dy] + x;
+	p2 = rowBuf[2][dy] + x;
+	for (i = 0; i < m; ++i) {
+	  out[0] = p0[i];
+	  out[1] = p1[i];
+	  out[2] = p2[i];
+	  out += 3;
+	}
+      } else if (numComps == 4) {
+	p1 = rowBuf[1][dy] + x;
+	p2 = rowBuf[2][dy] + x;
+	p3 = rowBuf[3][dy] + x;
+	for (i = 0; i < m; ++i) {
+	  out[0] = p0[i];
+	  out[1] = p1[i];
+	  out[2] = p2[i];
+	  out[3] = p3[i];
+	  out += 4;
+	}
+      } else {
+	for (i = 0; i < m; ++i) {
+	  for (cc = 0; cc < numComps; ++cc) {
+	    *out++ = rowBuf[cc][dy][x + i];
+	  }
+	}
+      }
+    }
+    n += m * numComps;
+
+    // advance to the next row
+    x += m;
+    if (x == width) {
+      x = 0;
+      ++y;
+      if (!progressive && interleaved) {
+	++dy;
+	if (y == height) {
+	  readTrailer();
+	}
+      }
+    }
+  }
+  return n;
+}
+
 void DCTStream::restart() {
   int i;
 
   inputBits = 0;
+  inputEnd = gFalse;
   restartCtr = restartInterval;
   for (i = 0; i < numComps; ++i) {
     compInfo[i].prevDC = 0;
@@ -2676,7 +3230,6 @@ GBool DCTStream::readMCURow() {
   int data1[64];
   Guchar data2[64];
   Guchar *p1, *p2;
-  int pY, pCb, pCr, pR, pG, pB;
   int h, v, horiz, vert, hSub, vSub;
   int x1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
   int c;
@@ -2715,24 +3268,30 @@ GBool DCTStream::readMCURow() {
 			    data1)) {
 	    return gFalse;
 	  }
+	  if (dcOnly) {
+	    data2[0] = dctDCPixel(quantTables[compInfo[cc].quantTable],
+				  data1[0]);
+	    for (y3 = 0; y3 < vert; ++y3) {
+	      memset(&rowBuf[cc][y2+y3][x1+x2], data2[0], horiz);
+	    }
+	    continue;
+	  }
 	  transformDataUnit(quantTables[compInfo[cc].quantTable],
 			    data1, data2);
 	  if (hSub == 1 && vSub == 1) {
 	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      p1 = &rowBuf[cc][y2+y3][x1+x2];
-	      p1[0] = data2[i];
-	      p1[1] = data2[i+1];
-	      p1[2] = data2[i+2];
-	      p1[3] = data2[i+3];
-	      p1[4] = data2[i+4];
-	      p1[5] = data2[i+5];
-	      p1[6] = data2[i+6];
-	      p1[7] = data2[i+7];
+	      memcpy(&rowBuf[cc][y2+y3][x1+x2], data2 + i, 8);
 	    }
 	  } else if (hSub == 2 && vSub == 2) {
 	    for (y3 = 0, i = 0; y3 < 16; y3 += 2, i += 8) {
 	      p1 = &rowBuf[cc][y2+y3][x1+x2];
 	      p2 = &rowBuf[cc][y2+y3+1][x1+x2];
+#if DCT_SSE2
+	      __m128i d = _mm_loadl_epi64((const __m128i *)(data2 + i));
+	      d = _mm_unpacklo_epi8(d, d);
+	      _mm_storeu_si128((__m128i *)p1, d);
+	      _mm_storeu_si128((__m128i *)p2, d);
+#else
 	      p1[0] = p1[1] = p2[0] = p2[1] = data2[i];
 	      p1[2] = p1[3] = p2[2] = p2[3] = data2[i+1];
 	      p1[4] = p1[5] = p2[4] = p2[5] = data2[i+2];
@@ -2741,6 +3300,7 @@ GBool DCTStream::readMCURow() {
 	      p1[10] = p1[11] = p2[10] = p2[11] = data2[i+5];
 	      p1[12] = p1[13] = p2[12] = p2[13] = data2[i+6];
 	      p1[14] = p1[15] = p2[14] = p2[15] = data2[i+7];
+#endif
 	    }
 	  } else {
 	    i = 0;
@@ -2757,45 +3317,111 @@ GBool DCTStream::readMCURow() {
       }
     }
     --restartCtr;
+  }
 
-    // color space conversion
-    if (colorXform) {
-      // convert YCbCr to RGB
-      if (numComps == 3) {
-	for (y2 = 0; y2 < mcuHeight; ++y2) {
-	  for (x2 = 0; x2 < mcuWidth; ++x2) {
-	    pY = rowBuf[0][y2][x1+x2];
-	    pCb = rowBuf[1][y2][x1+x2] - 128;
-	    pCr = rowBuf[2][y2][x1+x2] - 128;
-	    pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	    rowBuf[0][y2][x1+x2] = dctClip[dctClipOffset + pR];
-	    pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
-	    rowBuf[1][y2][x1+x2] = dctClip[dctClipOffset + pG];
-	    pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	    rowBuf[2][y2][x1+x2] = dctClip[dctClipOffset + pB];
-	  }
-	}
-      // convert YCbCrK to CMYK (K is passed through unchanged)
-      } else if (numComps == 4) {
-	for (y2 = 0; y2 < mcuHeight; ++y2) {
-	  for (x2 = 0; x2 < mcuWidth; ++x2) {
-	    pY = rowBuf[0][y2][x1+x2];
-	    pCb = rowBuf[1][y2][x1+x2] - 128;
-	    pCr = rowBuf[2][y2][x1+x2] - 128;
-	    pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	    rowBuf[0][y2][x1+x2] = 255 - dctClip[dctClipOffset + pR];
-	    pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
-	    rowBuf[1][y2][x1+x2] = 255 - dctClip[dctClipOffset + pG];
-	    pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	    rowBuf[2][y2][x1+x2] = 255 - dctClip[dctClipOffset + pB];
-	  }
-	}
-      }
+  // color space conversion
+  if (colorXform && (numComps == 3 || numComps == 4)) {
+    for (y2 = 0; y2 < mcuHeight; ++y2) {
+      convertRow(rowBuf[0][y2], rowBuf[1][y2], rowBuf[2][y2], bufWidth);
     }
   }
   return gTrue;
 }
 
+// Convert <n> pixels from YCbCr to RGB, or, for YCbCrK images, to the
+// CMY part of CMYK (K is passed through unchanged), in place.
+void DCTStream::convertRow(Guchar *row0, Guchar *row1, Guchar *row2, int n) {
+  int pY, pCb, pCr, pR, pG, pB;
+  int i;
+
+  i = 0;
+#if DCT_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i inv = numComps == 4 ? _mm_set1_epi8((char)0xff) : zero;
+  __m128i r, g, b;
+  for (; i + 8 <= n; i += 8) {
+    dctYCbCrToRGB(
+	_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row0 + i)), zero),
+	_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row1 + i)), zero),
+	_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row2 + i)), zero),
+	&r, &g, &b);
+    _mm_storel_epi64((__m128i *)(row0 + i),
+		     _mm_xor_si128(_mm_packus_epi16(r, r), inv));
+    _mm_storel_epi64((__m128i *)(row1 + i),
+		     _mm_xor_si128(_mm_packus_epi16(g, g), inv));
+    _mm_storel_epi64((__m128i *)(row2 + i),
+		     _mm_xor_si128(_mm_packus_epi16(b, b), inv));
+  }
+#endif
+  for (; i < n; ++i) {
+    pY = row0[i];
+    pCb = row1[i] - 128;
+    pCr = row2[i] - 128;
+    pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
+    pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
+    pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
+    if (numComps == 4) {
+      row0[i] = 255 - dctClip[dctClipOffset + pR];
+      row1[i] = 255 - dctClip[dctClipOffset + pG];
+      row2[i] = 255 - dctClip[dctClipOffset + pB];
+    } else {
+      row0[i] = dctClip[dctClipOffset + pR];
+      row1[i] = dctClip[dctClipOffset + pG];
+      row2[i] = dctClip[dctClipOffset + pB];
+    }
+  }
+}
+
+// Same as above, for the frame buffer of progressive and
+// non-interleaved images.
+void DCTStream::convertRow(int *row0, int *row1, int *row2, int n) {
+  int pY, pCb, pCr, pR, pG, pB;
+  int i;
+
+  i = 0;
+#if DCT_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i inv = numComps == 4 ? _mm_set1_epi16(0xff) : zero;
+  __m128i r, g, b;
+  for (; i + 8 <= n; i += 8) {
+    dctYCbCrToRGB(
+	_mm_packs_epi32(_mm_loadu_si128((const __m128i *)(row0 + i)),
+			_mm_loadu_si128((const __m128i *)(row0 + i + 4))),
+	_mm_packs_epi32(_mm_loadu_si128((const __m128i *)(row1 + i)),
+			_mm_loadu_si128((const __m128i *)(row1 + i + 4))),
+	_mm_packs_epi32(_mm_loadu_si128((const __m128i *)(row2 + i)),
+			_mm_loadu_si128((const __m128i *)(row2 + i + 4))),
+	&r, &g, &b);
+    r = _mm_xor_si128(_mm_unpacklo_epi8(_mm_packus_epi16(r, r), zero), inv);
+    g = _mm_xor_si128(_mm_unpacklo_epi8(_mm_packus_epi16(g, g), zero), inv);
+    b = _mm_xor_si128(_mm_unpacklo_epi8(_mm_packus_epi16(b, b), zero), inv);
+    _mm_storeu_si128((__m128i *)(row0 + i), _mm_unpacklo_epi16(r, zero));
+    _mm_storeu_si128((__m128i *)(row0 + i + 4), _mm_unpackhi_epi16(r, zero));
+    _mm_storeu_si128((__m128i *)(row1 + i), _mm_unpacklo_epi16(g, zero));
+    _mm_storeu_si128((__m128i *)(row1 + i + 4), _mm_unpackhi_epi16(g, zero));
+    _mm_storeu_si128((__m128i *)(row2 + i), _mm_unpacklo_epi16(b, zero));
+    _mm_storeu_si128((__m128i *)(row2 + i + 4), _mm_unpackhi_epi16(b, zero));
+  }
+#endif
+  for (; i < n; ++i) {
+    pY = row0[i];
+    pCb = row1[i] - 128;
+    pCr = row2[i] - 128;
+    pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
+    pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr + 32768) >> 16;
+    pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
+    if (numComps == 4) {
+      row0[i] = 255 - dctClip[dctClipOffset + pR];
+      row1[i] = 255 - dctClip[dctClipOffset + pG];
+      row2[i] = 255 - dctClip[dctClipOffset + pB];
+    } else {
+      row0[i] = dctClip[dctClipOffset + pR];
+      row1[i] = dctClip[dctClipOffset + pG];
+      row2[i] = dctClip[dctClipOffset + pB];
+    }
+  }
+}
+
 // Read one scan from a progressive or non-interleaved JPEG stream.
 void DCTStream::readScan() {
   int data[64];
@@ -2817,6 +3443,17 @@ void DCTStream::readScan() {
     dy1 = mcuHeight;
   }
 
+  // when decoding only the DC coefficients, skip the AC scans of
+  // progressive images, up to the next marker that isn't a restart
+  // marker (which is left for readHeader)
+  if (dcOnly && progressive && scanInfo.firstCoeff > 0) {
+    do {
+      c = readMarker();
+    } while (c >= 0xd0 && c <= 0xd7);
+    inputMarker = c;
+    return;
+  }
+
   for (y1 = 0; y1 < height; y1 += dy1) {
     for (x1 = 0; x1 < width; x1 += dx1) {
 
@@ -2848,18 +3485,23 @@ void DCTStream::readScan() {
 	for (y2 = 0; y2 < dy1; y2 += vert) {
 	  for (x2 = 0; x2 < dx1; x2 += horiz) {
 
-	    // pull out the current values
+	    // pull out the current values (just the DC coefficient, in
+	    // the top left pixel, when decoding only the DC coefficients)
 	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
-	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      data[i] = p1[0];
-	      data[i+1] = p1[1];
-	      data[i+2] = p1[2];
-	      data[i+3] = p1[3];
-	      data[i+4] = p1[4];
-	      data[i+5] = p1[5];
-	      data[i+6] = p1[6];
-	      data[i+7] = p1[7];
-	      p1 += bufWidth * vSub;
+	    if (dcOnly) {
+	      data[0] = p1[0];
+	    } else {
+	      for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
+		data[i] = p1[0];
+		data[i+1] = p1[1];
+		data[i+2] = p1[2];
+		data[i+3] = p1[3];
+		data[i+4] = p1[4];
+		data[i+5] = p1[5];
+		data[i+6] = p1[6];
+		data[i+7] = p1[7];
+		p1 += bufWidth * vSub;
+	      }
 	    }
 
 	    // read one data unit
@@ -2882,6 +3524,10 @@ void DCTStream::readScan() {
 
 	    // add the data unit into frameBuf
 	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
+	    if (dcOnly) {
+	      p1[0] = data[0];
+	      continue;
+	    }
 	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
 	      p1[0] = data[i];
 	      p1[1] = data[i+1];
@@ -3082,10 +3728,9 @@ void DCTStream::decodeImage() {
   int dataIn[64];
   Guchar dataOut[64];
   Gushort *quantTable;
-  int pY, pCb, pCr, pR, pG, pB;
   int x1, y1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
   int h, v, horiz, vert, hSub, vSub;
-  int *p0, *p1, *p2;
+  int *p1, *p2;
 
   for (y1 = 0; y1 < bufHeight; y1 += mcuHeight) {
     for (x1 = 0; x1 < bufWidth; x1 += mcuWidth) {
@@ -3100,8 +3745,22 @@ void DCTStream::decodeImage() {
 	for (y2 = 0; y2 < mcuHeight; y2 += vert) {
 	  for (x2 = 0; x2 < mcuWidth; x2 += horiz) {
 
-	    // pull out the coded data unit
+	    // when decoding only the DC coefficients, replace the DC
+	    // coefficient with the pixel value, replicated for
+	    // subsampled components
 	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
+	    if (dcOnly) {
+	      i = dctDCPixel(quantTable, p1[0]);
+	      for (y3 = 0; y3 < vert; ++y3) {
+		for (x3 = 0; x3 < horiz; ++x3) {
+		  p1[x3] = i;
+		}
+		p1 += bufWidth;
+	      }
+	      continue;
+	    }
+
+	    // pull out the coded data unit
 	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
 	      dataIn[i]   = p1[0];
 	      dataIn[i+1] = p1[1];
@@ -3165,48 +3824,14 @@ void DCTStream::decodeImage() {
 	  }
 	}
       }
+    }
 
-      // color space conversion
-      if (colorXform) {
-	// convert YCbCr to RGB
-	if (numComps == 3) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = dctClip[dctClipOffset + pR];
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = dctClip[dctClipOffset + pG];
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = dctClip[dctClipOffset + pB];
-	    }
-	  }
-	// convert YCbCrK to CMYK (K is passed through unchanged)
-	} else if (numComps == 4) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = 255 - dctClip[dctClipOffset + pR];
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = 255 - dctClip[dctClipOffset + pG];
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = 255 - dctClip[dctClipOffset + pB];
-	    }
-	  }
-	}
+    // color space conversion
+    if (colorXform && (numComps == 3 || numComps == 4)) {
+      for (y2 = 0; y2 < mcuHeight; ++y2) {
+	i = (y1 + y2) * bufWidth;
+	convertRow(frameBuf[0] + i, frameBuf[1] + i, frameBuf[2] + i,
+		   bufWidth);
       }
     }
   }
@@ -3219,9 +3844,66 @@ void DCTStream::decodeImage() {
 //   IEEE Intl. Conf. on Acoustics, Speech & Signal Processing, 1989,
 //   988-991.
 // The stage numbers mentioned in the comments refer to Figure 1 in this
-// paper.
+// paper.  The SSE2 version does the same computation, four rows (or
+// columns) at a time, and gives the same results.
 void DCTStream::transformDataUnit(Gushort *quantTable,
 				  int dataIn[64], Guchar dataOut[64]) {
+#if DCT_SSE2
+  __m128i m[16], p[8], q, v, big;
+  int i, j;
+
+  // dequant
+  for (i = 0; i < 64; i += 8) {
+    q = _mm_loadu_si128((const __m128i *)(quantTable + i));
+    m[i >> 2] =
+	dctMul2(_mm_loadu_si128((const __m128i *)(dataIn + i)),
+		_mm_unpacklo_epi16(q, _mm_setzero_si128()));
+    m[(i >> 2) + 1] =
+	dctMul2(_mm_loadu_si128((const __m128i *)(dataIn + i + 4)),
+		_mm_unpackhi_epi16(q, _mm_setzero_si128()));
+  }
+
+  // inverse DCT on rows: after the transpose, m[2*k + j] holds
+  // coefficient k of rows 4*j .. 4*j+3
+  dctTranspose(m);
+  for (j = 0; j < 2; ++j) {
+    for (i = 0; i < 8; ++i) {
+      p[i] = m[2 * i + j];
+    }
+    dctIDCT4(p, 8, 10, 4);
+    for (i = 0; i < 8; ++i) {
+      m[2 * i + j] = p[i];
+    }
+  }
+
+  // inverse DCT on columns
+  dctTranspose(m);
+  for (j = 0; j < 2; ++j) {
+    for (i = 0; i < 8; ++i) {
+      p[i] = m[2 * i + j];
+    }
+    dctIDCT4(p, 12, 14, 0);
+    for (i = 0; i < 8; ++i) {
+      m[2 * i + j] = p[i];
+    }
+  }
+
+  // convert to 8-bit integers: like dctClip, this maps values below 0
+  // to 0, values in 256..511 to 255, and anything larger to 0
+  for (i = 0; i < 8; ++i) {
+    p[0] = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(m[2 * i],
+						      _mm_set1_epi32(8)), 4),
+			 _mm_set1_epi32(128));
+    p[1] = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(m[2 * i + 1],
+						      _mm_set1_epi32(8)), 4),
+			 _mm_set1_epi32(128));
+    big = _mm_packs_epi32(_mm_cmpgt_epi32(p[0], _mm_set1_epi32(511)),
+			  _mm_cmpgt_epi32(p[1], _mm_set1_epi32(511)));
+    v = _mm_packs_epi32(p[0], p[1]);
+    v = _mm_andnot_si128(_mm_packs_epi16(big, big), _mm_packus_epi16(v, v));
+    _mm_storel_epi64((__m128i *)(dataOut + 8 * i), v);
+  }
+#else
   int v0, v1, v2, v3, v4, v5, v6, v7, t;
   int *p;
   int i;
@@ -3376,13 +4058,34 @@ void DCTStream::transformDataUnit(Gushort *quantTable,
       dataOut[i] = dctClip[ix];
     }
   }
+#endif
 }
 
 int DCTStream::readHuffSym(DCTHuffTable *table) {
   Gushort code;
   int bit;
   int codeBits;
+  int idx, len;
+
+  // look up the code in the table indexed by the next dctHuffLookBits
+  // bits of input
+  if (inputBits < dctHuffLookBits) {
+    fillInputBits();
+  }
+  if (inputBits >= dctHuffLookBits) {
+    idx = (inputBuf >> (inputBits - dctHuffLookBits)) &
+	  ((1 << dctHuffLookBits) - 1);
+  } else {
+    idx = (inputBuf << (dctHuffLookBits - inputBits)) &
+	  ((1 << dctHuffLookBits) - 1);
+  }
+  len = table->lookLen[idx];
+  if (len > 0 && len <= inputBits) {
+    inputBits -= len;
+    return table->lookSym[idx];
+  }
 
+  // longer codes (and bad codes) are read one bit at a time
   code = 0;
   codeBits = 0;
   do {
@@ -3411,6 +4114,21 @@ int DCTStream::readAmp(int size) {
   int amp, bit;
   int bits;
 
+  if (size == 0) {
+    return 0;
+  }
+  if (size <= 16) {
+    if (inputBits < size) {
+      fillInputBits();
+    }
+    if (inputBits >= size) {
+      inputBits -= size;
+      amp = (inputBuf >> inputBits) & ((1 << size) - 1);
+      if (amp < (1 << (size - 1)))
+	amp -= (1 << size) - 1;
+      return amp;
+    }
+  }
   amp = 0;
   for (bits = 0; bits < size; ++bits) {
     if ((bit = readBit()) == EOF)
@@ -3423,27 +4141,63 @@ int DCTStream::readAmp(int size) {
 }
 
 int DCTStream::readBit() {
-  int bit;
-  int c, c2;
-
   if (inputBits == 0) {
-    if ((c = str->getChar()) == EOF)
+    fillInputBits();
+    if (inputBits == 0) {
+      if (inputMarker != 0) {
+	error(errSyntaxError, getPos(), "Bad DCT data: missing 00 after ff");
+      }
       return EOF;
+    }
+  }
+  --inputBits;
+  return (inputBuf >> inputBits) & 1;
+}
+
+// Read entropy-coded data into the input buffer, a byte at a time,
+// until it holds more than 24 bits, or the data end at a marker (which
+// is left for readMarker) or at the end of the stream.  Stuffed zero
+// bytes are removed.
+void DCTStream::fillInputBits() {
+  const Guchar *p;
+  int n, i, c, c2;
+
+  while (inputBits <= 24 && !inputEnd) {
+
+    // take bytes straight from the underlying stream's buffer, up to
+    // the next 0xff
+    n = str->lookBufferedChars(&p);
+    if (n > 0) {
+      if (n > (32 - inputBits) / 8) {
+	n = (32 - inputBits) / 8;
+      }
+      for (i = 0; i < n && p[i] != 0xff; ++i) {
+	inputBuf = (inputBuf << 8) | p[i];
+      }
+      if (i > 0) {
+	str->skipBufferedChars(i);
+	inputBits += 8 * i;
+	continue;
+      }
+    }
+
+    if ((c = str->getChar()) == EOF) {
+      inputEnd = gTrue;
+      break;
+    }
     if (c == 0xff) {
       do {
 	c2 = str->getChar();
       } while (c2 == 0xff);
       if (c2 != 0x00) {
-	error(errSyntaxError, getPos(), "Bad DCT data: missing 00 after ff");
-	return EOF;
+	inputEnd = gTrue;
+	inputMarker = c2;
+	break;
       }
     }
-    inputBuf = c;
-    inputBits = 8;
+    inputBuf = (inputBuf << 8) | c;
+    inputBits += 8;
   }
-  bit = (inputBuf >> (inputBits - 1)) & 1;
-  --inputBits;
-  return bit;
 }
 
 GBool DCTStream::readHeader() {
@@ -3733,10 +4487,40 @@ GBool DCTStream::readHuffmanTables() {
     for (i = 0; i < sym; ++i)
       tbl->sym[i] = str->getChar();
     length -= sym;
+    buildHuffLookup(tbl);
   }
   return gTrue;
 }
 
+// Fill in the lookup table of a Huffman table, by running the
+// bit-at-a-time decoding in readHuffSym on every dctHuffLookBits-bit
+// input.  Entries for codes that are longer, or bad, are left 0, so
+// that readHuffSym falls back to decoding them one bit at a time.
+void DCTStream::buildHuffLookup(DCTHuffTable *tbl) {
+  Gushort code;
+  int codeBits, idx, k;
+
+  for (idx = 0; idx < (1 << dctHuffLookBits); ++idx) {
+    tbl->lookLen[idx] = 0;
+    tbl->lookSym[idx] = 0;
+    code = 0;
+    for (codeBits = 1; codeBits <= dctHuffLookBits; ++codeBits) {
+      code = (code << 1) + ((idx >> (dctHuffLookBits - codeBits)) & 1);
+      if (code < tbl->firstCode[codeBits]) {
+	break;
+      }
+      if (code - tbl->firstCode[codeBits] < tbl->numCodes[codeBits]) {
+	k = tbl->firstSym[codeBits] + (code - tbl->firstCode[codeBits]);
+	if (k < 256) {
+	  tbl->lookLen[idx] = codeBits;
+	  tbl->lookSym[idx] = tbl->sym[k];
+	}
+	break;
+      }
+    }
+  }
+}
+
 GBool DCTStream::readRestartInterval() {
   int length;
 
@@ -3825,6 +4609,12 @@ GBool DCTStream::readTrailer() {
 int DCTStream::readMarker() {
   int c;
 
+  // the entropy-coded data may have been read up to the marker already
+  if (inputMarker > 0) {
+    c = inputMarker;
+    inputMarker = 0;
+    return c;
+  }
   do {
     do {
       c = str->getChar();
@@ -3941,564 +4731,6 @@ FlateDecode FlateStream::distDecode[flateMaxDistCodes] = {
   {13, 24577}
 };
 
-static FlateCode flateFixedLitCodeTabCodes[512] = {
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c0},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a0},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e0},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0090},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d0},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b0},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f0},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c8},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a8},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e8},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0098},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d8},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b8},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f8},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c4},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a4},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e4},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0094},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d4},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b4},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f4},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cc},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ac},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ec},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009c},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dc},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bc},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fc},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c2},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a2},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e2},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0092},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d2},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b2},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f2},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00ca},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00aa},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00ea},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009a},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00da},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00ba},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fa},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c6},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a6},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e6},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0096},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d6},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b6},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f6},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00ce},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00ae},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ee},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009e},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00de},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00be},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00fe},
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c1},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a1},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e1},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0091},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d1},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b1},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f1},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c9},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a9},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e9},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0099},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d9},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b9},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f9},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c5},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a5},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e5},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0095},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d5},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b5},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f5},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cd},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ad},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ed},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009d},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dd},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bd},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fd},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c3},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a3},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e3},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0093},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d3},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b3},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f3},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00cb},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00ab},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00eb},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009b},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00db},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00bb},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fb},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c7},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a7},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e7},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0097},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d7},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b7},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f7},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00cf},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00af},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ef},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009f},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00df},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00bf},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00ff}
-};
-
-FlateHuffmanTab FlateStream::fixedLitCodeTab = {
-  flateFixedLitCodeTabCodes, 9
-};
-
-static FlateCode flateFixedDistCodeTabCodes[32] = {
-  {5, 0x0000},
-  {5, 0x0010},
-  {5, 0x0008},
-  {5, 0x0018},
-  {5, 0x0004},
-  {5, 0x0014},
-  {5, 0x000c},
-  {5, 0x001c},
-  {5, 0x0002},
-  {5, 0x0012},
-  {5, 0x000a},
-  {5, 0x001a},
-  {5, 0x0006},
-  {5, 0x0016},
-  {5, 0x000e},
-  {0, 0x0000},
-  {5, 0x0001},
-  {5, 0x0011},
-  {5, 0x0009},
-  {5, 0x0019},
-  {5, 0x0005},
-  {5, 0x0015},
-  {5, 0x000d},
-  {5, 0x001d},
-  {5, 0x0003},
-  {5, 0x0013},
-  {5, 0x000b},
-  {5, 0x001b},
-  {5, 0x0007},
-  {5, 0x0017},
-  {5, 0x000f},
-  {0, 0x0000}
-};
-
-FlateHuffmanTab FlateStream::fixedDistCodeTab = {
-  flateFixedDistCodeTabCodes, 5
-};
-
 FlateStream::FlateStream(Stream *strA, int predictor, int columns,
 			 int colors, int bits):
     FilterStream(strA) {
@@ -4512,17 +4744,20 @@ FlateStream::FlateStream(Stream *strA, int predictor, int columns,
     pred = NULL;
   }
   litCodeTab.codes = NULL;
+  litCodeTab.pairs = NULL;
+  litCodeTab.size = litCodeTab.bits = litCodeTab.maxLen = 0;
   distCodeTab.codes = NULL;
+  distCodeTab.pairs = NULL;
+  distCodeTab.size = distCodeTab.bits = distCodeTab.maxLen = 0;
+  fixedCodes = gFalse;
+  // distances reaching back before the start of the data read zeros
   memset(buf, 0, flateWindow);
 }
 
 FlateStream::~FlateStream() {
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
-  }
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
-  }
+  gfree(litCodeTab.codes);
+  gfree(litCodeTab.pairs);
+  gfree(distCodeTab.codes);
   if (pred) {
     delete pred;
   }
@@ -4535,7 +4770,7 @@ void FlateStream::flateReset(GBool unfiltered) {
   else
     str->reset();
 
-  index = 0;
+  index = flateWindow;
   remain = 0;
   codeBuf = 0;
   codeSize = 0;
@@ -4584,16 +4819,36 @@ int FlateStream::getChar() {
 }
 
 int FlateStream::getChars(int nChars, Guchar *buffer) {
+  int n, m;
+
   if (pred) {
     return pred->getChars(nChars, buffer);
-  } else {
-    for (int i = 0; i < nChars; ++i) {
-      const int c = doGetRawChar();
-      if (likely(c != EOF)) buffer[i] = c;
-      else return i;
+  }
+  n = 0;
+  while (n < nChars) {
+    while (remain == 0) {
+      if (endOfBlock && eof)
+	return n;
+      readSome();
+    }
+    m = remain;
+    if (m > nChars - n) {
+      m = nChars - n;
     }
-    return nChars;
+    memcpy(buffer + n, buf + index, m);
+    index += m;
+    remain -= m;
+    n += m;
   }
+  return n;
+}
+
+int FlateStream::lookBufferedChars(const Guchar **chars) {
+  if (pred) {
+    return 0;
+  }
+  *chars = buf + index;
+  return remain;
 }
 
 int FlateStream::lookChar() {
@@ -4637,11 +4892,15 @@ GBool FlateStream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
 
+// Decode more data, at buf[index].  Called when the output buffer is
+// empty.
 void FlateStream::readSome() {
-  int code1, code2;
-  int len, dist;
-  int i, j, k;
-  int c;
+  // slide the window back to the start of the buffer when the room
+  // left for new data gets small
+  if (index > flateWindow + flateWindow / 2) {
+    memmove(buf, buf + index - flateWindow, flateWindow);
+    index = flateWindow;
+  }
 
   if (endOfBlock) {
     if (!startBlock())
@@ -4649,73 +4908,245 @@ void FlateStream::readSome() {
   }
 
   if (compressedBlock) {
-    if ((code1 = getHuffmanCodeWord(&litCodeTab)) == EOF)
-      goto err;
-    if (code1 < 256) {
-      buf[index] = code1;
-      remain = 1;
-    } else if (code1 == 256) {
-      endOfBlock = gTrue;
-      remain = 0;
-    } else {
-      code1 -= 257;
-      code2 = lengthDecode[code1].bits;
-      if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
-	goto err;
-      len = lengthDecode[code1].first + code2;
-      if ((code1 = getHuffmanCodeWord(&distCodeTab)) == EOF)
-	goto err;
-      code2 = distDecode[code1].bits;
-      if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
-	goto err;
-      dist = distDecode[code1].first + code2;
-      i = index;
-      j = (index - dist) & flateMask;
-      for (k = 0; k < len; ++k) {
-	buf[i] = buf[j];
-	i = (i + 1) & flateMask;
-	j = (j + 1) & flateMask;
-      }
-      remain = len;
+    if (!readCodes()) {
+      error(errSyntaxError, getPos(), "Unexpected end of file in flate stream");
+      endOfBlock = eof = gTrue;
     }
-
   } else {
-    len = (blockLen < flateWindow) ? blockLen : flateWindow;
-    for (i = 0, j = index; i < len; ++i, j = (j + 1) & flateMask) {
-      if ((c = str->getChar()) == EOF) {
-	endOfBlock = eof = gTrue;
-	break;
+    readStored();
+  }
+}
+
+// Decode codes from a compressed block until the end of the block, or
+// until the output buffer is full.  The input is read directly from
+// the buffer of the underlying stream, eight bytes at a time; near the
+// end of that buffer (or if the stream has none), codes are decoded
+// one at a time by readCode, which reads only the bytes it needs, so
+// that the data following the compressed data (e.g., the rest of the
+// content stream after an inline image) is left unread.  Returns false
+// on a bad code or at the end of the input.
+GBool FlateStream::readCodes() {
+  FlateCode *litCodes, *distCodes, *code;
+  Guint *pairs;
+  unsigned long long cb;
+  const Guchar *in, *inStart, *inEnd;
+  Guchar *out, *outEnd, *outStart, *from, *end;
+  int litBits, litMask, distBits, distMask;
+  int cs, len, dist, n, c;
+  Guint pair;
+  GBool ok;
+
+  litCodes = litCodeTab.codes;
+  pairs = litCodeTab.pairs;
+  litBits = litCodeTab.bits;
+  litMask = (1 << litBits) - 1;
+  distCodes = distCodeTab.codes;
+  distBits = distCodeTab.bits;
+  distMask = (1 << distBits) - 1;
+  cb = codeBuf;
+  cs = codeSize;
+  outStart = out = buf + index + remain;
+  outEnd = buf + 2 * flateWindow - flateMaxMatch;
+  n = str->lookBufferedChars(&inStart);
+  in = inStart;
+  inEnd = inStart + n;
+  ok = gTrue;
+
+  while (out <= outEnd) {
+
+    // refill the bit buffer: 48 bits hold a length code, a distance
+    // code, and their extra bits
+    if (cs < 48) {
+      if (inEnd - in >= 8) {
+	do {
+	  cb |= (unsigned long long)*in++ << cs;
+	  cs += 8;
+	} while (cs <= 56);
+      } else {
+	str->skipBufferedChars((int)(in - inStart));
+	codeBuf = cb;
+	codeSize = cs;
+	n = readCode(out);
+	cb = codeBuf;
+	cs = codeSize;
+	if (n <= 0) {
+	  in = inStart = inEnd = NULL;
+	  if (n == 0) {
+	    endOfBlock = gTrue;
+	  } else {
+	    ok = gFalse;
+	  }
+	  break;
+	}
+	out += n;
+	n = str->lookBufferedChars(&inStart);
+	in = inStart;
+	inEnd = inStart + n;
+	continue;
       }
-      buf[j] = c & 0xff;
     }
-    remain = i;
-    blockLen -= len;
-    if (blockLen == 0)
+
+    // two literals
+    pair = pairs[cb & litMask];
+    if (pair) {
+      out[0] = (Guchar)(pair >> 8);
+      out[1] = (Guchar)(pair >> 16);
+      out += 2;
+      cb >>= pair & 0xff;
+      cs -= pair & 0xff;
+      continue;
+    }
+
+    // literal, end of block, or length
+    code = &litCodes[cb & litMask];
+    if (code->link) {
+      code = &litCodes[code->val + ((cb >> litBits) & ((1 << code->len) - 1))];
+    }
+    if (code->len == 0) {
+      ok = gFalse;
+      break;
+    }
+    cb >>= code->len;
+    cs -= code->len;
+    c = code->val;
+    if (c < 256) {
+      *out++ = (Guchar)c;
+      continue;
+    }
+    if (c == 256) {
       endOfBlock = gTrue;
+      break;
+    }
+    c -= 257;
+    len = lengthDecode[c].first;
+    if ((n = lengthDecode[c].bits) > 0) {
+      len += (int)(cb & ((1 << n) - 1));
+      cb >>= n;
+      cs -= n;
+    }
+
+    // distance
+    code = &distCodes[cb & distMask];
+    if (code->link) {
+      code = &distCodes[code->val +
+			((cb >> distBits) & ((1 << code->len) - 1))];
+    }
+    if (code->len == 0) {
+      ok = gFalse;
+      break;
+    }
+    cb >>= code->len;
+    cs -= code->len;
+    c = code->val;
+    dist = distDecode[c].first;
+    if ((n = distDecode[c].bits) > 0) {
+      dist += (int)(cb & ((1 << n) - 1));
+      cb >>= n;
+      cs -= n;
+    }
+
+    // copy the match; the window (at least flateWindow bytes) always
+    // precedes the output, and the distance is at most flateWindow
+    from = out - dist;
+    end = out + len;
+    if (dist >= 8) {
+      // eight bytes at a time, possibly writing past the end of the
+      // match, into the slack at the end of the buffer
+      do {
+	memcpy(out, from, 8);
+	out += 8;
+	from += 8;
+      } while (out < end);
+      out = end;
+    } else {
+      do {
+	*out++ = *from++;
+      } while (out < end);
+    }
   }
 
-  return;
+  // give the whole bytes left in the bit buffer back to the input
+  // stream, if they came from its buffer
+  n = (int)(in - inStart);
+  if (n > cs >> 3) {
+    n = cs >> 3;
+  }
+  in -= n;
+  cs -= 8 * n;
+  cb &= ((unsigned long long)1 << cs) - 1;
+  str->skipBufferedChars((int)(in - inStart));
 
-err:
-  error(errSyntaxError, getPos(), "Unexpected end of file in flate stream");
-  endOfBlock = eof = gTrue;
-  remain = 0;
+  codeBuf = cb;
+  codeSize = cs;
+  remain += (int)(out - outStart);
+  return ok;
 }
 
-GBool FlateStream::startBlock() {
-  int blockHdr;
-  int c;
-  int check;
+// Decode one code from a compressed block, reading the input one byte
+// at a time, and write the decoded data at <out>.  Returns the number
+// of bytes written, 0 at the end of the block, or -1 on error.
+int FlateStream::readCode(Guchar *out) {
+  int code1, code2;
+  int len, dist, k;
 
-  // free the code tables from the previous block
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
+  if ((code1 = getHuffmanCodeWord(&litCodeTab)) == EOF)
+    return -1;
+  if (code1 < 256) {
+    out[0] = (Guchar)code1;
+    return 1;
   }
-  litCodeTab.codes = NULL;
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
+  if (code1 == 256)
+    return 0;
+  code1 -= 257;
+  code2 = lengthDecode[code1].bits;
+  if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
+    return -1;
+  len = lengthDecode[code1].first + code2;
+  if ((code1 = getHuffmanCodeWord(&distCodeTab)) == EOF)
+    return -1;
+  code2 = distDecode[code1].bits;
+  if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
+    return -1;
+  dist = distDecode[code1].first + code2;
+  for (k = 0; k < len; ++k) {
+    out[k] = out[k - dist];
+  }
+  return len;
+}
+
+// Copy data from an uncompressed block until the end of the block, or
+// until the output buffer is full.
+void FlateStream::readStored() {
+  Guchar *out;
+  int len, n;
+
+  out = buf + index + remain;
+  len = (int)(buf + 2 * flateWindow - out);
+  if (len > blockLen) {
+    len = blockLen;
+  }
+  // the first bytes may already be in the bit buffer
+  n = 0;
+  while (n < len && codeSize >= 8) {
+    out[n++] = (Guchar)(codeBuf & 0xff);
+    codeBuf >>= 8;
+    codeSize -= 8;
+  }
+  if (n < len) {
+    n += str->doGetChars(len - n, out + n);
+  }
+  remain += n;
+  blockLen -= n;
+  if (n < len) {
+    endOfBlock = eof = gTrue;
+  } else if (blockLen == 0) {
+    endOfBlock = gTrue;
   }
-  distCodeTab.codes = NULL;
+}
+
+GBool FlateStream::startBlock() {
+  int blockHdr;
+  int check;
 
   // read block header
   blockHdr = getCodeWord(3);
@@ -4726,27 +5157,23 @@ GBool FlateStream::startBlock() {
   // uncompressed block
   if (blockHdr == 0) {
     compressedBlock = gFalse;
-    if ((c = str->getChar()) == EOF)
+    // skip to a byte boundary; the length may already be in the bit
+    // buffer
+    codeBuf >>= codeSize & 7;
+    codeSize &= ~7;
+    if ((blockLen = getCodeWord(16)) == EOF)
       goto err;
-    blockLen = c & 0xff;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    blockLen |= (c & 0xff) << 8;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    check = c & 0xff;
-    if ((c = str->getChar()) == EOF)
+    if ((check = getCodeWord(16)) == EOF)
       goto err;
-    check |= (c & 0xff) << 8;
     if (check != (~blockLen & 0xffff))
       error(errSyntaxError, getPos(), "Bad uncompressed block length in flate stream");
-    codeBuf = 0;
-    codeSize = 0;
 
   // compressed block with fixed codes
   } else if (blockHdr == 1) {
     compressedBlock = gTrue;
-    loadFixedCodes();
+    if (!loadFixedCodes()) {
+      goto err;
+    }
 
   // compressed block with dynamic codes
   } else if (blockHdr == 2) {
@@ -4769,11 +5196,36 @@ err:
   return gFalse;
 }
 
-void FlateStream::loadFixedCodes() {
-  litCodeTab.codes = fixedLitCodeTab.codes;
-  litCodeTab.maxLen = fixedLitCodeTab.maxLen;
-  distCodeTab.codes = fixedDistCodeTab.codes;
-  distCodeTab.maxLen = fixedDistCodeTab.maxLen;
+GBool FlateStream::loadFixedCodes() {
+  int i;
+
+  // the tables are kept from one fixed code block to the next
+  if (fixedCodes) {
+    return gTrue;
+  }
+  for (i = 0; i < 144; ++i) {
+    codeLengths[i] = 8;
+  }
+  for (; i < 256; ++i) {
+    codeLengths[i] = 9;
+  }
+  for (; i < 280; ++i) {
+    codeLengths[i] = 7;
+  }
+  for (; i < flateMaxLitCodes; ++i) {
+    codeLengths[i] = 8;
+  }
+  // codes 30 and 31 are not used: they are errors when decoding
+  for (i = 0; i < flateMaxDistCodes; ++i) {
+    codeLengths[flateMaxLitCodes + i] = 5;
+  }
+  if (!compHuffmanCodes(codeLengths, flateMaxLitCodes, &litCodeTab, gTrue) ||
+      !compHuffmanCodes(codeLengths + flateMaxLitCodes, flateMaxDistCodes,
+			&distCodeTab, gFalse)) {
+    return gFalse;
+  }
+  fixedCodes = gTrue;
+  return gTrue;
 }
 
 GBool FlateStream::readDynamicCodes() {
@@ -4785,7 +5237,10 @@ GBool FlateStream::readDynamicCodes() {
   int len, repeat, code;
   int i;
 
+  fixedCodes = gFalse;
   codeLenCodeTab.codes = NULL;
+  codeLenCodeTab.pairs = NULL;
+  codeLenCodeTab.size = 0;
 
   // read lengths
   if ((numLitCodes = getCodeWord(5)) == EOF) {
@@ -4815,7 +5270,10 @@ GBool FlateStream::readDynamicCodes() {
       goto err;
     }
   }
-  compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes, &codeLenCodeTab);
+  if (!compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes,
+			&codeLenCodeTab, gFalse)) {
+    goto err;
+  }
 
   // build the literal and distance code tables
   len = 0;
@@ -4864,8 +5322,11 @@ GBool FlateStream::readDynamicCodes() {
       codeLengths[i++] = len = code;
     }
   }
-  compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab);
-  compHuffmanCodes(codeLengths + numLitCodes, numDistCodes, &distCodeTab);
+  if (!compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab, gTrue) ||
+      !compHuffmanCodes(codeLengths + numLitCodes, numDistCodes,
+			&distCodeTab, gFalse)) {
+    goto err;
+  }
 
   gfree(codeLenCodeTab.codes);
   return gTrue;
@@ -4877,53 +5338,136 @@ err:
 }
 
 // Convert an array <lengths> of <n> lengths, in value order, into a
-// Huffman code lookup table.
-void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab) {
-  int tabSize, len, code, code2, skip, val, i, t;
-
-  // find max code length
+// Huffman code lookup table, reusing the memory of the previous table.
+// If <pairs> is set, also build the table of literal pairs.  Returns
+// false if the lengths are over-subscribed; incomplete codes are
+// allowed, the missing codes are errors when decoding.
+GBool FlateStream::compHuffmanCodes(int *lengths, int n,
+				    FlateHuffmanTab *tab, GBool pairs) {
+  int count[flateMaxHuffman + 1], nextCode[flateMaxHuffman + 1];
+  int revCodes[flateMaxLitCodes];
+  int subBits[1 << flateLookupBits], subIndex[1 << flateLookupBits];
+  FlateCode *code1, *code2;
+  int tabSize, tabBits, mask, left, len, len2, code, rev, val, sub, i;
+
+  // count the codes of each length
+  for (len = 0; len <= flateMaxHuffman; ++len) {
+    count[len] = 0;
+  }
   tab->maxLen = 0;
   for (val = 0; val < n; ++val) {
+    ++count[lengths[val]];
     if (lengths[val] > tab->maxLen) {
       tab->maxLen = lengths[val];
     }
   }
-
-  // allocate the table
-  tabSize = 1 << tab->maxLen;
-  tab->codes = (FlateCode *)gmallocn(tabSize, sizeof(FlateCode));
-
-  // clear the table
-  for (i = 0; i < tabSize; ++i) {
-    tab->codes[i].len = 0;
-    tab->codes[i].val = 0;
+  left = 1;
+  for (len = 1; len <= flateMaxHuffman; ++len) {
+    left = (left << 1) - count[len];
+    if (left < 0) {
+      return gFalse;
+    }
   }
 
-  // build the table
-  for (len = 1, code = 0, skip = 2;
-       len <= tab->maxLen;
-       ++len, code <<= 1, skip <<= 1) {
-    for (val = 0; val < n; ++val) {
-      if (lengths[val] == len) {
+  // assign the (bit-reversed) codes, and find the size of the subtable
+  // under each primary entry
+  tabBits = tab->maxLen < flateLookupBits ? tab->maxLen : flateLookupBits;
+  if (tabBits < 1) {
+    tabBits = 1;
+  }
+  mask = (1 << tabBits) - 1;
+  code = 0;
+  count[0] = 0;
+  for (len = 1; len <= flateMaxHuffman; ++len) {
+    code = (code + count[len - 1]) << 1;
+    nextCode[len] = code;
+  }
+  for (i = 0; i <= mask; ++i) {
+    subBits[i] = 0;
+  }
+  for (val = 0; val < n; ++val) {
+    if ((len = lengths[val])) {
+      code = nextCode[len]++;
+      rev = 0;
+      for (i = 0; i < len; ++i) {
+	rev = (rev << 1) | (code & 1);
+	code >>= 1;
+      }
+      revCodes[val] = rev;
+      if (len - tabBits > subBits[rev & mask]) {
+	subBits[rev & mask] = len - tabBits;
+      }
+    }
+  }
+  tabSize = 1 << tabBits;
+  for (i = 0; i <= mask; ++i) {
+    if (subBits[i]) {
+      subIndex[i] = tabSize;
+      tabSize += 1 << subBits[i];
+    }
+  }
 
-	// bit-reverse the code
-	code2 = 0;
-	t = code;
-	for (i = 0; i < len; ++i) {
-	  code2 = (code2 << 1) | (t & 1);
-	  t >>= 1;
-	}
+  // allocate and clear the table
+  if (tabSize > tab->size) {
+    tab->codes = (FlateCode *)greallocn(tab->codes, tabSize,
+					sizeof(FlateCode));
+    tab->size = tabSize;
+  }
+  memset(tab->codes, 0, tabSize * sizeof(FlateCode));
+  tab->bits = tabBits;
 
-	// fill in the table entries
-	for (i = code2; i < tabSize; i += skip) {
-	  tab->codes[i].len = (Gushort)len;
+  // fill in the links and the codes
+  for (i = 0; i <= mask; ++i) {
+    if (subBits[i]) {
+      tab->codes[i].len = (Guchar)subBits[i];
+      tab->codes[i].link = 1;
+      tab->codes[i].val = (Gushort)subIndex[i];
+    }
+  }
+  for (val = 0; val < n; ++val) {
+    if ((len = lengths[val])) {
+      rev = revCodes[val];
+      if (len <= tabBits) {
+	for (i = rev; i <= mask; i += 1 << len) {
+	  tab->codes[i].len = (Guchar)len;
 	  tab->codes[i].val = (Gushort)val;
 	}
+      } else {
+	sub = rev & mask;
+	for (i = rev >> tabBits; i < (1 << subBits[sub]);
+	     i += 1 << (len - tabBits)) {
+	  tab->codes[subIndex[sub] + i].len = (Guchar)len;
+	  tab->codes[subIndex[sub] + i].val = (Gushort)val;
+	}
+      }
+    }
+  }
 
-	++code;
+  // find the primary entries holding two literal codes: the second
+  // code is decoded from the bits left after the first one
+  if (pairs) {
+    if (!tab->pairs) {
+      tab->pairs = (Guint *)gmallocn(1 << flateLookupBits, sizeof(Guint));
+    }
+    for (i = 0; i <= mask; ++i) {
+      tab->pairs[i] = 0;
+      code1 = &tab->codes[i];
+      len = code1->len;
+      if (code1->link || len == 0 || len >= tabBits || code1->val >= 256) {
+	continue;
       }
+      code2 = &tab->codes[i >> len];
+      len2 = code2->len;
+      if (code2->link || len2 == 0 || len + len2 > tabBits ||
+	  code2->val >= 256) {
+	continue;
+      }
+      tab->pairs[i] = (Guint)(len + len2) | ((Guint)code1->val << 8) |
+	              ((Guint)code2->val << 16);
     }
   }
+
+  return gTrue;
 }
 
 int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
@@ -4934,10 +5478,14 @@ int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
     if ((c = str->getChar()) == EOF) {
       break;
     }
-    codeBuf |= (c & 0xff) << codeSize;
+    codeBuf |= (unsigned long long)(c & 0xff) << codeSize;
     codeSize += 8;
   }
-  code = &tab->codes[codeBuf & ((1 << tab->maxLen) - 1)];
+  code = &tab->codes[codeBuf & ((1 << tab->bits) - 1)];
+  if (code->link) {
+    code = &tab->codes[code->val +
+		       ((codeBuf >> tab->bits) & ((1 << code->len) - 1))];
+  }
   if (codeSize == 0 || codeSize < code->len || code->len == 0) {
     return EOF;
   }
@@ -4952,10 +5500,10 @@ int FlateStream::getCodeWord(int bits) {
   while (codeSize < bits) {
     if ((c = str->getChar()) == EOF)
       return EOF;
-    codeBuf |= (c & 0xff) << codeSize;
+    codeBuf |= (unsigned long long)(c & 0xff) << codeSize;
     codeSize += 8;
   }
-  c = codeBuf & ((1 << bits) - 1);
+  c = (int)(codeBuf & ((1 << bits) - 1));
   codeBuf >>= bits;
   codeSize -= bits;
   return c;
@@ -5008,6 +5556,32 @@ int BufStream::getChar() {
   return c;
 }
 
+int BufStream::getChars(int nChars, Guchar *buffer) {
+  int n, m, i;
+
+  // take the look-ahead chars first, then read straight from the
+  // underlying stream
+  m = nChars < bufSize ? nChars : bufSize;
+  for (n = 0; n < m && buf[n] != EOF; ++n) {
+    buffer[n] = (Guchar)buf[n];
+  }
+  if (n == bufSize) {
+    n += str->doGetChars(nChars - n, buffer + n);
+    m = bufSize;
+  } else {
+    m = n;
+  }
+
+  // refill the look-ahead buffer
+  for (i = m; i < bufSize; ++i) {
+    buf[i - m] = buf[i];
+  }
+  for (i = bufSize - m; i < bufSize; ++i) {
+    buf[i] = str->getChar();
+  }
+  return n;
+}
+
 int BufStream::lookChar() {
   return buf[0];
 }
@@ -5047,6 +5621,17 @@ int FixedLengthEncoder::getChar() {
   return str->getChar();
 }
 
+int FixedLengthEncoder::getChars(int nChars, Guchar *buffer) {
+  int n;
+
+  if (length >= 0 && nChars > length - count) {
+    nChars = length - count;
+  }
+  n = str->doGetChars(nChars, buffer);
+  count += n;
+  return n;
+}
+
 int FixedLengthEncoder::lookChar() {
   if (length >= 0 && count >= length)
     return EOF;
@@ -5081,6 +5666,11 @@ void ASCIIHexEncoder::reset() {
   eof = gFalse;
 }
 
+int ASCIIHexEncoder::getChars(int nChars, Guchar *buffer) {
+  return getBufferedChars(this, &ASCIIHexEncoder::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 GBool ASCIIHexEncoder::fillBuf() {
   static const char *hex = "0123456789abcdef";
   int c;
@@ -5127,6 +5717,11 @@ void ASCII85Encoder::reset() {
   eof = gFalse;
 }
 
+int ASCII85Encoder::getChars(int nChars, Guchar *buffer) {
+  return getBufferedChars(this, &ASCII85Encoder::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 GBool ASCII85Encoder::fillBuf() {
   Guint t;
   char buf1[5];
@@ -5301,6 +5896,11 @@ GBool RunLengthEncoder::fillBuf() {
   return gTrue;
 }
 
+int RunLengthEncoder::getChars(int nChars, Guchar *buffer) {
+  return getBufferedChars(this, &RunLengthEncoder::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 //------------------------------------------------------------------------
 // LZWEncoder
 //------------------------------------------------------------------------
@@ -5446,6 +6046,18 @@ void LZWEncoder::fillBuf() {
   }
 }
 
+int LZWEncoder::getChars(int nChars, Guchar *buffer) {
+  int n, c;
+
+  for (n = 0; n < nChars; ++n) {
+    if ((c = LZWEncoder::getChar()) == EOF) {
+      break;
+    }
+    buffer[n] = (Guchar)c;
+  }
+  return n;
+}
+
 //------------------------------------------------------------------------
 // CMYKGrayEncoder
 //------------------------------------------------------------------------
@@ -5467,6 +6079,11 @@ void CMYKGrayEncoder::reset() {
   eof = gFalse;
 }
 
+int CMYKGrayEncoder::getChars(int nChars, Guchar *buffer) {
+  return getBufferedChars(this, &CMYKGrayEncoder::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 GBool CMYKGrayEncoder::fillBuf() {
   int c0, c1, c2, c3;
   int i;
@@ -5510,6 +6127,11 @@ void RGBGrayEncoder::reset() {
   eof = gFalse;
 }
 
+int RGBGrayEncoder::getChars(int nChars, Guchar *buffer) {
+  return getBufferedChars(this, &RGBGrayEncoder::fillBuf, &bufPtr, &bufEnd,
+			  nChars, buffer);
+}
+
 GBool RGBGrayEncoder::fillBuf() {
   int c0, c1, c2;
   int i;
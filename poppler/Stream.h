@@ -174,6 +174,34 @@ public:
   // Peek at next char in stream.
   virtual int lookChar() = 0;
 
+  // Get a pointer to the chars the stream has already decoded and
+  // buffered, without consuming them.  Returns the number of chars
+  // available, or 0 if the buffer is empty (getChar will refill it) or
+  // the stream doesn't expose one.  The chars are consumed with
+  // skipBufferedChars, which must be called before any other call on
+  // the stream.
+  virtual int lookBufferedChars(const Guchar ** /*chars*/) { return 0; }
+
+  // Consume <n> of the chars returned by lookBufferedChars.
+  virtual void skipBufferedChars(int /*n*/) {}
+
+  // Ask an image stream to decode the image at a reduced resolution:
+  // 1/<scale> of its width and height, rounded up, where <scale> is a
+  // power of 2 up to 32.  This must be called before reset(), and stays
+  // in effect until it is called again.  Returns the scale the stream
+  // will actually decode at (at most <scale>: 8 for DCT, 32 for JPX),
+  // which is 1 if it can't reduce the resolution.
+  virtual int setDecodeScale(int /*scale*/) { return 1; }
+
+  // Ask the stream to decode only the pixels in [<x0>,<x1>) x
+  // [<y0>,<y1>) of the (full resolution) image, if it can skip parts
+  // of it.  The other pixels may then be anything.  Like
+  // setDecodeScale, this must be called before reset(), and stays in
+  // effect until it is called again; an empty region means the whole
+  // image.
+  virtual void setDecodeRegion(int /*x0*/, int /*y0*/,
+			       int /*x1*/, int /*y1*/) {}
+
   // Get next char from stream without using the predictor.
   // This is only used by StreamPredictor.
   virtual int getRawChar();
@@ -323,6 +351,13 @@ public:
   virtual Goffset getStart() = 0;
   virtual void moveStart(Goffset delta) = 0;
 
+  // Get direct access to the stream contents, if they are in memory or
+  // can be mapped: the char at position <pos> (as used by getPos and
+  // setPos) is data[pos], for <pos> in [*startA, *endA).  Returns NULL
+  // if the stream can't be read this way.
+  virtual const char *getData(Goffset * /*startA*/, Goffset * /*endA*/)
+    { return NULL; }
+
 protected:
 
   Goffset length;
@@ -459,10 +494,14 @@ public:
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr++ & 0xff); }
   virtual int lookChar()
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr & 0xff); }
+  virtual int lookBufferedChars(const Guchar **chars)
+    { *chars = (const Guchar *)bufPtr; return (int)(bufEnd - bufPtr); }
+  virtual void skipBufferedChars(int n) { bufPtr += n; }
   virtual Goffset getPos() { return bufPos + (bufPtr - buf); }
   virtual void setPos(Goffset pos, int dir = 0);
   virtual Goffset getStart() { return start; }
   virtual void moveStart(Goffset delta);
+  virtual const char *getData(Goffset *startA, Goffset *endA);
 
   virtual int getUnfilteredChar () { return getChar(); }
   virtual void unfilteredReset () { reset(); }
@@ -505,6 +544,66 @@ private:
   Goffset bufPos;
   Goffset savePos;
   GBool saved;
+  const char *map;		// mapping of the whole file, made by
+  Goffset mapLength;		//   getData
+};
+
+//------------------------------------------------------------------------
+// MMapStream
+//
+// Reads a local file through a read-only memory mapping of the whole
+// file.  Positions are file offsets, as in FileStream.  Substreams and
+// copies are windows on the same mapping, which is released when the
+// stream created from the GooFile is deleted.
+//------------------------------------------------------------------------
+
+class MMapStream: public BaseStream {
+public:
+
+  // Map <fileA>.  Check isOk() before using the stream.
+  MMapStream(GooFile *fileA, Object *dictA);
+  MMapStream(const char *mapA, Goffset mapLengthA, Goffset startA,
+	     GBool limitedA, Goffset lengthA, Object *dictA);
+  virtual ~MMapStream();
+  GBool isOk() { return map != NULL; }
+  virtual BaseStream *copy();
+  virtual Stream *makeSubStream(Goffset startA, GBool limitedA,
+				Goffset lengthA, Object *dictA);
+  virtual StreamKind getKind() { return strFile; }
+  virtual void reset();
+  virtual void close();
+  virtual int getChar()
+    { return (bufPtr < bufEnd) ? (*bufPtr++ & 0xff) : EOF; }
+  virtual int lookChar()
+    { return (bufPtr < bufEnd) ? (*bufPtr & 0xff) : EOF; }
+  virtual int lookBufferedChars(const Guchar **chars)
+    { *chars = (const Guchar *)bufPtr; return (int)(bufEnd - bufPtr); }
+  virtual void skipBufferedChars(int n) { bufPtr += n; }
+  virtual Goffset getPos() { return bufPtr - map; }
+  virtual void setPos(Goffset pos, int dir = 0);
+  virtual Goffset getStart() { return start; }
+  virtual void moveStart(Goffset delta);
+  virtual const char *getData(Goffset *startA, Goffset *endA)
+    { *startA = start; *endA = bufEnd - map; return map; }
+
+  virtual int getUnfilteredChar () { return getChar(); }
+  virtual void unfilteredReset () { reset(); }
+
+private:
+
+  void setBounds();
+
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
+  const char *map;		// the whole file
+  Goffset mapLength;
+  GBool mapOwner;		// true if the mapping is released by
+				//   this stream
+  Goffset start;
+  GBool limited;
+  const char *bufPtr;
+  const char *bufEnd;
 };
 
 //------------------------------------------------------------------------
@@ -529,6 +628,9 @@ public:
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr++ & 0xff); }
   virtual int lookChar()
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr & 0xff); }
+  virtual int lookBufferedChars(const Guchar **chars)
+    { *chars = (const Guchar *)bufPtr; return (int)(bufEnd - bufPtr); }
+  virtual void skipBufferedChars(int n) { bufPtr += n; }
   virtual Goffset getPos() { return bufPos + (bufPtr - buf); }
   virtual void setPos(Goffset pos, int dir = 0);
   virtual Goffset getStart() { return start; }
@@ -541,6 +643,9 @@ private:
 
   GBool fillBuf();
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   CachedFile *cc;
   Goffset start;
   GBool limited;
@@ -572,10 +677,15 @@ public:
     { return (bufPtr < bufEnd) ? (*bufPtr++ & 0xff) : EOF; }
   virtual int lookChar()
     { return (bufPtr < bufEnd) ? (*bufPtr & 0xff) : EOF; }
+  virtual int lookBufferedChars(const Guchar **chars)
+    { *chars = (const Guchar *)bufPtr; return (int)(bufEnd - bufPtr); }
+  virtual void skipBufferedChars(int n) { bufPtr += n; }
   virtual Goffset getPos() { return (int)(bufPtr - buf); }
   virtual void setPos(Goffset pos, int dir = 0);
   virtual Goffset getStart() { return start; }
   virtual void moveStart(Goffset delta);
+  virtual const char *getData(Goffset *startA, Goffset *endA)
+    { *startA = start; *endA = bufEnd - buf; return buf; }
 
   //if needFree = true, the stream will delete buf when it is destroyed
   //otherwise it will not touch it. Default value is false
@@ -655,6 +765,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   int buf;
   GBool eof;
 };
@@ -678,6 +791,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   int c[5];
   int b[4];
   int index, n;
@@ -698,6 +814,8 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int lookBufferedChars(const Guchar **chars);
+  virtual void skipBufferedChars(int n) { seqIndex += n; }
   virtual int getRawChar();
   virtual void getRawChars(int nChars, int *buffer);
   virtual GooString *getPSFilter(int psLevel, const char *indent);
@@ -759,6 +877,9 @@ public:
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr++ & 0xff); }
   virtual int lookChar()
     { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr & 0xff); }
+  virtual int lookBufferedChars(const Guchar **chars)
+    { *chars = (const Guchar *)bufPtr; return (int)(bufEnd - bufPtr); }
+  virtual void skipBufferedChars(int n) { bufPtr += n; }
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -805,6 +926,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   void ccittReset(GBool unfiltered);
   int encoding;			// 'K' parameter
   GBool endOfLine;		// 'EndOfLine' parameter
@@ -857,12 +981,18 @@ struct DCTScanInfo {
   int ah, al;			// successive approximation parameters
 };
 
+#define dctHuffLookBits 9	// # bits of a Huffman lookup table index
+
 // DCT Huffman decoding table
 struct DCTHuffTable {
   Guchar firstSym[17];		// first symbol for this bit length
   Gushort firstCode[17];	// first code for this bit length
   Gushort numCodes[17];		// number of codes of this bit length
   Guchar sym[256];		// symbols
+  Guchar lookLen[1 << dctHuffLookBits]; // length of the code the next
+				//   dctHuffLookBits bits of input start
+				//   with (0 if it is longer)
+  Guchar lookSym[1 << dctHuffLookBits]; // symbol of that code
 };
 
 class DCTStream: public FilterStream {
@@ -880,9 +1010,17 @@ public:
 
   virtual void unfilteredReset();
 
+  // Only 1/8 scale is supported, by decoding only the DC coefficient
+  // of each data unit.
+  virtual int setDecodeScale(int scale);
+
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   void dctReset(GBool unfiltered);  
+  GBool dcOnly;			// set to decode one pixel per data unit
   GBool progressive;		// set if in progressive mode
   GBool interleaved;		// set if in interleaved mode
   int width, height;		// image size
@@ -909,11 +1047,18 @@ private:
   int restartCtr;		// MCUs left until restart
   int restartMarker;		// next restart marker
   int eobRun;			// number of EOBs left in the current run
-  int inputBuf;			// input buffer for variable length codes
+  Guint inputBuf;		// input buffer for variable length codes
   int inputBits;		// number of valid bits in input buffer
+  GBool inputEnd;		// set when the entropy-coded data have
+				//   been read up to a marker or to the
+				//   end of the stream
+  int inputMarker;		// marker code that ended the data, EOF if
+				//   they ended with a bad 0xff byte, or 0
 
   void restart();
   GBool readMCURow();
+  void convertRow(Guchar *row0, Guchar *row1, Guchar *row2, int n);
+  void convertRow(int *row0, int *row1, int *row2, int n);
   void readScan();
   GBool readDataUnit(DCTHuffTable *dcHuffTable,
 		     DCTHuffTable *acHuffTable,
@@ -927,6 +1072,8 @@ private:
   int readHuffSym(DCTHuffTable *table);
   int readAmp(int size);
   int readBit();
+  void fillInputBits();
+  void buildHuffLookup(DCTHuffTable *tbl);
   GBool readHeader();
   GBool readBaselineSOF();
   GBool readProgressiveSOF();
@@ -948,22 +1095,34 @@ private:
 // FlateStream
 //------------------------------------------------------------------------
 
-#define flateWindow          32768    // buffer size
-#define flateMask            (flateWindow-1)
+#define flateWindow          32768    // LZ77 window size
 #define flateMaxHuffman         15    // max Huffman code length
 #define flateMaxCodeLenCodes    19    // max # code length codes
 #define flateMaxLitCodes       288    // max # literal codes
 #define flateMaxDistCodes       30    // max # distance codes
+#define flateMaxMatch          258    // max length of a match
+#define flateLookupBits         10    // # bits of a primary table lookup
+#define flateOutSlack            8    // bytes a match copy can overrun
 
-// Huffman code table entry
+// Huffman code table entry.  A primary table is indexed by the next
+// (bit-reversed) <bits> bits of input; codes longer than that go
+// through a link to a subtable, indexed by the bits that follow.
 struct FlateCode {
-  Gushort len;			// code length, in bits
-  Gushort val;			// value represented by this code
+  Guchar len;			// code length, in bits (0 if no code); for
+				//   a link, # bits indexing the subtable
+  Guchar link;			// set if this entry links to a subtable
+  Gushort val;			// value represented by this code, or index
+				//   of the subtable
 };
 
 struct FlateHuffmanTab {
-  FlateCode *codes;
-  int maxLen;
+  FlateCode *codes;		// primary table, followed by subtables
+  Guint *pairs;			// pairs of literals decoded by a single
+				//   primary lookup: length of the two codes
+				//   | (first << 8) | (second << 16), or 0
+  int size;			// number of allocated entries in codes
+  int bits;			// # bits indexing the primary table
+  int maxLen;			// max code length
 };
 
 // Decoding info for length and distance code words
@@ -982,6 +1141,9 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int lookBufferedChars(const Guchar **chars);
+  virtual void skipBufferedChars(int n)
+    { index += n; remain -= n; }
   virtual int getRawChar();
   virtual void getRawChars(int nChars, int *buffer);
   virtual GooString *getPSFilter(int psLevel, const char *indent);
@@ -998,8 +1160,7 @@ private:
         return EOF;
       readSome();
     }
-    c = buf[index];
-    index = (index + 1) & flateMask;
+    c = buf[index++];
     --remain;
     return c;
   }
@@ -1008,15 +1169,19 @@ private:
   virtual int getChars(int nChars, Guchar *buffer);
 
   StreamPredictor *pred;	// predictor
-  Guchar buf[flateWindow];	// output data buffer
+  // Output data buffer.  The data is decoded at buf[index + remain],
+  // after the last flateWindow bytes of output (the LZ77 window), which
+  // are slid back to the start of the buffer when it fills up.
+  Guchar buf[2 * flateWindow + flateOutSlack];
   int index;			// current index into output buffer
   int remain;			// number valid bytes in output buffer
-  int codeBuf;			// input buffer
+  unsigned long long codeBuf;	// input bit buffer
   int codeSize;			// number of bits in input buffer
   int				// literal and distance code lengths
     codeLengths[flateMaxLitCodes + flateMaxDistCodes];
   FlateHuffmanTab litCodeTab;	// literal code table
   FlateHuffmanTab distCodeTab;	// distance code table
+  GBool fixedCodes;		// set if the tables hold the fixed codes
   GBool compressedBlock;	// set if reading a compressed block
   int blockLen;			// remaining length of uncompressed block
   GBool endOfBlock;		// set when end of block is reached
@@ -1028,16 +1193,16 @@ private:
     lengthDecode[flateMaxLitCodes-257];
   static FlateDecode		// distance decoding info
     distDecode[flateMaxDistCodes];
-  static FlateHuffmanTab	// fixed literal code table
-    fixedLitCodeTab;
-  static FlateHuffmanTab	// fixed distance code table
-    fixedDistCodeTab;
 
   void readSome();
+  GBool readCodes();
+  int readCode(Guchar *out);
+  void readStored();
   GBool startBlock();
-  void loadFixedCodes();
+  GBool loadFixedCodes();
   GBool readDynamicCodes();
-  void compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab);
+  GBool compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab,
+			 GBool pairs);
   int getHuffmanCodeWord(FlateHuffmanTab *tab);
   int getCodeWord(int bits);
 };
@@ -1058,6 +1223,11 @@ public:
   virtual int lookChar() { return EOF; }
   virtual GooString *getPSFilter(int /*psLevel*/, const char * /*indent*/)  { return NULL; }
   virtual GBool isBinary(GBool /*last = gTrue*/) { return gFalse; }
+
+private:
+
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int /*nChars*/, Guchar * /*buffer*/) { return 0; }
 };
 
 //------------------------------------------------------------------------
@@ -1081,6 +1251,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   int *buf;
   int bufSize;
 };
@@ -1104,6 +1277,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   int length;
   int count;
 };
@@ -1129,6 +1305,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   char buf[4];
   char *bufPtr;
   char *bufEnd;
@@ -1159,6 +1338,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   char buf[8];
   char *bufPtr;
   char *bufEnd;
@@ -1189,6 +1371,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   char buf[131];
   char *bufPtr;
   char *bufEnd;
@@ -1224,6 +1409,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   LZWEncoderNode table[4096];
   int nextSeq;
   int codeLen;
@@ -1257,6 +1445,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   char buf[2];
   char *bufPtr;
   char *bufEnd;
@@ -1286,6 +1477,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   char buf[2];
   char *bufPtr;
   char *bufEnd;
@@ -46,6 +46,8 @@
 #include <float.h>
 #include "goo/gfile.h"
 #include "goo/gmem.h"
+#include "goo/GooThread.h"
+#include "goo/GooTimer.h"
 #include "Object.h"
 #include "Stream.h"
 #include "Lexer.h"
@@ -55,6 +57,8 @@
 #include "ErrorCodes.h"
 #include "XRef.h"
 #include "PopplerCache.h"
+#include "GlobalParams.h"
+#include "DocIndex.h"
 
 //------------------------------------------------------------------------
 // Permission bits
@@ -79,6 +83,24 @@
 #  define xrefCondLocker(X)
 #endif
 
+#if MULTITHREADED
+#  define shardLocker(S)   MutexLocker locker(&(S)->mutex)
+#else
+#  define shardLocker(S)
+#endif
+
+#if MULTITHREADED
+#  define streamCacheLocker()   MutexLocker locker(&mutex)
+#else
+#  define streamCacheLocker()
+#endif
+
+// number of independently locked shards in the resolved object cache
+#define xrefObjCacheShards 16
+
+// min size of the chunks of a damaged file scanned in parallel
+#define xrefScanChunkSize (4 * 1024 * 1024)
+
 //------------------------------------------------------------------------
 // ObjectStream
 //------------------------------------------------------------------------
@@ -97,6 +119,9 @@ public:
   // Return the object number of this object stream.
   int getObjStrNum() { return objStrNum; }
 
+  // Return the approximate memory used by the parsed objects.
+  size_t getSize() { return size; }
+
   // Get the <objIdx>th object from this stream, which should be
   // object number <objNum>, generation 0.
   Object *getObject(int objIdx, int objNum, Object *obj);
@@ -107,39 +132,350 @@ private:
   int nObjects;			// number of objects in the stream
   Object *objs;			// the objects (length = nObjects)
   int *objNums;			// the object numbers (length = nObjects)
+  size_t size;			// approximate memory footprint, in bytes
   GBool ok;
 };
 
-class ObjectStreamKey : public PopplerCacheKey
-{
+//------------------------------------------------------------------------
+// XRefObjectCache
+//------------------------------------------------------------------------
+
+// Cache of resolved, non-stream objects, keyed by object number and
+// generation.  The cache is split into shards, each with its own lock,
+// so that threads fetching already resolved objects neither contend on
+// the XRef mutex nor on each other.
+//
+// Callers are free to modify the objects they fetch (PDFDoc::savePageAs
+// removes entries from the catalog, annotations set entries before
+// calling XRef::setModifiedObject, ...), so the Dicts and Arrays are
+// deep-copied in and out of the cache: a cached object is never shared
+// with a caller.
+class XRefObjectCache {
+public:
+
+  XRefObjectCache(int cacheSizeA);
+  ~XRefObjectCache();
+
+  // If (num, gen) is cached, deep-copy it into <obj> and return true.
+  GBool lookup(int num, int gen, Object *obj);
+
+  // Cache a deep copy of <obj> as (num, gen), evicting the least
+  // recently used object of the shard if it is full.
+  void put(int num, int gen, Object *obj);
+
+  // Drop any cached object with object number <num>.
+  void remove(int num);
+
+  // Drop all cached objects.
+  void clear();
+
+private:
+
+  class CachedObject {
   public:
-    ObjectStreamKey(int num) : objStrNum(num)
-    {
-    }
+    CachedObject(int genA, Object *objA) : gen(genA) { deepCopy(objA, &obj); }
+    ~CachedObject() { obj.free(); }
 
-    bool operator==(const PopplerCacheKey &key) const
-    {
-      const ObjectStreamKey *k = static_cast<const ObjectStreamKey*>(&key);
-      return objStrNum == k->objStrNum;
-    }
+    int gen;
+    Object obj;
+  };
+
+  struct Shard {
+    PopplerCache<int, CachedObject> *cache;
+#if MULTITHREADED
+    GooMutex mutex;
+#endif
+  };
+
+  static Object *deepCopy(Object *src, Object *dst);
 
-    const int objStrNum;
+  Shard *getShard(int num)
+    { return &shards[(unsigned int)num % xrefObjCacheShards]; }
+
+  Shard shards[xrefObjCacheShards];
 };
 
-class ObjectStreamItem : public PopplerCacheItem
-{
+XRefObjectCache::XRefObjectCache(int cacheSizeA) {
+  int shardSize = cacheSizeA / xrefObjCacheShards;
+  if (shardSize < 1) {
+    shardSize = 1;
+  }
+  for (int i = 0; i < xrefObjCacheShards; ++i) {
+    shards[i].cache = new PopplerCache<int, CachedObject>(shardSize);
+#if MULTITHREADED
+    gInitMutex(&shards[i].mutex);
+#endif
+  }
+}
+
+XRefObjectCache::~XRefObjectCache() {
+  for (int i = 0; i < xrefObjCacheShards; ++i) {
+    delete shards[i].cache;
+#if MULTITHREADED
+    gDestroyMutex(&shards[i].mutex);
+#endif
+  }
+}
+
+// Copy <src> into <dst>, with new Dicts and Arrays all the way down
+// (the objects are direct, so the recursion is bounded by the parser's
+// nesting limit).
+Object *XRefObjectCache::deepCopy(Object *src, Object *dst) {
+  Object obj1, obj2;
+  int i;
+
+  if (src->isDict()) {
+    Dict *dict = src->getDict();
+    dst->initDict(dict->getXRef());
+    for (i = 0; i < dict->getLength(); ++i) {
+      char *key = dict->getKey(i);
+      deepCopy(dict->getValNF(i, &obj1), &obj2);
+      obj1.free();
+      dst->dictAdd(isInternedName(key) ? key : copyString(key), &obj2);
+    }
+  } else if (src->isArray()) {
+    Array *array = src->getArray();
+    dst->initArray(array->getXRef());
+    for (i = 0; i < array->getLength(); ++i) {
+      deepCopy(array->getNF(i, &obj1), &obj2);
+      obj1.free();
+      dst->arrayAdd(&obj2);
+    }
+  } else {
+    src->copy(dst);
+  }
+  return dst;
+}
+
+GBool XRefObjectCache::lookup(int num, int gen, Object *obj) {
+  Shard *shard = getShard(num);
+  shardLocker(shard);
+  CachedObject *item = shard->cache->lookup(num);
+  if (!item || item->gen != gen) {
+    return gFalse;
+  }
+  deepCopy(&item->obj, obj);
+  return gTrue;
+}
+
+void XRefObjectCache::put(int num, int gen, Object *obj) {
+  Shard *shard = getShard(num);
+  shardLocker(shard);
+  shard->cache->put(num, new CachedObject(gen, obj));
+}
+
+void XRefObjectCache::remove(int num) {
+  Shard *shard = getShard(num);
+  shardLocker(shard);
+  shard->cache->remove(num);
+}
+
+void XRefObjectCache::clear() {
+  for (int i = 0; i < xrefObjCacheShards; ++i) {
+    Shard *shard = &shards[i];
+    shardLocker(shard);
+    shard->cache->clear();
+  }
+}
+
+//------------------------------------------------------------------------
+// XRefStreamCache
+//------------------------------------------------------------------------
+
+// Cache of the decoded data of image and form streams, keyed by object
+// number and generation, and bounded by the total size of the data.
+// A stream is only decoded into the cache the second time it is drawn,
+// so that streams used once are not copied for nothing.
+class XRefStreamCache {
+public:
+
+  XRefStreamCache(size_t maxBytesA);
+  ~XRefStreamCache();
+
+  // Replace the stream in <obj>, fetched from (num, gen), with one
+  // reading its decoded data from the cache.  See
+  // XRef::getDecodedStream.
+  GBool getDecodedStream(int num, int gen, Object *obj);
+
+  // Drop any cached stream with object number <num>.
+  void remove(int num);
+
+  // Drop all cached streams.
+  void clear();
+
+private:
+
+  class CachedStream {
   public:
-    ObjectStreamItem(ObjectStream *objStr) : objStream(objStr)
-    {
+    CachedStream(int genA, char *dataA, int lengthA)
+      : gen(genA), data(dataA), length(lengthA) {}
+    ~CachedStream() { gfree(data); }
+
+    int gen;
+    char *data;			// decoded data, NULL if the stream has
+				//   only been seen once, or can't be
+				//   cached
+    int length;			// length of <data>, -1 if the stream
+				//   can't be cached
+  };
+
+  static GBool isCacheable(Stream *str);
+  static char *decode(Stream *str, int maxLength, int *length);
+  static void makeStream(Object *obj, char *data, int length);
+
+  PopplerCache<int, CachedStream> *cache;
+  int maxLength;		// max length of a cached stream
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+XRefStreamCache::XRefStreamCache(size_t maxBytesA) {
+  // the byte budget is the only real limit, the item count only keeps
+  // the "seen once" entries in check
+  cache = new PopplerCache<int, CachedStream>(4096, maxBytesA);
+  maxLength = maxBytesA / 4 < INT_MAX ? (int)(maxBytesA / 4) : INT_MAX;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+XRefStreamCache::~XRefStreamCache() {
+  delete cache;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+// Only streams whose filters are all general-purpose decoders are
+// cached: the output devices look at the kind of the top-level stream
+// to pass DCT, JPX, JBIG2 and CCITT data through undecoded, and those
+// decoders keep state (e.g. JBIG2 globals) outside the stream data.
+// Streams with an /F entry are not cached either: their data is in an
+// external file (which poppler doesn't read), not in the stream's own
+// bytes.
+GBool XRefStreamCache::isCacheable(Stream *str) {
+  if (!str->getNextStream() || str->getDict()->hasKey("F")) {
+    return gFalse;
+  }
+  for (; str->getNextStream(); str = str->getNextStream()) {
+    switch (str->getKind()) {
+    case strFlate:
+    case strLZW:
+    case strASCIIHex:
+    case strASCII85:
+    case strRunLength:
+    case strCrypt:
+      break;
+    default:
+      return gFalse;
     }
+  }
+  return gTrue;
+}
 
-    ~ObjectStreamItem()
-    {
-      delete objStream;
+// Read all of <str>.  Returns NULL if it is longer than <maxLength>.
+char *XRefStreamCache::decode(Stream *str, int maxLength, int *length) {
+  char *data;
+  int size, n, total;
+
+  size = 65536;
+  data = (char *)gmalloc(size);
+  total = 0;
+  str->reset();
+  while ((n = str->doGetChars(size - total, (Guchar *)data + total)) > 0) {
+    total += n;
+    if (total == size) {
+      if (size > maxLength) {
+	str->close();
+	gfree(data);
+	return NULL;
+      }
+      size = size <= INT_MAX / 2 ? 2 * size : INT_MAX;
+      data = (char *)grealloc(data, size);
     }
+  }
+  str->close();
+  if (total > maxLength) {
+    gfree(data);
+    return NULL;
+  }
+  *length = total;
+  return data;
+}
 
-    ObjectStream *objStream;
-};
+// Replace the stream in <obj> with a MemStream over (a copy of) <data>,
+// whose dictionary no longer lists any filters.  (Streams with /F,
+// which Stream::addFilters would also take for a filter name, aren't
+// cached, and decode parameters are only used along with filters.)
+void XRefStreamCache::makeStream(Object *obj, char *data, int length) {
+  Dict *dict;
+  Object dictObj, lengthObj;
+  MemStream *str;
+  char *buf;
+
+  dict = obj->streamGetDict()->copy(obj->streamGetDict()->getXRef());
+  dict->remove("Filter");
+  dict->remove("DecodeParms");
+  lengthObj.initInt(length);
+  dict->set("Length", &lengthObj);
+  dictObj.initDict(dict);
+  dict->decRef();
+  buf = (char *)gmalloc(length > 0 ? length : 1);
+  memcpy(buf, data, length);
+  str = new MemStream(buf, 0, length, &dictObj);
+  str->setNeedFree(gTrue);
+  obj->free();
+  obj->initStream(str);
+}
+
+GBool XRefStreamCache::getDecodedStream(int num, int gen, Object *obj) {
+  CachedStream *item;
+  char *data;
+  int length;
+
+  {
+    streamCacheLocker();
+    item = cache->lookup(num);
+    if (item && item->gen == gen) {
+      if (item->data) {
+	makeStream(obj, item->data, item->length);
+	return gTrue;
+      }
+      if (item->length < 0) {
+	return gFalse;
+      }
+    } else {
+      // first time this stream is drawn: just remember it
+      cache->put(num, new CachedStream(gen, NULL,
+				       isCacheable(obj->getStream()) ? 0 : -1));
+      return gFalse;
+    }
+  }
+
+  // second time: decode the stream (without holding the lock) and
+  // keep the data
+  if (!(data = decode(obj->getStream(), maxLength, &length))) {
+    streamCacheLocker();
+    cache->put(num, new CachedStream(gen, NULL, -1));
+    return gFalse;
+  }
+  streamCacheLocker();
+  item = new CachedStream(gen, data, length);
+  cache->put(num, item, length);
+  makeStream(obj, item->data, item->length);
+  return gTrue;
+}
+
+void XRefStreamCache::remove(int num) {
+  streamCacheLocker();
+  cache->remove(num);
+}
+
+void XRefStreamCache::clear() {
+  streamCacheLocker();
+  cache->clear();
+}
 
 ObjectStream::ObjectStream(XRef *xref, int objStrNumA, int recursion) {
   Stream *str;
@@ -153,6 +489,7 @@ ObjectStream::ObjectStream(XRef *xref, int objStrNumA, int recursion) {
   nObjects = 0;
   objs = NULL;
   objNums = NULL;
+  size = 0;
   ok = gFalse;
 
   if (!xref->fetch(objStrNum, 0, &objStr, recursion)->isStream()) {
@@ -248,6 +585,8 @@ ObjectStream::ObjectStream(XRef *xref, int objStrNumA, int recursion) {
     delete parser;
   }
 
+  // the parsed objects take roughly as much memory as their source
+  size = nObjects * (sizeof(Object) + sizeof(int)) + first + offsets[nObjects - 1];
   gfree(offsets);
   ok = gTrue;
 
@@ -274,6 +613,226 @@ Object *ObjectStream::getObject(int objIdx, int objNum, Object *obj) {
   return objs[objIdx].copy(obj);
 }
 
+//------------------------------------------------------------------------
+// XRefScanner
+//------------------------------------------------------------------------
+
+// Finds the object headers, trailers and stream ends of a damaged file
+// for XRef::constructXRef.  A scanner handles the lines starting in a
+// range of the file.  It reads them from the stream or, when the file
+// contents are in memory, straight from the data, so that several
+// scanners can work on separate chunks of the file in parallel.
+// Merging their items in file order gives the same result as a single
+// scan, as long as the chunks start on lines that the single scan
+// would also have started on (see findScanChunkStart).
+
+struct XRefScanItem {
+  enum Kind {
+    objHeader,			// "<num> <gen> obj"
+    trailer,			// "trailer"
+    streamEnd			// "endstream"
+  };
+
+  Kind kind;
+  Goffset pos;			// position of the line
+  int num, gen;			// object number and generation, for
+				//   objHeader items
+};
+
+class XRefScanner {
+public:
+
+  // Scan the whole stream, from its current position.
+  XRefScanner(Stream *strA);
+
+  // Scan the lines starting in [startA, endA) of the file contents
+  // <dataA>, which go up to <dataEndA>.
+  XRefScanner(const char *dataA, Goffset dataEndA,
+	      Goffset startA, Goffset endA);
+
+  void scan();
+
+  std::vector<XRefScanItem> items;
+
+private:
+
+  char *getLine(char *buf, int size);
+  void addItem(XRefScanItem::Kind kind, Goffset pos,
+	       int num = 0, int gen = 0);
+
+  Stream *str;			// stream, if not reading from <data>
+  const char *data;		// file contents
+  Goffset dataEnd;		// end of <data>
+  Goffset dataPos;		// current position in <data>
+  Goffset end;			// end of the range of line starts
+};
+
+XRefScanner::XRefScanner(Stream *strA) {
+  str = strA;
+  data = NULL;
+  dataEnd = dataPos = 0;
+  end = LLONG_MAX;
+}
+
+XRefScanner::XRefScanner(const char *dataA, Goffset dataEndA,
+			 Goffset startA, Goffset endA) {
+  str = NULL;
+  data = dataA;
+  dataEnd = dataEndA;
+  dataPos = startA;
+  end = endA;
+}
+
+// Same as Stream::getLine.
+char *XRefScanner::getLine(char *buf, int size) {
+  int i, c;
+
+  if (str) {
+    return str->getLine(buf, size);
+  }
+  if (dataPos >= dataEnd || size < 0)
+    return NULL;
+  for (i = 0; i < size - 1 && dataPos < dataEnd; ++i) {
+    c = data[dataPos++] & 0xff;
+    if (c == '\n')
+      break;
+    if (c == '\r') {
+      if (dataPos < dataEnd && data[dataPos] == '\n')
+	++dataPos;
+      break;
+    }
+    buf[i] = c;
+  }
+  buf[i] = '\0';
+  return buf;
+}
+
+void XRefScanner::addItem(XRefScanItem::Kind kind, Goffset pos,
+			  int num, int gen) {
+  XRefScanItem item;
+
+  item.kind = kind;
+  item.pos = pos;
+  item.num = num;
+  item.gen = gen;
+  items.push_back(item);
+}
+
+void XRefScanner::scan() {
+  char buf[256];
+  Goffset pos;
+  int num, gen;
+  char *p;
+  char* token = NULL;
+  bool oneCycle = true;
+  int offset = 0;
+
+  while (1) {
+    pos = str ? str->getPos() : dataPos;
+    if (pos >= end || !getLine(buf, 256)) {
+      break;
+    }
+    p = buf;
+
+    // skip whitespace
+    while (*p && Lexer::isSpace(*p & 0xff)) ++p;
+
+    oneCycle = true;
+    offset = 0;
+
+    while( ( token = strstr( p, "endobj" ) ) || oneCycle ) {
+      oneCycle = false;
+
+      if( token ) {
+        oneCycle = true;
+        token[0] = '\0'; 
+        offset = token - p;
+      }
+
+      // got trailer dictionary
+      if (!strncmp(p, "trailer", 7)) {
+        addItem(XRefScanItem::trailer, pos);
+
+      // look for object
+      } else if (isdigit(*p & 0xff)) {
+	num = atoi(p);
+	if (num > 0) {
+	  do {
+	    ++p;
+	  } while (*p && isdigit(*p & 0xff));
+	  if ((*p & 0xff) == 0 || isspace(*p & 0xff)) {
+	    if ((*p & 0xff) == 0) {
+	      //new line, continue with next line!
+	      getLine(buf, 256);
+	      p = buf - 1;
+	    }
+	    do {
+	      ++p;
+	    } while (*p && isspace(*p & 0xff));
+	    if (isdigit(*p & 0xff)) {
+	      gen = atoi(p);
+	      do {
+		++p;
+	      } while (*p && isdigit(*p & 0xff));
+	      if ((*p & 0xff) == 0 || isspace(*p & 0xff)) {
+		if ((*p & 0xff) == 0) {
+		  //new line, continue with next line!
+		  getLine(buf, 256);
+		  p = buf - 1;
+		}
+		do {
+		  ++p;
+		} while (*p && isspace(*p & 0xff));
+		if (!strncmp(p, "obj", 3)) {
+		  addItem(XRefScanItem::objHeader, pos, num, gen);
+		}
+	      }
+	    }
+	  }
+	}
+
+      } else if (!strncmp(p, "endstream", 9)) {
+        addItem(XRefScanItem::streamEnd, pos);
+      }
+      if( token ) {
+        p = token + 6;// strlen( "endobj" ) = 6
+        pos += offset + 6;// strlen( "endobj" ) = 6
+        while (*p && Lexer::isSpace(*p & 0xff)) {
+          ++p;
+          ++pos;
+        }
+      }
+    }
+  }
+}
+
+static void scanXRefChunk(int chunk, void *scanners) {
+  ((XRefScanner **)scanners)[chunk]->scan();
+}
+
+// Returns the first position >= <pos> (and <= <end>) at which the scan
+// is sure to start a line of its own: right after an end of line, with
+// no digit before it that could make the scan read that line as the
+// continuation of an object header.
+static Goffset findScanChunkStart(const char *data, Goffset pos,
+				  Goffset end) {
+  Goffset i, j;
+
+  for (i = pos - 1; i < end; ++i) {
+    if (data[i] == '\n' ||
+	(data[i] == '\r' && (i + 1 == end || data[i + 1] != '\n'))) {
+      j = i - 1;
+      if (data[i] == '\n' && data[j] == '\r') {
+	--j;
+      }
+      if (!isdigit(data[j] & 0xff)) {
+	return i + 1;
+      }
+    }
+  }
+  return end;
+}
+
 //------------------------------------------------------------------------
 // XRef
 //------------------------------------------------------------------------
@@ -290,7 +849,19 @@ void XRef::init() {
   modified = gFalse;
   streamEnds = NULL;
   streamEndsLen = 0;
-  objStrs = new PopplerCache(5);
+  if (globalParams) {
+    objStrs = new PopplerCache<int, ObjectStream>(globalParams->getObjStreamCacheSize(),
+						  globalParams->getObjStreamCacheBytes());
+    objCache = globalParams->getObjectCacheSize() > 0 ?
+                 new XRefObjectCache(globalParams->getObjectCacheSize()) : NULL;
+    streamCache = globalParams->getDecodedStreamCacheBytes() > 0 ?
+                    new XRefStreamCache(globalParams->getDecodedStreamCacheBytes())
+                    : NULL;
+  } else {
+    objStrs = new PopplerCache<int, ObjectStream>(5);
+    objCache = NULL;
+    streamCache = NULL;
+  }
   mainXRefEntriesOffset = 0;
   xRefStream = gFalse;
   scannedSpecialFlags = gFalse;
@@ -301,6 +872,8 @@ void XRef::init() {
   strOwner = gFalse;
   xrefReconstructed = gFalse;
   encAlgorithm = cryptNone;
+  numReconstructions = 0;
+  reconstructionTime = 0;
 }
 
 XRef::XRef() {
@@ -391,6 +964,51 @@ XRef::XRef(BaseStream *strA, Goffset pos, Goffset mainXRefEntriesOffsetA, GBool
   trailerDict.getDict()->setXRef(this);
 }
 
+XRef::XRef(BaseStream *strA, DocIndex *index) {
+  int n;
+
+  init();
+  str = strA;
+  start = str->getStart();
+  prevXRefOffset = 0;
+  mainXRefOffset = index->mainXRefOffset;
+  mainXRefEntriesOffset = index->mainXRefEntriesOffset;
+  xRefStream = index->xRefStream;
+  xrefReconstructed = index->xrefReconstructed;
+
+  n = (int)index->entries.size();
+  if (resize(n) != n) {
+    ok = gFalse;
+    errCode = errDamaged;
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    entries[i].offset = index->entries[i].offset;
+    entries[i].gen = index->entries[i].gen;
+    entries[i].type = index->entries[i].type;
+  }
+  streamEndsLen = (int)index->streamEnds.size();
+  if (streamEndsLen) {
+    streamEnds = (Goffset *)gmallocn(streamEndsLen, sizeof(Goffset));
+    for (int i = 0; i < streamEndsLen; ++i) {
+      streamEnds[i] = index->streamEnds[i];
+    }
+  }
+  index->getTrailer(this, &trailerDict);
+  rootNum = index->rootNum;
+  rootGen = index->rootGen;
+
+  // the index key doesn't cover the whole file, so make sure the
+  // catalog is still where the index says it is
+  if (!trailerDict.isDict() || rootNum < 0 || rootNum >= size ||
+      !checkObjectHeader(rootNum)) {
+    ok = gFalse;
+    errCode = errDamaged;
+    return;
+  }
+  trailerDict.getDict()->setXRef(this);
+}
+
 XRef::~XRef() {
   for(int i=0; i<size; i++) {
       entries[i].obj.free ();
@@ -404,6 +1022,8 @@ XRef::~XRef() {
   if (objStrs) {
     delete objStrs;
   }
+  delete objCache;
+  delete streamCache;
   if (strOwner) {
     delete str;
   }
@@ -896,19 +1516,25 @@ GBool XRef::readXRefStreamSection(Stream *xrefStr, int *w, int first, int n) {
 
 // Attempt to construct an xref table for a damaged file.
 GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
+  GooTimer timer;
+  XRefScanner **scanners;
   Parser *parser;
   Object newTrailerDict, obj;
-  char buf[256];
-  Goffset pos;
-  int num, gen;
+  const char *data;
+  Goffset dataStart, dataEnd, chunkStart, chunkEnd;
+  int nScanners, nThreads, maxScanners;
   int newSize;
   int streamEndsSize;
-  char *p;
-  GBool gotRoot;
-  char* token = NULL;
-  bool oneCycle = true;
-  int offset = 0;
+  GBool gotRoot, failed;
+  int i;
+  size_t j;
 
+  if (objCache) {
+    objCache->clear();
+  }
+  if (streamCache) {
+    streamCache->clear();
+  }
   gfree(entries);
   capacity = 0;
   size = 0;
@@ -922,35 +1548,56 @@ GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
     *wasReconstructed = true;
   }
 
-  str->reset();
-  while (1) {
-    pos = str->getPos();
-    if (!str->getLine(buf, 256)) {
-      break;
+  // scan the file: in parallel chunks if the contents can be read
+  // directly, otherwise line by line through the stream
+  nThreads = globalParams ? globalParams->getNumThreads() : 1;
+  data = NULL;
+  if (nThreads > 1) {
+    data = str->getData(&dataStart, &dataEnd);
+  }
+  if (data) {
+    maxScanners = (int)((dataEnd - dataStart) / xrefScanChunkSize);
+    if (maxScanners > 4 * nThreads) {
+      maxScanners = 4 * nThreads;
+    } else if (maxScanners < 1) {
+      maxScanners = 1;
+    }
+    scanners = (XRefScanner **)gmallocn(maxScanners, sizeof(XRefScanner *));
+    nScanners = 0;
+    chunkStart = dataStart;
+    for (i = 1; i <= maxScanners && chunkStart < dataEnd; ++i) {
+      chunkEnd = dataStart + (dataEnd - dataStart) / maxScanners * i;
+      if (i == maxScanners || chunkEnd <= chunkStart) {
+	chunkEnd = dataEnd;
+      } else {
+	chunkEnd = findScanChunkStart(data, chunkEnd, dataEnd);
+      }
+      scanners[nScanners++] = new XRefScanner(data, dataEnd,
+					      chunkStart, chunkEnd);
+      chunkStart = chunkEnd;
     }
-    p = buf;
-
-    // skip whitespace
-    while (*p && Lexer::isSpace(*p & 0xff)) ++p;
+    gRunJobs(nScanners, nThreads, &scanXRefChunk, scanners);
+  } else {
+    str->reset();
+    scanners = (XRefScanner **)gmalloc(sizeof(XRefScanner *));
+    scanners[0] = new XRefScanner(str);
+    scanners[0]->scan();
+    nScanners = 1;
+  }
 
-    oneCycle = true;
-    offset = 0;
-
-    while( ( token = strstr( p, "endobj" ) ) || oneCycle ) {
-      oneCycle = false;
-
-      if( token ) {
-        oneCycle = true;
-        token[0] = '\0'; 
-        offset = token - p;
-      }
+  // build the table from what was found, in file order
+  failed = gFalse;
+  for (i = 0; i < nScanners && !failed; ++i) {
+    for (j = 0; j < scanners[i]->items.size() && !failed; ++j) {
+      XRefScanItem *item = &scanners[i]->items[j];
+      switch (item->kind) {
 
       // got trailer dictionary
-      if (!strncmp(p, "trailer", 7)) {
+      case XRefScanItem::trailer:
         obj.initNull();
         parser = new Parser(NULL,
 		 new Lexer(NULL,
-		   str->makeSubStream(pos + 7, gFalse, 0, &obj)),
+		   str->makeSubStream(item->pos + 7, gFalse, 0, &obj)),
 		 gFalse);
         parser->getObj(&newTrailerDict);
         if (newTrailerDict.isDict()) {
@@ -968,83 +1615,56 @@ GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
         }
         newTrailerDict.free();
         delete parser;
+        break;
 
-      // look for object
-    } else if (isdigit(*p & 0xff)) {
-      num = atoi(p);
-      if (num > 0) {
-	do {
-	  ++p;
-	} while (*p && isdigit(*p & 0xff));
-	if ((*p & 0xff) == 0 || isspace(*p & 0xff)) {
-          if ((*p & 0xff) == 0) {
-            //new line, continue with next line!
-            str->getLine(buf, 256);
-            p = buf - 1;
-          }
-	  do {
-	    ++p;
-	  } while (*p && isspace(*p & 0xff));
-	  if (isdigit(*p & 0xff)) {
-	    gen = atoi(p);
-	    do {
-	      ++p;
-	    } while (*p && isdigit(*p & 0xff));
-	    if ((*p & 0xff) == 0 || isspace(*p & 0xff)) {
-              if ((*p & 0xff) == 0) {
-                //new line, continue with next line!
-                str->getLine(buf, 256);
-                p = buf - 1;
-              }
-	      do {
-		++p;
-	      } while (*p && isspace(*p & 0xff));
-	      if (!strncmp(p, "obj", 3)) {
-		if (num >= size) {
-		  newSize = (num + 1 + 255) & ~255;
-		  if (newSize < 0) {
-		    error(errSyntaxError, -1, "Bad object number");
-		    return gFalse;
-		  }
-		    if (resize(newSize) != newSize) {
-		      error(errSyntaxError, -1, "Invalid 'obj' parameters");
-		      return gFalse;
-		    }
-		  }
-		  if (entries[num].type == xrefEntryFree ||
-		      gen >= entries[num].gen) {
-		    entries[num].offset = pos - start;
-		    entries[num].gen = gen;
-		    entries[num].type = xrefEntryUncompressed;
-		}
-	        }
-	      }
-	    }
+      case XRefScanItem::objHeader:
+	if (item->num >= size) {
+	  newSize = (item->num + 1 + 255) & ~255;
+	  if (newSize < 0) {
+	    error(errSyntaxError, -1, "Bad object number");
+	    failed = gTrue;
+	    break;
 	  }
-        }
+	  if (resize(newSize) != newSize) {
+	    error(errSyntaxError, -1, "Invalid 'obj' parameters");
+	    failed = gTrue;
+	    break;
+	  }
+	}
+	if (entries[item->num].type == xrefEntryFree ||
+	    item->gen >= entries[item->num].gen) {
+	  entries[item->num].offset = item->pos - start;
+	  entries[item->num].gen = item->gen;
+	  entries[item->num].type = xrefEntryUncompressed;
+	}
+        break;
 
-      } else if (!strncmp(p, "endstream", 9)) {
+      case XRefScanItem::streamEnd:
         if (streamEndsLen == streamEndsSize) {
 	  streamEndsSize += 64;
           if (streamEndsSize >= INT_MAX / (int)sizeof(int)) {
             error(errSyntaxError, -1, "Invalid 'endstream' parameter.");
-            return gFalse;
+	    failed = gTrue;
+	    break;
           }
 	  streamEnds = (Goffset *)greallocn(streamEnds,
 					streamEndsSize, sizeof(Goffset));
         }
-        streamEnds[streamEndsLen++] = pos;
-      }
-      if( token ) {
-        p = token + 6;// strlen( "endobj" ) = 6
-        pos += offset + 6;// strlen( "endobj" ) = 6
-        while (*p && Lexer::isSpace(*p & 0xff)) {
-          ++p;
-          ++pos;
-        }
+        streamEnds[streamEndsLen++] = item->pos;
+        break;
       }
     }
   }
+  for (i = 0; i < nScanners; ++i) {
+    delete scanners[i];
+  }
+  gfree(scanners);
+
+  ++numReconstructions;
+  reconstructionTime += timer.getElapsed();
+
+  if (failed)
+    return gFalse;
 
   if (gotRoot)
     return gTrue;
@@ -1150,6 +1770,11 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   Parser *parser;
   Object obj1, obj2, obj3;
 
+  // resolved objects are served without taking the XRef lock
+  if (objCache && objCache->lookup(num, gen, obj)) {
+    return obj;
+  }
+
   xrefLocker();
   // check for bogus ref - this can happen in corrupted PDF files
   if (num < 0 || num >= size) {
@@ -1230,13 +1855,7 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
       goto err;
     }
 
-    ObjectStream *objStr = NULL;
-    ObjectStreamKey key(e->offset);
-    PopplerCacheItem *item = objStrs->lookup(key);
-    if (item) {
-      ObjectStreamItem *it = static_cast<ObjectStreamItem *>(item);
-      objStr = it->objStream;
-    }
+    ObjectStream *objStr = objStrs->lookup((int)e->offset);
 
     if (!objStr) {
       objStr = new ObjectStream(this, e->offset, recursion + 1);
@@ -1247,9 +1866,7 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
       } else {
 	// XRef could be reconstructed in constructor of ObjectStream:
 	e = getEntry(num);
-	ObjectStreamKey *newkey = new ObjectStreamKey(e->offset);
-	ObjectStreamItem *newitem = new ObjectStreamItem(objStr);
-	objStrs->put(newkey, newitem);
+	objStrs->put((int)e->offset, objStr, objStr->getSize());
       }
     }
     objStr->getObject(e->gen, num, obj);
@@ -1259,7 +1876,12 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   default:
     goto err;
   }
-  
+
+  // streams carry a read position, so they can't be shared; objects
+  // parsed below the top level may have been cut at the recursion limit
+  if (objCache && recursion == 0 && !obj->isStream() && !obj->isNull()) {
+    objCache->put(num, gen, obj);
+  }
   return obj;
 
  err:
@@ -1272,6 +1894,13 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   return obj->initNull();
 }
 
+GBool XRef::getDecodedStream(Ref ref, Object *obj) {
+  if (!streamCache || !obj->isStream()) {
+    return gFalse;
+  }
+  return streamCache->getDecodedStream(ref.num, ref.gen, obj);
+}
+
 void XRef::lock() {
 #if MULTITHREADED
   gLockMutex(&mutex);
@@ -1377,6 +2006,12 @@ int XRef::getNumEntry(Goffset offset)
 
 void XRef::add(int num, int gen, Goffset offs, GBool used) {
   xrefLocker();
+  if (objCache) {
+    objCache->remove(num);
+  }
+  if (streamCache) {
+    streamCache->remove(num);
+  }
   if (num >= size) {
     if (num >= capacity) {
       entries = (XRefEntry *)greallocn(entries, num + 1, sizeof(XRefEntry));
@@ -1410,6 +2045,12 @@ void XRef::setModifiedObject (Object* o, Ref r) {
     error(errInternal, -1,"XRef::setModifiedObject on unknown ref: {0:d}, {1:d}\n", r.num, r.gen);
     return;
   }
+  if (objCache) {
+    objCache->remove(r.num);
+  }
+  if (streamCache) {
+    streamCache->remove(r.num);
+  }
   XRefEntry *e = getEntry(r.num);
   e->obj.free();
   o->copy(&(e->obj));
@@ -1454,6 +2095,12 @@ void XRef::removeIndirectObject(Ref r) {
     error(errInternal, -1,"XRef::removeIndirectObject on unknown ref: {0:d}, {1:d}\n", r.num, r.gen);
     return;
   }
+  if (objCache) {
+    objCache->remove(r.num);
+  }
+  if (streamCache) {
+    streamCache->remove(r.num);
+  }
   XRefEntry *e = getEntry(r.num);
   if (e->type == xrefEntryFree) {
     return;
@@ -1621,6 +2268,82 @@ GBool XRef::parseEntry(Goffset offset, XRefEntry *entry)
   return r;
 }
 
+// Check that object <num>, or the object stream holding it, starts
+// at the offset given by its entry.
+GBool XRef::checkObjectHeader(int num)
+{
+  XRefEntry *e;
+  GBool r;
+
+  e = &entries[num];
+  if (e->type == xrefEntryCompressed) {
+    if (e->offset >= (Guint)size) {
+      return gFalse;
+    }
+    num = (int)e->offset;
+    e = &entries[num];
+  }
+  if (e->type != xrefEntryUncompressed) {
+    return gFalse;
+  }
+
+  Object obj;
+  obj.initNull();
+  Parser parser = Parser(NULL, new Lexer(NULL,
+     str->makeSubStream(start + e->offset, gFalse, 0, &obj)), gTrue);
+
+  Object obj1, obj2, obj3;
+  r = parser.getObj(&obj1)->isInt() && obj1.getInt() == num &&
+      parser.getObj(&obj2)->isInt() && obj2.getInt() == e->gen &&
+      parser.getObj(&obj3)->isCmd("obj");
+  obj1.free();
+  obj2.free();
+  obj3.free();
+
+  return r;
+}
+
+GBool XRef::storeIndex(DocIndex *index)
+{
+  xrefLocker();
+  if (!ok || modified || !trailerDict.isDict()) {
+    return gFalse;
+  }
+
+  // read the sections that haven't been needed yet; a reconstructed
+  // table already has every object found in the file
+  if (prevXRefOffset && !numReconstructions) {
+    readXRefUntil(-1);
+    if (!ok) {
+      return gFalse;
+    }
+  }
+  if (!xRefStream && mainXRefEntriesOffset) {
+    for (int i = 0; i < size; ++i) {
+      if (entries[i].type == xrefEntryNone) {
+        parseEntry(mainXRefEntriesOffset + 20*i, &entries[i]);
+      }
+    }
+  }
+
+  index->entries.resize(size);
+  for (int i = 0; i < size; ++i) {
+    index->entries[i].offset = entries[i].offset;
+    index->entries[i].gen = entries[i].gen;
+    index->entries[i].type = entries[i].type;
+  }
+  index->setTrailer(&trailerDict);
+  index->rootNum = rootNum;
+  index->rootGen = rootGen;
+  index->xRefStream = xRefStream;
+  index->mainXRefOffset = mainXRefOffset;
+  index->mainXRefEntriesOffset = mainXRefEntriesOffset;
+  index->xrefReconstructed = xrefReconstructed;
+  index->streamEnds.assign(streamEnds, streamEnds + streamEndsLen);
+
+  return gTrue;
+}
+
 /* Traverse all XRef tables and, if untilEntryNum != -1, stop as soon as
  * untilEntryNum is found, or try to reconstruct the xref table if it's not
  * present in any xref.
@@ -41,13 +41,17 @@
 #include "goo/GooMutex.h"
 #include "Object.h"
 #include "Stream.h"
+#include "PopplerCache.h"
 
 #include <vector>
 
 class Dict;
 class Stream;
 class Parser;
-class PopplerCache;
+class ObjectStream;
+class XRefObjectCache;
+class XRefStreamCache;
+class DocIndex;
 
 //------------------------------------------------------------------------
 // XRef
@@ -100,6 +104,9 @@ public:
   XRef(Object *trailerDictA);
   // Constructor.  Read xref table from stream.
   XRef(BaseStream *strA, Goffset pos, Goffset mainXRefEntriesOffsetA = 0, GBool *wasReconstructed = NULL, GBool reconstruct = false);
+  // Constructor.  Take the xref table from a document index, checking
+  // it against the stream.
+  XRef(BaseStream *strA, DocIndex *index);
 
   // Destructor.
   ~XRef();
@@ -116,6 +123,11 @@ public:
   // Get the error code (if isOk() returns false).
   int getErrorCode() { return errCode; }
 
+  // Number of times the xref table was reconstructed because the file
+  // is damaged, and the total time spent doing it, in seconds.
+  int getNumReconstructions() { return numReconstructions; }
+  double getReconstructionTime() { return reconstructionTime; }
+
   // Set the encryption parameters.
   void setEncryption(int permFlagsA, GBool ownerPasswordOkA,
 		     Guchar *fileKeyA, int keyLengthA,
@@ -146,6 +158,14 @@ public:
   // Fetch an indirect reference.
   Object *fetch(int num, int gen, Object *obj, int recursion = 0);
 
+  // <obj> is the stream object <ref>, about to be drawn.  If the
+  // stream has been drawn before and all its filters are general
+  // purpose ones (Flate, LZW, ...), replace it with an unfiltered
+  // stream reading the decoded data from the decoded stream cache,
+  // decoding the stream into the cache first if needed.  Returns true
+  // if <obj> was replaced.
+  GBool getDecodedStream(Ref ref, Object *obj);
+
   // Return the document's Info dictionary (if any).
   Object *getDocInfo(Object *obj);
   Object *getDocInfoNF(Object *obj);
@@ -194,6 +214,10 @@ public:
   void removeIndirectObject(Ref r);
   void add(int num, int gen,  Goffset offs, GBool used);
 
+  // Read all the xref sections and store the table in <index>.
+  // Returns false if the table can't be indexed.
+  GBool storeIndex(DocIndex *index);
+
   // Output XRef table to stream
   void writeTableToFile(OutStream* outStr, GBool writeAllEntries);
   // Output XRef stream contents to GooString and fill trailerDict fields accordingly
@@ -220,7 +244,10 @@ private:
   Goffset *streamEnds;		// 'endstream' positions - only used in
 				//   damaged files
   int streamEndsLen;		// number of valid entries in streamEnds
-  PopplerCache *objStrs;	// cached object streams
+  PopplerCache<int, ObjectStream> *objStrs; // cached object streams
+  XRefObjectCache *objCache;	// cached resolved objects, can be read
+				//   without holding <mutex>
+  XRefStreamCache *streamCache;	// cached decoded image and form streams
   GBool encrypted;		// true if file is encrypted
   int encRevision;		
   int encVersion;		// encryption algorithm
@@ -235,6 +262,8 @@ private:
   Goffset mainXRefOffset;	// position of the main XRef table/stream
   GBool scannedSpecialFlags;	// true if scanSpecialFlags has been called
   GBool strOwner;     // true if str is owned by the instance
+  int numReconstructions;	// number of calls to constructXRef
+  double reconstructionTime;	// time spent in constructXRef, in seconds
 #if MULTITHREADED
   GooMutex mutex;
 #endif
@@ -248,6 +277,7 @@ private:
   GBool readXRefStream(Stream *xrefStr, Goffset *pos);
   GBool constructXRef(GBool *wasReconstructed, GBool needCatalogDict = gFalse);
   GBool parseEntry(Goffset offset, XRefEntry *entry);
+  GBool checkObjectHeader(int num);
   void readXRefUntil(int untilEntryNum, std::vector<int> *xrefStreamObjsNum = NULL);
   void markUnencrypted(Object *obj);
 
@@ -39,6 +39,7 @@
 #include "goo/gmem.h"
 #include "goo/GooLikely.h"
 #include "goo/GooList.h"
+#include "goo/GooThread.h"
 #include "poppler/Error.h"
 #include "SplashErrorCodes.h"
 #include "SplashMath.h"
@@ -51,6 +52,7 @@
 #include "SplashScreen.h"
 #include "SplashFont.h"
 #include "SplashGlyphBitmap.h"
+#include "SplashSpan.h"
 #include "Splash.h"
 #include <algorithm>
 
@@ -123,6 +125,14 @@ struct ImageSection {
 
 #define splashPipeMaxStages 9
 
+enum SplashPipeSpanKind {
+  splashPipeSpanNone,		// no span kernel: run the pipe per pixel
+  splashPipeSpanFill,		// opaque, constant color
+  splashPipeSpanComposite,	// constant color, composited
+  splashPipeSpanBlend		// constant color, with a blend function:
+				//   run by pipeRunRow
+};
+
 struct SplashPipe {
   // pixel coordinates
   int x, y;
@@ -163,6 +173,9 @@ struct SplashPipe {
 
   // the "run" function
   void (Splash::*run)(SplashPipe *pipe);
+
+  // span kernel used by drawSpan and drawAALine
+  SplashPipeSpanKind spanKind;
 };
 
 SplashPipeResultColorCtrl Splash::pipeResultColorNoAlphaBlend[] = {
@@ -340,6 +353,27 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y,
 #endif
     }
   }
+
+  // select the span kernel: it handles a constant source color without
+  // a blend function, non-isolated groups or overprint
+  pipe->spanKind = splashPipeSpanNone;
+  if (splashSpanGetImpl() != splashSpanImplNone &&
+      !pipe->pattern && !state->blendFunc &&
+      splashSpanModeSupported(bitmap->mode)
+#if SPLASH_CMYK
+      && (bitmap->mode != splashModeCMYK8 ||
+	  ((state->overprintMask & 15) == 15 && !state->overprintAdditive))
+#endif
+      ) {
+    if (pipe->noTransparency) {
+      pipe->spanKind = splashPipeSpanFill;
+    } else if (pipe->destAlphaPtr && !pipe->alpha0Ptr &&
+	       !pipe->nonIsolatedGroup) {
+      pipe->spanKind = splashPipeSpanComposite;
+    }
+  } else if (state->blendFunc && pipeRowSupported(pipe)) {
+    pipe->spanKind = splashPipeSpanBlend;
+  }
 }
 
 // general case
@@ -1321,6 +1355,355 @@ void Splash::pipeRunAADeviceN8(SplashPipe *pipe) {
 }
 #endif
 
+// Run the pipe on pixels <x0>..<x1> of row <y> with its span kernel.
+// <shape> has the shape of each pixel, or is NULL to use pipe->shape.
+// Unlike the run functions, this doesn't advance the pipe.
+inline void Splash::pipeRunSpan(SplashPipe *pipe, int x0, int x1, int y,
+				Guchar *shape) {
+  SplashSpanSrc src;
+  SplashColorPtr cSrc;
+  Guchar pixel[4];
+  int k;
+
+  if (pipe->spanKind == splashPipeSpanBlend) {
+    pipeRunRow(pipe, x0, x1, y, NULL, shape);
+    return;
+  }
+
+  pipeSetXY(pipe, x0, y);
+  cSrc = pipe->cSrc;
+
+  // the color and transfer functions, in the byte order of the bitmap
+  switch (bitmap->mode) {
+  case splashModeMono8:
+    src.color[0] = cSrc[0];
+    src.transfer[0] = state->grayTransfer;
+    break;
+  case splashModeRGB8:
+    src.color[0] = cSrc[0];
+    src.color[1] = cSrc[1];
+    src.color[2] = cSrc[2];
+    src.transfer[0] = state->rgbTransferR;
+    src.transfer[1] = state->rgbTransferG;
+    src.transfer[2] = state->rgbTransferB;
+    break;
+  case splashModeXBGR8:
+  case splashModeBGR8:
+    src.color[0] = cSrc[2];
+    src.color[1] = cSrc[1];
+    src.color[2] = cSrc[0];
+    src.transfer[0] = state->rgbTransferB;
+    src.transfer[1] = state->rgbTransferG;
+    src.transfer[2] = state->rgbTransferR;
+    break;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    src.color[0] = cSrc[0];
+    src.color[1] = cSrc[1];
+    src.color[2] = cSrc[2];
+    src.color[3] = cSrc[3];
+    src.transfer[0] = state->cmykTransferC;
+    src.transfer[1] = state->cmykTransferM;
+    src.transfer[2] = state->cmykTransferY;
+    src.transfer[3] = state->cmykTransferK;
+    break;
+#endif
+  default:
+    return;
+  }
+
+  if (pipe->spanKind == splashPipeSpanFill) {
+    // (the X byte of XBGR8 has no color or transfer function)
+    for (k = 0; k < splashColorModeNComps[bitmap->mode]; ++k) {
+      if (bitmap->mode == splashModeXBGR8 && k == 3) {
+	pixel[k] = 255;
+      } else {
+	pixel[k] = src.transfer[k][src.color[k]];
+      }
+    }
+    splashSpanFill(bitmap->mode, pipe->destColorPtr, pipe->destAlphaPtr,
+		   pixel, x1 - x0 + 1);
+  } else {
+    if (state->identityTransfer) {
+      for (k = 0; k < 4; ++k) {
+	src.transfer[k] = NULL;
+      }
+    }
+    src.aInput = pipe->aInput;
+    src.shape = pipe->usesShape ? shape : NULL;
+    src.shapeVal = pipe->usesShape ? pipe->shape : 255;
+    src.softMask = state->softMask ? pipe->softMaskPtr : NULL;
+    splashSpanComposite(bitmap->mode, &src, pipe->destColorPtr,
+			pipe->destAlphaPtr, x1 - x0 + 1);
+  }
+}
+
+// Can pipeRunRow run <pipe>?  It handles the modes of the span kernels,
+// without a pattern, non-isolated group element alpha (alpha0) or
+// knockout.
+inline GBool Splash::pipeRowSupported(SplashPipe *pipe) {
+  return splashSpanGetImpl() != splashSpanImplNone &&
+         !pipe->pattern && !pipe->alpha0Ptr && !pipe->knockout &&
+         splashSpanModeSupported(bitmap->mode)
+#if SPLASH_CMYK
+         && (bitmap->mode != splashModeCMYK8 ||
+	     ((state->overprintMask & 15) == 15 && !state->overprintAdditive))
+#endif
+         ;
+}
+
+// number of pixels pipeRunRow handles at a time
+#define splashPipeRowChunk 128
+
+// splashRecip.r[d] = (1 << 24) / d + 1: for 0 <= x <= 255 * 255,
+// (x * splashRecip.r[d]) >> 24 = x / d (and the product fits in 32
+// bits if x <= 255 * d)
+struct SplashRecipTable {
+  Guint r[256];
+  SplashRecipTable() {
+    r[0] = 0;
+    for (int d = 1; d < 256; ++d) {
+      r[d] = 0x1000000 / d + 1;
+    }
+  }
+};
+
+static SplashRecipTable splashRecip;
+
+// Run the pipe on pixels <x0>..<x1> of row <y>, with the same
+// arithmetic as pipeRun, a chunk of pixels at a time: the blend
+// function is called once per chunk.  <srcRow> has the source color
+// of each pixel, in the format of the bitmap, or is NULL to use
+// pipe->cSrc for all of them.  <shape> has the shape of each pixel, or
+// is NULL to use pipe->shape.  The pipe must be supported by
+// pipeRowSupported.  Unlike the run functions, this doesn't advance
+// the pipe.
+void Splash::pipeRunRow(SplashPipe *pipe, int x0, int x1, int y,
+			SplashColorPtr srcRow, Guchar *shape) {
+  Guchar cSrcBuf[splashPipeRowChunk * 4];
+  Guchar cDestBuf[splashPipeRowChunk * 4];
+  Guchar cBlendBuf[splashPipeRowChunk * 4];
+  Guchar aDestBuf[splashPipeRowChunk];
+  Guchar cResult[4];
+  SplashColorPtr destColorPtr, cSrc, cDest, cBlend, p, q;
+  Guchar *destAlphaPtr, *softMaskPtr, *transfer[4];
+  Guchar aSrc, aDest, aResult, shapeVal;
+  Guint m;
+  int nComps, nResult, n, i, k, t, v;
+
+  // the transfer functions, in the order of the pipe's colors
+  switch (bitmap->mode) {
+  case splashModeMono8:
+    nResult = 1;
+    transfer[0] = state->grayTransfer;
+    break;
+  case splashModeRGB8:
+  case splashModeXBGR8:
+  case splashModeBGR8:
+    nResult = 3;
+    transfer[0] = state->rgbTransferR;
+    transfer[1] = state->rgbTransferG;
+    transfer[2] = state->rgbTransferB;
+    break;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    nResult = 4;
+    transfer[0] = state->cmykTransferC;
+    transfer[1] = state->cmykTransferM;
+    transfer[2] = state->cmykTransferY;
+    transfer[3] = state->cmykTransferK;
+    break;
+#endif
+  default:
+    return;
+  }
+  nComps = splashColorModeNComps[bitmap->mode];
+
+  pipeSetXY(pipe, x0, y);
+  destColorPtr = pipe->destColorPtr;
+  destAlphaPtr = pipe->destAlphaPtr;
+  softMaskPtr = state->softMask ? pipe->softMaskPtr : NULL;
+
+  for (; x0 <= x1; x0 += n) {
+    n = x1 - x0 + 1;
+    if (n > splashPipeRowChunk) {
+      n = splashPipeRowChunk;
+    }
+
+    //----- source and destination colors, in the order of the pipe
+
+    if (bitmap->mode == splashModeBGR8 || bitmap->mode == splashModeXBGR8) {
+      for (i = 0, p = destColorPtr, q = cDestBuf; i < n;
+	   ++i, p += nComps, q += nComps) {
+	q[0] = p[2];
+	q[1] = p[1];
+	q[2] = p[0];
+	if (nComps == 4) {
+	  q[3] = 255;
+	}
+      }
+      if (srcRow) {
+	for (i = 0, p = srcRow, q = cSrcBuf; i < n;
+	     ++i, p += nComps, q += nComps) {
+	  q[0] = p[2];
+	  q[1] = p[1];
+	  q[2] = p[0];
+	  if (nComps == 4) {
+	    q[3] = p[3];
+	  }
+	}
+      }
+    } else {
+      memcpy(cDestBuf, destColorPtr, n * nComps);
+      if (srcRow) {
+	memcpy(cSrcBuf, srcRow, n * nComps);
+      }
+    }
+    if (!srcRow) {
+      for (i = 0, q = cSrcBuf; i < n; ++i, q += nComps) {
+	memcpy(q, pipe->cSrc, nComps);
+      }
+    }
+    if (destAlphaPtr) {
+      memcpy(aDestBuf, destAlphaPtr, n);
+    } else {
+      memset(aDestBuf, 0xff, n);
+    }
+
+    //----- non-isolated group correction
+
+    if (pipe->nonIsolatedGroup) {
+      // as in pipeRun, the shape is the source (group) alpha
+      for (i = 0; i < n; ++i) {
+	shapeVal = shape ? shape[i] : pipe->shape;
+	if (shapeVal == 0) {
+	  continue;
+	}
+	aDest = aDestBuf[i];
+	t = (int)(((unsigned long long)(aDest * 255) * splashRecip.r[shapeVal])
+		  >> 24) - aDest;
+	cSrc = cSrcBuf + i * nComps;
+	cDest = cDestBuf + i * nComps;
+	for (k = 0; k < nResult; ++k) {
+	  cSrc[k] = clip255(cSrc[k] + ((cSrc[k] - cDest[k]) * t) / 255);
+	}
+	if (nComps > nResult) {
+	  cSrc[3] = 255;
+	}
+      }
+    }
+
+    //----- blend function
+
+    if (state->blendFunc) {
+      if (state->blendRowFunc) {
+	(*state->blendRowFunc)(cSrcBuf, cDestBuf, cBlendBuf, n,
+			       bitmap->mode);
+      } else {
+	for (i = 0; i < n; ++i) {
+	  (*state->blendFunc)(cSrcBuf + i * nComps, cDestBuf + i * nComps,
+			      cBlendBuf + i * nComps, bitmap->mode);
+	}
+      }
+    }
+
+    //----- result alpha and color
+
+    for (i = 0; i < n; ++i) {
+      cSrc = cSrcBuf + i * nComps;
+      cDest = cDestBuf + i * nComps;
+      cBlend = cBlendBuf + i * nComps;
+      aDest = aDestBuf[i];
+      shapeVal = shape ? shape[i] : pipe->shape;
+      if (softMaskPtr) {
+	if (pipe->usesShape) {
+	  aSrc = div255(div255(pipe->aInput * softMaskPtr[i]) * shapeVal);
+	} else {
+	  aSrc = div255(pipe->aInput * softMaskPtr[i]);
+	}
+      } else if (pipe->usesShape) {
+	aSrc = div255(pipe->aInput * shapeVal);
+      } else {
+	aSrc = pipe->aInput;
+      }
+
+      if (pipe->noTransparency) {
+	// (only with a blend function)
+	aResult = 255;
+	for (k = 0; k < nResult; ++k) {
+	  cResult[k] = transfer[k][div255((255 - aDest) * cSrc[k] +
+					  aDest * cBlend[k])];
+	}
+      } else {
+	// alphaI = aResult and alphaIm1 = aDest
+	aResult = aSrc + aDest - div255(aSrc * aDest);
+	if (aSrc == 0 && aDest != 0 && state->identityTransfer) {
+	  // the result is the destination pixel
+	  if (nComps > nResult) {
+	    destColorPtr[i * nComps + 3] = 255;
+	  }
+	  continue;
+	}
+	if (aResult == 0) {
+	  for (k = 0; k < nResult; ++k) {
+	    cResult[k] = 0;
+	  }
+	} else {
+	  // the sums below are at most 255 * aResult
+	  m = splashRecip.r[aResult];
+	  if (state->blendFunc) {
+	    for (k = 0; k < nResult; ++k) {
+	      v = (aSrc * ((255 - aDest) * cSrc[k] + aDest * cBlend[k])) / 255;
+	      cResult[k] = transfer[k][(((aResult - aSrc) * cDest[k] + v) * m)
+				       >> 24];
+	    }
+	  } else {
+	    for (k = 0; k < nResult; ++k) {
+	      cResult[k] = transfer[k][(((aResult - aSrc) * cDest[k] +
+					 aSrc * cSrc[k]) * m) >> 24];
+	    }
+	  }
+	}
+      }
+
+      //----- write destination pixel
+
+      p = destColorPtr + i * nComps;
+      switch (bitmap->mode) {
+      case splashModeXBGR8:
+	p[3] = 255;
+      case splashModeBGR8:
+	p[0] = cResult[2];
+	p[1] = cResult[1];
+	p[2] = cResult[0];
+	break;
+      default:
+	for (k = 0; k < nResult; ++k) {
+	  p[k] = cResult[k];
+	}
+	break;
+      }
+      if (destAlphaPtr) {
+	destAlphaPtr[i] = aResult;
+      }
+    }
+
+    destColorPtr += n * nComps;
+    if (destAlphaPtr) {
+      destAlphaPtr += n;
+    }
+    if (softMaskPtr) {
+      softMaskPtr += n;
+    }
+    if (srcRow) {
+      srcRow += n * nComps;
+    }
+    if (shape) {
+      shape += n;
+    }
+  }
+}
+
 inline void Splash::pipeSetXY(SplashPipe *pipe, int x, int y) {
   pipe->x = x;
   pipe->y = y;
@@ -1481,12 +1864,16 @@ inline void Splash::drawAAPixel(SplashPipe *pipe, int x, int y) {
 
 inline void Splash::drawSpan(SplashPipe *pipe, int x0, int x1, int y,
 			     GBool noClip) {
-  int x;
+  int x, xRun;
 
   if (noClip) {
-    pipeSetXY(pipe, x0, y);
-    for (x = x0; x <= x1; ++x) {
-      (this->*pipe->run)(pipe);
+    if (pipe->spanKind != splashPipeSpanNone) {
+      pipeRunSpan(pipe, x0, x1, y, NULL);
+    } else {
+      pipeSetXY(pipe, x0, y);
+      for (x = x0; x <= x1; ++x) {
+	(this->*pipe->run)(pipe);
+      }
     }
     updateModX(x0);
     updateModX(x1);
@@ -1498,6 +1885,25 @@ inline void Splash::drawSpan(SplashPipe *pipe, int x0, int x1, int y,
     if (x1 > state->clip->getXMaxI()) {
       x1 = state->clip->getXMaxI();
     }
+    if (pipe->spanKind != splashPipeSpanNone) {
+      // run the span kernel on each run of pixels inside the clip
+      x = x0;
+      while (x <= x1) {
+	if (!state->clip->test(x, y)) {
+	  ++x;
+	  continue;
+	}
+	xRun = x;
+	do {
+	  ++x;
+	} while (x <= x1 && state->clip->test(x, y));
+	pipeRunSpan(pipe, xRun, x - 1, y, NULL);
+	updateModX(xRun);
+	updateModX(x - 1);
+	updateModY(y);
+      }
+      return;
+    }
     pipeSetXY(pipe, x0, y);
     for (x = x0; x <= x1; ++x) {
       if (state->clip->test(x, y)) {
@@ -1521,7 +1927,9 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool ad
   SplashColorPtr p;
   int xx, yy, t;
 #endif
-  int x;
+  GBool useSpan;
+  Guchar shape;
+  int x, xRun;
 
 #if splashAASize == 4
   p0 = aaBuf->getDataPtr() + (x0 >> 1);
@@ -1529,6 +1937,10 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool ad
   p2 = p1 + aaBuf->getRowSize();
   p3 = p2 + aaBuf->getRowSize();
 #endif
+  // with a span kernel, the shapes are collected in aaShape, and each
+  // run of covered pixels is drawn at once
+  useSpan = pipe->spanKind != splashPipeSpanNone && aaShape;
+  xRun = -1;
   pipeSetXY(pipe, x0, y);
   for (x = x0; x <= x1; ++x) {
 
@@ -1554,14 +1966,81 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool ad
 #endif
 
     if (t != 0) {
-      pipe->shape = (adjustLine) ? div255((int) lineOpacity * (double)aaGamma[t]) : (double)aaGamma[t];
-      (this->*pipe->run)(pipe);
-      updateModX(x);
-      updateModY(y);
+      shape = (adjustLine) ? div255((int) lineOpacity * (double)aaGamma[t]) : (double)aaGamma[t];
+      if (useSpan) {
+	if (xRun < 0) {
+	  xRun = x;
+	}
+	aaShape[x - x0] = shape;
+      } else {
+	pipe->shape = shape;
+	(this->*pipe->run)(pipe);
+	updateModX(x);
+	updateModY(y);
+      }
+    } else if (useSpan) {
+      if (xRun >= 0) {
+	pipeRunSpan(pipe, xRun, x - 1, y, aaShape + (xRun - x0));
+	updateModX(xRun);
+	updateModX(x - 1);
+	updateModY(y);
+	xRun = -1;
+      }
     } else {
       pipeIncX(pipe);
     }
   }
+  if (xRun >= 0) {
+    pipeRunSpan(pipe, xRun, x1, y, aaShape + (xRun - x0));
+    updateModX(xRun);
+    updateModX(x1);
+    updateModY(y);
+  }
+}
+
+// Like drawAALine, but with the exact coverage values in aaCoverage
+// (splashAAAnalytic).
+inline void Splash::drawAACoverageLine(SplashPipe *pipe, int x0, int x1,
+				       int y) {
+  GBool useSpan;
+  Guchar c;
+  int x, xRun;
+
+  useSpan = pipe->spanKind != splashPipeSpanNone && aaShape;
+  xRun = -1;
+  pipeSetXY(pipe, x0, y);
+  for (x = x0; x <= x1; ++x) {
+    c = aaCoverage[x];
+    if (c != 0) {
+      if (useSpan) {
+	if (xRun < 0) {
+	  xRun = x;
+	}
+	aaShape[x - x0] = aaCoverageGamma[c];
+      } else {
+	pipe->shape = aaCoverageGamma[c];
+	(this->*pipe->run)(pipe);
+	updateModX(x);
+	updateModY(y);
+      }
+    } else if (useSpan) {
+      if (xRun >= 0) {
+	pipeRunSpan(pipe, xRun, x - 1, y, aaShape + (xRun - x0));
+	updateModX(xRun);
+	updateModX(x - 1);
+	updateModY(y);
+	xRun = -1;
+      }
+    } else {
+      pipeIncX(pipe);
+    }
+  }
+  if (xRun >= 0) {
+    pipeRunSpan(pipe, xRun, x1, y, aaShape + (xRun - x0));
+    updateModX(xRun);
+    updateModX(x1);
+    updateModY(y);
+  }
 }
 
 //------------------------------------------------------------------------
@@ -1593,6 +2072,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   if (vectorAntialias) {
     aaBuf = new SplashBitmap(splashAASize * bitmap->width, splashAASize,
 			     1, splashModeMono1, gFalse);
+    aaShape = (Guchar *)gmalloc(bitmap->width);
     for (i = 0; i <= splashAASize * splashAASize; ++i) {
       aaGamma[i] = (Guchar)splashRound(
 		       splashPow((SplashCoord)i /
@@ -1601,9 +2081,16 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
     }
   } else {
     aaBuf = NULL;
+    aaShape = NULL;
   }
   minLineWidth = 0;
   thinLineMode = splashThinLineDefault;
+  numThreads = 1;
+  aaMode = splashAASupersample;
+  aaAccum = NULL;
+  aaCoverage = NULL;
+  aaClipCoverage = NULL;
+  aaCoverageGamma = NULL;
   clearModRegion();
   debugMode = gFalse;
   alpha0Bitmap = NULL;
@@ -1621,6 +2108,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   if (vectorAntialias) {
     aaBuf = new SplashBitmap(splashAASize * bitmap->width, splashAASize,
 			     1, splashModeMono1, gFalse);
+    aaShape = (Guchar *)gmalloc(bitmap->width);
     for (i = 0; i <= splashAASize * splashAASize; ++i) {
       aaGamma[i] = (Guchar)splashRound(
 		       splashPow((SplashCoord)i /
@@ -1629,9 +2117,16 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
     }
   } else {
     aaBuf = NULL;
+    aaShape = NULL;
   }
   minLineWidth = 0;
   thinLineMode = splashThinLineDefault;
+  numThreads = 1;
+  aaMode = splashAASupersample;
+  aaAccum = NULL;
+  aaCoverage = NULL;
+  aaClipCoverage = NULL;
+  aaCoverageGamma = NULL;
   clearModRegion();
   debugMode = gFalse;
   alpha0Bitmap = NULL;
@@ -1643,6 +2138,11 @@ Splash::~Splash() {
   }
   delete state;
   delete aaBuf;
+  gfree(aaShape);
+  gfree(aaAccum);
+  gfree(aaCoverage);
+  gfree(aaClipCoverage);
+  gfree(aaCoverageGamma);
 }
 
 //------------------------------------------------------------------------
@@ -1745,8 +2245,9 @@ void Splash::setScreen(SplashScreen *screen) {
   state->setScreen(screen);
 }
 
-void Splash::setBlendFunc(SplashBlendFunc func) {
+void Splash::setBlendFunc(SplashBlendFunc func, SplashBlendRowFunc rowFunc) {
   state->blendFunc = func;
+  state->blendRowFunc = func ? rowFunc : NULL;
 }
 
 void Splash::setStrokeAlpha(SplashCoord alpha) {
@@ -1819,6 +2320,10 @@ void Splash::clipResetToRect(SplashCoord x0, SplashCoord y0,
   state->clip->resetToRect(x0, y0, x1, y1);
 }
 
+void Splash::setBand(int yMin, int yMax) {
+  state->clip->setBand(yMin, yMax);
+}
+
 SplashError Splash::clipToRect(SplashCoord x0, SplashCoord y0,
 			       SplashCoord x1, SplashCoord y1) {
   return state->clip->clipToRect(x0, y0, x1, y1);
@@ -1850,6 +2355,24 @@ void Splash::setOverprintMask(Guint overprintMask, GBool additive) {
   state->overprintAdditive = additive;
 }
 
+void Splash::setAAMode(SplashAAMode aaModeA) {
+  int i;
+
+  aaMode = aaModeA;
+  if (aaMode == splashAAAnalytic && !aaAccum) {
+    aaAccum = (SplashCoord *)gmallocn(bitmap->width + 2, sizeof(SplashCoord));
+    memset(aaAccum, 0, (bitmap->width + 2) * sizeof(SplashCoord));
+    aaCoverage = (Guchar *)gmalloc(bitmap->width);
+    aaClipCoverage = (Guchar *)gmalloc(bitmap->width);
+    aaCoverageGamma = (Guchar *)gmalloc(256);
+    for (i = 0; i < 256; ++i) {
+      aaCoverageGamma[i] = (Guchar)splashRound(
+			       splashPow((SplashCoord)i / 255,
+					 splashAAGamma) * 255);
+    }
+  }
+}
+
 //------------------------------------------------------------------------
 // state save/restore
 //------------------------------------------------------------------------
@@ -2463,8 +2986,9 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
   SplashPipe pipe;
   SplashXPath *xPath;
   SplashXPathScanner *scanner;
-  int xMinI, yMinI, xMaxI, yMaxI, x0, x1, y;
+  int xMinI, yMinI, xMaxI, yMaxI, yMinB, yMaxB, x0, x1, y;
   SplashClipResult clipRes, clipRes2;
+  SplashCoord rxMin, ryMin, rxMax, ryMax;
   GBool adjustLine = gFalse; 
   int linePosI = 0;
 
@@ -2517,6 +3041,16 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
 
   xPath = new SplashXPath(path, state->matrix, state->flatness, gTrue, 
     adjustLine, linePosI);
+
+  // axis-aligned rectangles (table cells, rules, bars) don't need the
+  // scanner
+  if (thinLineMode == splashThinLineDefault &&
+      xPath->isRect(&rxMin, &ryMin, &rxMax, &ryMax) &&
+      fillRect(rxMin, ryMin, rxMax, ryMax, pattern, alpha)) {
+    delete xPath;
+    return splashOk;
+  }
+
   if (vectorAntialias && !inShading) {
     xPath->aaScale();
   }
@@ -2558,9 +3092,32 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
     pipeInit(&pipe, 0, yMinI, pattern, NULL, (Guchar)splashRound(alpha * 255),
 	     vectorAntialias && !inShading, gFalse);
 
+    // skip the rows outside the band
+    yMinB = yMinI;
+    if (yMinB < state->clip->getBandYMin()) {
+      yMinB = state->clip->getBandYMin();
+    }
+    yMaxB = yMaxI;
+    if (yMaxB > state->clip->getBandYMax()) {
+      yMaxB = state->clip->getBandYMax();
+    }
+
     // draw the spans
-    if (vectorAntialias && !inShading) {
-      for (y = yMinI; y <= yMaxI; ++y) {
+    if (vectorAntialias && !inShading && aaMode == splashAAAnalytic &&
+	thinLineMode == splashThinLineDefault) {
+      for (y = yMinB; y <= yMaxB; ++y) {
+	scanner->renderAACoverageLine(aaAccum, aaCoverage, bitmap->width,
+				      &x0, &x1, y);
+	if (clipRes != splashClipAllInside && x0 <= x1) {
+	  state->clip->clipAACoverageLine(aaAccum, aaCoverage,
+					  aaClipCoverage, &x0, &x1, y);
+	}
+	if (x0 <= x1) {
+	  drawAACoverageLine(&pipe, x0, x1, y);
+	}
+      }
+    } else if (vectorAntialias && !inShading) {
+      for (y = yMinB; y <= yMaxB; ++y) {
 	scanner->renderAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
 	if (clipRes != splashClipAllInside) {
 	  state->clip->clipAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
@@ -2578,7 +3135,7 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
 	drawAALine(&pipe, x0, x1, y, adjustLine, lineShape);
       }
     } else {
-      for (y = yMinI; y <= yMaxI; ++y) {
+      for (y = yMinB; y <= yMaxB; ++y) {
 	while (scanner->getNextSpan(y, &x0, &x1)) {
 	  if (clipRes == splashClipAllInside) {
 	    drawSpan(&pipe, x0, x1, y, gTrue);
@@ -2604,6 +3161,177 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
   return splashOk;
 }
 
+// Fill the rectangle [<xMinA>, <xMaxA>] x [<yMinA>, <yMaxA>], in
+// device space.  The pixels, and the anti-aliasing shapes, are those
+// the scanner computes for the rectangle, without the intersection
+// lists and the aaBuf bitmap: each row (or row of subpixels) is a
+// single span, and each pixel shape is the number of subpixel rows
+// times the number of subpixel columns covered.  Returns false, to
+// leave the fill to the scanner, with analytic anti-aliasing, and with
+// anti-aliasing if the clip has paths.
+GBool Splash::fillRect(SplashCoord xMinA, SplashCoord yMinA,
+		       SplashCoord xMaxA, SplashCoord yMaxA,
+		       SplashPattern *pattern, SplashCoord alpha) {
+  SplashPipe pipe;
+  SplashClipResult clipRes, clipRes2;
+  GBool aa, partialClip;
+  int xMinI, yMinI, xMaxI, yMaxI, yMinB, yMaxB;
+  int xx0, yy0, xx1, yy1, x0, x1, y, yy, nRows, t, x;
+
+  aa = vectorAntialias && !inShading;
+  if (aa && (aaMode == splashAAAnalytic || !aaShape ||
+	     state->clip->getNumPaths() > 0)) {
+    return gFalse;
+  }
+
+  // the (subpixel, with anti-aliasing) rows and columns covered,
+  // clipped vertically like in the scanner
+  if (aa) {
+    xMinA *= splashAASize;
+    yMinA *= splashAASize;
+    xMaxA *= splashAASize;
+    yMaxA *= splashAASize;
+  }
+  xx0 = splashFloor(xMinA);
+  yy0 = splashFloor(yMinA);
+  xx1 = splashFloor(xMaxA);
+  yy1 = splashFloor(yMaxA);
+  partialClip = gFalse;
+  if (aa) {
+    y = state->clip->getYMinI() * splashAASize;
+  } else {
+    y = state->clip->getYMinI();
+  }
+  if (y > yy0) {
+    yy0 = y;
+    partialClip = gTrue;
+  }
+  if (aa) {
+    y = (state->clip->getYMaxI() + 1) * splashAASize - 1;
+  } else {
+    y = state->clip->getYMaxI();
+  }
+  if (y < yy1) {
+    yy1 = y;
+    partialClip = gTrue;
+  }
+  if (aa) {
+    xMinI = xx0 / splashAASize;
+    yMinI = yy0 / splashAASize;
+    xMaxI = xx1 / splashAASize;
+    yMaxI = yy1 / splashAASize;
+  } else {
+    xMinI = xx0;
+    yMinI = yy0;
+    xMaxI = xx1;
+    yMaxI = yy1;
+  }
+
+  // check clipping
+  if ((clipRes = state->clip->testRect(xMinI, yMinI, xMaxI, yMaxI))
+      != splashClipAllOutside) {
+    if (partialClip) {
+      clipRes = splashClipPartial;
+    }
+
+    pipeInit(&pipe, 0, yMinI, pattern, NULL, (Guchar)splashRound(alpha * 255),
+	     aa, gFalse);
+
+    // skip the rows outside the band
+    yMinB = yMinI;
+    if (yMinB < state->clip->getBandYMin()) {
+      yMinB = state->clip->getBandYMin();
+    }
+    yMaxB = yMaxI;
+    if (yMaxB > state->clip->getBandYMax()) {
+      yMaxB = state->clip->getBandYMax();
+    }
+
+    if (aa) {
+      // the subpixel columns covered, limited to the bitmap and (as
+      // clipAALine does) to the clip rectangle
+      if (xx0 < 0) {
+	xx0 = 0;
+      }
+      ++xx1;
+      if (xx1 > aaBuf->getWidth()) {
+	xx1 = aaBuf->getWidth();
+      }
+      if (clipRes != splashClipAllInside) {
+	x = splashFloor(state->clip->getXMin() * splashAASize);
+	if (xx0 < x) {
+	  xx0 = x;
+	}
+	x = splashFloor(state->clip->getXMax() * splashAASize) + 1;
+	if (xx1 > x) {
+	  xx1 = x;
+	}
+      }
+      if (xx0 < xx1) {
+	x0 = xx0 / splashAASize;
+	x1 = (xx1 - 1) / splashAASize;
+	for (y = yMinB; y <= yMaxB; ++y) {
+	  nRows = 0;
+	  for (yy = 0; yy < splashAASize; ++yy) {
+	    if (splashAASize * y + yy >= yy0 && splashAASize * y + yy <= yy1) {
+	      ++nRows;
+	    }
+	  }
+	  if (nRows == 0) {
+	    continue;
+	  }
+	  for (x = x0; x <= x1; ++x) {
+	    t = splashAASize;
+	    if (x == x0) {
+	      t -= xx0 - x0 * splashAASize;
+	    }
+	    if (x == x1) {
+	      t -= (x1 + 1) * splashAASize - xx1;
+	    }
+	    aaShape[x - x0] = aaGamma[nRows * t];
+	  }
+	  if (pipe.spanKind != splashPipeSpanNone) {
+	    pipeRunSpan(&pipe, x0, x1, y, aaShape);
+	    updateModX(x0);
+	    updateModX(x1);
+	    updateModY(y);
+	  } else {
+	    pipeSetXY(&pipe, x0, y);
+	    for (x = x0; x <= x1; ++x) {
+	      pipe.shape = aaShape[x - x0];
+	      (this->*pipe.run)(&pipe);
+	      updateModX(x);
+	      updateModY(y);
+	    }
+	  }
+	}
+      }
+
+    } else {
+      for (y = yMinB; y <= yMaxB; ++y) {
+	if (clipRes == splashClipAllInside) {
+	  drawSpan(&pipe, xx0, xx1, y, gTrue);
+	} else {
+	  // limit the x range
+	  x0 = xx0;
+	  if (x0 < state->clip->getXMinI()) {
+	    x0 = state->clip->getXMinI();
+	  }
+	  x1 = xx1;
+	  if (x1 > state->clip->getXMaxI()) {
+	    x1 = state->clip->getXMaxI();
+	  }
+	  clipRes2 = state->clip->testSpan(x0, x1, y);
+	  drawSpan(&pipe, x0, x1, y, clipRes2 == splashClipAllInside);
+	}
+      }
+    }
+  }
+  opClipRes = clipRes;
+
+  return gTrue;
+}
+
 GBool Splash::pathAllOutside(SplashPath *path) {
   SplashCoord xMin1, yMin1, xMax1, yMax1;
   SplashCoord xMin2, yMin2, xMax2, yMax2;
@@ -2667,7 +3395,14 @@ GBool Splash::pathAllOutside(SplashPath *path) {
   xMaxI = splashFloor(xMax2);
   yMaxI = splashFloor(yMax2);
 
-  return state->clip->testRect(xMinI, yMinI, xMaxI, yMaxI) ==
+  // stroke adjustment can still move the edges by a pixel or so, so
+  // leave some slack around the band (drawing is clipped to the band
+  // anyway)
+  if (yMax2 + 2 < state->clip->getBandYMin() ||
+      yMin2 - 3 > state->clip->getBandYMax()) {
+    return gTrue;
+  }
+  return state->clip->testRect(xMinI, yMinI, xMaxI, yMaxI, gFalse) ==
          splashClipAllOutside;
 }
 
@@ -2678,6 +3413,7 @@ SplashError Splash::xorFill(SplashPath *path, GBool eo) {
   int xMinI, yMinI, xMaxI, yMaxI, x0, x1, y;
   SplashClipResult clipRes, clipRes2;
   SplashBlendFunc origBlendFunc;
+  SplashBlendRowFunc origBlendRowFunc;
 
   if (path->length == 0) {
     return splashErrEmptyPath;
@@ -2698,7 +3434,9 @@ SplashError Splash::xorFill(SplashPath *path, GBool eo) {
     }
 
     origBlendFunc = state->blendFunc;
+    origBlendRowFunc = state->blendRowFunc;
     state->blendFunc = &blendXor;
+    state->blendRowFunc = NULL;
     pipeInit(&pipe, 0, yMinI, state->fillPattern, NULL, 255, gFalse, gFalse);
 
     // draw the spans
@@ -2720,6 +3458,7 @@ SplashError Splash::xorFill(SplashPath *path, GBool eo) {
       }
     }
     state->blendFunc = origBlendFunc;
+    state->blendRowFunc = origBlendRowFunc;
   }
   opClipRes = clipRes;
 
@@ -3261,6 +4000,399 @@ void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
 }
 
 // Scale an image mask into a SplashBitmap.
+//------------------------------------------------------------------------
+// image scaling
+//------------------------------------------------------------------------
+
+// Images and masks are scaled one block of source rows at a time: the
+// rows are read, in order, from the image source into a buffer (the
+// source is a stream, so this can't be split up), and the destination
+// rows which only depend on the buffered rows are then computed by up
+// to Splash::numThreads threads, while the next block is being read.
+//
+// The work of each scaler is split into units -- a destination row
+// when rows are added up or interpolated, a source row when it is
+// replicated -- and unit <u> uses source rows firstRow[u] ..
+// lastRow[u], which never decrease with <u>, and leave no row out.
+
+// max size of a block of source rows, in bytes
+#define splashScaleBlockSize (1 << 20)
+
+// images with fewer source + destination bytes are scaled on a single
+// thread
+#define splashScaleMinThreadedSize (1 << 20)
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define SPLASH_SCALE_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+struct SplashScaler;
+
+typedef void (*SplashScaleUnitsFunc)(SplashScaler *sc, int u0, int u1);
+
+struct SplashScaler {
+  SplashImageSource src;	// image source, or
+  SplashImageMaskSource maskSrc; //   mask source
+  void *srcData;
+  SplashColorMode srcMode;
+  int nComps;
+  GBool srcAlpha;
+  int srcWidth, srcHeight;
+  int scaledWidth, scaledHeight;
+  SplashBitmap *dest;
+
+  int nUnits;
+  int *firstRow, *lastRow;	// source rows used by each unit
+  int *destRow;			// first destination row of each unit
+				//   (and of unit nUnits), when source
+				//   rows are replicated
+  double *yFrac;		// weight of lastRow[u], when rows are
+				//   interpolated
+  SplashScaleUnitsFunc scaleUnits;
+
+  // the block of source rows being scaled
+  Guchar *lines;		// color rows, lineSize bytes apart
+  Guchar *alphaLines;		// alpha rows, srcWidth + 1 bytes apart
+  int lineSize;			// (srcWidth + 1) * nComps -- each row
+				//   is padded with a copy of its last
+				//   pixel
+  int row0;			// source row at the start of the buffer
+  int nextRow;			// next source row to be read
+};
+
+static void initScaler(SplashScaler *sc,
+		       SplashImageSource src, SplashImageMaskSource maskSrc,
+		       void *srcData, SplashColorMode srcMode, int nComps,
+		       GBool srcAlpha, int srcWidth, int srcHeight,
+		       int scaledWidth, int scaledHeight, SplashBitmap *dest) {
+  sc->src = src;
+  sc->maskSrc = maskSrc;
+  sc->srcData = srcData;
+  sc->srcMode = srcMode;
+  sc->nComps = nComps;
+  sc->srcAlpha = srcAlpha;
+  sc->srcWidth = srcWidth;
+  sc->srcHeight = srcHeight;
+  sc->scaledWidth = scaledWidth;
+  sc->scaledHeight = scaledHeight;
+  sc->dest = dest;
+  sc->nUnits = 0;
+  sc->firstRow = sc->lastRow = sc->destRow = NULL;
+  sc->yFrac = NULL;
+  sc->scaleUnits = NULL;
+  sc->lines = sc->alphaLines = NULL;
+  sc->lineSize = (srcWidth + 1) * nComps;
+  sc->row0 = sc->nextRow = 0;
+}
+
+static void freeScaler(SplashScaler *sc) {
+  gfree(sc->firstRow);
+  gfree(sc->lastRow);
+  gfree(sc->destRow);
+  gfree(sc->yFrac);
+}
+
+// One unit per destination row, which adds up the next yStep source
+// rows (Bresenham).
+static void setScalerRowsDown(SplashScaler *sc) {
+  int yp, yq, yt, y, yStep, row;
+
+  yp = sc->srcHeight / sc->scaledHeight;
+  yq = sc->srcHeight % sc->scaledHeight;
+  sc->nUnits = sc->scaledHeight;
+  sc->firstRow = (int *)gmallocn(sc->nUnits, sizeof(int));
+  sc->lastRow = (int *)gmallocn(sc->nUnits, sizeof(int));
+  yt = 0;
+  row = 0;
+  for (y = 0; y < sc->scaledHeight; ++y) {
+    if ((yt += yq) >= sc->scaledHeight) {
+      yt -= sc->scaledHeight;
+      yStep = yp + 1;
+    } else {
+      yStep = yp;
+    }
+    sc->firstRow[y] = row;
+    row += yStep;
+    sc->lastRow[y] = row - 1;
+  }
+}
+
+// One unit per source row, which is replicated into the next yStep
+// destination rows (Bresenham).
+static void setScalerRowsUp(SplashScaler *sc) {
+  int yp, yq, yt, y, yStep;
+
+  yp = sc->scaledHeight / sc->srcHeight;
+  yq = sc->scaledHeight % sc->srcHeight;
+  sc->nUnits = sc->srcHeight;
+  sc->firstRow = (int *)gmallocn(sc->nUnits, sizeof(int));
+  sc->lastRow = (int *)gmallocn(sc->nUnits, sizeof(int));
+  sc->destRow = (int *)gmallocn(sc->nUnits + 1, sizeof(int));
+  yt = 0;
+  sc->destRow[0] = 0;
+  for (y = 0; y < sc->srcHeight; ++y) {
+    if ((yt += yq) >= sc->srcHeight) {
+      yt -= sc->srcHeight;
+      yStep = yp + 1;
+    } else {
+      yStep = yp;
+    }
+    sc->firstRow[y] = sc->lastRow[y] = y;
+    sc->destRow[y + 1] = sc->destRow[y] + yStep;
+  }
+}
+
+// Return the number of the first unit after <u0> which doesn't fit in
+// a block of <blockRows> rows starting with the rows of <u0>.
+static int getScalerBlockEnd(SplashScaler *sc, int u0, int blockRows) {
+  int u;
+
+  for (u = u0 + 1;
+       u < sc->nUnits && sc->lastRow[u] - sc->firstRow[u0] < blockRows;
+       ++u) ;
+  return u;
+}
+
+// Read source rows <row0> .. <row1> into <lines> and <alphaLines>.
+// The rows which were already read are copied from the current block.
+static void readScalerBlock(SplashScaler *sc, int row0, int row1,
+			    Guchar *lines, Guchar *alphaLines) {
+  Guchar *line, *alphaLine, *prevLine, *prevAlphaLine;
+  int alphaLineSize, row, i;
+
+  alphaLineSize = sc->srcWidth + 1;
+  for (row = row0; row <= row1; ++row) {
+    line = lines + (size_t)(row - row0) * sc->lineSize;
+    alphaLine = sc->srcAlpha
+                  ? alphaLines + (size_t)(row - row0) * alphaLineSize
+                  : NULL;
+    if (row < sc->nextRow) {
+      memcpy(line, sc->lines + (size_t)(row - sc->row0) * sc->lineSize,
+	     sc->lineSize);
+      if (sc->srcAlpha) {
+	memcpy(alphaLine,
+	       sc->alphaLines + (size_t)(row - sc->row0) * alphaLineSize,
+	       alphaLineSize);
+      }
+      continue;
+    }
+
+    // the interpolating scaler reads one row past the end of the
+    // image, which the source may leave untouched: start with the
+    // previous row, as if a single row buffer was reused
+    if (row >= sc->srcHeight) {
+      if (row > row0) {
+	prevLine = line - sc->lineSize;
+	prevAlphaLine = alphaLine ? alphaLine - alphaLineSize : NULL;
+      } else {
+	prevLine = sc->lines + (size_t)(row - 1 - sc->row0) * sc->lineSize;
+	prevAlphaLine = sc->srcAlpha
+	                  ? sc->alphaLines +
+	                      (size_t)(row - 1 - sc->row0) * alphaLineSize
+	                  : NULL;
+      }
+      memcpy(line, prevLine, sc->lineSize);
+      if (prevAlphaLine) {
+	memcpy(alphaLine, prevAlphaLine, alphaLineSize);
+      }
+    }
+
+    if (sc->maskSrc) {
+      (*sc->maskSrc)(sc->srcData, line);
+    } else {
+      (*sc->src)(sc->srcData, line, alphaLine);
+    }
+    for (i = 0; i < sc->nComps; ++i) {
+      line[sc->srcWidth * sc->nComps + i] =
+	  line[(sc->srcWidth - 1) * sc->nComps + i];
+    }
+    if (alphaLine) {
+      alphaLine[sc->srcWidth] = alphaLine[sc->srcWidth - 1];
+    }
+  }
+  sc->nextRow = row1 + 1;
+}
+
+struct SplashScaleJobs {
+  SplashScaler *sc;
+  int u0, u1;			// units being scaled
+  int nSlices;			// number of jobs they are split into
+  GBool readNext;		// true if job 0 reads the next block
+  int nextRow0, nextRow1;	// rows of the next block
+  Guchar *nextLines, *nextAlphaLines;
+};
+
+static void runScalerJob(int job, void *data) {
+  SplashScaleJobs *jobs = (SplashScaleJobs *)data;
+  int n, u0, u1;
+
+  if (jobs->readNext) {
+    if (job == 0) {
+      readScalerBlock(jobs->sc, jobs->nextRow0, jobs->nextRow1,
+		      jobs->nextLines, jobs->nextAlphaLines);
+      return;
+    }
+    --job;
+  }
+  n = jobs->u1 - jobs->u0;
+  u0 = jobs->u0 + (int)(((long long)n * job) / jobs->nSlices);
+  u1 = jobs->u0 + (int)(((long long)n * (job + 1)) / jobs->nSlices);
+  if (u0 < u1) {
+    (*jobs->sc->scaleUnits)(jobs->sc, u0, u1);
+  }
+}
+
+// Read the source and scale all the units of <sc>, using up to
+// <nThreads> threads.
+static void runScaler(SplashScaler *sc, int nThreads) {
+  SplashScaleJobs jobs;
+  Guchar *lines[2], *alphaLines[2];
+  int alphaLineSize, nRows, maxRows, blockRows, cur, u2, u;
+
+  if (sc->nUnits < 1) {
+    return;
+  }
+  alphaLineSize = sc->srcWidth + 1;
+  nRows = sc->lastRow[sc->nUnits - 1] + 1;
+  maxRows = 1;
+  for (u = 0; u < sc->nUnits; ++u) {
+    if (sc->lastRow[u] - sc->firstRow[u] + 1 > maxRows) {
+      maxRows = sc->lastRow[u] - sc->firstRow[u] + 1;
+    }
+  }
+  blockRows = splashScaleBlockSize /
+              (sc->lineSize + (sc->srcAlpha ? alphaLineSize : 0));
+  if (blockRows < maxRows) {
+    blockRows = maxRows;
+  }
+  if (blockRows > nRows) {
+    blockRows = nRows;
+  }
+  if ((double)sc->srcWidth * sc->srcHeight * sc->nComps +
+        (double)sc->scaledWidth * sc->scaledHeight * sc->nComps
+      < splashScaleMinThreadedSize) {
+    nThreads = 1;
+  }
+
+  for (cur = 0; cur < 2; ++cur) {
+    lines[cur] = (Guchar *)gmallocn_checkoverflow(blockRows, sc->lineSize);
+    alphaLines[cur] = sc->srcAlpha
+                        ? (Guchar *)gmallocn_checkoverflow(blockRows,
+							     alphaLineSize)
+                        : NULL;
+  }
+  if (unlikely(!lines[0] || !lines[1] ||
+	       (sc->srcAlpha && (!alphaLines[0] || !alphaLines[1])))) {
+    error(errInternal, -1, "Couldn't allocate image scaling buffers");
+    for (cur = 0; cur < 2; ++cur) {
+      gfree(lines[cur]);
+      gfree(alphaLines[cur]);
+    }
+    return;
+  }
+
+  // read the first block
+  cur = 0;
+  jobs.sc = sc;
+  jobs.u0 = 0;
+  jobs.u1 = getScalerBlockEnd(sc, 0, blockRows);
+  readScalerBlock(sc, sc->firstRow[0], sc->lastRow[jobs.u1 - 1],
+		  lines[0], alphaLines[0]);
+  sc->lines = lines[0];
+  sc->alphaLines = alphaLines[0];
+  sc->row0 = sc->firstRow[0];
+
+  while (jobs.u0 < sc->nUnits) {
+
+    // scale this block, and read the next one
+    jobs.readNext = jobs.u1 < sc->nUnits;
+    u2 = jobs.u1;
+    if (jobs.readNext) {
+      u2 = getScalerBlockEnd(sc, jobs.u1, blockRows);
+      jobs.nextRow0 = sc->firstRow[jobs.u1];
+      jobs.nextRow1 = sc->lastRow[u2 - 1];
+      jobs.nextLines = lines[cur ^ 1];
+      jobs.nextAlphaLines = alphaLines[cur ^ 1];
+    }
+    jobs.nSlices = nThreads > 1 ? 2 * nThreads : 1;
+    if (jobs.nSlices > jobs.u1 - jobs.u0) {
+      jobs.nSlices = jobs.u1 - jobs.u0;
+    }
+    gRunJobs(jobs.nSlices + (jobs.readNext ? 1 : 0), nThreads,
+	     &runScalerJob, &jobs);
+
+    if (jobs.readNext) {
+      cur ^= 1;
+      sc->lines = lines[cur];
+      sc->alphaLines = alphaLines[cur];
+      sc->row0 = jobs.nextRow0;
+    }
+    jobs.u0 = jobs.u1;
+    jobs.u1 = u2;
+  }
+
+  for (cur = 0; cur < 2; ++cur) {
+    gfree(lines[cur]);
+    gfree(alphaLines[cur]);
+  }
+}
+
+static inline Guchar *getScalerLine(SplashScaler *sc, int row) {
+  return sc->lines + (size_t)(row - sc->row0) * sc->lineSize;
+}
+
+static inline Guchar *getScalerAlphaLine(SplashScaler *sc, int row) {
+  return sc->alphaLines + (size_t)(row - sc->row0) * (sc->srcWidth + 1);
+}
+
+// Set sum[j] to the sum of line[i * lineSize + j], for i in
+// 0 .. nLines - 1 and j in 0 .. n - 1.
+static void sumLines(Guint *sum, Guchar *line, int lineSize, int nLines,
+		     int n) {
+  Guchar *p;
+  int i, j;
+
+  j = 0;
+#if SPLASH_SCALE_SSE2
+  // 16 bytes at a time, in 16-bit sums (up to 257 rows of 255)
+  // which are then added to 32-bit ones
+  __m128i zero, v, lo, hi, sum0, sum1, sum2, sum3;
+  int i0, i1;
+
+  zero = _mm_setzero_si128();
+  for (; j + 16 <= n; j += 16) {
+    sum0 = sum1 = sum2 = sum3 = zero;
+    for (i0 = 0; i0 < nLines; i0 = i1) {
+      i1 = i0 + 257 < nLines ? i0 + 257 : nLines;
+      lo = hi = zero;
+      p = line + (size_t)i0 * lineSize + j;
+      for (i = i0; i < i1; ++i, p += lineSize) {
+	v = _mm_loadu_si128((const __m128i *)p);
+	lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+	hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+      }
+      sum0 = _mm_add_epi32(sum0, _mm_unpacklo_epi16(lo, zero));
+      sum1 = _mm_add_epi32(sum1, _mm_unpackhi_epi16(lo, zero));
+      sum2 = _mm_add_epi32(sum2, _mm_unpacklo_epi16(hi, zero));
+      sum3 = _mm_add_epi32(sum3, _mm_unpackhi_epi16(hi, zero));
+    }
+    _mm_storeu_si128((__m128i *)(sum + j), sum0);
+    _mm_storeu_si128((__m128i *)(sum + j + 4), sum1);
+    _mm_storeu_si128((__m128i *)(sum + j + 8), sum2);
+    _mm_storeu_si128((__m128i *)(sum + j + 12), sum3);
+  }
+#endif
+  if (j < n) {
+    memset(sum + j, 0, (n - j) * sizeof(Guint));
+    for (i = 0, p = line; i < nLines; ++i, p += lineSize) {
+      for (int k = j; k < n; ++k) {
+	sum[k] += p[k];
+      }
+    }
+  }
+}
+
 SplashBitmap *Splash::scaleMask(SplashImageMaskSource src, void *srcData,
 				int srcWidth, int srcHeight,
 				int scaledWidth, int scaledHeight) {
@@ -3288,51 +4420,30 @@ SplashBitmap *Splash::scaleMask(SplashImageMaskSource src, void *srcData,
   return dest;
 }
 
-void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
-			   int srcWidth, int srcHeight,
-			   int scaledWidth, int scaledHeight,
-			   SplashBitmap *dest) {
-  Guchar *lineBuf;
+static void scaleMaskYdXdUnits(SplashScaler *sc, int u0, int u1) {
   Guint *pixBuf;
   Guint pix;
   Guchar *destPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
-  int i, j;
+  int srcWidth, scaledWidth, xp, xq, y, yStep, xt, x, xStep, xx, d, d0, d1;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = srcHeight / scaledHeight;
-  yq = srcHeight % scaledHeight;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
 
   // Bresenham parameters for x scale
   xp = srcWidth / scaledWidth;
   xq = srcWidth % scaledWidth;
 
   // allocate buffers
-  lineBuf = (Guchar *)gmalloc(srcWidth);
   pixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
 
-  // init y scale Bresenham
-  yt = 0;
+  destPtr = sc->dest->getDataPtr() + (size_t)u0 * scaledWidth;
+  for (y = u0; y < u1; ++y) {
 
-  destPtr = dest->data;
-  for (y = 0; y < scaledHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= scaledHeight) {
-      yt -= scaledHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
-
-    // read rows from image
-    memset(pixBuf, 0, srcWidth * sizeof(int));
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
-    }
+    // add up the source rows
+    yStep = sc->lastRow[y] - sc->firstRow[y] + 1;
+    sumLines(pixBuf, getScalerLine(sc, sc->firstRow[y]), sc->lineSize,
+	     yStep, srcWidth);
 
     // init x scale Bresenham
     xt = 0;
@@ -3366,59 +4477,46 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
   }
 
   gfree(pixBuf);
-  gfree(lineBuf);
 }
 
-void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
+void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
 			   int srcWidth, int srcHeight,
 			   int scaledWidth, int scaledHeight,
 			   SplashBitmap *dest) {
-  Guchar *lineBuf;
+  SplashScaler sc;
+
+  initScaler(&sc, NULL, src, srcData, splashModeMono8, 1, gFalse,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsDown(&sc);
+  sc.scaleUnits = &scaleMaskYdXdUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleMaskYdXuUnits(SplashScaler *sc, int u0, int u1) {
   Guint *pixBuf;
   Guint pix;
   Guchar *destPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-  int i, j;
-  
-  destPtr = dest->data;
-  if (destPtr == NULL) {
-    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYdXu");
-    return;
-  }
+  int srcWidth, scaledWidth, xp, xq, y, yStep, xt, x, xStep, d;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = srcHeight / scaledHeight;
-  yq = srcHeight % scaledHeight;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
 
   // Bresenham parameters for x scale
   xp = scaledWidth / srcWidth;
   xq = scaledWidth % srcWidth;
 
   // allocate buffers
-  lineBuf = (Guchar *)gmalloc(srcWidth);
   pixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
 
-  // init y scale Bresenham
-  yt = 0;
+  destPtr = sc->dest->getDataPtr() + (size_t)u0 * scaledWidth;
+  for (y = u0; y < u1; ++y) {
 
-  for (y = 0; y < scaledHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= scaledHeight) {
-      yt -= scaledHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
-
-    // read rows from image
-    memset(pixBuf, 0, srcWidth * sizeof(int));
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
-    }
+    // add up the source rows
+    yStep = sc->lastRow[y] - sc->firstRow[y] + 1;
+    sumLines(pixBuf, getScalerLine(sc, sc->firstRow[y]), sc->lineSize,
+	     yStep, srcWidth);
 
     // init x scale Bresenham
     xt = 0;
@@ -3447,51 +4545,46 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
   }
 
   gfree(pixBuf);
-  gfree(lineBuf);
 }
 
-void Splash::scaleMaskYuXd(SplashImageMaskSource src, void *srcData,
+void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
 			   int srcWidth, int srcHeight,
 			   int scaledWidth, int scaledHeight,
 			   SplashBitmap *dest) {
+  SplashScaler sc;
+
+  if (dest->data == NULL) {
+    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYdXu");
+    return;
+  }
+
+  initScaler(&sc, NULL, src, srcData, splashModeMono8, 1, gFalse,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsDown(&sc);
+  sc.scaleUnits = &scaleMaskYdXuUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleMaskYuXdUnits(SplashScaler *sc, int u0, int u1) {
   Guchar *lineBuf;
   Guint pix;
   Guchar *destPtr0, *destPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
+  int srcWidth, scaledWidth, xp, xq, y, yStep, xt, x, xStep, xx, d, d0, d1;
   int i;
-  
-  destPtr0 = dest->data;
-  if (destPtr0 == NULL) {
-    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYuXd");
-    return;
-  }
 
-  // Bresenham parameters for y scale
-  yp = scaledHeight / srcHeight;
-  yq = scaledHeight % srcHeight;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
 
   // Bresenham parameters for x scale
   xp = srcWidth / scaledWidth;
   xq = srcWidth % scaledWidth;
 
-  // allocate buffers
-  lineBuf = (Guchar *)gmalloc(srcWidth);
+  destPtr0 = sc->dest->getDataPtr() + (size_t)sc->destRow[u0] * scaledWidth;
+  for (y = u0; y < u1; ++y) {
 
-  // init y scale Bresenham
-  yt = 0;
-
-  for (y = 0; y < srcHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= srcHeight) {
-      yt -= srcHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
-
-    // read row from image
-    (*src)(srcData, lineBuf);
+    yStep = sc->destRow[y + 1] - sc->destRow[y];
+    lineBuf = getScalerLine(sc, y);
 
     // init x scale Bresenham
     xt = 0;
@@ -3528,57 +4621,52 @@ void Splash::scaleMaskYuXd(SplashImageMaskSource src, void *srcData,
 
     destPtr0 += yStep * scaledWidth;
   }
-
-  gfree(lineBuf);
 }
 
-void Splash::scaleMaskYuXu(SplashImageMaskSource src, void *srcData,
+void Splash::scaleMaskYuXd(SplashImageMaskSource src, void *srcData,
 			   int srcWidth, int srcHeight,
 			   int scaledWidth, int scaledHeight,
 			   SplashBitmap *dest) {
+  SplashScaler sc;
+
+  if (dest->data == NULL) {
+    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYuXd");
+    return;
+  }
+
+  initScaler(&sc, NULL, src, srcData, splashModeMono8, 1, gFalse,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsUp(&sc);
+  sc.scaleUnits = &scaleMaskYuXdUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleMaskYuXuUnits(SplashScaler *sc, int u0, int u1) {
   Guchar *lineBuf;
   Guint pix;
   Guchar *destPtr0, *destPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx;
-  int i, j;
-
-  destPtr0 = dest->data;
-  if (destPtr0 == NULL) {
-    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYuXu");
-    return;
-  }
+  int srcWidth, scaledWidth, xp, xq, y, yStep, xt, x, xStep, xx;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = scaledHeight / srcHeight;
-  yq = scaledHeight % srcHeight;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
 
   // Bresenham parameters for x scale
   xp = scaledWidth / srcWidth;
   xq = scaledWidth % srcWidth;
 
-  // allocate buffers
-  lineBuf = (Guchar *)gmalloc(srcWidth);
-
-  // init y scale Bresenham
-  yt = 0;
-
-  for (y = 0; y < srcHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= srcHeight) {
-      yt -= srcHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
+  destPtr0 = sc->dest->getDataPtr() + (size_t)sc->destRow[u0] * scaledWidth;
+  for (y = u0; y < u1; ++y) {
 
-    // read row from image
-    (*src)(srcData, lineBuf);
+    yStep = sc->destRow[y + 1] - sc->destRow[y];
+    lineBuf = getScalerLine(sc, y);
 
     // init x scale Bresenham
     xt = 0;
 
-    xx = 0;
+    // expand the first destination row, and copy it to the others
+    destPtr = destPtr0;
     for (x = 0; x < srcWidth; ++x) {
 
       // x scale Bresenham
@@ -3593,20 +4681,35 @@ void Splash::scaleMaskYuXu(SplashImageMaskSource src, void *srcData,
       pix = lineBuf[x] ? 255 : 0;
 
       // store the pixel
-      for (i = 0; i < yStep; ++i) {
-	for (j = 0; j < xStep; ++j) {
-	  destPtr = destPtr0 + i * scaledWidth + xx + j;
-	  *destPtr++ = (Guchar)pix;
-	}
+      for (xx = 0; xx < xStep; ++xx) {
+	*destPtr++ = (Guchar)pix;
       }
-
-      xx += xStep;
+    }
+    for (i = 1; i < yStep; ++i) {
+      memcpy(destPtr0 + i * scaledWidth, destPtr0, scaledWidth);
     }
 
     destPtr0 += yStep * scaledWidth;
   }
+}
 
-  gfree(lineBuf);
+void Splash::scaleMaskYuXu(SplashImageMaskSource src, void *srcData,
+			   int srcWidth, int srcHeight,
+			   int scaledWidth, int scaledHeight,
+			   SplashBitmap *dest) {
+  SplashScaler sc;
+
+  if (dest->data == NULL) {
+    error(errInternal, -1, "dest->data is NULL in Splash::scaleMaskYuXu");
+    return;
+  }
+
+  initScaler(&sc, NULL, src, srcData, splashModeMono8, 1, gFalse,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsUp(&sc);
+  sc.scaleUnits = &scaleMaskYuXuUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
 }
 
 void Splash::blitMask(SplashBitmap *src, int xDest, int yDest,
@@ -4182,12 +5285,8 @@ SplashBitmap *Splash::scaleImage(SplashImageSource src, void *srcData,
   return dest;
 }
 
-void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
-			    SplashColorMode srcMode, int nComps,
-			    GBool srcAlpha, int srcWidth, int srcHeight,
-			    int scaledWidth, int scaledHeight,
-			    SplashBitmap *dest) {
-  Guchar *lineBuf, *alphaLineBuf;
+static void scaleImageYdXdUnits(SplashScaler *sc, int u0, int u1) {
+  SplashColorMode srcMode;
   Guint *pixBuf, *alphaPixBuf;
   Guint pix0, pix1, pix2;
 #if SPLASH_CMYK
@@ -4196,58 +5295,39 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
 #endif
   Guint alpha;
   Guchar *destPtr, *destAlphaPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
-  int i, j;
+  int srcWidth, scaledWidth, nComps;
+  int xp, xq, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = srcHeight / scaledHeight;
-  yq = srcHeight % scaledHeight;
+  srcMode = sc->srcMode;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
+  nComps = sc->nComps;
 
   // Bresenham parameters for x scale
   xp = srcWidth / scaledWidth;
   xq = srcWidth % scaledWidth;
 
   // allocate buffers
-  lineBuf = (Guchar *)gmallocn(srcWidth, nComps);
   pixBuf = (Guint *)gmallocn(srcWidth, nComps * sizeof(int));
-  if (srcAlpha) {
-    alphaLineBuf = (Guchar *)gmalloc(srcWidth);
+  if (sc->srcAlpha) {
     alphaPixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
   } else {
-    alphaLineBuf = NULL;
     alphaPixBuf = NULL;
   }
 
-  // init y scale Bresenham
-  yt = 0;
-
-  destPtr = dest->data;
-  destAlphaPtr = dest->alpha;
-  for (y = 0; y < scaledHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= scaledHeight) {
-      yt -= scaledHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
+  destPtr = sc->dest->getDataPtr() + (size_t)u0 * scaledWidth * nComps;
+  destAlphaPtr = sc->srcAlpha ? sc->dest->getAlphaPtr() + (size_t)u0 * scaledWidth
+                              : NULL;
+  for (y = u0; y < u1; ++y) {
 
-    // read rows from image
-    memset(pixBuf, 0, srcWidth * nComps * sizeof(int));
-    if (srcAlpha) {
-      memset(alphaPixBuf, 0, srcWidth * sizeof(int));
-    }
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf, alphaLineBuf);
-      for (j = 0; j < srcWidth * nComps; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
-      if (srcAlpha) {
-	for (j = 0; j < srcWidth; ++j) {
-	  alphaPixBuf[j] += alphaLineBuf[j];
-	}
-      }
+    // add up the source rows
+    yStep = sc->lastRow[y] - sc->firstRow[y] + 1;
+    sumLines(pixBuf, getScalerLine(sc, sc->firstRow[y]), sc->lineSize,
+	     yStep, srcWidth * nComps);
+    if (sc->srcAlpha) {
+      sumLines(alphaPixBuf, getScalerAlphaLine(sc, sc->firstRow[y]),
+	       srcWidth + 1, yStep, srcWidth);
     }
 
     // init x scale Bresenham
@@ -4400,7 +5480,7 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
       }
 
       // process alpha
-      if (srcAlpha) {
+      if (sc->srcAlpha) {
 	alpha = 0;
 	for (i = 0; i < xStep; ++i, ++xxa) {
 	  alpha += alphaPixBuf[xxa];
@@ -4413,73 +5493,63 @@ void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
   }
 
   gfree(alphaPixBuf);
-  gfree(alphaLineBuf);
   gfree(pixBuf);
-  gfree(lineBuf);
 }
 
-void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
+void Splash::scaleImageYdXd(SplashImageSource src, void *srcData,
 			    SplashColorMode srcMode, int nComps,
 			    GBool srcAlpha, int srcWidth, int srcHeight,
 			    int scaledWidth, int scaledHeight,
 			    SplashBitmap *dest) {
-  Guchar *lineBuf, *alphaLineBuf;
+  SplashScaler sc;
+
+  initScaler(&sc, src, NULL, srcData, srcMode, nComps, srcAlpha,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsDown(&sc);
+  sc.scaleUnits = &scaleImageYdXdUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleImageYdXuUnits(SplashScaler *sc, int u0, int u1) {
+  SplashColorMode srcMode;
   Guint *pixBuf, *alphaPixBuf;
   Guint pix[splashMaxColorComps];
   Guint alpha;
   Guchar *destPtr, *destAlphaPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-  int i, j;
+  int srcWidth, scaledWidth, nComps;
+  int xp, xq, y, yStep, xt, x, xStep, d;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = srcHeight / scaledHeight;
-  yq = srcHeight % scaledHeight;
+  srcMode = sc->srcMode;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
+  nComps = sc->nComps;
 
   // Bresenham parameters for x scale
   xp = scaledWidth / srcWidth;
   xq = scaledWidth % srcWidth;
 
   // allocate buffers
-  lineBuf = (Guchar *)gmallocn(srcWidth, nComps);
   pixBuf = (Guint *)gmallocn(srcWidth, nComps * sizeof(int));
-  if (srcAlpha) {
-    alphaLineBuf = (Guchar *)gmalloc(srcWidth);
+  if (sc->srcAlpha) {
     alphaPixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
   } else {
-    alphaLineBuf = NULL;
     alphaPixBuf = NULL;
   }
 
-  // init y scale Bresenham
-  yt = 0;
-
-  destPtr = dest->data;
-  destAlphaPtr = dest->alpha;
-  for (y = 0; y < scaledHeight; ++y) {
-
-    // y scale Bresenham
-    if ((yt += yq) >= scaledHeight) {
-      yt -= scaledHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
-    }
+  destPtr = sc->dest->getDataPtr() + (size_t)u0 * scaledWidth * nComps;
+  destAlphaPtr = sc->srcAlpha ? sc->dest->getAlphaPtr() + (size_t)u0 * scaledWidth
+                              : NULL;
+  for (y = u0; y < u1; ++y) {
 
-    // read rows from image
-    memset(pixBuf, 0, srcWidth * nComps * sizeof(int));
-    if (srcAlpha) {
-      memset(alphaPixBuf, 0, srcWidth * sizeof(int));
-    }
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf, alphaLineBuf);
-      for (j = 0; j < srcWidth * nComps; ++j) {
-	pixBuf[j] += lineBuf[j];
-      }
-      if (srcAlpha) {
-	for (j = 0; j < srcWidth; ++j) {
-	  alphaPixBuf[j] += alphaLineBuf[j];
-	}
-      }
+    // add up the source rows
+    yStep = sc->lastRow[y] - sc->firstRow[y] + 1;
+    sumLines(pixBuf, getScalerLine(sc, sc->firstRow[y]), sc->lineSize,
+	     yStep, srcWidth * nComps);
+    if (sc->srcAlpha) {
+      sumLines(alphaPixBuf, getScalerAlphaLine(sc, sc->firstRow[y]),
+	       srcWidth + 1, yStep, srcWidth);
     }
 
     // init x scale Bresenham
@@ -4552,7 +5622,7 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
       }
 
       // process alpha
-      if (srcAlpha) {
+      if (sc->srcAlpha) {
 	// alphaPixBuf[] / yStep
 	alpha = (alphaPixBuf[x] * d) >> 23;
 	for (i = 0; i < xStep; ++i) {
@@ -4563,59 +5633,56 @@ void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
   }
 
   gfree(alphaPixBuf);
-  gfree(alphaLineBuf);
   gfree(pixBuf);
-  gfree(lineBuf);
 }
 
-void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
+void Splash::scaleImageYdXu(SplashImageSource src, void *srcData,
 			    SplashColorMode srcMode, int nComps,
 			    GBool srcAlpha, int srcWidth, int srcHeight,
 			    int scaledWidth, int scaledHeight,
 			    SplashBitmap *dest) {
+  SplashScaler sc;
+
+  initScaler(&sc, src, NULL, srcData, srcMode, nComps, srcAlpha,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsDown(&sc);
+  sc.scaleUnits = &scaleImageYdXuUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleImageYuXdUnits(SplashScaler *sc, int u0, int u1) {
+  SplashColorMode srcMode;
   Guchar *lineBuf, *alphaLineBuf;
   Guint pix[splashMaxColorComps];
   Guint alpha;
   Guchar *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
+  int srcWidth, scaledWidth, nComps;
+  int xp, xq, y, yStep, xt, x, xStep, xx, xxa, d, d0, d1;
   int i, j;
 
-  // Bresenham parameters for y scale
-  yp = scaledHeight / srcHeight;
-  yq = scaledHeight % srcHeight;
+  srcMode = sc->srcMode;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
+  nComps = sc->nComps;
 
   // Bresenham parameters for x scale
   xp = srcWidth / scaledWidth;
   xq = srcWidth % scaledWidth;
 
-  // allocate buffers
-  lineBuf = (Guchar *)gmallocn_checkoverflow(srcWidth, nComps);
-  if (unlikely(!lineBuf))
-    return;
-  if (srcAlpha) {
-    alphaLineBuf = (Guchar *)gmalloc(srcWidth);
-  } else {
-    alphaLineBuf = NULL;
-  }
-
-  // init y scale Bresenham
-  yt = 0;
-
-  destPtr0 = dest->data;
-  destAlphaPtr0 = dest->alpha;
-  for (y = 0; y < srcHeight; ++y) {
+  destPtr0 = sc->dest->getDataPtr() + (size_t)sc->destRow[u0] * scaledWidth * nComps;
+  destAlphaPtr0 = sc->srcAlpha
+                    ? sc->dest->getAlphaPtr() + (size_t)sc->destRow[u0] * scaledWidth
+                    : NULL;
+  alphaLineBuf = NULL;
+  for (y = u0; y < u1; ++y) {
 
-    // y scale Bresenham
-    if ((yt += yq) >= srcHeight) {
-      yt -= srcHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
+    yStep = sc->destRow[y + 1] - sc->destRow[y];
+    lineBuf = getScalerLine(sc, y);
+    if (sc->srcAlpha) {
+      alphaLineBuf = getScalerAlphaLine(sc, y);
     }
 
-    // read row from image
-    (*src)(srcData, lineBuf, alphaLineBuf);
-
     // init x scale Bresenham
     xt = 0;
     d0 = (1 << 23) / xp;
@@ -4704,7 +5771,7 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
       }
 
       // process alpha
-      if (srcAlpha) {
+      if (sc->srcAlpha) {
 	alpha = 0;
 	for (i = 0; i < xStep; ++i, ++xxa) {
 	  alpha += alphaLineBuf[xxa];
@@ -4719,65 +5786,65 @@ void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
     }
 
     destPtr0 += yStep * scaledWidth * nComps;
-    if (srcAlpha) {
+    if (sc->srcAlpha) {
       destAlphaPtr0 += yStep * scaledWidth;
     }
   }
-
-  gfree(alphaLineBuf);
-  gfree(lineBuf);
 }
 
-void Splash::scaleImageYuXu(SplashImageSource src, void *srcData,
+void Splash::scaleImageYuXd(SplashImageSource src, void *srcData,
 			    SplashColorMode srcMode, int nComps,
 			    GBool srcAlpha, int srcWidth, int srcHeight,
 			    int scaledWidth, int scaledHeight,
 			    SplashBitmap *dest) {
+  SplashScaler sc;
+
+  initScaler(&sc, src, NULL, srcData, srcMode, nComps, srcAlpha,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsUp(&sc);
+  sc.scaleUnits = &scaleImageYuXdUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
+static void scaleImageYuXuUnits(SplashScaler *sc, int u0, int u1) {
+  SplashColorMode srcMode;
   Guchar *lineBuf, *alphaLineBuf;
   Guint pix[splashMaxColorComps];
   Guint alpha;
   Guchar *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
-  int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx;
-  int i, j;
+  int srcWidth, scaledWidth, nComps;
+  int xp, xq, y, yStep, xt, x, xStep;
+  int i;
 
-  // Bresenham parameters for y scale
-  yp = scaledHeight / srcHeight;
-  yq = scaledHeight % srcHeight;
+  srcMode = sc->srcMode;
+  srcWidth = sc->srcWidth;
+  scaledWidth = sc->scaledWidth;
+  nComps = sc->nComps;
 
   // Bresenham parameters for x scale
   xp = scaledWidth / srcWidth;
   xq = scaledWidth % srcWidth;
 
-  // allocate buffers
-  lineBuf = (Guchar *)gmallocn(srcWidth, nComps);
-  if (srcAlpha) {
-    alphaLineBuf = (Guchar *)gmalloc(srcWidth);
-  } else {
-    alphaLineBuf = NULL;
-  }
-
-  // init y scale Bresenham
-  yt = 0;
-
-  destPtr0 = dest->data;
-  destAlphaPtr0 = dest->alpha;
-  for (y = 0; y < srcHeight; ++y) {
+  destPtr0 = sc->dest->getDataPtr() + (size_t)sc->destRow[u0] * scaledWidth * nComps;
+  destAlphaPtr0 = sc->srcAlpha
+                    ? sc->dest->getAlphaPtr() + (size_t)sc->destRow[u0] * scaledWidth
+                    : NULL;
+  alphaLineBuf = NULL;
+  for (y = u0; y < u1; ++y) {
 
-    // y scale Bresenham
-    if ((yt += yq) >= srcHeight) {
-      yt -= srcHeight;
-      yStep = yp + 1;
-    } else {
-      yStep = yp;
+    yStep = sc->destRow[y + 1] - sc->destRow[y];
+    lineBuf = getScalerLine(sc, y);
+    if (sc->srcAlpha) {
+      alphaLineBuf = getScalerAlphaLine(sc, y);
     }
 
-    // read row from image
-    (*src)(srcData, lineBuf, alphaLineBuf);
-
     // init x scale Bresenham
     xt = 0;
 
-    xx = 0;
+    // expand the first destination row, and copy it to the others
+    destPtr = destPtr0;
+    destAlphaPtr = destAlphaPtr0;
     for (x = 0; x < srcWidth; ++x) {
 
       // x scale Bresenham
@@ -4798,93 +5865,92 @@ void Splash::scaleImageYuXu(SplashImageSource src, void *srcData,
       case splashModeMono1: // mono1 is not allowed
 	break;
       case splashModeMono8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-	    *destPtr++ = (Guchar)pix[0];
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destPtr++ = (Guchar)pix[0];
 	}
 	break;
       case splashModeRGB8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-	    *destPtr++ = (Guchar)pix[0];
-	    *destPtr++ = (Guchar)pix[1];
-	    *destPtr++ = (Guchar)pix[2];
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destPtr++ = (Guchar)pix[0];
+	  *destPtr++ = (Guchar)pix[1];
+	  *destPtr++ = (Guchar)pix[2];
 	}
 	break;
       case splashModeXBGR8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-	    *destPtr++ = (Guchar)pix[2];
-	    *destPtr++ = (Guchar)pix[1];
-	    *destPtr++ = (Guchar)pix[0];
-	    *destPtr++ = (Guchar)255;
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destPtr++ = (Guchar)pix[2];
+	  *destPtr++ = (Guchar)pix[1];
+	  *destPtr++ = (Guchar)pix[0];
+	  *destPtr++ = (Guchar)255;
 	}
 	break;
       case splashModeBGR8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-	    *destPtr++ = (Guchar)pix[2];
-	    *destPtr++ = (Guchar)pix[1];
-	    *destPtr++ = (Guchar)pix[0];
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destPtr++ = (Guchar)pix[2];
+	  *destPtr++ = (Guchar)pix[1];
+	  *destPtr++ = (Guchar)pix[0];
 	}
 	break;
 #if SPLASH_CMYK
       case splashModeCMYK8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-	    *destPtr++ = (Guchar)pix[0];
-	    *destPtr++ = (Guchar)pix[1];
-	    *destPtr++ = (Guchar)pix[2];
-	    *destPtr++ = (Guchar)pix[3];
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destPtr++ = (Guchar)pix[0];
+	  *destPtr++ = (Guchar)pix[1];
+	  *destPtr++ = (Guchar)pix[2];
+	  *destPtr++ = (Guchar)pix[3];
 	}
 	break;
       case splashModeDeviceN8:
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destPtr = destPtr0 + (i * scaledWidth + xx + j) * nComps;
-      for (int cp = 0; cp < SPOT_NCOMPS+4; cp++)
-        *destPtr++ = (Guchar)pix[cp];
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  for (int cp = 0; cp < SPOT_NCOMPS+4; cp++)
+	    *destPtr++ = (Guchar)pix[cp];
 	}
 	break;
 #endif
       }
 
       // process alpha
-      if (srcAlpha) {
+      if (sc->srcAlpha) {
 	alpha = alphaLineBuf[x];
-	for (i = 0; i < yStep; ++i) {
-	  for (j = 0; j < xStep; ++j) {
-	    destAlphaPtr = destAlphaPtr0 + i * scaledWidth + xx + j;
-	    *destAlphaPtr = (Guchar)alpha;
-	  }
+	for (i = 0; i < xStep; ++i) {
+	  *destAlphaPtr++ = (Guchar)alpha;
 	}
       }
-
-      xx += xStep;
+    }
+    for (i = 1; i < yStep; ++i) {
+      memcpy(destPtr0 + i * scaledWidth * nComps, destPtr0,
+	     scaledWidth * nComps);
+      if (sc->srcAlpha) {
+	memcpy(destAlphaPtr0 + i * scaledWidth, destAlphaPtr0, scaledWidth);
+      }
     }
 
     destPtr0 += yStep * scaledWidth * nComps;
-    if (srcAlpha) {
+    if (sc->srcAlpha) {
       destAlphaPtr0 += yStep * scaledWidth;
     }
   }
+}
 
-  gfree(alphaLineBuf);
-  gfree(lineBuf);
+void Splash::scaleImageYuXu(SplashImageSource src, void *srcData,
+			    SplashColorMode srcMode, int nComps,
+			    GBool srcAlpha, int srcWidth, int srcHeight,
+			    int scaledWidth, int scaledHeight,
+			    SplashBitmap *dest) {
+  SplashScaler sc;
+
+  initScaler(&sc, src, NULL, srcData, srcMode, nComps, srcAlpha,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+  setScalerRowsUp(&sc);
+  sc.scaleUnits = &scaleImageYuXuUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
 }
 
-// expand source row to scaledWidth using linear interpolation
+// expand source row to scaledWidth using linear interpolation (the
+// source row is padded with a copy of its last pixel, so that when
+// xStep is inside the last pixel we still have two pixels to
+// interpolate between)
 static void expandRow(Guchar *srcBuf, Guchar *dstBuf, int srcWidth, int scaledWidth, int nComps)
 {
   double xStep = (double)srcWidth/scaledWidth;
@@ -4892,12 +5958,6 @@ static void expandRow(Guchar *srcBuf, Guchar *dstBuf, int srcWidth, int scaledWi
   double xFrac, xInt;
   int p;
 
-  // pad the source with an extra pixel equal to the last pixel
-  // so that when xStep is inside the last pixel we still have two
-  // pixels to interpolate between.
-  for (int i = 0; i < nComps; i++)
-    srcBuf[srcWidth*nComps + i] = srcBuf[(srcWidth-1)*nComps + i];
-
   for (int x = 0; x < scaledWidth; x++) {
     xFrac = modf(xSrc, &xInt);
     p = (int)xInt;
@@ -4908,127 +5968,175 @@ static void expandRow(Guchar *srcBuf, Guchar *dstBuf, int srcWidth, int scaledWi
   }
 }
 
-// Scale up image using bilinear interpolation
-void Splash::scaleImageYuXuBilinear(SplashImageSource src, void *srcData,
-                                    SplashColorMode srcMode, int nComps,
-                                    GBool srcAlpha, int srcWidth, int srcHeight,
-                                    int scaledWidth, int scaledHeight,
-                                    SplashBitmap *dest) {
-  Guchar *srcBuf, *lineBuf1, *lineBuf2, *alphaSrcBuf, *alphaLineBuf1, *alphaLineBuf2;
-  Guint pix[splashMaxColorComps];
-  Guchar *destPtr0, *destPtr, *destAlphaPtr0, *destAlphaPtr;
+// Set dst[i] to line1[i] * (1 - yFrac) + line2[i] * yFrac, for i in
+// 0 .. n - 1.
+static void interpolateLines(Guchar *dst, Guchar *line1, Guchar *line2,
+			     int n, double yFrac) {
   int i;
 
-  if (srcWidth < 1 || srcHeight < 1)
-    return;
+  i = 0;
+#if SPLASH_SCALE_SSE2
+  // same double precision arithmetic as below, 4 bytes at a time
+  __m128i zero, v1, v2, r0, r1;
+  __m128d w1, w2;
+  int k;
+
+  zero = _mm_setzero_si128();
+  w1 = _mm_set1_pd(1.0 - yFrac);
+  w2 = _mm_set1_pd(yFrac);
+  for (; i + 4 <= n; i += 4) {
+    memcpy(&k, line1 + i, 4);
+    v1 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(k), zero),
+			    zero);
+    memcpy(&k, line2 + i, 4);
+    v2 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(k), zero),
+			    zero);
+    r0 = _mm_cvttpd_epi32(
+	   _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(v1), w1),
+		      _mm_mul_pd(_mm_cvtepi32_pd(v2), w2)));
+    r1 = _mm_cvttpd_epi32(
+	   _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v1, 8)), w1),
+		      _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v2, 8)), w2)));
+    r0 = _mm_unpacklo_epi64(r0, r1);
+    r0 = _mm_packus_epi16(_mm_packs_epi32(r0, zero), zero);
+    k = _mm_cvtsi128_si32(r0);
+    memcpy(dst + i, &k, 4);
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] = (Guint)(line1[i]*(1.0 - yFrac) + line2[i]*yFrac);
+  }
+}
+
+static void scaleImageYuXuBilinearUnits(SplashScaler *sc, int u0, int u1) {
+  SplashColorMode srcMode;
+  Guchar *lineBuf1, *lineBuf2, *alphaLineBuf1, *alphaLineBuf2, *t;
+  Guchar *destPtr, *p;
+  Guchar c;
+  int scaledWidth, nComps, row1, row2, y, x;
+
+  srcMode = sc->srcMode;
+  scaledWidth = sc->scaledWidth;
+  nComps = sc->nComps;
 
   // allocate buffers
-  srcBuf = (Guchar *)gmallocn(srcWidth+1, nComps); // + 1 pixel of padding
   lineBuf1 = (Guchar *)gmallocn(scaledWidth, nComps);
   lineBuf2 = (Guchar *)gmallocn(scaledWidth, nComps);
-  if (srcAlpha) {
-    alphaSrcBuf = (Guchar *)gmalloc(srcWidth+1); // + 1 pixel of padding
+  if (sc->srcAlpha) {
     alphaLineBuf1 = (Guchar *)gmalloc(scaledWidth);
     alphaLineBuf2 = (Guchar *)gmalloc(scaledWidth);
   } else {
-    alphaSrcBuf = NULL;
     alphaLineBuf1 = NULL;
     alphaLineBuf2 = NULL;
   }
 
-  double ySrc = 0.0;
-  double yStep = (double)srcHeight/scaledHeight;
-  double yFrac, yInt;
-  int currentSrcRow = -1;
-  (*src)(srcData, srcBuf, alphaSrcBuf);
-  expandRow(srcBuf, lineBuf2, srcWidth, scaledWidth, nComps);
-  if (srcAlpha)
-    expandRow(alphaSrcBuf, alphaLineBuf2, srcWidth, scaledWidth, 1);
+  // the source rows currently in lineBuf1 and lineBuf2
+  row1 = row2 = -1;
 
-  destPtr0 = dest->data;
-  destAlphaPtr0 = dest->alpha;
-  for (int y = 0; y < scaledHeight; y++) {
-    yFrac = modf(ySrc, &yInt);
-    if ((int)yInt > currentSrcRow) {
-      currentSrcRow++;
-      // Copy line2 data to line1 and get next line2 data.
-      // If line2 already contains the last source row we don't touch it.
-      // This effectively adds an extra row of padding for interpolating the
-      // last source row with.
-      memcpy(lineBuf1, lineBuf2, scaledWidth * nComps);
-      if (srcAlpha)
-        memcpy(alphaLineBuf1, alphaLineBuf2, scaledWidth);
-      if (currentSrcRow < srcHeight) {
-        (*src)(srcData, srcBuf, alphaSrcBuf);
-        expandRow(srcBuf, lineBuf2, srcWidth, scaledWidth, nComps);
-        if (srcAlpha)
-          expandRow(alphaSrcBuf, alphaLineBuf2, srcWidth, scaledWidth, 1);
+  for (y = u0; y < u1; ++y) {
+
+    // expand the two source rows of this destination row
+    if (sc->firstRow[y] != row1) {
+      if (sc->firstRow[y] == row2) {
+	t = lineBuf1; lineBuf1 = lineBuf2; lineBuf2 = t;
+	t = alphaLineBuf1; alphaLineBuf1 = alphaLineBuf2; alphaLineBuf2 = t;
+	row2 = -1;
+      } else {
+	expandRow(getScalerLine(sc, sc->firstRow[y]), lineBuf1,
+		  sc->srcWidth, scaledWidth, nComps);
+	if (sc->srcAlpha) {
+	  expandRow(getScalerAlphaLine(sc, sc->firstRow[y]), alphaLineBuf1,
+		    sc->srcWidth, scaledWidth, 1);
+	}
       }
+      row1 = sc->firstRow[y];
     }
-
-    // write row y using linear interpolation on lineBuf1 and lineBuf2
-    for (int x = 0; x < scaledWidth; ++x) {
-      // compute the final pixel
-      for (i = 0; i < nComps; ++i) {
-	pix[i] = lineBuf1[x*nComps + i]*(1.0 - yFrac) + lineBuf2[x*nComps + i]*yFrac;
+    if (sc->lastRow[y] != row2) {
+      expandRow(getScalerLine(sc, sc->lastRow[y]), lineBuf2,
+		sc->srcWidth, scaledWidth, nComps);
+      if (sc->srcAlpha) {
+	expandRow(getScalerAlphaLine(sc, sc->lastRow[y]), alphaLineBuf2,
+		  sc->srcWidth, scaledWidth, 1);
       }
+      row2 = sc->lastRow[y];
+    }
 
-      // store the pixel
-      destPtr = destPtr0 + (y * scaledWidth + x) * nComps;
-      switch (srcMode) {
-        case splashModeMono1: // mono1 is not allowed
-          break;
-        case splashModeMono8:
-          *destPtr++ = (Guchar)pix[0];
-          break;
-        case splashModeRGB8:
-          *destPtr++ = (Guchar)pix[0];
-          *destPtr++ = (Guchar)pix[1];
-          *destPtr++ = (Guchar)pix[2];
-          break;
-        case splashModeXBGR8:
-          *destPtr++ = (Guchar)pix[2];
-          *destPtr++ = (Guchar)pix[1];
-          *destPtr++ = (Guchar)pix[0];
-          *destPtr++ = (Guchar)255;
-          break;
-        case splashModeBGR8:
-          *destPtr++ = (Guchar)pix[2];
-          *destPtr++ = (Guchar)pix[1];
-          *destPtr++ = (Guchar)pix[0];
-          break;
-#if SPLASH_CMYK
-        case splashModeCMYK8:
-          *destPtr++ = (Guchar)pix[0];
-          *destPtr++ = (Guchar)pix[1];
-          *destPtr++ = (Guchar)pix[2];
-          *destPtr++ = (Guchar)pix[3];
-          break;
-        case splashModeDeviceN8:
-          for (int cp = 0; cp < SPOT_NCOMPS+4; cp++)
-            *destPtr++ = (Guchar)pix[cp];
-          break;
-#endif
+    // write row y using linear interpolation on lineBuf1 and lineBuf2
+    destPtr = sc->dest->getDataPtr() + (size_t)y * scaledWidth * nComps;
+    interpolateLines(destPtr, lineBuf1, lineBuf2, scaledWidth * nComps,
+		     sc->yFrac[y]);
+    switch (srcMode) {
+    case splashModeXBGR8:
+      for (x = 0, p = destPtr; x < scaledWidth; ++x, p += 4) {
+	c = p[0]; p[0] = p[2]; p[2] = c;
+	p[3] = 255;
       }
-
-      // process alpha
-      if (srcAlpha) {
-        destAlphaPtr = destAlphaPtr0 + y*scaledWidth + x;
-        *destAlphaPtr = alphaLineBuf1[x]*(1.0 - yFrac) + alphaLineBuf2[x]*yFrac;
+      break;
+    case splashModeBGR8:
+      for (x = 0, p = destPtr; x < scaledWidth; ++x, p += 3) {
+	c = p[0]; p[0] = p[2]; p[2] = c;
       }
+      break;
+    default:
+      break;
     }
 
-    ySrc += yStep;
+    // process alpha
+    if (sc->srcAlpha) {
+      interpolateLines(sc->dest->getAlphaPtr() + (size_t)y * scaledWidth,
+		       alphaLineBuf1, alphaLineBuf2, scaledWidth,
+		       sc->yFrac[y]);
+    }
   }
 
-  gfree(alphaSrcBuf);
   gfree(alphaLineBuf1);
   gfree(alphaLineBuf2);
-  gfree(srcBuf);
   gfree(lineBuf1);
   gfree(lineBuf2);
 }
 
+// Scale up image using bilinear interpolation
+void Splash::scaleImageYuXuBilinear(SplashImageSource src, void *srcData,
+                                    SplashColorMode srcMode, int nComps,
+                                    GBool srcAlpha, int srcWidth, int srcHeight,
+                                    int scaledWidth, int scaledHeight,
+                                    SplashBitmap *dest) {
+  SplashScaler sc;
+  double ySrc, yStep, yInt;
+  int currentSrcRow, y;
+
+  if (srcWidth < 1 || srcHeight < 1)
+    return;
+
+  initScaler(&sc, src, NULL, srcData, srcMode, nComps, srcAlpha,
+	     srcWidth, srcHeight, scaledWidth, scaledHeight, dest);
+
+  // one unit per destination row, interpolated between source rows
+  // currentSrcRow and currentSrcRow + 1 -- the row after the last one
+  // is read from the source like the others, which effectively adds an
+  // extra row of padding for interpolating the last source row with
+  sc.nUnits = scaledHeight;
+  sc.firstRow = (int *)gmallocn(scaledHeight, sizeof(int));
+  sc.lastRow = (int *)gmallocn(scaledHeight, sizeof(int));
+  sc.yFrac = (double *)gmallocn(scaledHeight, sizeof(double));
+  ySrc = 0.0;
+  yStep = (double)srcHeight/scaledHeight;
+  currentSrcRow = -1;
+  for (y = 0; y < scaledHeight; y++) {
+    sc.yFrac[y] = modf(ySrc, &yInt);
+    if ((int)yInt > currentSrcRow) {
+      currentSrcRow++;
+    }
+    sc.firstRow[y] = currentSrcRow < srcHeight ? currentSrcRow : srcHeight;
+    sc.lastRow[y] = currentSrcRow < srcHeight ? currentSrcRow + 1 : srcHeight;
+    ySrc += yStep;
+  }
+
+  sc.scaleUnits = &scaleImageYuXuBilinearUnits;
+  runScaler(&sc, numThreads);
+  freeScaler(&sc);
+}
+
 void Splash::vertFlipImage(SplashBitmap *img, int width, int height,
 			   int nComps) {
   Guchar *lineBuf;
@@ -5073,11 +6181,19 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
   SplashPipe pipe;
   SplashColor pixel;
   Guchar *ap;
-  int w, h, x0, y0, x1, y1, x, y;
+  int w, h, x0, y0, x1, y1, yMinB, yMaxB, ya, x, y;
 
   // split the image into clipped and unclipped regions
   w = src->getWidth();
   h = src->getHeight();
+  yMinB = 0;
+  if (state->clip->getBandYMin() > yDest) {
+    yMinB = state->clip->getBandYMin() - yDest;
+  }
+  yMaxB = h;
+  if (state->clip->getBandYMax() < yDest + h - 1) {
+    yMaxB = state->clip->getBandYMax() + 1 - yDest;
+  }
   if (clipRes == splashClipAllInside) {
     x0 = 0;
     y0 = 0;
@@ -5103,6 +6219,13 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
       if ((y1 = splashFloor(state->clip->getYMax()) - yDest) > h) {
 	y1 = h;
       }
+      // skip the rows outside the band
+      if (y0 < yMinB) {
+	y0 = yMinB;
+      }
+      if (y1 > yMaxB) {
+	y1 = yMaxB;
+      }
       if (y1 < y0) {
 	y1 = y0;
       }
@@ -5138,12 +6261,15 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
     updateModY(yDest + y1 - 1);
   }
 
-  // draw the clipped regions
-  if (y0 > 0) {
-    blitImageClipped(src, srcAlpha, 0, 0, xDest, yDest, w, y0);
+  // draw the clipped regions (in the band)
+  ya = y0 < yMaxB ? y0 : yMaxB;
+  if (ya > yMinB) {
+    blitImageClipped(src, srcAlpha, 0, yMinB, xDest, yDest + yMinB,
+		     w, ya - yMinB);
   }
-  if (y1 < h) {
-    blitImageClipped(src, srcAlpha, 0, y1, xDest, yDest + y1, w, h - y1);
+  if (y1 < yMaxB) {
+    ya = y1 > yMinB ? y1 : yMinB;
+    blitImageClipped(src, srcAlpha, 0, ya, xDest, yDest + ya, w, yMaxB - ya);
   }
   if (x0 > 0 && y0 < y1) {
     blitImageClipped(src, srcAlpha, 0, y0, xDest, yDest + y0, x0, y1 - y0);
@@ -5228,9 +6354,11 @@ SplashError Splash::composite(SplashBitmap *src, int xSrc, int ySrc,
 			      GBool knockout, SplashCoord knockoutOpacity) {
   SplashPipe pipe;
   SplashColor pixel;
+  SplashColorPtr sp;
   Guchar alpha;
   Guchar *ap;
-  int x, y;
+  GBool useRow;
+  int x, y, xRun;
 
   if (src->mode != bitmap->mode) {
     return splashErrModeMismatch;
@@ -5248,10 +6376,19 @@ SplashError Splash::composite(SplashBitmap *src, int xSrc, int ySrc,
     pipeInit(&pipe, xDest, yDest, NULL, pixel,
 	     (Guchar)splashRound(state->fillAlpha * 255), gTrue, nonIsolated,
 	     knockout, (Guchar)splashRound(knockoutOpacity * 255));
+    // if possible, each row (or each run of pixels inside the clip) is
+    // composited at once
+    useRow = pipeRowSupported(&pipe);
     if (noClip) {
       for (y = 0; y < h; ++y) {
-	pipeSetXY(&pipe, xDest, yDest + y);
 	ap = src->getAlphaPtr() + (ySrc + y) * src->getWidth() + xSrc;
+	if (useRow) {
+	  sp = src->getDataPtr() + (ySrc + y) * src->getRowSize() +
+	       xSrc * splashColorModeNComps[src->mode];
+	  pipeRunRow(&pipe, xDest, xDest + w - 1, yDest + y, sp, ap);
+	  continue;
+	}
+	pipeSetXY(&pipe, xDest, yDest + y);
 	for (x = 0; x < w; ++x) {
 	  src->getPixel(xSrc + x, ySrc + y, pixel);
 	  alpha = *ap++;
@@ -5267,8 +6404,30 @@ SplashError Splash::composite(SplashBitmap *src, int xSrc, int ySrc,
       updateModY(yDest + h - 1);
     } else {
       for (y = 0; y < h; ++y) {
-	pipeSetXY(&pipe, xDest, yDest + y);
 	ap = src->getAlphaPtr() + (ySrc + y) * src->getWidth() + xSrc;
+	if (useRow) {
+	  sp = src->getDataPtr() + (ySrc + y) * src->getRowSize() +
+	       xSrc * splashColorModeNComps[src->mode];
+	  x = 0;
+	  while (x < w) {
+	    if (!state->clip->test(xDest + x, yDest + y)) {
+	      ++x;
+	      continue;
+	    }
+	    xRun = x;
+	    do {
+	      ++x;
+	    } while (x < w && state->clip->test(xDest + x, yDest + y));
+	    pipeRunRow(&pipe, xDest + xRun, xDest + x - 1, yDest + y,
+		       sp + xRun * splashColorModeNComps[src->mode],
+		       ap + xRun);
+	    updateModX(xDest + xRun);
+	    updateModX(xDest + x - 1);
+	    updateModY(yDest + y);
+	  }
+	  continue;
+	}
+	pipeSetXY(&pipe, xDest, yDest + y);
 	for (x = 0; x < w; ++x) {
 	  src->getPixel(xSrc + x, ySrc + y, pixel);
 	  alpha = *ap++;
@@ -5843,7 +7002,7 @@ SplashError Splash::blitTransparent(SplashBitmap *src, int xSrc, int ySrc,
   case splashModeMono8:
     for (y = 0; y < h; ++y) {
       p = &bitmap->data[(yDest + y) * bitmap->rowSize + xDest];
-      sp = &src->data[(ySrc + y) * bitmap->rowSize + xSrc];
+      sp = &src->data[(ySrc + y) * src->rowSize + xSrc];
       for (x = 0; x < w; ++x) {
 	*p++ = *sp++;
       }
@@ -6347,7 +7506,7 @@ SplashError Splash::shadedFill(SplashPath *path, GBool hasBBox,
   SplashPipe pipe;
   SplashXPath *xPath;
   SplashXPathScanner *scanner;
-  int xMinI, yMinI, xMaxI, yMaxI, x0, x1, y;
+  int xMinI, yMinI, xMaxI, yMaxI, yMinB, yMaxB, x0, x1, y;
   SplashClipResult clipRes;
 
   if (vectorAntialias && aaBuf == NULL) { // should not happen, but to be secure
@@ -6388,9 +7547,19 @@ SplashError Splash::shadedFill(SplashPath *path, GBool hasBBox,
 
     pipeInit(&pipe, 0, yMinI, pattern, NULL, (Guchar)splashRound(state->fillAlpha * 255), vectorAntialias && !hasBBox, gFalse);
 
+    // skip the rows outside the band
+    yMinB = yMinI;
+    if (yMinB < state->clip->getBandYMin()) {
+      yMinB = state->clip->getBandYMin();
+    }
+    yMaxB = yMaxI;
+    if (yMaxB > state->clip->getBandYMax()) {
+      yMaxB = state->clip->getBandYMax();
+    }
+
     // draw the spans
     if (vectorAntialias) {
-      for (y = yMinI; y <= yMaxI; ++y) {
+      for (y = yMinB; y <= yMaxB; ++y) {
         scanner->renderAALine(aaBuf, &x0, &x1, y);
         if (clipRes != splashClipAllInside) {
           state->clip->clipAALine(aaBuf, &x0, &x1, y);
@@ -6448,7 +7617,7 @@ SplashError Splash::shadedFill(SplashPath *path, GBool hasBBox,
       }
     } else {
       SplashClipResult clipRes2;
-      for (y = yMinI; y <= yMaxI; ++y) {
+      for (y = yMinB; y <= yMaxB; ++y) {
         while (scanner->getNextSpan(y, &x0, &x1)) {
           if (clipRes == splashClipAllInside) {
             drawSpan(&pipe, x0, x1, y, gTrue);
@@ -126,7 +126,8 @@ public:
   void setStrokePattern(SplashPattern *strokeColor);
   void setFillPattern(SplashPattern *fillColor);
   void setScreen(SplashScreen *screen);
-  void setBlendFunc(SplashBlendFunc func);
+  // <rowFunc>, if not NULL, is the row version of <func>.
+  void setBlendFunc(SplashBlendFunc func, SplashBlendRowFunc rowFunc = NULL);
   void setStrokeAlpha(SplashCoord alpha);
   void setFillAlpha(SplashCoord alpha);
   void setPatternAlpha(SplashCoord strokeAlpha, SplashCoord fillAlpha);
@@ -151,6 +152,10 @@ public:
 			 SplashCoord x1, SplashCoord y1);
   // NB: uses untransformed coordinates.
   SplashError clipToPath(SplashPath *path, GBool eo);
+  // Only draw the bitmap rows <yMin> .. <yMax>, e.g., to render one
+  // band of a page while other threads render the others into the same
+  // bitmap.  This must be called before saving the state.
+  void setBand(int yMin, int yMax);
   void setSoftMask(SplashBitmap *softMask);
   void setInNonIsolatedGroup(SplashBitmap *alpha0BitmapA,
 			     int alpha0XA, int alpha0YA);
@@ -258,6 +263,18 @@ public:
   void setThinLineMode(SplashThinLineMode thinLineModeA) { thinLineMode = thinLineModeA; }
   SplashThinLineMode getThinLineMode() { return thinLineMode; }
 
+  // Set the anti-aliasing method used to fill paths (the default is
+  // splashAASupersample).  splashAAAnalytic is only used in
+  // splashThinLineDefault mode.
+  void setAAMode(SplashAAMode aaModeA);
+  SplashAAMode getAAMode() { return aaMode; }
+
+  // Set the number of threads used to scale large images (the default
+  // is 1).
+  void setNumThreads(int numThreadsA)
+    { numThreads = numThreadsA > 0 ? numThreadsA : 1; }
+  int getNumThreads() { return numThreads; }
+
   // Get a bounding box which includes all modifications since the
   // last call to clearModRegion.
   void getModRegion(int *xMin, int *yMin, int *xMax, int *yMax)
@@ -311,6 +328,10 @@ private:
   void pipeRunAACMYK8(SplashPipe *pipe);
   void pipeRunAADeviceN8(SplashPipe *pipe);
 #endif
+  void pipeRunSpan(SplashPipe *pipe, int x0, int x1, int y, Guchar *shape);
+  GBool pipeRowSupported(SplashPipe *pipe);
+  void pipeRunRow(SplashPipe *pipe, int x0, int x1, int y,
+		  SplashColorPtr srcRow, Guchar *shape);
   void pipeSetXY(SplashPipe *pipe, int x, int y);
   void pipeIncX(SplashPipe *pipe);
   void drawPixel(SplashPipe *pipe, int x, int y, GBool noClip);
@@ -318,6 +339,7 @@ private:
   void drawAAPixel(SplashPipe *pipe, int x, int y);
   void drawSpan(SplashPipe *pipe, int x0, int x1, int y, GBool noClip);
   void drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool adjustLine = gFalse, Guchar lineOpacity = 0);
+  void drawAACoverageLine(SplashPipe *pipe, int x0, int x1, int y);
   void transform(SplashCoord *matrix, SplashCoord xi, SplashCoord yi,
 		 SplashCoord *xo, SplashCoord *yo);
   void updateModX(int x);
@@ -336,6 +358,9 @@ private:
   void getBBoxFP(SplashPath *path, SplashCoord *xMinA, SplashCoord *yMinA, SplashCoord *xMaxA, SplashCoord *yMaxA);
   SplashError fillWithPattern(SplashPath *path, GBool eo,
 			      SplashPattern *pattern, SplashCoord alpha);
+  GBool fillRect(SplashCoord xMinA, SplashCoord yMinA,
+		 SplashCoord xMaxA, SplashCoord yMaxA,
+		 SplashPattern *pattern, SplashCoord alpha);
   GBool pathAllOutside(SplashPath *path);
   void fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph, GBool noclip);
   void arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
@@ -415,12 +440,23 @@ private:
   SplashState *state;
   SplashBitmap *aaBuf;
   int aaBufY;
+  Guchar *aaShape;		// shape values of an antialiased line, for
+				//   the span kernels
   SplashBitmap *alpha0Bitmap;	// for non-isolated groups, this is the
 				//   bitmap containing the alpha0 values
   int alpha0X, alpha0Y;		// offset within alpha0Bitmap
   SplashCoord aaGamma[splashAASize * splashAASize + 1];
+  SplashAAMode aaMode;
+  SplashCoord *aaAccum;		// area accumulation buffer, for
+				//   splashAAAnalytic
+  Guchar *aaCoverage;		// pixel coverage of an antialiased line,
+				//   for splashAAAnalytic
+  Guchar *aaClipCoverage;	// pixel coverage of a clip path, for
+				//   splashAAAnalytic
+  Guchar *aaCoverageGamma;	// gamma table for aaCoverage values
   SplashCoord minLineWidth;
   SplashThinLineMode thinLineMode;
+  int numThreads;		// max number of threads scaling an image
   int modXMin, modYMin, modXMax, modYMax;
   SplashClipResult opClipRes;
   GBool vectorAntialias;
@@ -27,6 +27,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "goo/gmem.h"
 #include "SplashErrorCodes.h"
 #include "SplashPath.h"
@@ -67,6 +68,8 @@ SplashClip::SplashClip(SplashCoord x0, SplashCoord y0,
   yMinI = splashFloor(yMin);
   xMaxI = splashCeil(xMax) - 1;
   yMaxI = splashCeil(yMax) - 1;
+  bandYMin = INT_MIN;
+  bandYMax = INT_MAX;
   paths = NULL;
   flags = NULL;
   scanners = NULL;
@@ -86,6 +89,8 @@ SplashClip::SplashClip(SplashClip *clip) {
   yMinI = clip->yMinI;
   xMaxI = clip->xMaxI;
   yMaxI = clip->yMaxI;
+  bandYMin = clip->bandYMin;
+  bandYMax = clip->bandYMax;
   length = clip->length;
   size = clip->size;
   paths = (SplashXPath **)gmallocn(size, sizeof(SplashXPath *));
@@ -216,6 +221,7 @@ SplashError SplashClip::clipToRect(SplashCoord x0, SplashCoord y0,
 SplashError SplashClip::clipToPath(SplashPath *path, SplashCoord *matrix,
 				   SplashCoord flatness, GBool eo) {
   SplashXPath *xPath;
+  SplashCoord rxMin, ryMin, rxMax, ryMax;
   int yMinAA, yMaxAA;
 
   xPath = new SplashXPath(path, matrix, flatness, gTrue);
@@ -229,33 +235,8 @@ SplashError SplashClip::clipToPath(SplashPath *path, SplashCoord *matrix,
     delete xPath;
 
   // check for a rectangle
-  } else if (xPath->length == 4 &&
-	     ((xPath->segs[0].x0 == xPath->segs[0].x1 &&
-	       xPath->segs[0].x0 == xPath->segs[1].x0 &&
-	       xPath->segs[0].x0 == xPath->segs[3].x1 &&
-	       xPath->segs[2].x0 == xPath->segs[2].x1 &&
-	       xPath->segs[2].x0 == xPath->segs[1].x1 &&
-	       xPath->segs[2].x0 == xPath->segs[3].x0 &&
-	       xPath->segs[1].y0 == xPath->segs[1].y1 &&
-	       xPath->segs[1].y0 == xPath->segs[0].y1 &&
-	       xPath->segs[1].y0 == xPath->segs[2].y0 &&
-	       xPath->segs[3].y0 == xPath->segs[3].y1 &&
-	       xPath->segs[3].y0 == xPath->segs[0].y0 &&
-	       xPath->segs[3].y0 == xPath->segs[2].y1) ||
-	      (xPath->segs[0].y0 == xPath->segs[0].y1 &&
-	       xPath->segs[0].y0 == xPath->segs[1].y0 &&
-	       xPath->segs[0].y0 == xPath->segs[3].y1 &&
-	       xPath->segs[2].y0 == xPath->segs[2].y1 &&
-	       xPath->segs[2].y0 == xPath->segs[1].y1 &&
-	       xPath->segs[2].y0 == xPath->segs[3].y0 &&
-	       xPath->segs[1].x0 == xPath->segs[1].x1 &&
-	       xPath->segs[1].x0 == xPath->segs[0].x1 &&
-	       xPath->segs[1].x0 == xPath->segs[2].x0 &&
-	       xPath->segs[3].x0 == xPath->segs[3].x1 &&
-	       xPath->segs[3].x0 == xPath->segs[0].x0 &&
-	       xPath->segs[3].x0 == xPath->segs[2].x1))) {
-    clipToRect(xPath->segs[0].x0, xPath->segs[0].y0,
-	       xPath->segs[2].x0, xPath->segs[2].y0);
+  } else if (xPath->isRect(&rxMin, &ryMin, &rxMax, &ryMax)) {
+    clipToRect(rxMin, ryMin, rxMax, ryMax);
     delete xPath;
 
   } else {
@@ -281,7 +262,8 @@ SplashError SplashClip::clipToPath(SplashPath *path, SplashCoord *matrix,
 }
 
 SplashClipResult SplashClip::testRect(int rectXMin, int rectYMin,
-				      int rectXMax, int rectYMax) {
+				      int rectXMax, int rectYMax,
+				      GBool useBand) {
   // This tests the rectangle:
   //     x = [rectXMin, rectXMax + 1)    (note: rect coords are ints)
   //     y = [rectYMin, rectYMax + 1)
@@ -289,11 +271,13 @@ SplashClipResult SplashClip::testRect(int rectXMin, int rectYMin,
   //     x = [xMin, xMax)                (note: clipping coords are fp)
   //     y = [yMin, yMax)
   if ((SplashCoord)(rectXMax + 1) <= xMin || (SplashCoord)rectXMin >= xMax ||
-      (SplashCoord)(rectYMax + 1) <= yMin || (SplashCoord)rectYMin >= yMax) {
+      (SplashCoord)(rectYMax + 1) <= yMin || (SplashCoord)rectYMin >= yMax ||
+      (useBand && (rectYMax < bandYMin || rectYMin > bandYMax))) {
     return splashClipAllOutside;
   }
   if ((SplashCoord)rectXMin >= xMin && (SplashCoord)(rectXMax + 1) <= xMax &&
       (SplashCoord)rectYMin >= yMin && (SplashCoord)(rectYMax + 1) <= yMax &&
+      (!useBand || (rectYMin >= bandYMin && rectYMax <= bandYMax)) &&
       length == 0) {
     return splashClipAllInside;
   }
@@ -310,7 +294,8 @@ SplashClipResult SplashClip::testSpan(int spanXMin, int spanXMax, int spanY) {
   //     x = [xMin, xMax)                (note: clipping coords are fp)
   //     y = [yMin, yMax)
   if ((SplashCoord)(spanXMax + 1) <= xMin || (SplashCoord)spanXMin >= xMax ||
-      (SplashCoord)(spanY + 1) <= yMin || (SplashCoord)spanY >= yMax) {
+      (SplashCoord)(spanY + 1) <= yMin || (SplashCoord)spanY >= yMax ||
+      spanY < bandYMin || spanY > bandYMax) {
     return splashClipAllOutside;
   }
   if (!((SplashCoord)spanXMin >= xMin && (SplashCoord)(spanXMax + 1) <= xMax &&
@@ -339,6 +324,13 @@ void SplashClip::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, GBool
   int xx0, xx1, xx, yy, i;
   SplashColorPtr p;
 
+  // zero out the whole line if it is outside the band
+  if (y < bandYMin || y > bandYMax) {
+    memset(aaBuf->getDataPtr(), 0, aaBuf->getRowSize() * aaBuf->getHeight());
+    *x0 = *x1 = 0;
+    return;
+  }
+
   // zero out pixels with x < xMin
   xx0 = *x0 * splashAASize;
   xx1 = splashFloor(xMin * splashAASize);
@@ -409,3 +401,62 @@ void SplashClip::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, GBool
     }
   }
 }
+
+void SplashClip::clipAACoverageLine(SplashCoord *accum, Guchar *coverage,
+				    Guchar *clipCoverage,
+				    int *x0, int *x1, int y) {
+  SplashCoord f, fy;
+  int cx0, cx1, x, i;
+
+  // drop the whole line if it is outside the band
+  if (y < bandYMin || y > bandYMax) {
+    *x1 = *x0 - 1;
+    return;
+  }
+
+  // the rectangle: scale the row by its vertical coverage, and the
+  // pixels on its left and right edges by their horizontal coverage
+  fy = (y + 1 < yMax ? y + 1 : yMax) - (y > yMin ? y : yMin);
+  if (*x0 < xMinI) {
+    *x0 = xMinI;
+  }
+  if (*x1 > xMaxI) {
+    *x1 = xMaxI;
+  }
+  if (fy <= 0 || *x0 > *x1) {
+    *x1 = *x0 - 1;
+    return;
+  }
+  if (fy < 1) {
+    for (x = *x0; x <= *x1; ++x) {
+      coverage[x] = (Guchar)(coverage[x] * fy + (SplashCoord)0.5);
+    }
+  }
+  if (*x0 == xMinI) {
+    f = (xMinI + 1 < xMax ? xMinI + 1 : xMax) - xMin;
+    if (f < 1) {
+      coverage[xMinI] = (Guchar)(coverage[xMinI] * f + (SplashCoord)0.5);
+    }
+  }
+  if (*x1 == xMaxI && xMaxI != xMinI) {
+    f = xMax - xMaxI;
+    if (f < 1) {
+      coverage[xMaxI] = (Guchar)(coverage[xMaxI] * f + (SplashCoord)0.5);
+    }
+  }
+
+  // the paths: multiply by their coverage
+  for (i = 0; i < length && *x0 <= *x1; ++i) {
+    scanners[i]->renderAACoverageLine(accum, clipCoverage, *x1 + 1,
+				      &cx0, &cx1, y);
+    if (cx0 > *x0) {
+      *x0 = cx0;
+    }
+    if (cx1 < *x1) {
+      *x1 = cx1;
+    }
+    for (x = *x0; x <= *x1; ++x) {
+      coverage[x] = (Guchar)((coverage[x] * clipCoverage[x] + 127) / 255);
+    }
+  }
+}
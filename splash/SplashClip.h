@@ -71,13 +71,21 @@ public:
   SplashError clipToPath(SplashPath *path, SplashCoord *matrix,
 			 SplashCoord flatness, GBool eo);
 
+  // Restrict the clip to the rows <bandYMinA> .. <bandYMaxA>.  Unlike
+  // clipToRect, this doesn't change the rectangle returned by getXMin,
+  // etc., which Splash uses to lay out paths and images: the pixels
+  // drawn in a band are exactly those drawn without it.
+  void setBand(int bandYMinA, int bandYMaxA)
+    { bandYMin = bandYMinA; bandYMax = bandYMaxA; }
+
   // Returns true if (<x>,<y>) is inside the clip.
   GBool test(int x, int y)
   {
     int i;
 
     // check the rectangle
-    if (x < xMinI || x > xMaxI || y < yMinI || y > yMaxI) {
+    if (x < xMinI || x > xMaxI || y < yMinI || y > yMaxI ||
+	y < bandYMin || y > bandYMax) {
       return gFalse;
     }
 
@@ -108,8 +116,10 @@ public:
   //     clipped
   //   - splashClipPartial if the rectangle is part inside and part
   //     outside the clipping region
+  // If <useBand> is false, the band (see setBand) is ignored.
   SplashClipResult testRect(int rectXMin, int rectYMin,
-			    int rectXMax, int rectYMax);
+			    int rectXMax, int rectYMax,
+			    GBool useBand = gTrue);
 
   // Similar to testRect, but tests a horizontal span.
   SplashClipResult testSpan(int spanXMin, int spanXMax, int spanY);
@@ -120,6 +130,16 @@ public:
   void clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y,
     GBool adjustVertLine = gFalse);
 
+  // Clips a line of exact pixel coverage values (see
+  // SplashXPathScanner::renderAACoverageLine) by multiplying them
+  // with the coverage of the clip region.  On entry, all non-zero
+  // values are between <x0> and <x1>; this function will update <x0>
+  // and <x1> (<x0> > <x1> if nothing is left).  <accum> and
+  // <clipCoverage> are scratch buffers, as large as <coverage> (plus
+  // two entries for <accum>).
+  void clipAACoverageLine(SplashCoord *accum, Guchar *coverage,
+			  Guchar *clipCoverage, int *x0, int *x1, int y);
+
   // Get the rectangle part of the clip region.
   SplashCoord getXMin() { return xMin; }
   SplashCoord getXMax() { return xMax; }
@@ -132,6 +152,11 @@ public:
   int getYMinI() { return yMinI; }
   int getYMaxI() { return yMaxI; }
 
+  // Get the band (see setBand).  Without a band, these are INT_MIN and
+  // INT_MAX.
+  int getBandYMin() { return bandYMin; }
+  int getBandYMax() { return bandYMax; }
+
   // Get the number of arbitrary paths used by the clip region.
   int getNumPaths() { return length; }
 
@@ -143,6 +168,7 @@ protected:
   GBool antialias;
   SplashCoord xMin, yMin, xMax, yMax;
   int xMinI, yMinI, xMaxI, yMaxI;
+  int bandYMin, bandYMax;
   SplashXPath **paths;
   Guchar *flags;
   SplashXPathScanner **scanners;
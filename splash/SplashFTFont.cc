@@ -233,6 +233,11 @@ GBool SplashFTFont::getGlyph(int c, int xFrac, int yFrac,
   return SplashFont::getGlyph(c, xFrac, 0, bitmap, x0, y0, clip, clipRes);
 }
 
+Guint SplashFTFont::getRasterizerID() {
+  return 0x100 | (enableFreeTypeHinting ? 1 : 0) |
+         (enableSlightHinting ? 2 : 0);
+}
+
 static FT_Int32 getFTLoadFlags(GBool type1, GBool trueType, GBool aa, GBool enableFreeTypeHinting, GBool enableSlightHinting)
 {
   int ret = FT_LOAD_DEFAULT;
@@ -64,6 +64,10 @@ public:
   // Return the advance of a glyph. (in 0..1 range)
   virtual double getGlyphAdvance(int c);
 
+protected:
+
+  virtual Guint getRasterizerID();
+
 private:
 
   FT_Size sizeObj;
@@ -27,9 +27,12 @@
 #include <limits.h>
 #include <string.h>
 #include "goo/gmem.h"
+#include "goo/GooString.h"
 #include "SplashMath.h"
 #include "SplashGlyphBitmap.h"
 #include "SplashFontFile.h"
+#include "SplashFontFileID.h"
+#include "SplashGlyphCache.h"
 #include "SplashFont.h"
 
 //------------------------------------------------------------------------
@@ -61,6 +64,9 @@ SplashFont::SplashFont(SplashFontFile *fontFileA, SplashCoord *matA,
 
   cache = NULL;
   cacheTags = NULL;
+  cacheAssoc = 0;
+  glyphCache = NULL;
+  glyphCacheFaceID = 0;
 
   xMin = yMin = xMax = yMax = 0;
 }
@@ -109,6 +115,21 @@ void SplashFont::initCache() {
   }
 }
 
+void SplashFont::shareGlyphs(SplashGlyphCache *glyphCacheA) {
+  GooString *key;
+  Guint rasterizer;
+
+  // the shared cache refills the font's own cache, so there is nothing
+  // to share without one
+  if (cacheAssoc == 0 || !(rasterizer = getRasterizerID()) ||
+      !(key = fontFile->getID()->getSharedKey())) {
+    return;
+  }
+  glyphCache = glyphCacheA;
+  glyphCacheFaceID = glyphCache->getFaceID(key, mat, textMat, aa, rasterizer);
+  delete key;
+}
+
 SplashFont::~SplashFont() {
   fontFile->decRefCnt();
   if (cache) {
@@ -164,6 +185,40 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
     }
   }
 
+  // check the shared cache, copying the glyph to the least recently
+  // used entry of the set
+  if (glyphCache) {
+    for (j = 0; j < cacheAssoc; ++j) {
+      if ((cacheTags[i+j].mru & 0x7fffffff) == cacheAssoc - 1) {
+	break;
+      }
+    }
+    p = cache + (i+j) * glyphSize;
+    if (glyphCache->lookup(glyphCacheFaceID, c, xFrac, yFrac,
+			   bitmap, p, glyphSize)) {
+      for (k = 0; k < cacheAssoc; ++k) {
+	if (k != j) {
+	  ++cacheTags[i+k].mru;
+	}
+      }
+      cacheTags[i+j].mru = 0x80000000;
+      cacheTags[i+j].c = c;
+      cacheTags[i+j].xFrac = (short)xFrac;
+      cacheTags[i+j].yFrac = (short)yFrac;
+      cacheTags[i+j].x = bitmap->x;
+      cacheTags[i+j].y = bitmap->y;
+      cacheTags[i+j].w = bitmap->w;
+      cacheTags[i+j].h = bitmap->h;
+
+      *clipRes = clip->testRect(x0 - bitmap->x,
+                                y0 - bitmap->y,
+                                x0 - bitmap->x + bitmap->w - 1,
+                                y0 - bitmap->y + bitmap->h - 1);
+
+      return gTrue;
+    }
+  }
+
   // generate the glyph bitmap
   if (!makeGlyph(c, xFrac, yFrac, &bitmap2, x0, y0, clip, clipRes)) {
     return gFalse;
@@ -219,6 +274,9 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
     if (bitmap2.freeData) {
       gfree(bitmap2.data);
     }
+    if (glyphCache) {
+      glyphCache->insert(glyphCacheFaceID, c, xFrac, yFrac, bitmap);
+    }
   }
   return gTrue;
 }
@@ -31,6 +31,7 @@
 
 struct SplashGlyphBitmap;
 struct SplashFontCacheTag;
+class SplashGlyphCache;
 class SplashFontFile;
 class SplashPath;
 
@@ -57,6 +58,13 @@ public:
   // constructor has a chance to compute the bbox.
   void initCache();
 
+  // Share the glyph bitmaps of this font with the other fonts that use
+  // <glyphCacheA>: glyphs missing from the font's own cache are looked
+  // up there before being rasterized, and added to it afterwards.  This
+  // has no effect if the font file can't be identified across font
+  // engines.  Must be called after initCache.
+  void shareGlyphs(SplashGlyphCache *glyphCacheA);
+
   virtual ~SplashFont();
 
   SplashFontFile *getFontFile() { return fontFile; }
@@ -102,6 +110,12 @@ public:
 
 protected:
 
+  // Return a non-zero value that identifies the rasterizer and those of
+  // its settings that change the glyph bitmaps, so that fonts made by
+  // different font engines don't share glyphs they would rasterize
+  // differently.  Fonts that return 0 don't share their glyphs.
+  virtual Guint getRasterizerID() { return 0; }
+
   SplashFontFile *fontFile;
   SplashCoord mat[4];		// font transform matrix
 				//   (text space -> device space)
@@ -116,6 +130,8 @@ protected:
   int glyphSize;		// size of glyph bitmaps, in bytes
   int cacheSets;		// number of sets in cache
   int cacheAssoc;		// cache associativity (glyphs per set)
+  SplashGlyphCache *glyphCache;	// shared glyph cache, or NULL
+  Guint glyphCacheFaceID;	// ID of this font in <glyphCache>
 };
 
 #endif
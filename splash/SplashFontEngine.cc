@@ -80,6 +80,7 @@ SplashFontEngine::SplashFontEngine(
   for (i = 0; i < splashFontCacheSize; ++i) {
     fontCache[i] = NULL;
   }
+  glyphCache = NULL;
 
 #if HAVE_T1LIB_H
   if (enableT1lib) {
@@ -326,6 +327,9 @@ SplashFont *SplashFontEngine::getFont(SplashFontFile *fontFile,
     }
   }
   font = fontFile->makeFont(mat, textMat);
+  if (glyphCache) {
+    font->shareGlyphs(glyphCache);
+  }
   if (fontCache[splashFontCacheSize - 1]) {
     delete fontCache[splashFontCacheSize - 1];
   }
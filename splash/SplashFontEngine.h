@@ -40,6 +40,7 @@ class SplashFontFile;
 class SplashFontFileID;
 class SplashFont;
 class SplashFontSrc;
+class SplashGlyphCache;
 
 //------------------------------------------------------------------------
 
@@ -95,9 +96,16 @@ public:
   void setAA(GBool aa);
 #endif
 
+  // Make the fonts created from now on share their glyph bitmaps
+  // through <glyphCacheA> (see SplashFont::shareGlyphs), or stop
+  // sharing them if it is NULL.
+  void setGlyphCache(SplashGlyphCache *glyphCacheA)
+    { glyphCache = glyphCacheA; }
+
 private:
 
   SplashFont *fontCache[splashFontCacheSize];
+  SplashGlyphCache *glyphCache;
 
 #if HAVE_T1LIB_H
   SplashT1FontEngine *t1Engine;
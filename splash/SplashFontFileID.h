@@ -13,6 +13,8 @@
 
 #include "goo/gtypes.h"
 
+class GooString;
+
 //------------------------------------------------------------------------
 // SplashFontFileID
 //------------------------------------------------------------------------
@@ -23,6 +25,12 @@ public:
   SplashFontFileID();
   virtual ~SplashFontFileID();
   virtual GBool matches(SplashFontFileID *id) = 0;
+
+  // Return a string that identifies the font file among all the font
+  // files loaded by the process, so that its glyphs can be shared
+  // between font engines, or NULL if they can't be shared.  The caller
+  // should delete the string.
+  virtual GooString *getSharedKey() { return NULL; }
 };
 
 #endif
@@ -0,0 +1,380 @@
+//========================================================================
+//
+// SplashGlyphCache.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#if MULTITHREADED
+#include "goo/GooMutex.h"
+#endif
+#include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
+
+#if MULTITHREADED
+#  define glyphCacheLocker(M)   MutexLocker locker(M)
+#else
+#  define glyphCacheLocker(M)
+#endif
+
+// Max number of faces remembered by getFaceID.  Past that, the table
+// is emptied: fonts created afterwards get new IDs, and the glyphs of
+// the forgotten faces age out of the cache.
+#define splashGlyphCacheMaxFaces 16384
+
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheKey {
+  Guint faceID;
+  int c;
+  int frac;			// xFrac | (yFrac << 16)
+
+  bool operator==(const SplashGlyphCacheKey &key) const
+    { return faceID == key.faceID && c == key.c && frac == key.frac; }
+};
+
+static inline Guint hashGlyphKey(Guint faceID, int c, int frac) {
+  Guint h;
+
+  h = faceID * 0x9e3779b1u;
+  h ^= (Guint)c * 0x85ebca6bu;
+  h ^= (Guint)frac * 0xc2b2ae35u;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+struct SplashGlyphCacheKeyHash {
+  size_t operator()(const SplashGlyphCacheKey &key) const
+    { return hashGlyphKey(key.faceID, key.c, key.frac); }
+};
+
+// A cached glyph.  The bitmap follows the structure in memory.
+struct SplashGlyphCacheEntry {
+  SplashGlyphCacheKey key;
+  int x, y, w, h;		// offset and size of glyph
+  GBool aa;
+  int dataSize;			// size of the bitmap, in bytes
+  SplashGlyphCacheEntry *prev,	// LRU list, most recently used first
+                        *next;
+
+  Guchar *getData() { return (Guchar *)(this + 1); }
+  long getCost();
+};
+
+// Memory charged to the cache for a glyph: its bitmap plus an estimate
+// of the overhead of the entry and of its hash node.
+static inline long glyphCost(int dataSize) {
+  return dataSize + (long)sizeof(SplashGlyphCacheEntry) + 32;
+}
+
+long SplashGlyphCacheEntry::getCost() {
+  return glyphCost(dataSize);
+}
+
+typedef std::unordered_map<SplashGlyphCacheKey, SplashGlyphCacheEntry *,
+			   SplashGlyphCacheKeyHash> SplashGlyphCacheMap;
+
+struct SplashGlyphCacheShard {
+  SplashGlyphCacheMap entries;
+  SplashGlyphCacheEntry *first,	// LRU list
+                        *last;
+  long size;			// cost of the cached entries
+  long maxSize;
+  long lookups, hits, insertions, evictions;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+
+  void unlink(SplashGlyphCacheEntry *entry);
+  void pushFront(SplashGlyphCacheEntry *entry);
+  void evict(long limit);
+};
+
+void SplashGlyphCacheShard::unlink(SplashGlyphCacheEntry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    first = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    last = entry->prev;
+  }
+}
+
+void SplashGlyphCacheShard::pushFront(SplashGlyphCacheEntry *entry) {
+  entry->prev = NULL;
+  entry->next = first;
+  if (first) {
+    first->prev = entry;
+  } else {
+    last = entry;
+  }
+  first = entry;
+}
+
+// Drop least recently used entries until the size is at most <limit>.
+void SplashGlyphCacheShard::evict(long limit) {
+  SplashGlyphCacheEntry *entry;
+
+  while (size > limit && (entry = last)) {
+    unlink(entry);
+    entries.erase(entry->key);
+    size -= entry->getCost();
+    gfree(entry);
+    ++evictions;
+  }
+}
+
+struct SplashGlyphCacheFaces {
+  std::unordered_map<std::string, Guint> ids;
+  Guint lastID;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+SplashGlyphCache *SplashGlyphCache::getGlobal() {
+  static SplashGlyphCache cache(splashGlyphCacheDefaultSize);
+
+  return &cache;
+}
+
+SplashGlyphCache::SplashGlyphCache(long maxSizeA) {
+  int i;
+
+  shards = new SplashGlyphCacheShard[splashGlyphCacheShards];
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shards[i].first = shards[i].last = NULL;
+    shards[i].size = 0;
+    shards[i].maxSize = maxSizeA / splashGlyphCacheShards;
+    shards[i].lookups = shards[i].hits = 0;
+    shards[i].insertions = shards[i].evictions = 0;
+#if MULTITHREADED
+    gInitMutex(&shards[i].mutex);
+#endif
+  }
+  faces = new SplashGlyphCacheFaces;
+  faces->lastID = 0;
+#if MULTITHREADED
+  gInitMutex(&faces->mutex);
+#endif
+}
+
+SplashGlyphCache::~SplashGlyphCache() {
+  int i;
+
+  clear();
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+#if MULTITHREADED
+    gDestroyMutex(&shards[i].mutex);
+#endif
+  }
+  delete[] shards;
+#if MULTITHREADED
+  gDestroyMutex(&faces->mutex);
+#endif
+  delete faces;
+}
+
+void SplashGlyphCache::setMaxSize(long maxSizeA) {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  if (maxSizeA < 0) {
+    maxSizeA = 0;
+  }
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    glyphCacheLocker(&shard->mutex);
+    shard->maxSize = maxSizeA / splashGlyphCacheShards;
+    shard->evict(shard->maxSize);
+  }
+}
+
+long SplashGlyphCache::getMaxSize() {
+  SplashGlyphCacheShard *shard;
+  long maxSize;
+  int i;
+
+  maxSize = 0;
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    glyphCacheLocker(&shard->mutex);
+    maxSize += shard->maxSize;
+  }
+  return maxSize;
+}
+
+Guint SplashGlyphCache::getFaceID(GooString *fontKey, SplashCoord *mat,
+				  SplashCoord *textMat, GBool aa,
+				  Guint rasterizer) {
+  std::string key;
+  std::unordered_map<std::string, Guint>::iterator it;
+  char flag;
+
+  // the matrices are compared bit for bit: a face that only differs by
+  // the sign of a zero gets its own ID, which is harmless
+  key.assign(fontKey->getCString(), fontKey->getLength());
+  key.append((const char *)mat, 4 * sizeof(SplashCoord));
+  key.append((const char *)textMat, 4 * sizeof(SplashCoord));
+  flag = aa ? 1 : 0;
+  key.append(&flag, 1);
+  key.append((const char *)&rasterizer, sizeof(rasterizer));
+
+  glyphCacheLocker(&faces->mutex);
+  it = faces->ids.find(key);
+  if (it != faces->ids.end()) {
+    return it->second;
+  }
+  if ((int)faces->ids.size() >= splashGlyphCacheMaxFaces) {
+    faces->ids.clear();
+  }
+  faces->ids[key] = ++faces->lastID;
+  return faces->lastID;
+}
+
+SplashGlyphCacheShard *SplashGlyphCache::getShard(Guint faceID, int c,
+						  int xFrac, int yFrac) {
+  return &shards[(hashGlyphKey(faceID, c, xFrac | (yFrac << 16)) >> 16) %
+		 splashGlyphCacheShards];
+}
+
+GBool SplashGlyphCache::lookup(Guint faceID, int c, int xFrac, int yFrac,
+			       SplashGlyphBitmap *bitmap,
+			       Guchar *data, int dataSize) {
+  SplashGlyphCacheShard *shard;
+  SplashGlyphCacheEntry *entry;
+  SplashGlyphCacheMap::iterator it;
+  SplashGlyphCacheKey key;
+
+  key.faceID = faceID;
+  key.c = c;
+  key.frac = xFrac | (yFrac << 16);
+  shard = getShard(faceID, c, xFrac, yFrac);
+  glyphCacheLocker(&shard->mutex);
+  ++shard->lookups;
+  it = shard->entries.find(key);
+  if (it == shard->entries.end()) {
+    return gFalse;
+  }
+  entry = it->second;
+  if (entry->dataSize > dataSize) {
+    return gFalse;
+  }
+  ++shard->hits;
+  if (entry != shard->first) {
+    shard->unlink(entry);
+    shard->pushFront(entry);
+  }
+  memcpy(data, entry->getData(), entry->dataSize);
+  bitmap->x = entry->x;
+  bitmap->y = entry->y;
+  bitmap->w = entry->w;
+  bitmap->h = entry->h;
+  bitmap->aa = entry->aa;
+  bitmap->data = data;
+  bitmap->freeData = gFalse;
+  return gTrue;
+}
+
+void SplashGlyphCache::insert(Guint faceID, int c, int xFrac, int yFrac,
+			      SplashGlyphBitmap *bitmap) {
+  SplashGlyphCacheShard *shard;
+  SplashGlyphCacheEntry *entry;
+  SplashGlyphCacheKey key;
+  int dataSize;
+
+  if (bitmap->aa) {
+    dataSize = bitmap->w * bitmap->h;
+  } else {
+    dataSize = ((bitmap->w + 7) >> 3) * bitmap->h;
+  }
+  key.faceID = faceID;
+  key.c = c;
+  key.frac = xFrac | (yFrac << 16);
+  shard = getShard(faceID, c, xFrac, yFrac);
+  glyphCacheLocker(&shard->mutex);
+  if (glyphCost(dataSize) > shard->maxSize ||
+      shard->entries.find(key) != shard->entries.end()) {
+    return;
+  }
+  entry = (SplashGlyphCacheEntry *)gmalloc(sizeof(SplashGlyphCacheEntry) +
+					   dataSize);
+  entry->key = key;
+  entry->x = bitmap->x;
+  entry->y = bitmap->y;
+  entry->w = bitmap->w;
+  entry->h = bitmap->h;
+  entry->aa = bitmap->aa;
+  entry->dataSize = dataSize;
+  memcpy(entry->getData(), bitmap->data, dataSize);
+  shard->evict(shard->maxSize - entry->getCost());
+  shard->entries[key] = entry;
+  shard->pushFront(entry);
+  shard->size += entry->getCost();
+  ++shard->insertions;
+}
+
+void SplashGlyphCache::clear() {
+  SplashGlyphCacheShard *shard;
+  long evictions;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    glyphCacheLocker(&shard->mutex);
+    evictions = shard->evictions;
+    shard->evict(0);
+    shard->evictions = evictions;
+  }
+}
+
+void SplashGlyphCache::getStats(SplashGlyphCacheStats *stats) {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  memset(stats, 0, sizeof(*stats));
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    glyphCacheLocker(&shard->mutex);
+    stats->lookups += shard->lookups;
+    stats->hits += shard->hits;
+    stats->insertions += shard->insertions;
+    stats->evictions += shard->evictions;
+    stats->glyphs += (long)shard->entries.size();
+    stats->size += shard->size;
+    stats->maxSize += shard->maxSize;
+  }
+}
+
+void SplashGlyphCache::resetStats() {
+  SplashGlyphCacheShard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    glyphCacheLocker(&shard->mutex);
+    shard->lookups = shard->hits = 0;
+    shard->insertions = shard->evictions = 0;
+  }
+}
@@ -0,0 +1,109 @@
+//========================================================================
+//
+// SplashGlyphCache.h
+//
+// Process-wide cache of glyph bitmaps, shared by font engines.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHGLYPHCACHE_H
+#define SPLASHGLYPHCACHE_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "goo/gtypes.h"
+#include "SplashTypes.h"
+
+class GooString;
+struct SplashGlyphBitmap;
+struct SplashGlyphCacheShard;
+struct SplashGlyphCacheFaces;
+
+//------------------------------------------------------------------------
+
+// Default max size of the glyph cache, in bytes.
+#define splashGlyphCacheDefaultSize (16 * 1024 * 1024)
+
+// Number of independently locked shards.
+#define splashGlyphCacheShards 16
+
+//------------------------------------------------------------------------
+// SplashGlyphCacheStats
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheStats {
+  long lookups;			// number of lookups
+  long hits;			// number of lookups that found a glyph
+  long insertions;		// number of glyphs added
+  long evictions;		// number of glyphs dropped to make room
+  long glyphs;			// number of glyphs in the cache
+  long size;			// size of the cached glyphs, in bytes
+  long maxSize;			// max size, in bytes
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+// The glyph bitmaps are keyed by face and character code (and
+// fractional position).  A face is a font file at a given transform,
+// with given anti-aliasing and rasterizer settings: each SplashFont
+// that uses the cache gets the ID of its face once, from getFaceID.
+//
+// The cache is split into shards, each with its own lock and its own
+// LRU list, so that threads rasterizing text in parallel rarely
+// contend.  Bitmaps are copied in and out of the cache, so that a
+// glyph returned by lookup stays valid when other threads evict it.
+class SplashGlyphCache {
+public:
+
+  // Return the cache shared by the whole process.
+  static SplashGlyphCache *getGlobal();
+
+  SplashGlyphCache(long maxSizeA);
+  ~SplashGlyphCache();
+
+  // Change the max size of the cache, in bytes, evicting glyphs if
+  // needed.  A size of 0 keeps nothing.
+  void setMaxSize(long maxSizeA);
+  long getMaxSize();
+
+  // Return the ID of the face identified by <fontKey> (see
+  // SplashFontFileID::getSharedKey), the font transform <mat> and text
+  // transform <textMat>, anti-aliasing <aa>, and <rasterizer>, a value
+  // that distinguishes the rasterizers and their settings.  IDs are
+  // never reused.
+  Guint getFaceID(GooString *fontKey, SplashCoord *mat, SplashCoord *textMat,
+		  GBool aa, Guint rasterizer);
+
+  // If the glyph is cached and its bitmap takes at most <dataSize>
+  // bytes, copy the bitmap to <data>, fill in <bitmap> (pointing to
+  // <data>) and return true.
+  GBool lookup(Guint faceID, int c, int xFrac, int yFrac,
+	       SplashGlyphBitmap *bitmap, Guchar *data, int dataSize);
+
+  // Add a copy of a glyph bitmap to the cache, evicting the least
+  // recently used glyphs of its shard if needed.
+  void insert(Guint faceID, int c, int xFrac, int yFrac,
+	      SplashGlyphBitmap *bitmap);
+
+  // Drop all cached glyphs.
+  void clear();
+
+  // Get the statistics, summed over the shards.
+  void getStats(SplashGlyphCacheStats *stats);
+  void resetStats();
+
+private:
+
+  SplashGlyphCacheShard *getShard(Guint faceID, int c, int xFrac, int yFrac);
+
+  SplashGlyphCacheShard *shards;
+  SplashGlyphCacheFaces *faces;
+};
+
+#endif
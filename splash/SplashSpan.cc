@@ -0,0 +1,727 @@
+//========================================================================
+//
+// SplashSpan.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "SplashSpan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define SPLASH_SPAN_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#    define SPLASH_SPAN_AVX2 1
+#    include <immintrin.h>
+#    define AVX2_FUNC __attribute__((target("avx2")))
+#  endif
+#endif
+
+//------------------------------------------------------------------------
+// pixel layout
+//------------------------------------------------------------------------
+
+// Get the number of bytes per pixel and the number of color components
+// (the 4th byte of an XBGR8 pixel is always 255).
+static GBool getLayout(SplashColorMode mode, int *nBytes, int *nComps) {
+  switch (mode) {
+  case splashModeMono8:
+    *nBytes = *nComps = 1;
+    return gTrue;
+  case splashModeRGB8:
+  case splashModeBGR8:
+    *nBytes = *nComps = 3;
+    return gTrue;
+  case splashModeXBGR8:
+    *nBytes = 4;
+    *nComps = 3;
+    return gTrue;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    *nBytes = *nComps = 4;
+    return gTrue;
+#endif
+  default:
+    return gFalse;
+  }
+}
+
+// Divide a 16-bit value (in [0, 255*255]) by 255, returning an 8-bit
+// result -- the same rounding as in Splash.cc.
+static inline Guchar div255(int x) {
+  return (Guchar)((x + (x >> 8) + 0x80) >> 8);
+}
+
+//------------------------------------------------------------------------
+// scalar kernels
+//------------------------------------------------------------------------
+
+static void fillScalar(int nBytes, Guchar *pixel, Guchar *dest,
+		       Guchar *destAlpha, int n) {
+  int i;
+
+  switch (nBytes) {
+  case 1:
+    memset(dest, pixel[0], n);
+    break;
+  case 3:
+    for (i = 0; i < n; ++i, dest += 3) {
+      dest[0] = pixel[0];
+      dest[1] = pixel[1];
+      dest[2] = pixel[2];
+    }
+    break;
+  case 4:
+    for (i = 0; i < n; ++i, dest += 4) {
+      memcpy(dest, pixel, 4);
+    }
+    break;
+  }
+  if (destAlpha) {
+    memset(destAlpha, 255, n);
+  }
+}
+
+static void compositeScalar(int nBytes, int nComps, SplashSpanSrc *src,
+			    Guchar *dest, Guchar *destAlpha, int n) {
+  int aSrc, aDest, aResult, c, i, k;
+
+  for (i = 0; i < n; ++i, dest += nBytes) {
+    aSrc = div255(src->aInput * (src->softMask ? src->softMask[i] : 255));
+    aSrc = div255(aSrc * (src->shape ? src->shape[i] : src->shapeVal));
+    aDest = destAlpha[i];
+    aResult = aSrc + aDest - div255(aSrc * aDest);
+    for (k = 0; k < nComps; ++k) {
+      if (aResult == 0) {
+	dest[k] = 0;
+      } else {
+	c = ((aResult - aSrc) * dest[k] + aSrc * src->color[k]) / aResult;
+	dest[k] = src->transfer[0] ? src->transfer[k][c] : c;
+      }
+    }
+    if (nBytes > nComps) {
+      dest[nComps] = 255;
+    }
+    destAlpha[i] = aResult;
+  }
+}
+
+// Composite pixels [start, n) of a span with the scalar kernel -- the
+// ones left over by a vector kernel.
+static void compositeTail(int nBytes, int nComps, SplashSpanSrc *src,
+			  Guchar *dest, Guchar *destAlpha, int start, int n) {
+  SplashSpanSrc tail;
+
+  if (start >= n) {
+    return;
+  }
+  tail = *src;
+  if (tail.shape) {
+    tail.shape += start;
+  }
+  if (tail.softMask) {
+    tail.softMask += start;
+  }
+  compositeScalar(nBytes, nComps, &tail, dest + start * nBytes,
+		  destAlpha + start, n - start);
+}
+
+// The vector kernels composite without the transfer functions, then
+// apply them to the pixels they wrote.
+static void applyTransfer(int nBytes, int nComps, SplashSpanSrc *src,
+			  Guchar *dest, Guchar *destAlpha, int n) {
+  int i, k;
+
+  for (i = 0; i < n; ++i, dest += nBytes) {
+    if (destAlpha[i]) {
+      for (k = 0; k < nComps; ++k) {
+	dest[k] = src->transfer[k][dest[k]];
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// SSE2 kernels
+//
+// The arithmetic is done on 16-bit lanes.  The division by the result
+// alpha is done in single precision, which is exact here: the quotient
+// of two integers below 2^16, with a divisor of at most 255, is either
+// an integer or at least 1/255 away from one, far more than the
+// rounding error of the division, so truncating it gives the integer
+// quotient.
+//------------------------------------------------------------------------
+
+#if SPLASH_SPAN_SSE2
+
+static inline __m128i div255SSE2(__m128i x) {
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)),
+				      _mm_set1_epi16(0x80)),
+			8);
+}
+
+// Load 8 bytes into 16-bit lanes.
+static inline __m128i load8SSE2(const Guchar *p) {
+  return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),
+			   _mm_setzero_si128());
+}
+
+// Store the 16-bit lanes (all in [0, 255]) as 8 bytes.
+static inline void store8SSE2(Guchar *p, __m128i x) {
+  _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(x, x));
+}
+
+// <num> / <den>, or 0 where <den> is 0.
+static inline __m128i divideSSE2(__m128i num, __m128i den) {
+  __m128i zero, q;
+  __m128 numLo, numHi, denLo, denHi;
+
+  zero = _mm_setzero_si128();
+  numLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(num, zero));
+  numHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(num, zero));
+  denLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(den, zero));
+  denHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(den, zero));
+  q = _mm_packs_epi32(_mm_cvttps_epi32(_mm_div_ps(numLo, denLo)),
+		      _mm_cvttps_epi32(_mm_div_ps(numHi, denHi)));
+  return _mm_andnot_si128(_mm_cmpeq_epi16(den, zero), q);
+}
+
+// Get byte <k> of eight 4-byte pixels (<lo> and <hi>) as 16-bit lanes.
+static inline __m128i getByteSSE2(__m128i lo, __m128i hi, int k) {
+  __m128i mask;
+
+  mask = _mm_set1_epi32(0xff);
+  switch (k) {
+  case 0:
+    break;
+  case 1:
+    lo = _mm_srli_epi32(lo, 8);
+    hi = _mm_srli_epi32(hi, 8);
+    break;
+  case 2:
+    lo = _mm_srli_epi32(lo, 16);
+    hi = _mm_srli_epi32(hi, 16);
+    break;
+  default:
+    lo = _mm_srli_epi32(lo, 24);
+    hi = _mm_srli_epi32(hi, 24);
+    break;
+  }
+  return _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+}
+
+// The vector kernels handle whole blocks of pixels: they start at pixel
+// <start> and return the index of the first pixel they left.  The fill
+// kernels store 48 (or 96) bytes
+// at a time, i.e., 16 (32) RGB pixels or 12 (24) XBGR or CMYK pixels.
+static int fillSSE2(int nBytes, Guchar *pixel, Guchar *dest, int start,
+		    int n) {
+  Guchar pattern[48];
+  __m128i v0, v1, v2;
+  int nPixels, i, j;
+
+  for (j = 0; j < 48; j += nBytes) {
+    memcpy(pattern + j, pixel, nBytes);
+  }
+  v0 = _mm_loadu_si128((const __m128i *)pattern);
+  v1 = _mm_loadu_si128((const __m128i *)(pattern + 16));
+  v2 = _mm_loadu_si128((const __m128i *)(pattern + 32));
+  nPixels = 48 / nBytes;
+  dest += start * nBytes;
+  for (i = start; i + nPixels <= n; i += nPixels, dest += 48) {
+    _mm_storeu_si128((__m128i *)dest, v0);
+    _mm_storeu_si128((__m128i *)(dest + 16), v1);
+    _mm_storeu_si128((__m128i *)(dest + 32), v2);
+  }
+  return i;
+}
+
+static int compositeSSE2(int nBytes, int nComps, SplashSpanSrc *src,
+			 Guchar *dest, Guchar *destAlpha, int start, int n) {
+  union {
+    __m128i v;
+    Gushort s[8];
+  } planes[3];
+  __m128i color[4], cDest[4], cResult[4];
+  __m128i aInput, shapeVal, aSrc, aDest, aResult, aDestWeight;
+  __m128i lo, hi, zero, opaque;
+  Guchar *p;
+  int i, j, k;
+
+  zero = _mm_setzero_si128();
+  opaque = _mm_set1_epi32((int)0xff000000);
+  aInput = _mm_set1_epi16(src->aInput);
+  shapeVal = _mm_set1_epi16(src->shapeVal);
+  for (k = 0; k < nComps; ++k) {
+    color[k] = _mm_set1_epi16(src->color[k]);
+  }
+
+  for (i = start; i + 8 <= n; i += 8) {
+    p = dest + i * nBytes;
+
+    //----- alpha
+    aSrc = aInput;
+    if (src->softMask) {
+      aSrc = div255SSE2(_mm_mullo_epi16(aSrc, load8SSE2(src->softMask + i)));
+    }
+    aSrc = div255SSE2(_mm_mullo_epi16(aSrc, src->shape
+					      ? load8SSE2(src->shape + i)
+					      : shapeVal));
+    aDest = load8SSE2(destAlpha + i);
+    aResult = _mm_sub_epi16(_mm_add_epi16(aSrc, aDest),
+			    div255SSE2(_mm_mullo_epi16(aSrc, aDest)));
+    aDestWeight = _mm_sub_epi16(aResult, aSrc);
+
+    //----- read destination pixels
+    switch (nBytes) {
+    case 1:
+      cDest[0] = load8SSE2(p);
+      break;
+    case 3:
+      for (j = 0; j < 8; ++j) {
+	planes[0].s[j] = p[3 * j];
+	planes[1].s[j] = p[3 * j + 1];
+	planes[2].s[j] = p[3 * j + 2];
+      }
+      for (k = 0; k < 3; ++k) {
+	cDest[k] = planes[k].v;
+      }
+      break;
+    case 4:
+      lo = _mm_loadu_si128((const __m128i *)p);
+      hi = _mm_loadu_si128((const __m128i *)(p + 16));
+      for (k = 0; k < nComps; ++k) {
+	cDest[k] = getByteSSE2(lo, hi, k);
+      }
+      break;
+    }
+
+    //----- result color
+    for (k = 0; k < nComps; ++k) {
+      cResult[k] = divideSSE2(_mm_add_epi16(_mm_mullo_epi16(aDestWeight,
+							    cDest[k]),
+					    _mm_mullo_epi16(aSrc, color[k])),
+			      aResult);
+    }
+
+    //----- write destination pixels
+    switch (nBytes) {
+    case 1:
+      store8SSE2(p, cResult[0]);
+      break;
+    case 3:
+      for (k = 0; k < 3; ++k) {
+	planes[k].v = cResult[k];
+      }
+      for (j = 0; j < 8; ++j) {
+	p[3 * j] = (Guchar)planes[0].s[j];
+	p[3 * j + 1] = (Guchar)planes[1].s[j];
+	p[3 * j + 2] = (Guchar)planes[2].s[j];
+      }
+      break;
+    case 4:
+      lo = _mm_or_si128(
+	       _mm_or_si128(_mm_unpacklo_epi16(cResult[0], zero),
+			    _mm_slli_epi32(_mm_unpacklo_epi16(cResult[1], zero),
+					   8)),
+	       _mm_slli_epi32(_mm_unpacklo_epi16(cResult[2], zero), 16));
+      hi = _mm_or_si128(
+	       _mm_or_si128(_mm_unpackhi_epi16(cResult[0], zero),
+			    _mm_slli_epi32(_mm_unpackhi_epi16(cResult[1], zero),
+					   8)),
+	       _mm_slli_epi32(_mm_unpackhi_epi16(cResult[2], zero), 16));
+      if (nComps == 4) {
+	lo = _mm_or_si128(lo, _mm_slli_epi32(_mm_unpacklo_epi16(cResult[3],
+								zero), 24));
+	hi = _mm_or_si128(hi, _mm_slli_epi32(_mm_unpackhi_epi16(cResult[3],
+								zero), 24));
+      } else {
+	lo = _mm_or_si128(lo, opaque);
+	hi = _mm_or_si128(hi, opaque);
+      }
+      _mm_storeu_si128((__m128i *)p, lo);
+      _mm_storeu_si128((__m128i *)(p + 16), hi);
+      break;
+    }
+    store8SSE2(destAlpha + i, aResult);
+
+    if (src->transfer[0]) {
+      applyTransfer(nBytes, nComps, src, p, destAlpha + i, 8);
+    }
+  }
+  return i;
+}
+
+#endif // SPLASH_SPAN_SSE2
+
+//------------------------------------------------------------------------
+// AVX2 kernels
+//
+// The same as the SSE2 ones, 16 pixels at a time.  They are compiled
+// for AVX2 whatever the compiler flags, and only called if the CPU
+// supports it.
+//------------------------------------------------------------------------
+
+#if SPLASH_SPAN_AVX2
+
+AVX2_FUNC static inline __m256i div255AVX2(__m256i x) {
+  return _mm256_srli_epi16(
+	     _mm256_add_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)),
+			      _mm256_set1_epi16(0x80)),
+	     8);
+}
+
+// Load 16 bytes into 16-bit lanes.
+AVX2_FUNC static inline __m256i load16AVX2(const Guchar *p) {
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+// Store the 16-bit lanes (all in [0, 255]) as 16 bytes.
+AVX2_FUNC static inline void store16AVX2(Guchar *p, __m256i x) {
+  _mm_storeu_si128((__m128i *)p,
+		   _mm_packus_epi16(_mm256_castsi256_si128(x),
+				    _mm256_extracti128_si256(x, 1)));
+}
+
+// <num> / <den>, or 0 where <den> is 0.
+AVX2_FUNC static inline __m256i divideAVX2(__m256i num, __m256i den) {
+  __m256i q;
+  __m256 numLo, numHi, denLo, denHi;
+
+  numLo = _mm256_cvtepi32_ps(
+	      _mm256_cvtepu16_epi32(_mm256_castsi256_si128(num)));
+  numHi = _mm256_cvtepi32_ps(
+	      _mm256_cvtepu16_epi32(_mm256_extracti128_si256(num, 1)));
+  denLo = _mm256_cvtepi32_ps(
+	      _mm256_cvtepu16_epi32(_mm256_castsi256_si128(den)));
+  denHi = _mm256_cvtepi32_ps(
+	      _mm256_cvtepu16_epi32(_mm256_extracti128_si256(den, 1)));
+  // packs works within 128-bit lanes, so put the quarters back in order
+  q = _mm256_permute4x64_epi64(
+	  _mm256_packs_epi32(_mm256_cvttps_epi32(_mm256_div_ps(numLo, denLo)),
+			     _mm256_cvttps_epi32(_mm256_div_ps(numHi, denHi))),
+	  0xd8);
+  return _mm256_andnot_si256(_mm256_cmpeq_epi16(den, _mm256_setzero_si256()),
+			     q);
+}
+
+// Get byte <k> of sixteen 4-byte pixels (<lo> and <hi>) as 16-bit
+// lanes.
+AVX2_FUNC static inline __m256i getByteAVX2(__m256i lo, __m256i hi, int k) {
+  __m256i mask;
+
+  mask = _mm256_set1_epi32(0xff);
+  switch (k) {
+  case 0:
+    break;
+  case 1:
+    lo = _mm256_srli_epi32(lo, 8);
+    hi = _mm256_srli_epi32(hi, 8);
+    break;
+  case 2:
+    lo = _mm256_srli_epi32(lo, 16);
+    hi = _mm256_srli_epi32(hi, 16);
+    break;
+  default:
+    lo = _mm256_srli_epi32(lo, 24);
+    hi = _mm256_srli_epi32(hi, 24);
+    break;
+  }
+  return _mm256_permute4x64_epi64(
+	     _mm256_packs_epi32(_mm256_and_si256(lo, mask),
+				_mm256_and_si256(hi, mask)),
+	     0xd8);
+}
+
+// Put the 16-bit lanes <c>, for 16 pixels, into byte <k> of 4-byte
+// pixels.
+AVX2_FUNC static inline void putByteAVX2(__m256i *lo, __m256i *hi,
+					 __m256i c, int k) {
+  __m256i cLo, cHi;
+
+  cLo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(c));
+  cHi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(c, 1));
+  switch (k) {
+  case 0:
+    break;
+  case 1:
+    cLo = _mm256_slli_epi32(cLo, 8);
+    cHi = _mm256_slli_epi32(cHi, 8);
+    break;
+  case 2:
+    cLo = _mm256_slli_epi32(cLo, 16);
+    cHi = _mm256_slli_epi32(cHi, 16);
+    break;
+  default:
+    cLo = _mm256_slli_epi32(cLo, 24);
+    cHi = _mm256_slli_epi32(cHi, 24);
+    break;
+  }
+  *lo = _mm256_or_si256(*lo, cLo);
+  *hi = _mm256_or_si256(*hi, cHi);
+}
+
+AVX2_FUNC static int fillAVX2(int nBytes, Guchar *pixel, Guchar *dest,
+			      int start, int n) {
+  Guchar pattern[96];
+  __m256i v0, v1, v2;
+  int nPixels, i, j;
+
+  for (j = 0; j < 96; j += nBytes) {
+    memcpy(pattern + j, pixel, nBytes);
+  }
+  v0 = _mm256_loadu_si256((const __m256i *)pattern);
+  v1 = _mm256_loadu_si256((const __m256i *)(pattern + 32));
+  v2 = _mm256_loadu_si256((const __m256i *)(pattern + 64));
+  nPixels = 96 / nBytes;
+  dest += start * nBytes;
+  for (i = start; i + nPixels <= n; i += nPixels, dest += 96) {
+    _mm256_storeu_si256((__m256i *)dest, v0);
+    _mm256_storeu_si256((__m256i *)(dest + 32), v1);
+    _mm256_storeu_si256((__m256i *)(dest + 64), v2);
+  }
+  return i;
+}
+
+AVX2_FUNC static int compositeAVX2(int nBytes, int nComps,
+				   SplashSpanSrc *src, Guchar *dest,
+				   Guchar *destAlpha, int start, int n) {
+  union {
+    __m256i v;
+    Gushort s[16];
+  } planes[3];
+  __m256i color[4], cDest[4], cResult[4];
+  __m256i aInput, shapeVal, aSrc, aDest, aResult, aDestWeight;
+  __m256i lo, hi;
+  Guchar *p;
+  int i, j, k;
+
+  aInput = _mm256_set1_epi16(src->aInput);
+  shapeVal = _mm256_set1_epi16(src->shapeVal);
+  for (k = 0; k < nComps; ++k) {
+    color[k] = _mm256_set1_epi16(src->color[k]);
+  }
+
+  for (i = start; i + 16 <= n; i += 16) {
+    p = dest + i * nBytes;
+
+    //----- alpha
+    aSrc = aInput;
+    if (src->softMask) {
+      aSrc = div255AVX2(_mm256_mullo_epi16(aSrc,
+					   load16AVX2(src->softMask + i)));
+    }
+    aSrc = div255AVX2(_mm256_mullo_epi16(aSrc, src->shape
+						 ? load16AVX2(src->shape + i)
+						 : shapeVal));
+    aDest = load16AVX2(destAlpha + i);
+    aResult = _mm256_sub_epi16(_mm256_add_epi16(aSrc, aDest),
+			       div255AVX2(_mm256_mullo_epi16(aSrc, aDest)));
+    aDestWeight = _mm256_sub_epi16(aResult, aSrc);
+
+    //----- read destination pixels
+    switch (nBytes) {
+    case 1:
+      cDest[0] = load16AVX2(p);
+      break;
+    case 3:
+      for (j = 0; j < 16; ++j) {
+	planes[0].s[j] = p[3 * j];
+	planes[1].s[j] = p[3 * j + 1];
+	planes[2].s[j] = p[3 * j + 2];
+      }
+      for (k = 0; k < 3; ++k) {
+	cDest[k] = planes[k].v;
+      }
+      break;
+    case 4:
+      lo = _mm256_loadu_si256((const __m256i *)p);
+      hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+      for (k = 0; k < nComps; ++k) {
+	cDest[k] = getByteAVX2(lo, hi, k);
+      }
+      break;
+    }
+
+    //----- result color
+    for (k = 0; k < nComps; ++k) {
+      cResult[k] = divideAVX2(
+		       _mm256_add_epi16(_mm256_mullo_epi16(aDestWeight,
+							   cDest[k]),
+					_mm256_mullo_epi16(aSrc, color[k])),
+		       aResult);
+    }
+
+    //----- write destination pixels
+    switch (nBytes) {
+    case 1:
+      store16AVX2(p, cResult[0]);
+      break;
+    case 3:
+      for (k = 0; k < 3; ++k) {
+	planes[k].v = cResult[k];
+      }
+      for (j = 0; j < 16; ++j) {
+	p[3 * j] = (Guchar)planes[0].s[j];
+	p[3 * j + 1] = (Guchar)planes[1].s[j];
+	p[3 * j + 2] = (Guchar)planes[2].s[j];
+      }
+      break;
+    case 4:
+      if (nComps == 4) {
+	lo = hi = _mm256_setzero_si256();
+      } else {
+	lo = hi = _mm256_set1_epi32((int)0xff000000);
+      }
+      for (k = 0; k < nComps; ++k) {
+	putByteAVX2(&lo, &hi, cResult[k], k);
+      }
+      _mm256_storeu_si256((__m256i *)p, lo);
+      _mm256_storeu_si256((__m256i *)(p + 32), hi);
+      break;
+    }
+    store16AVX2(destAlpha + i, aResult);
+
+    if (src->transfer[0]) {
+      applyTransfer(nBytes, nComps, src, p, destAlpha + i, 16);
+    }
+  }
+  return i;
+}
+
+static GBool cpuHasAVX2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? gTrue : gFalse;
+}
+
+#endif // SPLASH_SPAN_AVX2
+
+//------------------------------------------------------------------------
+// dispatch
+//------------------------------------------------------------------------
+
+static SplashSpanImpl getBestImpl() {
+#if SPLASH_SPAN_AVX2
+  if (cpuHasAVX2()) {
+    return splashSpanImplAVX2;
+  }
+#endif
+#if SPLASH_SPAN_SSE2
+  return splashSpanImplSSE2;
+#else
+  return splashSpanImplScalar;
+#endif
+}
+
+static SplashSpanImpl spanImpl = getBestImpl();
+
+SplashSpanImpl splashSpanGetImpl() {
+  return spanImpl;
+}
+
+GBool splashSpanSetImpl(SplashSpanImpl impl) {
+  if (!splashSpanImplAvailable(impl)) {
+    return gFalse;
+  }
+  spanImpl = impl;
+  return gTrue;
+}
+
+GBool splashSpanImplAvailable(SplashSpanImpl impl) {
+  switch (impl) {
+  case splashSpanImplNone:
+  case splashSpanImplScalar:
+    return gTrue;
+  case splashSpanImplSSE2:
+#if SPLASH_SPAN_SSE2
+    return gTrue;
+#else
+    return gFalse;
+#endif
+  case splashSpanImplAVX2:
+#if SPLASH_SPAN_AVX2
+    return cpuHasAVX2();
+#else
+    return gFalse;
+#endif
+  }
+  return gFalse;
+}
+
+GBool splashSpanModeSupported(SplashColorMode mode) {
+  int nBytes, nComps;
+
+  return getLayout(mode, &nBytes, &nComps);
+}
+
+void splashSpanFill(SplashColorMode mode, SplashColorPtr dest,
+		    Guchar *destAlpha, Guchar *pixel, int n) {
+  int nBytes, nComps, done;
+
+  if (n <= 0 || !getLayout(mode, &nBytes, &nComps)) {
+    return;
+  }
+
+  // Mono8 is a memset, and short spans aren't worth setting up the
+  // pattern for
+  done = 0;
+  if (nBytes > 1 && n >= 64) {
+    switch (spanImpl) {
+#if SPLASH_SPAN_AVX2
+    case splashSpanImplAVX2:
+      done = fillAVX2(nBytes, pixel, dest, 0, n);
+      break;
+#endif
+#if SPLASH_SPAN_SSE2
+    case splashSpanImplSSE2:
+      done = fillSSE2(nBytes, pixel, dest, 0, n);
+      break;
+#endif
+    default:
+      break;
+    }
+  }
+  fillScalar(nBytes, pixel, dest + done * nBytes, NULL, n - done);
+  if (destAlpha) {
+    memset(destAlpha, 255, n);
+  }
+}
+
+void splashSpanComposite(SplashColorMode mode, SplashSpanSrc *src,
+			 SplashColorPtr dest, Guchar *destAlpha, int n) {
+  int nBytes, nComps, done;
+
+  if (n <= 0 || !getLayout(mode, &nBytes, &nComps)) {
+    return;
+  }
+
+  // the AVX2 kernel leaves up to 15 pixels, and the SSE2 one up to 7
+  done = 0;
+  switch (spanImpl) {
+#if SPLASH_SPAN_AVX2
+  case splashSpanImplAVX2:
+    if (n >= 16) {
+      done = compositeAVX2(nBytes, nComps, src, dest, destAlpha, 0, n);
+    }
+    // fall through
+#endif
+#if SPLASH_SPAN_SSE2
+  case splashSpanImplSSE2:
+    if (n - done >= 8) {
+      done = compositeSSE2(nBytes, nComps, src, dest, destAlpha, done, n);
+    }
+    break;
+#endif
+  default:
+    break;
+  }
+  compositeTail(nBytes, nComps, src, dest, destAlpha, done, n);
+}
@@ -0,0 +1,80 @@
+//========================================================================
+//
+// SplashSpan.h
+//
+// Span compositing kernels for the Splash pipeline.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHSPAN_H
+#define SPLASHSPAN_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "SplashTypes.h"
+
+//------------------------------------------------------------------------
+// SplashSpanImpl
+//------------------------------------------------------------------------
+
+enum SplashSpanImpl {
+  splashSpanImplNone,		// no span kernels: Splash composites pixel
+				//   by pixel
+  splashSpanImplScalar,		// portable C
+  splashSpanImplSSE2,
+  splashSpanImplAVX2
+};
+
+// The implementation in use.  By default it is the fastest one the CPU
+// supports.
+SplashSpanImpl splashSpanGetImpl();
+
+// Select the implementation, e.g., to compare them in tests.  Returns
+// false, and keeps the current one, if <impl> isn't available.  This
+// is not thread safe: it must not be called while rendering.
+GBool splashSpanSetImpl(SplashSpanImpl impl);
+
+// Is <impl> available on this CPU?
+GBool splashSpanImplAvailable(SplashSpanImpl impl);
+
+// Do the span kernels handle bitmaps in <mode>?  They handle Mono8,
+// RGB8, BGR8, XBGR8 and CMYK8.
+GBool splashSpanModeSupported(SplashColorMode mode);
+
+//------------------------------------------------------------------------
+// SplashSpanSrc
+//
+// The source of a composited span: a constant color with a constant
+// alpha, which can be modulated, per pixel, by a shape (i.e., the
+// antialiasing coverage) and a soft mask.
+//------------------------------------------------------------------------
+
+struct SplashSpanSrc {
+  Guchar color[4];		// color, in the byte order of the bitmap
+  Guchar aInput;		// alpha
+  Guchar *shape;		// shape of each pixel, or NULL to use
+				//   <shapeVal> for all of them
+  Guchar shapeVal;
+  Guchar *softMask;		// soft mask value of each pixel, or NULL
+  Guchar *transfer[4];		// transfer function for each byte of the
+				//   color; all NULL if they are the
+				//   identity
+};
+
+//------------------------------------------------------------------------
+
+// Set <n> pixels starting at <dest> to <pixel> (one pixel in the format
+// of <mode>), and their alpha, if <destAlpha> is not NULL, to 255.
+void splashSpanFill(SplashColorMode mode, SplashColorPtr dest,
+		    Guchar *destAlpha, Guchar *pixel, int n);
+
+// Composite <src> over <n> pixels starting at <dest>, which have their
+// alpha at <destAlpha>, with the same arithmetic as Splash::pipeRun.
+void splashSpanComposite(SplashColorMode mode, SplashSpanSrc *src,
+			 SplashColorPtr dest, Guchar *destAlpha, int n);
+
+#endif
@@ -57,6 +57,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
   fillPattern = new SplashSolidColor(color);
   screen = new SplashScreen(screenParams);
   blendFunc = NULL;
+  blendRowFunc = NULL;
   strokeAlpha = 1;
   fillAlpha = 1;
   multiplyPatternAlpha = gFalse;
@@ -93,6 +94,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
 #endif
   }
   overprintMask = 0xffffffff;
+  identityTransfer = gTrue;
   overprintAdditive = gFalse;
   next = NULL;
 }
@@ -110,6 +112,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
   fillPattern = new SplashSolidColor(color);
   screen = screenA->copy();
   blendFunc = NULL;
+  blendRowFunc = NULL;
   strokeAlpha = 1;
   fillAlpha = 1;
   multiplyPatternAlpha = gFalse;
@@ -146,6 +149,7 @@ SplashState::SplashState(int width, int height, GBool vectorAntialias,
 #endif
   }
   overprintMask = 0xffffffff;
+  identityTransfer = gTrue;
   overprintAdditive = gFalse;
   next = NULL;
 }
@@ -156,6 +160,7 @@ SplashState::SplashState(SplashState *state) {
   fillPattern = state->fillPattern->copy();
   screen = state->screen->copy();
   blendFunc = state->blendFunc;
+  blendRowFunc = state->blendRowFunc;
   strokeAlpha = state->strokeAlpha;
   fillAlpha = state->fillAlpha;
   multiplyPatternAlpha = state->multiplyPatternAlpha;
@@ -196,6 +201,7 @@ SplashState::SplashState(SplashState *state) {
     memcpy(deviceNTransfer[cp], state->deviceNTransfer[cp], 256);
 #endif
   overprintMask = state->overprintMask;
+  identityTransfer = state->identityTransfer;
   overprintAdditive = state->overprintAdditive;
   next = NULL;
 }
@@ -249,9 +255,9 @@ void SplashState::setSoftMask(SplashBitmap *softMaskA) {
 
 void SplashState::setTransfer(Guchar *red, Guchar *green, Guchar *blue,
 			      Guchar *gray) {
-#if SPLASH_CMYK
   int i;
 
+#if SPLASH_CMYK
   for (i = 0; i < 256; ++i) {
     cmykTransferC[i] = 255 - rgbTransferR[255 - i];
     cmykTransferM[i] = 255 - rgbTransferG[255 - i];
@@ -269,4 +275,18 @@ void SplashState::setTransfer(Guchar *red, Guchar *green, Guchar *blue,
   memcpy(rgbTransferG, green, 256);
   memcpy(rgbTransferB, blue, 256);
   memcpy(grayTransfer, gray, 256);
+
+  identityTransfer = gTrue;
+  for (i = 0; i < 256 && identityTransfer; ++i) {
+    identityTransfer = rgbTransferR[i] == i && rgbTransferG[i] == i &&
+                       rgbTransferB[i] == i && grayTransfer[i] == i;
+#if SPLASH_CMYK
+    for (int cp = 0; cp < SPOT_NCOMPS + 4 && identityTransfer; ++cp) {
+      identityTransfer = deviceNTransfer[cp][i] == i;
+    }
+    identityTransfer = identityTransfer &&
+                       cmykTransferC[i] == i && cmykTransferM[i] == i &&
+                       cmykTransferY[i] == i && cmykTransferK[i] == i;
+#endif
+  }
 }
@@ -99,6 +99,8 @@ private:
   SplashPattern *fillPattern;
   SplashScreen *screen;
   SplashBlendFunc blendFunc;
+  SplashBlendRowFunc blendRowFunc;	// NULL if blendFunc has no row
+					//   version
   SplashCoord strokeAlpha;
   SplashCoord fillAlpha;
   GBool multiplyPatternAlpha;
@@ -131,6 +133,8 @@ private:
          cmykTransferK[256];
   Guchar deviceNTransfer[SPOT_NCOMPS+4][256];
 #endif
+  GBool identityTransfer;	// all the transfer functions are the
+				//   identity
   Guint overprintMask;
   GBool overprintAdditive;
 
@@ -55,6 +55,10 @@ public:
   // Return the path for a glyph.
   virtual SplashPath *getGlyphPath(int c);
 
+protected:
+
+  virtual Guint getRasterizerID() { return 0x200; }
+
 private:
 
   int t1libID;			// t1lib font ID
@@ -80,6 +80,14 @@ enum SplashThinLineMode {
   splashThinLineSolid,     // draw line solid at least with 1 pixel 
   splashThinLineShape     // draw line shaped at least with 1 pixel
 };
+
+enum SplashAAMode {
+  splashAASupersample,		// count the covered points of a
+				//   splashAASize x splashAASize grid in
+				//   each pixel
+  splashAAAnalytic		// compute the exact area of each pixel
+				//   covered by the path
+};
 // number of components in each color mode
 // (defined in SplashState.cc)
 extern int splashColorModeNComps[];
@@ -159,6 +167,13 @@ static inline void splashColorXor(SplashColorPtr dest, SplashColorPtr src) {
 typedef void (*SplashBlendFunc)(SplashColorPtr src, SplashColorPtr dest,
 				SplashColorPtr blend, SplashColorMode cm);
 
+// The same, on <n> pixels at a time: <src>, <dest> and <blend> each
+// hold <n> pixels of splashColorModeNComps[cm] bytes.  The results
+// must be the same as those of the matching SplashBlendFunc.
+typedef void (*SplashBlendRowFunc)(SplashColorPtr src, SplashColorPtr dest,
+				   SplashColorPtr blend, int n,
+				   SplashColorMode cm);
+
 //------------------------------------------------------------------------
 // screen parameters
 //------------------------------------------------------------------------
@@ -470,3 +470,49 @@ void SplashXPath::aaScale() {
 void SplashXPath::sort() {
   std::sort(segs, segs + length, cmpXPathSegsFunctor());
 }
+
+GBool SplashXPath::isRect(SplashCoord *xMinA, SplashCoord *yMinA,
+			  SplashCoord *xMaxA, SplashCoord *yMaxA) {
+  if (length != 4 ||
+      !((segs[0].x0 == segs[0].x1 &&
+	 segs[0].x0 == segs[1].x0 &&
+	 segs[0].x0 == segs[3].x1 &&
+	 segs[2].x0 == segs[2].x1 &&
+	 segs[2].x0 == segs[1].x1 &&
+	 segs[2].x0 == segs[3].x0 &&
+	 segs[1].y0 == segs[1].y1 &&
+	 segs[1].y0 == segs[0].y1 &&
+	 segs[1].y0 == segs[2].y0 &&
+	 segs[3].y0 == segs[3].y1 &&
+	 segs[3].y0 == segs[0].y0 &&
+	 segs[3].y0 == segs[2].y1) ||
+	(segs[0].y0 == segs[0].y1 &&
+	 segs[0].y0 == segs[1].y0 &&
+	 segs[0].y0 == segs[3].y1 &&
+	 segs[2].y0 == segs[2].y1 &&
+	 segs[2].y0 == segs[1].y1 &&
+	 segs[2].y0 == segs[3].y0 &&
+	 segs[1].x0 == segs[1].x1 &&
+	 segs[1].x0 == segs[0].x1 &&
+	 segs[1].x0 == segs[2].x0 &&
+	 segs[3].x0 == segs[3].x1 &&
+	 segs[3].x0 == segs[0].x0 &&
+	 segs[3].x0 == segs[2].x1))) {
+    return gFalse;
+  }
+  if (segs[0].x0 < segs[2].x0) {
+    *xMinA = segs[0].x0;
+    *xMaxA = segs[2].x0;
+  } else {
+    *xMinA = segs[2].x0;
+    *xMaxA = segs[0].x0;
+  }
+  if (segs[0].y0 < segs[2].y0) {
+    *yMinA = segs[0].y0;
+    *yMaxA = segs[2].y0;
+  } else {
+    *yMinA = segs[2].y0;
+    *yMaxA = segs[0].y0;
+  }
+  return gTrue;
+}
@@ -79,6 +79,12 @@ public:
   // Sort by upper coordinate (lower y), in y-major order.
   void sort();
 
+  // If the path is an axis-aligned rectangle (four horizontal and
+  // vertical segments, in order around it), set its bounds and return
+  // true.
+  GBool isRect(SplashCoord *xMinA, SplashCoord *yMinA,
+	       SplashCoord *xMaxA, SplashCoord *yMaxA);
+
 protected:
 
   SplashXPath(SplashXPath *xPath);
@@ -28,6 +28,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <algorithm>
 #include "goo/gmem.h"
 #include "SplashMath.h"
@@ -37,6 +38,13 @@
 
 //------------------------------------------------------------------------
 
+// Number of rows whose intersections are computed at once, when the
+// rows are requested in order (a power of 2, and a multiple of
+// splashAASize).
+#define splashXPathScannerBandRows 32
+
+//------------------------------------------------------------------------
+
 struct SplashIntersect {
   int y;
   int x0, x1;			// intersection of segment with [y, y+1)
@@ -119,15 +127,31 @@ SplashXPathScanner::SplashXPathScanner(SplashXPath *xPathA, GBool eoA,
     }
   }
 
+  // the intersections are computed on first use (the analytic
+  // anti-aliasing, renderAACoverageLine, doesn't need them), a band of
+  // rows at a time
   allInter = NULL;
+  allInterLen = allInterSize = 0;
   inter = NULL;
-  computeIntersections();
+  interSize = 0;
+  interYMin = yMin;
+  interYMax = yMin - 1;
+  active = NULL;
+  activeLen = 0;
+  nextSeg = 0;
   interY = yMin - 1;
+
+  aaActive = NULL;
+  aaActiveLen = 0;
+  aaSegIdx = 0;
+  aaRowY = INT_MIN;
 }
 
 SplashXPathScanner::~SplashXPathScanner() {
   gfree(inter);
   gfree(allInter);
+  gfree(active);
+  gfree(aaActive);
 }
 
 void SplashXPathScanner::getBBoxAA(int *xMinA, int *yMinA,
@@ -141,12 +165,7 @@ void SplashXPathScanner::getBBoxAA(int *xMinA, int *yMinA,
 void SplashXPathScanner::getSpanBounds(int y, int *spanXMin, int *spanXMax) {
   int interBegin, interEnd, xx, i;
 
-  if (y < yMin || y > yMax) {
-    interBegin = interEnd = 0;
-  } else {
-    interBegin = inter[y - yMin];
-    interEnd = inter[y - yMin + 1];
-  }
+  getInter(y, &interBegin, &interEnd);
   if (interBegin < interEnd) {
     *spanXMin = allInter[interBegin].x0;
     xx = allInter[interBegin].x1;
@@ -168,8 +187,7 @@ GBool SplashXPathScanner::test(int x, int y) {
   if (y < yMin || y > yMax) {
     return gFalse;
   }
-  interBegin = inter[y - yMin];
-  interEnd = inter[y - yMin + 1];
+  getInter(y, &interBegin, &interEnd);
   count = 0;
   for (i = interBegin; i < interEnd && allInter[i].x0 <= x; ++i) {
     if (x <= allInter[i].x1) {
@@ -186,8 +204,7 @@ GBool SplashXPathScanner::testSpan(int x0, int x1, int y) {
   if (y < yMin || y > yMax) {
     return gFalse;
   }
-  interBegin = inter[y - yMin];
-  interEnd = inter[y - yMin + 1];
+  getInter(y, &interBegin, &interEnd);
   count = 0;
   for (i = interBegin; i < interEnd && allInter[i].x1 < x0; ++i) {
     count += allInter[i].count;
@@ -214,17 +231,17 @@ GBool SplashXPathScanner::testSpan(int x0, int x1, int y) {
 }
 
 GBool SplashXPathScanner::getNextSpan(int y, int *x0, int *x1) {
-  int interEnd, xx0, xx1;
+  int interBegin, interEnd, xx0, xx1;
 
   if (y < yMin || y > yMax) {
     return gFalse;
   }
+  getInter(y, &interBegin, &interEnd);
   if (interY != y) {
     interY = y;
-    interIdx = inter[y - yMin];
+    interIdx = interBegin;
     interCount = 0;
   }
-  interEnd = inter[y - yMin + 1];
   if (interIdx >= interEnd) {
     return gFalse;
   }
@@ -246,22 +263,76 @@ GBool SplashXPathScanner::getNextSpan(int y, int *x0, int *x1) {
   return gTrue;
 }
 
-void SplashXPathScanner::computeIntersections() {
+// Get the range of <allInter> holding the intersections of row <y>,
+// computing them if needed.
+inline void SplashXPathScanner::getInter(int y, int *interBegin,
+					 int *interEnd) {
+  int bandYMin, bandYMax;
+
+  if (y < yMin || y > yMax) {
+    *interBegin = *interEnd = 0;
+    return;
+  }
+  if (y < interYMin || y > interYMax) {
+    if (y < interYMin) {
+      // the rows are requested out of order (a clip path used by
+      // several fills, for instance): compute all of them once
+      activeLen = 0;
+      nextSeg = 0;
+      bandYMin = yMin;
+      bandYMax = yMax;
+    } else {
+      bandYMin = y & ~(splashXPathScannerBandRows - 1);
+      if (bandYMin < yMin) {
+	bandYMin = yMin;
+      }
+      bandYMax = (y | (splashXPathScannerBandRows - 1));
+      if (bandYMax > yMax) {
+	bandYMax = yMax;
+      }
+    }
+    computeIntersections(bandYMin, bandYMax);
+  }
+  *interBegin = inter[y - interYMin];
+  *interEnd = inter[y - interYMin + 1];
+}
+
+// Compute the intersections of rows <bandYMin> .. <bandYMax>, which
+// must follow the rows computed before.  The segments are sorted by
+// their upper end, so the ones crossing the band are the active ones
+// (those crossing the previous bands and not ending above this one),
+// plus the ones starting in it: the memory used depends on the number
+// of segments crossing a band, not on the size of the whole path.
+void SplashXPathScanner::computeIntersections(int bandYMin, int bandYMax) {
   SplashXPathSeg *seg;
   SplashCoord segXMin, segXMax, segYMin, segYMax, xx0, xx1;
-  int x, y, y0, y1, i;
+  int x, y, y0, y1, i, j;
 
-  if (yMin > yMax) {
-    return;
+  if (!active) {
+    active = (int *)gmallocn(xPath->length > 0 ? xPath->length : 1,
+			     sizeof(int));
+  }
+
+  // add the segments starting above the bottom of the band
+  while (nextSeg < xPath->length) {
+    seg = &xPath->segs[nextSeg];
+    segYMin = (seg->flags & splashXPathFlip) ? seg->y1 : seg->y0;
+    if (splashFloor(segYMin) > bandYMax) {
+      break;
+    }
+    active[activeLen++] = nextSeg++;
   }
 
-  // build the list of all intersections
+  // build the list of the intersections in the band, and drop the
+  // segments ending in it
   allInterLen = 0;
-  allInterSize = 16;
-  allInter = (SplashIntersect *)gmallocn(allInterSize,
-					 sizeof(SplashIntersect));
-  for (i = 0; i < xPath->length; ++i) {
-    seg = &xPath->segs[i];
+  if (!allInter) {
+    allInterSize = 16;
+    allInter = (SplashIntersect *)gmallocn(allInterSize,
+					   sizeof(SplashIntersect));
+  }
+  for (i = j = 0; i < activeLen; ++i) {
+    seg = &xPath->segs[active[i]];
     if (seg->flags & splashXPathFlip) {
       segYMin = seg->y1;
       segYMax = seg->y0;
@@ -269,22 +340,26 @@ void SplashXPathScanner::computeIntersections() {
       segYMin = seg->y0;
       segYMax = seg->y1;
     }
+    y1 = splashFloor(segYMax);
+    if (y1 < bandYMin) {
+      continue;
+    }
+    if (y1 > bandYMax) {
+      active[j++] = active[i];
+      y1 = bandYMax;
+    }
+    y0 = splashFloor(segYMin);
+    if (y0 < bandYMin) {
+      y0 = bandYMin;
+    }
     if (seg->flags & splashXPathHoriz) {
       y = splashFloor(seg->y0);
-      if (y >= yMin && y <= yMax) {
+      if (y >= bandYMin && y <= bandYMax) {
 	if (!addIntersection(segYMin, segYMax, seg->flags,
 			y, splashFloor(seg->x0), splashFloor(seg->x1)))
           break;
       }
     } else if (seg->flags & splashXPathVert) {
-      y0 = splashFloor(segYMin);
-      if (y0 < yMin) {
-	y0 = yMin;
-      }
-      y1 = splashFloor(segYMax);
-      if (y1 > yMax) {
-	y1 = yMax;
-      }
       x = splashFloor(seg->x0);
       for (y = y0; y <= y1; ++y) {
 	if (!addIntersection(segYMin, segYMax, seg->flags, y, x, x))
@@ -298,14 +373,6 @@ void SplashXPathScanner::computeIntersections() {
 	segXMin = seg->x1;
 	segXMax = seg->x0;
       }
-      y0 = splashFloor(segYMin);
-      if (y0 < yMin) {
-	y0 = yMin;
-      }
-      y1 = splashFloor(segYMax);
-      if (y1 > yMax) {
-	y1 = yMax;
-      }
       // this loop could just add seg->dxdy to xx1 on each iteration,
       // but that introduces numerical accuracy problems
       xx1 = seg->x0 + ((SplashCoord)y0 - seg->y0) * seg->dxdy;
@@ -329,18 +396,28 @@ void SplashXPathScanner::computeIntersections() {
       }
     }
   }
+  for (; i < activeLen; ++i) {
+    active[j++] = active[i];
+  }
+  activeLen = j;
   std::sort(allInter, allInter + allInterLen, cmpIntersectFunctor());
 
   // build the list of y pointers
-  inter = (int *)gmallocn(yMax - yMin + 2, sizeof(int));
+  if (bandYMax - bandYMin + 2 > interSize) {
+    interSize = bandYMax - bandYMin + 2;
+    gfree(inter);
+    inter = (int *)gmallocn(interSize, sizeof(int));
+  }
   i = 0;
-  for (y = yMin; y <= yMax; ++y) {
-    inter[y - yMin] = i;
+  for (y = bandYMin; y <= bandYMax; ++y) {
+    inter[y - bandYMin] = i;
     while (i < allInterLen && allInter[i].y <= y) {
       ++i;
     }
   }
-  inter[yMax - yMin + 1] = i;
+  inter[bandYMax - bandYMin + 1] = i;
+  interYMin = bandYMin;
+  interYMax = bandYMax;
 }
 
 GBool SplashXPathScanner::addIntersection(double segYMin, double segYMax,
@@ -386,21 +463,8 @@ void SplashXPathScanner::renderAALine(SplashBitmap *aaBuf,
   xxMin = aaBuf->getWidth();
   xxMax = -1;
   if (yMin <= yMax) {
-    if (splashAASize * y < yMin) {
-      interIdx = inter[0];
-    } else if (splashAASize * y > yMax) {
-      interIdx = inter[yMax - yMin + 1];
-    } else {
-      interIdx = inter[splashAASize * y - yMin];
-    }
     for (yy = 0; yy < splashAASize; ++yy) {
-      if (splashAASize * y + yy < yMin) {
-	interEnd = inter[0];
-      } else if (splashAASize * y + yy > yMax) {
-	interEnd = inter[yMax - yMin + 1];
-      } else {
-	interEnd = inter[splashAASize * y + yy - yMin + 1];
-      }
+      getInter(splashAASize * y + yy, &interIdx, &interEnd);
       interCount = 0;
       while (interIdx < interEnd) {
 	xx0 = allInter[interIdx].x0;
@@ -467,18 +531,7 @@ void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf,
   for (yy = 0; yy < splashAASize; ++yy) {
     xx = *x0 * splashAASize;
     if (yMin <= yMax) {
-      if (splashAASize * y + yy < yMin) {
-	interIdx = interEnd = inter[0];
-      } else if (splashAASize * y + yy > yMax) {
-	interIdx = interEnd = inter[yMax - yMin + 1];
-      } else {
-	interIdx = inter[splashAASize * y + yy - yMin];
-	if (splashAASize * y + yy > yMax) {
-	  interEnd = inter[yMax - yMin + 1];
-	} else {
-	  interEnd = inter[splashAASize * y + yy - yMin + 1];
-	}
-      }
+      getInter(splashAASize * y + yy, &interIdx, &interEnd);
       interCount = 0;
       while (interIdx < interEnd && xx < (*x1 + 1) * splashAASize) {
 	xx0 = allInter[interIdx].x0;
@@ -542,3 +595,191 @@ void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf,
     }
   }
 }
+
+// Adds the area to the right of an edge piece, which goes from <xa> to
+// <xb> while spanning a height of <dy> (negative for upward edges)
+// within a row, to the cells of <accum>: the running sum of <accum>
+// is then the signed coverage of each pixel.  The piece is first
+// clamped to [0, <w>] (which doesn't change the coverage of the pixels
+// in between).  The range of cells touched is merged into [*<xLo>,
+// *<xHi>].
+static void addCoverage(SplashCoord *accum, int w,
+			SplashCoord xa, SplashCoord xb, SplashCoord dy,
+			int *xLo, int *xHi) {
+  SplashCoord x0, x1, t, s, x0f, x1f, a0, a1, a2, am, xm;
+  int x0i, x1i, xi;
+
+  // split the pieces crossing x = 0 or x = w
+  if ((xa < 0 && xb > 0) || (xa > 0 && xb < 0)) {
+    t = xa / (xa - xb);
+    addCoverage(accum, w, xa, 0, dy * t, xLo, xHi);
+    addCoverage(accum, w, 0, xb, dy - dy * t, xLo, xHi);
+    return;
+  }
+  if ((xa < w && xb > w) || (xa > w && xb < w)) {
+    t = (w - xa) / (xb - xa);
+    addCoverage(accum, w, xa, w, dy * t, xLo, xHi);
+    addCoverage(accum, w, w, xb, dy - dy * t, xLo, xHi);
+    return;
+  }
+  if (xa <= 0 && xb <= 0) {
+    xa = xb = 0;
+  } else if (xa >= w && xb >= w) {
+    xa = xb = w;
+  }
+
+  if (xa < xb) {
+    x0 = xa;
+    x1 = xb;
+  } else {
+    x0 = xb;
+    x1 = xa;
+  }
+  x0i = splashFloor(x0);
+  x1i = splashCeil(x1);
+  if (x1i <= x0i + 1) {
+    // the piece is within one pixel: the pixel gets the area to the
+    // right of its midpoint, the next one the rest
+    xm = (SplashCoord)0.5 * (xa + xb) - x0i;
+    accum[x0i] += dy - dy * xm;
+    accum[x0i + 1] += dy * xm;
+    x1i = x0i + 1;
+  } else {
+    // the piece crosses several pixels: the area to its right grows
+    // quadratically over the first and last one, and linearly in
+    // between
+    s = 1 / (x1 - x0);
+    x0f = x0 - x0i;
+    a0 = (SplashCoord)0.5 * s * (1 - x0f) * (1 - x0f);
+    x1f = x1 - x1i + 1;
+    am = (SplashCoord)0.5 * s * x1f * x1f;
+    accum[x0i] += dy * a0;
+    if (x1i == x0i + 2) {
+      accum[x0i + 1] += dy * (1 - a0 - am);
+    } else {
+      a1 = s * ((SplashCoord)1.5 - x0f);
+      accum[x0i + 1] += dy * (a1 - a0);
+      for (xi = x0i + 2; xi < x1i - 1; ++xi) {
+	accum[xi] += dy * s;
+      }
+      a2 = a1 + (x1i - x0i - 3) * s;
+      accum[x1i - 1] += dy * (1 - a2 - am);
+    }
+    accum[x1i] += dy * am;
+  }
+  if (x0i < *xLo) {
+    *xLo = x0i;
+  }
+  if (x1i > *xHi) {
+    *xHi = x1i;
+  }
+}
+
+void SplashXPathScanner::renderAACoverageLine(SplashCoord *accum,
+					      Guchar *coverage, int w,
+					      int *x0, int *x1, int y) {
+  SplashXPathSeg *seg;
+  SplashCoord scale, yTop, yBot, segXMin, segXMax, segYMin, segYMax;
+  SplashCoord ya, yb, xa, xb, sum, a;
+  int xLo, xHi, x, i, j;
+
+  scale = (SplashCoord)1 / splashAASize;
+  yTop = y;
+  yBot = y + 1;
+
+  // the segments are sorted by their upper end: add the ones starting
+  // above the bottom of the row to the active list (starting over if
+  // the rows are not requested in order)
+  if (!aaActive) {
+    aaActive = (int *)gmallocn(xPath->length > 0 ? xPath->length : 1,
+			       sizeof(int));
+  }
+  if (y < aaRowY) {
+    aaActiveLen = 0;
+    aaSegIdx = 0;
+  }
+  aaRowY = y;
+  while (aaSegIdx < xPath->length) {
+    seg = &xPath->segs[aaSegIdx];
+    segYMin = ((seg->flags & splashXPathFlip) ? seg->y1 : seg->y0) * scale;
+    if (segYMin >= yBot) {
+      break;
+    }
+    // horizontal segments don't cover anything
+    if (!(seg->flags & splashXPathHoriz)) {
+      aaActive[aaActiveLen++] = aaSegIdx;
+    }
+    ++aaSegIdx;
+  }
+
+  // accumulate the area of the active segments within the row, and
+  // drop the ones ending above it
+  xLo = w + 2;
+  xHi = -1;
+  for (i = j = 0; i < aaActiveLen; ++i) {
+    seg = &xPath->segs[aaActive[i]];
+    if (seg->flags & splashXPathFlip) {
+      segYMin = seg->y1 * scale;
+      segYMax = seg->y0 * scale;
+    } else {
+      segYMin = seg->y0 * scale;
+      segYMax = seg->y1 * scale;
+    }
+    if (segYMax <= yTop) {
+      continue;
+    }
+    aaActive[j++] = aaActive[i];
+    ya = segYMin > yTop ? segYMin : yTop;
+    yb = segYMax < yBot ? segYMax : yBot;
+    if (yb <= ya) {
+      continue;
+    }
+    if (seg->flags & splashXPathVert) {
+      xa = xb = seg->x0 * scale;
+    } else {
+      xa = (seg->x0 + (ya * splashAASize - seg->y0) * seg->dxdy) * scale;
+      xb = (seg->x0 + (yb * splashAASize - seg->y0) * seg->dxdy) * scale;
+      // keep rounding errors from moving the ends past the segment
+      if (seg->x0 < seg->x1) {
+	segXMin = seg->x0 * scale;
+	segXMax = seg->x1 * scale;
+      } else {
+	segXMin = seg->x1 * scale;
+	segXMax = seg->x0 * scale;
+      }
+      xa = xa < segXMin ? segXMin : xa > segXMax ? segXMax : xa;
+      xb = xb < segXMin ? segXMin : xb > segXMax ? segXMax : xb;
+    }
+    addCoverage(accum, w, xa, xb,
+		(seg->flags & splashXPathFlip) ? ya - yb : yb - ya,
+		&xLo, &xHi);
+  }
+  aaActiveLen = j;
+
+  if (xLo > xHi) {
+    *x0 = 0;
+    *x1 = -1;
+    return;
+  }
+
+  // sum up the coverage, clearing the accumulation buffer on the way
+  sum = 0;
+  for (x = xLo; x <= xHi; ++x) {
+    sum += accum[x];
+    accum[x] = 0;
+    if (x < w) {
+      a = splashAbs(sum);
+      if (eo) {
+	a -= 2 * splashFloor(a * (SplashCoord)0.5);
+	if (a > 1) {
+	  a = 2 - a;
+	}
+      } else if (a > 1) {
+	a = 1;
+      }
+      coverage[x] = (Guchar)(a * 255 + (SplashCoord)0.5);
+    }
+  }
+  *x0 = xLo;
+  *x1 = xHi < w ? xHi : w - 1;
+}
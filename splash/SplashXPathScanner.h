@@ -82,9 +82,22 @@ public:
   // will update <x0> and <x1>.
   void clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y);
 
+  // Computes the exact area of each pixel of row <y> covered by the
+  // path (which must have been scaled with SplashXPath::aaScale), and
+  // stores it, scaled to 0..255, in <coverage>.  Pixels at x >= <w>
+  // are ignored.  <accum> is a scratch buffer of <w> + 2 entries,
+  // which must be zero on entry, and is left zero.  Returns the range
+  // of pixels set in <x0> and <x1> (<x0> > <x1> if the row is empty);
+  // the pixels outside it are not covered.  Rows should be requested
+  // in increasing order: the active segments are carried over from
+  // one row to the next.
+  void renderAACoverageLine(SplashCoord *accum, Guchar *coverage, int w,
+			    int *x0, int *x1, int y);
+
 private:
 
-  void computeIntersections();
+  void getInter(int y, int *interBegin, int *interEnd);
+  void computeIntersections(int bandYMin, int bandYMax);
   GBool addIntersection(double segYMin, double segYMax,
 		       Guint segFlags,
 		       int y, int x0, int x1);
@@ -94,15 +107,28 @@ private:
   int xMin, yMin, xMax, yMax;
   GBool partialClip;
 
-  SplashIntersect *allInter;	// array of intersections
+  SplashIntersect *allInter;	// array of intersections of the rows
+				//   interYMin .. interYMax
   int allInterLen;		// number of intersections in <allInter>
   int allInterSize;		// size of the <allInter> array
   int *inter;			// indexes into <allInter> for each y value
+  int interSize;		// size of the <inter> array
+  int interYMin, interYMax;	// rows in <allInter>
+  int *active;			// segments crossing the rows after
+				//   interYMax
+  int activeLen;		// number of segments in <active>
+  int nextSeg;			// next segment to add to <active>
   int interY;			// current y value - used by getNextSpan
   int interIdx;			// current index into <inter> - used by
 				//   getNextSpan 
   int interCount;		// current EO/NZWN counter - used by
 				//   getNextSpan
+
+  int *aaActive;		// segments crossing the current row - used
+				//   by renderAACoverageLine
+  int aaActiveLen;		// number of segments in <aaActive>
+  int aaSegIdx;			// next segment to add to <aaActive>
+  int aaRowY;			// current row
 };
 
 #endif
@@ -0,0 +1,179 @@
+//========================================================================
+//
+// alloc-bench.cc
+//
+// Runs the content streams of a document's pages through Gfx with an
+// output device that draws nothing, once with the parsed objects on
+// the heap and once with them in the content stream arena (see
+// GlobalParams::setContentArena), and reports the number of heap
+// allocations and the time taken by each run.
+//
+// Heap allocations are only counted with glibc, whose malloc can be
+// wrapped by the program.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "OutputDev.h"
+#include "PDFDoc.h"
+#include "utils/parseargs.h"
+
+//------------------------------------------------------------------------
+// malloc wrappers
+//------------------------------------------------------------------------
+
+static unsigned long numMallocs = 0;
+
+#ifdef __GLIBC__
+
+#define COUNT_MALLOCS 1
+
+extern "C" {
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) {
+  ++numMallocs;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  ++numMallocs;
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *p, size_t size) {
+  ++numMallocs;
+  return __libc_realloc(p, size);
+}
+
+}
+
+#endif
+
+//------------------------------------------------------------------------
+// NullOutputDev
+//------------------------------------------------------------------------
+
+class NullOutputDev: public OutputDev {
+public:
+
+  virtual GBool upsideDown() { return gTrue; }
+  virtual GBool useDrawChar() { return gFalse; }
+  virtual GBool interpretType3Chars() { return gFalse; }
+};
+
+//------------------------------------------------------------------------
+
+static int firstPage = 1;
+static int lastPage = 0;
+static int numRuns = 3;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to run"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to run"},
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of runs in each mode (default is 3)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+static void runPages(PDFDoc *doc, OutputDev *out) {
+  for (int page = firstPage; page <= lastPage; ++page) {
+    doc->displayPage(out, page, 72, 72, 0, gTrue, gFalse, gFalse);
+  }
+}
+
+static void runMode(PDFDoc *doc, OutputDev *out, GBool arena) {
+  GooTimer timer;
+  unsigned long mallocs;
+
+  globalParams->setContentArena(arena);
+  mallocs = numMallocs;
+  timer.start();
+  for (int i = 0; i < numRuns; ++i) {
+    runPages(doc, out);
+  }
+  timer.stop();
+  mallocs = numMallocs - mallocs;
+#ifdef COUNT_MALLOCS
+  printf("%-6s %12lu allocs %10.1f allocs/page %10.2f ms/run\n",
+	 arena ? "arena" : "heap", mallocs,
+	 (double)mallocs / (numRuns * (lastPage - firstPage + 1)),
+	 timer.getElapsed() * 1000 / numRuns);
+#else
+  printf("%-6s %10.2f ms/run\n",
+	 arena ? "arena" : "heap", timer.getElapsed() * 1000 / numRuns);
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  PDFDoc *doc;
+  NullOutputDev *out;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE", argDesc);
+    return printHelp ? 0 : 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  doc = new PDFDoc(new GooString(argv[1]));
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    delete doc;
+    delete globalParams;
+    return 1;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+  if (firstPage > lastPage) {
+    fprintf(stderr, "No pages to run\n");
+    delete doc;
+    delete globalParams;
+    return 1;
+  }
+
+  out = new NullOutputDev();
+  printf("%s: pages %d-%d, %d runs\n", argv[1], firstPage, lastPage, numRuns);
+
+  // load the fonts and fill the caches before counting
+  runPages(doc, out);
+
+  runMode(doc, out, gFalse);
+  runMode(doc, out, gTrue);
+
+  delete out;
+  delete doc;
+  delete globalParams;
+  return 0;
+}
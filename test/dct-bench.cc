@@ -0,0 +1,260 @@
+//========================================================================
+//
+// dct-bench.cc
+//
+// Collects the DCT-encoded (JPEG) image streams of one or more
+// documents, decodes them in memory with DCTStream (the built-in
+// decoder, or the libjpeg based one if poppler is built with libjpeg),
+// and reports the throughput.  With -v, the size and a checksum of the
+// output of each stream are listed, so that the output of two builds
+// can be compared.  With -scale, the streams are decoded at a reduced
+// resolution (see Stream::setDecodeScale).
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "XRef.h"
+#ifdef ENABLE_LIBJPEG
+#include "DCTStream.h"
+#endif
+#include "utils/parseargs.h"
+
+static int numRuns = 5;
+static int scale = 1;
+static GBool verbose = gFalse;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each stream is decoded (default is 5)"},
+  {"-scale",  argInt,      &scale,           0,
+   "decode at 1/2, 1/4, or 1/8 resolution (default is 1)"},
+  {"-v",      argFlag,     &verbose,         0,
+   "list the size and checksum of the output of each stream"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+struct DCTData {
+  char *data;			// encoded data
+  int length;
+  int colorXform;		// ColorTransform parameter, or -1
+  Object dict;			// stream dictionary
+  int num;			// object number
+  GooString *fileName;
+};
+
+struct Corpus {
+  DCTData *streams;
+  int nStreams, size;
+  PDFDoc **docs;		// the documents, kept open for the stream
+  int nDocs;			//   dictionaries
+};
+
+#define chunkSize 65536
+
+static Guchar chunk[chunkSize];
+
+static void addStream(Corpus *corpus, Object *obj, int num,
+		      GooString *fileName) {
+  DCTData *dd;
+  GooString *s;
+  Object params, obj1;
+
+  s = new GooString();
+  obj->getStream()->getNextStream()->fillGooString(s);
+  if (corpus->nStreams == corpus->size) {
+    corpus->size = corpus->size ? 2 * corpus->size : 64;
+    corpus->streams = (DCTData *)greallocn(corpus->streams, corpus->size,
+					   sizeof(DCTData));
+  }
+  dd = &corpus->streams[corpus->nStreams++];
+  dd->length = s->getLength();
+  dd->data = (char *)gmalloc(dd->length > 0 ? dd->length : 1);
+  memcpy(dd->data, s->getCString(), dd->length);
+  dd->colorXform = -1;
+  obj->streamGetDict()->lookup("DecodeParms", &params);
+  if (params.isDict() &&
+      params.dictLookup("ColorTransform", &obj1)->isInt()) {
+    dd->colorXform = obj1.getInt();
+  }
+  obj1.free();
+  params.free();
+  dd->dict.initDict(obj->streamGetDict());
+  dd->num = num;
+  dd->fileName = fileName;
+  delete s;
+}
+
+// Add the (decrypted) encoded data of all the DCT streams of a
+// document to the corpus.
+static GBool addDocument(Corpus *corpus, GooString *fileName) {
+  PDFDoc *doc;
+  XRef *xref;
+  XRefEntry *entry;
+  Object obj;
+  int i;
+
+  doc = new PDFDoc(fileName->copy());
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", fileName->getCString());
+    delete doc;
+    return gFalse;
+  }
+  corpus->docs[corpus->nDocs++] = doc;
+  xref = doc->getXRef();
+  for (i = 0; i < xref->getNumObjects(); ++i) {
+    entry = xref->getEntry(i, gFalse);
+    if (entry->type == xrefEntryFree || entry->type == xrefEntryNone) {
+      continue;
+    }
+    xref->fetch(i, entry->type == xrefEntryCompressed ? 0 : entry->gen, &obj);
+    if (obj.isStream() && obj.getStream()->getKind() == strDCT) {
+      addStream(corpus, &obj, i, fileName);
+    }
+    obj.free();
+  }
+  return gTrue;
+}
+
+// Return the scale the streams are actually decoded at.
+static int decodeScale() {
+  Stream *str;
+  Object dict;
+  int s;
+
+  dict.initNull();
+  str = new DCTStream(new MemStream((char *)"", 0, 0, &dict), -1, NULL, 0);
+  s = str->setDecodeScale(scale);
+  delete str;
+  return s;
+}
+
+// Decode a stream, and return the size of the output.  If <sum> is
+// not NULL, also compute the checksum of the output.
+static long decodeStream(DCTData *dd, unsigned int *sum) {
+  Stream *str;
+  Object dict;
+  long total;
+  int n, i;
+
+  dict.initNull();
+  str = new DCTStream(new MemStream(dd->data, 0, dd->length, &dict),
+		      dd->colorXform, &dd->dict, 0);
+  str->setDecodeScale(scale);
+  str->reset();
+  total = 0;
+  if (sum) {
+    *sum = 2166136261u;
+  }
+  while ((n = str->doGetChars(chunkSize, chunk)) > 0) {
+    if (sum) {
+      for (i = 0; i < n; ++i) {
+	*sum = (*sum ^ chunk[i]) * 16777619u;
+      }
+    }
+    total += n;
+  }
+  delete str;
+  return total;
+}
+
+int main(int argc, char *argv[]) {
+  Corpus corpus;
+  GooString **fileNames;
+  GooTimer timer;
+  DCTData *dd;
+  unsigned int sum;
+  long encoded, decoded, n;
+  double time;
+  int ret, run, i;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc < 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE...", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  corpus.streams = NULL;
+  corpus.nStreams = corpus.size = 0;
+  corpus.docs = (PDFDoc **)gmallocn(argc, sizeof(PDFDoc *));
+  corpus.nDocs = 0;
+  fileNames = (GooString **)gmallocn(argc, sizeof(GooString *));
+  ret = 0;
+  for (i = 1; i < argc; ++i) {
+    fileNames[i] = new GooString(argv[i]);
+    if (!addDocument(&corpus, fileNames[i])) {
+      ret = 1;
+    }
+  }
+
+  if (verbose) {
+    for (i = 0; i < corpus.nStreams; ++i) {
+      dd = &corpus.streams[i];
+      n = decodeStream(dd, &sum);
+      printf("%s: object %d: %ld bytes, checksum %08x\n",
+	     dd->fileName->getCString(), dd->num, n, sum);
+    }
+  }
+
+  encoded = decoded = 0;
+  time = 0;
+  for (i = 0; i < corpus.nStreams; ++i) {
+    dd = &corpus.streams[i];
+    timer.start();
+    n = 0;
+    for (run = 0; run < numRuns; ++run) {
+      n = decodeStream(dd, NULL);
+    }
+    timer.stop();
+    encoded += dd->length;
+    decoded += n;
+    time += timer.getElapsed();
+  }
+  printf("%d streams, %d runs, scale 1/%d\n", corpus.nStreams, numRuns,
+	 decodeScale());
+  printf("%10s %10s %10s %10s\n", "in MB", "out MB", "ms", "MB/s");
+  printf("%10.2f %10.2f %10.2f %10.1f\n",
+	 encoded / 1e6, decoded / 1e6, time * 1000 / numRuns,
+	 time > 0 ? decoded * numRuns / time / 1e6 : 0.0);
+
+  for (i = 0; i < corpus.nStreams; ++i) {
+    gfree(corpus.streams[i].data);
+    corpus.streams[i].dict.free();
+  }
+  gfree(corpus.streams);
+  for (i = 0; i < corpus.nDocs; ++i) {
+    delete corpus.docs[i];
+  }
+  gfree(corpus.docs);
+  for (i = 1; i < argc; ++i) {
+    delete fileNames[i];
+  }
+  gfree(fileNames);
+  delete globalParams;
+  return ret;
+}
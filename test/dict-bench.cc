@@ -0,0 +1,244 @@
+//========================================================================
+//
+// dict-bench.cc
+//
+// Microbenchmarks for Dict lookups.  Each workload is run on Dict and
+// on a copy of the lookup scheme Dict used before it had a hash index:
+// a linear search for small dictionaries, and a binary search over the
+// entries, sorted on the first lookup after a change, for big ones.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooTimer.h"
+#include "Object.h"
+#include "Dict.h"
+
+//------------------------------------------------------------------------
+// SortedDict
+//------------------------------------------------------------------------
+
+struct SortedDictEntry {
+  char *key;
+  int val;
+};
+
+static inline bool cmpEntries(const SortedDictEntry &e1,
+			      const SortedDictEntry &e2) {
+  return strcmp(e1.key, e2.key) < 0;
+}
+
+class SortedDict {
+public:
+
+  SortedDict() { entries = NULL; size = length = 0; sorted = gFalse; }
+  ~SortedDict() {
+    for (int i = 0; i < length; ++i) {
+      gfree(entries[i].key);
+    }
+    gfree(entries);
+  }
+
+  void add(char *key, int val) {
+    sorted = gFalse;
+    if (length == size) {
+      size = size ? 2 * size : 8;
+      entries = (SortedDictEntry *)greallocn(entries, size,
+					     sizeof(SortedDictEntry));
+    }
+    entries[length].key = key;
+    entries[length].val = val;
+    ++length;
+  }
+
+  SortedDictEntry *find(const char *key) {
+    if (!sorted && length >= 32) {
+      sorted = gTrue;
+      std::sort(entries, entries + length, cmpEntries);
+    }
+    if (sorted) {
+      int first = 0;
+      int end = length - 1;
+      while (first <= end) {
+	const int middle = (first + end) / 2;
+	const int res = strcmp(key, entries[middle].key);
+	if (res == 0) {
+	  return &entries[middle];
+	} else if (res < 0) {
+	  end = middle - 1;
+	} else {
+	  first = middle + 1;
+	}
+      }
+    } else {
+      for (int i = length - 1; i >= 0; --i) {
+	if (!strcmp(key, entries[i].key)) {
+	  return &entries[i];
+	}
+      }
+    }
+    return NULL;
+  }
+
+private:
+
+  SortedDictEntry *entries;
+  int size;
+  int length;
+  GBool sorted;
+};
+
+//------------------------------------------------------------------------
+
+#define numLookups 2000000
+
+// Keys look like the names of a big resource dictionary.  The lookup
+// keys are separate copies, as they are when they come from a content
+// stream operand.
+static char **makeKeys(int n) {
+  char **keys;
+  char buf[32];
+
+  keys = (char **)gmallocn(n, sizeof(char *));
+  for (int i = 0; i < n; ++i) {
+    sprintf(buf, "Im%d", i * 7919);
+    keys[i] = copyString(buf);
+  }
+  return keys;
+}
+
+static void freeKeys(char **keys, int n) {
+  for (int i = 0; i < n; ++i) {
+    gfree(keys[i]);
+  }
+  gfree(keys);
+}
+
+static double nsPerOp(GooTimer *timer, int ops) {
+  return timer->getElapsed() * 1e9 / ops;
+}
+
+// Fill the dictionary, then look up keys that are in it and keys that
+// are not.
+static void benchLookup(int n) {
+  char **keys, **lookupKeys;
+  GooTimer timer;
+  Object obj;
+  int found1, found2, i;
+
+  keys = makeKeys(n);
+  lookupKeys = makeKeys(2 * n);
+
+  SortedDict *sortedDict = new SortedDict();
+  for (i = 0; i < n; ++i) {
+    sortedDict->add(copyString(keys[i]), i);
+  }
+  found1 = 0;
+  timer.start();
+  for (i = 0; i < numLookups; ++i) {
+    found1 += sortedDict->find(lookupKeys[i % (2 * n)]) != NULL;
+  }
+  timer.stop();
+  double sortedNs = nsPerOp(&timer, numLookups);
+  delete sortedDict;
+
+  Dict *dict = new Dict((XRef *)NULL);
+  for (i = 0; i < n; ++i) {
+    dict->set(keys[i], obj.initInt(i));
+  }
+  found2 = 0;
+  timer.start();
+  for (i = 0; i < numLookups; ++i) {
+    found2 += dict->hasKey(lookupKeys[i % (2 * n)]);
+  }
+  timer.stop();
+  double hashedNs = nsPerOp(&timer, numLookups);
+  delete dict;
+
+  printf("lookup       %6d entries  sorted %8.1f ns  hashed %8.1f ns%s\n",
+	 n, sortedNs, hashedNs, found1 == found2 ? "" : "  MISMATCH");
+  freeKeys(keys, n);
+  freeKeys(lookupKeys, 2 * n);
+}
+
+// Alternate insertions and lookups, as when a dictionary is filled with
+// Dict::set(), which looks the key up first.  The time per operation
+// includes the time taken by the insertions (and by deleting the
+// dictionaries).
+static void benchInsert(int n) {
+  char **keys, **lookupKeys;
+  GooTimer timer;
+  Object obj;
+  int found1, found2, ops, reps, rep, i;
+
+  keys = makeKeys(n);
+  lookupKeys = makeKeys(n);
+  ops = 0;
+
+  // repeat small runs, to get measurable times
+  reps = 65536 / (n * n);
+  if (reps < 1) {
+    reps = 1;
+  }
+
+  found1 = 0;
+  timer.start();
+  for (rep = 0; rep < reps; ++rep) {
+    SortedDict *sortedDict = new SortedDict();
+    for (i = 0; i < n; ++i) {
+      found1 += sortedDict->find(lookupKeys[i]) != NULL;
+      sortedDict->add(copyString(keys[i]), i);
+      found1 += sortedDict->find(lookupKeys[i / 2]) != NULL;
+      ops += 3;
+    }
+    delete sortedDict;
+  }
+  timer.stop();
+  double sortedNs = nsPerOp(&timer, ops);
+
+  found2 = 0;
+  timer.start();
+  for (rep = 0; rep < reps; ++rep) {
+    Dict *dict = new Dict((XRef *)NULL);
+    for (i = 0; i < n; ++i) {
+      found2 += dict->hasKey(lookupKeys[i]);
+      dict->add(copyString(keys[i]), obj.initInt(i));
+      found2 += dict->hasKey(lookupKeys[i / 2]);
+    }
+    delete dict;
+  }
+  timer.stop();
+  double hashedNs = nsPerOp(&timer, ops);
+
+  printf("insert+find  %6d entries  sorted %8.1f ns  hashed %8.1f ns%s\n",
+	 n, sortedNs, hashedNs, found1 == found2 ? "" : "  MISMATCH");
+  freeKeys(keys, n);
+  freeKeys(lookupKeys, n);
+}
+
+int main(int argc, char *argv[]) {
+  static const int sizes[] = { 8, 31, 32, 256, 4096, 65536 };
+  int i;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i) {
+    benchLookup(sizes[i]);
+  }
+  for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i) {
+    // the sorted scheme re-sorts on every lookup here
+    if (sizes[i] <= 4096) {
+      benchInsert(sizes[i]);
+    }
+  }
+  return 0;
+}
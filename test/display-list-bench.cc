@@ -0,0 +1,190 @@
+//========================================================================
+//
+// display-list-bench.cc
+//
+// Records the pages of a document with DisplayListOutputDev, plays the
+// lists on a SplashOutputDev, and compares the bitmaps, and the time
+// taken, with those of drawing the pages directly.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "splash/SplashBitmap.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "DisplayListOutputDev.h"
+#include "utils/parseargs.h"
+
+static int firstPage = 1;
+static int lastPage = 0;
+static double recResolution = 72;
+static double resolution = 150;
+static int rotate = 0;
+static int numRuns = 3;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to draw"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to draw"},
+  {"-rec",    argFP,       &recResolution,   0,
+   "resolution the pages are recorded at, in DPI (default is 72)"},
+  {"-r",      argFP,       &resolution,      0,
+   "resolution the pages are drawn at, in DPI (default is 150)"},
+  {"-rot",    argInt,      &rotate,          0,
+   "rotation the pages are drawn with (default is 0)"},
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each page is drawn (default is 3)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+// Count the bytes that differ between two bitmaps, and the largest
+// difference.
+static long compareBitmaps(SplashBitmap *bitmap1, SplashBitmap *bitmap2,
+			   int *maxDiff) {
+  SplashColorPtr p1, p2;
+  long n;
+  int w, y, x, d;
+
+  *maxDiff = 0;
+  if (bitmap1->getWidth() != bitmap2->getWidth() ||
+      bitmap1->getHeight() != bitmap2->getHeight()) {
+    *maxDiff = 255;
+    return -1;
+  }
+  w = bitmap1->getWidth() * 3;
+  n = 0;
+  for (y = 0; y < bitmap1->getHeight(); ++y) {
+    p1 = bitmap1->getDataPtr() + y * bitmap1->getRowSize();
+    p2 = bitmap2->getDataPtr() + y * bitmap2->getRowSize();
+    for (x = 0; x < w; ++x) {
+      if (p1[x] != p2[x]) {
+	++n;
+	d = abs(p1[x] - p2[x]);
+	if (d > *maxDiff) {
+	  *maxDiff = d;
+	}
+      }
+    }
+  }
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  PDFDoc *doc;
+  SplashOutputDev *out, *out2;
+  DisplayListOutputDev *dlOut;
+  DisplayList *list;
+  SplashColor paperColor;
+  GooTimer timer;
+  double recTime, drawTime, playTime, totalRec, totalDraw, totalPlay;
+  long diffs, size;
+  int page, run, maxDiff, ret;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE", argDesc);
+    return printHelp ? 0 : 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  doc = new PDFDoc(new GooString(argv[1]));
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    delete doc;
+    delete globalParams;
+    return 1;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  out->startDoc(doc);
+  out2 = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  out2->startDoc(doc);
+  dlOut = new DisplayListOutputDev(doc, out);
+
+  printf("%s: recorded at %g DPI, drawn at %g DPI, %d runs\n",
+	 argv[1], recResolution, resolution, numRuns);
+  printf("%5s %8s %10s %10s %10s %10s %8s\n", "page", "ops", "size",
+	 "record ms", "draw ms", "play ms", "diffs");
+  ret = 0;
+  totalRec = totalDraw = totalPlay = 0;
+  for (page = firstPage; page <= lastPage; ++page) {
+    timer.start();
+    doc->displayPage(dlOut, page, recResolution, recResolution, 0,
+		     gFalse, gTrue, gFalse);
+    timer.stop();
+    recTime = timer.getElapsed();
+    list = dlOut->takeDisplayList();
+    if (!list) {
+      continue;
+    }
+
+    timer.start();
+    for (run = 0; run < numRuns; ++run) {
+      doc->displayPage(out, page, resolution, resolution, rotate,
+		       gFalse, gTrue, gFalse);
+    }
+    timer.stop();
+    drawTime = timer.getElapsed() / numRuns;
+
+    timer.start();
+    for (run = 0; run < numRuns; ++run) {
+      list->play(out2, resolution, resolution, rotate, gFalse, gTrue);
+    }
+    timer.stop();
+    playTime = timer.getElapsed() / numRuns;
+
+    diffs = compareBitmaps(out->getBitmap(), out2->getBitmap(), &maxDiff);
+    size = list->getSize();
+    printf("%5d %8d %9ldk %10.2f %10.2f %10.2f %8ld",
+	   page, list->getNumOps(), size / 1024, recTime * 1000,
+	   drawTime * 1000, playTime * 1000, diffs);
+    if (diffs) {
+      printf(" (max %d)", maxDiff);
+      ret = 2;
+    }
+    printf("\n");
+    totalRec += recTime;
+    totalDraw += drawTime;
+    totalPlay += playTime;
+    delete list;
+  }
+  printf("total %30.2f %10.2f %10.2f\n",
+	 totalRec * 1000, totalDraw * 1000, totalPlay * 1000);
+
+  delete dlOut;
+  delete out2;
+  delete out;
+  delete doc;
+  delete globalParams;
+  return ret;
+}
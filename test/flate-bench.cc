@@ -0,0 +1,332 @@
+//========================================================================
+//
+// flate-bench.cc
+//
+// Collects the Flate-encoded streams of one or more documents (page
+// contents, images, fonts, object streams, ...), decodes them in
+// memory with FlateStream, and reports the throughput separately for
+// image streams and for the other streams.  When poppler is built with
+// zlib, the streams are also decoded with zlib's inflate, for
+// comparison, and the output of the two decoders is checked to be
+// identical.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "XRef.h"
+#ifdef ENABLE_ZLIB_UNCOMPRESS
+#include "FlateStream.h"
+#endif
+#if ENABLE_ZLIB
+#include <zlib.h>
+#endif
+#include "utils/parseargs.h"
+
+static int numRuns = 5;
+static GBool verbose = gFalse;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each stream is decoded (default is 5)"},
+  {"-v",      argFlag,     &verbose,         0,
+   "list the streams the decoders disagree on"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+#define numKinds 2
+
+static const char *kindNames[numKinds] = { "image", "other" };
+
+struct FlateData {
+  char *data;			// encoded data
+  int length;
+  int kind;			// 0 = image, 1 = other
+  int num;			// object number
+  GooString *fileName;
+};
+
+struct Corpus {
+  FlateData *streams;
+  int nStreams, size;
+};
+
+struct Result {
+  long encoded;			// total size of the encoded data
+  long decoded;			// total size of the decoded data
+  double time;			// decoding time, for all the runs
+};
+
+#define chunkSize 65536
+
+static Guchar chunk[chunkSize];
+
+static void addStream(Corpus *corpus, Stream *str, int kind, int num,
+		      GooString *fileName) {
+  FlateData *fd;
+  GooString *s;
+
+  s = new GooString();
+  str->fillGooString(s);
+  if (corpus->nStreams == corpus->size) {
+    corpus->size = corpus->size ? 2 * corpus->size : 256;
+    corpus->streams = (FlateData *)greallocn(corpus->streams, corpus->size,
+					     sizeof(FlateData));
+  }
+  fd = &corpus->streams[corpus->nStreams++];
+  fd->length = s->getLength();
+  fd->data = (char *)gmalloc(fd->length > 0 ? fd->length : 1);
+  memcpy(fd->data, s->getCString(), fd->length);
+  fd->kind = kind;
+  fd->num = num;
+  fd->fileName = fileName;
+  delete s;
+}
+
+// Add the (decrypted) encoded data of all the Flate streams of a
+// document to the corpus.
+static GBool addDocument(Corpus *corpus, GooString *fileName) {
+  PDFDoc *doc;
+  XRef *xref;
+  XRefEntry *entry;
+  Object obj, subtype;
+  Stream *str;
+  int kind, i;
+
+  doc = new PDFDoc(fileName->copy());
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", fileName->getCString());
+    delete doc;
+    return gFalse;
+  }
+  xref = doc->getXRef();
+  for (i = 0; i < xref->getNumObjects(); ++i) {
+    entry = xref->getEntry(i, gFalse);
+    if (entry->type == xrefEntryFree || entry->type == xrefEntryNone) {
+      continue;
+    }
+    xref->fetch(i, entry->type == xrefEntryCompressed ? 0 : entry->gen, &obj);
+    if (obj.isStream() && obj.getStream()->getKind() == strFlate) {
+      obj.streamGetDict()->lookup("Subtype", &subtype);
+      kind = subtype.isName("Image") ? 0 : 1;
+      subtype.free();
+      str = obj.getStream()->getNextStream();
+      addStream(corpus, str, kind, i, fileName);
+    }
+    obj.free();
+  }
+  delete doc;
+  return gTrue;
+}
+
+static unsigned int checksum(unsigned int h, Guchar *p, int n) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    h = (h ^ p[i]) * 16777619u;
+  }
+  return h;
+}
+
+// Decode a stream with FlateStream, and return the size of the output.
+// If <sum> is not NULL, also compute the checksum of the output.
+static long decodeFlateStream(FlateData *fd, unsigned int *sum) {
+  FlateStream *str;
+  Object dict;
+  long total;
+  int n;
+
+  dict.initNull();
+  str = new FlateStream(new MemStream(fd->data, 0, fd->length, &dict),
+			1, 0, 0, 0);
+  str->reset();
+  total = 0;
+  if (sum) {
+    *sum = 2166136261u;
+  }
+  while ((n = str->doGetChars(chunkSize, chunk)) > 0) {
+    if (sum) {
+      *sum = checksum(*sum, chunk, n);
+    }
+    total += n;
+  }
+  delete str;
+  return total;
+}
+
+#if ENABLE_ZLIB
+
+// Decode a stream with zlib, stopping at the first error, and return
+// the size of the output.
+static long decodeZlib(FlateData *fd, unsigned int *sum) {
+  z_stream z;
+  long total;
+  int n, ret;
+
+  memset(&z, 0, sizeof(z));
+  if (inflateInit(&z) != Z_OK) {
+    return 0;
+  }
+  z.next_in = (Bytef *)fd->data;
+  z.avail_in = fd->length;
+  total = 0;
+  if (sum) {
+    *sum = 2166136261u;
+  }
+  do {
+    z.next_out = chunk;
+    z.avail_out = chunkSize;
+    ret = inflate(&z, Z_NO_FLUSH);
+    n = chunkSize - z.avail_out;
+    if (sum) {
+      *sum = checksum(*sum, chunk, n);
+    }
+    total += n;
+  } while (ret == Z_OK && n > 0);
+  inflateEnd(&z);
+  return total;
+}
+
+#endif
+
+static void bench(Corpus *corpus,
+		  long (*decode)(FlateData *fd, unsigned int *sum),
+		  Result *results) {
+  GooTimer timer;
+  FlateData *fd;
+  long n;
+  int run, i;
+
+  for (i = 0; i < numKinds; ++i) {
+    results[i].encoded = results[i].decoded = 0;
+    results[i].time = 0;
+  }
+  for (i = 0; i < corpus->nStreams; ++i) {
+    fd = &corpus->streams[i];
+    timer.start();
+    n = 0;
+    for (run = 0; run < numRuns; ++run) {
+      n = (*decode)(fd, NULL);
+    }
+    timer.stop();
+    results[fd->kind].encoded += fd->length;
+    results[fd->kind].decoded += n;
+    results[fd->kind].time += timer.getElapsed();
+  }
+}
+
+static void printResult(const char *decoder, int kind, Result *result) {
+  printf("%-6s %-6s %10.2f %10.2f %10.2f %10.1f\n",
+	 decoder, kindNames[kind], result->encoded / 1e6, result->decoded / 1e6,
+	 result->time * 1000 / numRuns,
+	 result->time > 0 ? result->decoded * numRuns / result->time / 1e6
+	                  : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+  Corpus corpus;
+  GooString **fileNames;
+  Result flateResults[numKinds];
+  FlateData *fd;
+  int nStreams[numKinds];
+  int ret, i;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc < 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE...", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  corpus.streams = NULL;
+  corpus.nStreams = corpus.size = 0;
+  fileNames = (GooString **)gmallocn(argc, sizeof(GooString *));
+  ret = 0;
+  for (i = 1; i < argc; ++i) {
+    fileNames[i] = new GooString(argv[i]);
+    if (!addDocument(&corpus, fileNames[i])) {
+      ret = 1;
+    }
+  }
+  for (i = 0; i < numKinds; ++i) {
+    nStreams[i] = 0;
+  }
+  for (i = 0; i < corpus.nStreams; ++i) {
+    ++nStreams[corpus.streams[i].kind];
+  }
+
+  printf("%d image streams, %d other streams, %d runs\n",
+	 nStreams[0], nStreams[1], numRuns);
+  printf("%-6s %-6s %10s %10s %10s %10s\n",
+	 "", "kind", "in MB", "out MB", "ms", "MB/s");
+  bench(&corpus, &decodeFlateStream, flateResults);
+  for (i = 0; i < numKinds; ++i) {
+    printResult("flate", i, &flateResults[i]);
+  }
+
+#if ENABLE_ZLIB
+  {
+    Result zlibResults[numKinds];
+    unsigned int sum1, sum2;
+    long n1, n2;
+    int nDiffs;
+
+    bench(&corpus, &decodeZlib, zlibResults);
+    for (i = 0; i < numKinds; ++i) {
+      printResult("zlib", i, &zlibResults[i]);
+    }
+    nDiffs = 0;
+    for (i = 0; i < corpus.nStreams; ++i) {
+      fd = &corpus.streams[i];
+      n1 = decodeFlateStream(fd, &sum1);
+      n2 = decodeZlib(fd, &sum2);
+      if (n1 != n2 || sum1 != sum2) {
+	if (verbose) {
+	  printf("%s: object %d: %ld bytes from FlateStream, %ld from zlib\n",
+		 fd->fileName->getCString(), fd->num, n1, n2);
+	}
+	++nDiffs;
+      }
+    }
+    printf("%d of %d streams differ\n", nDiffs, corpus.nStreams);
+    if (nDiffs) {
+      ret = 2;
+    }
+  }
+#endif
+
+  for (i = 0; i < corpus.nStreams; ++i) {
+    gfree(corpus.streams[i].data);
+  }
+  gfree(corpus.streams);
+  for (i = 1; i < argc; ++i) {
+    delete fileNames[i];
+  }
+  gfree(fileNames);
+  delete globalParams;
+  return ret;
+}
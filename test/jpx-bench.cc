@@ -0,0 +1,244 @@
+//========================================================================
+//
+// jpx-bench.cc
+//
+// Collects the JPX-encoded (JPEG 2000) image streams of one or more
+// documents, decodes them in memory with JPXStream, and reports the
+// throughput.  With -v, the size and a checksum of the output of each
+// stream are listed, so that the output of two builds can be compared.
+// With -scale, the streams are decoded at a reduced resolution (see
+// Stream::setDecodeScale), and with -j, the number of threads the
+// decoder may use is set.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "XRef.h"
+#ifdef ENABLE_LIBOPENJPEG
+#include "JPEG2000Stream.h"
+#else
+#include "JPXStream.h"
+#endif
+#include "utils/parseargs.h"
+
+static int numRuns = 5;
+static int scale = 1;
+static int numThreads = 0;
+static GBool verbose = gFalse;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each stream is decoded (default is 5)"},
+  {"-scale",  argInt,      &scale,           0,
+   "decode at 1/2, 1/4, 1/8, ... resolution (default is 1)"},
+  {"-j",      argInt,      &numThreads,      0,
+   "number of threads (default is the number of processors)"},
+  {"-v",      argFlag,     &verbose,         0,
+   "list the size and checksum of the output of each stream"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+struct JPXData {
+  char *data;			// encoded data
+  int length;
+  int num;			// object number
+  GooString *fileName;
+};
+
+struct Corpus {
+  JPXData *streams;
+  int nStreams, size;
+};
+
+#define chunkSize 65536
+
+static Guchar chunk[chunkSize];
+
+static void addStream(Corpus *corpus, Object *obj, int num,
+		      GooString *fileName) {
+  JPXData *jd;
+  GooString *s;
+
+  s = new GooString();
+  obj->getStream()->getNextStream()->fillGooString(s);
+  if (corpus->nStreams == corpus->size) {
+    corpus->size = corpus->size ? 2 * corpus->size : 64;
+    corpus->streams = (JPXData *)greallocn(corpus->streams, corpus->size,
+					   sizeof(JPXData));
+  }
+  jd = &corpus->streams[corpus->nStreams++];
+  jd->length = s->getLength();
+  jd->data = (char *)gmalloc(jd->length > 0 ? jd->length : 1);
+  memcpy(jd->data, s->getCString(), jd->length);
+  jd->num = num;
+  jd->fileName = fileName;
+  delete s;
+}
+
+// Add the (decrypted) encoded data of all the JPX streams of a
+// document to the corpus.
+static GBool addDocument(Corpus *corpus, GooString *fileName) {
+  PDFDoc *doc;
+  XRef *xref;
+  XRefEntry *entry;
+  Object obj;
+  int i;
+
+  doc = new PDFDoc(fileName->copy());
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", fileName->getCString());
+    delete doc;
+    return gFalse;
+  }
+  xref = doc->getXRef();
+  for (i = 0; i < xref->getNumObjects(); ++i) {
+    entry = xref->getEntry(i, gFalse);
+    if (entry->type == xrefEntryFree || entry->type == xrefEntryNone) {
+      continue;
+    }
+    xref->fetch(i, entry->type == xrefEntryCompressed ? 0 : entry->gen, &obj);
+    if (obj.isStream() && obj.getStream()->getKind() == strJPX) {
+      addStream(corpus, &obj, i, fileName);
+    }
+    obj.free();
+  }
+  delete doc;
+  return gTrue;
+}
+
+// Return the scale the streams are actually decoded at.
+static int decodeScale() {
+  Stream *str;
+  Object dict;
+  int s;
+
+  dict.initNull();
+  str = new JPXStream(new MemStream((char *)"", 0, 0, &dict));
+  s = str->setDecodeScale(scale);
+  delete str;
+  return s;
+}
+
+// Decode a stream, and return the size of the output.  If <sum> is
+// not NULL, also compute the checksum of the output.
+static long decodeStream(JPXData *jd, unsigned int *sum) {
+  Stream *str;
+  Object dict;
+  long total;
+  int n, i;
+
+  dict.initNull();
+  str = new JPXStream(new MemStream(jd->data, 0, jd->length, &dict));
+  str->setDecodeScale(scale);
+  str->reset();
+  total = 0;
+  if (sum) {
+    *sum = 2166136261u;
+  }
+  while ((n = str->doGetChars(chunkSize, chunk)) > 0) {
+    if (sum) {
+      for (i = 0; i < n; ++i) {
+	*sum = (*sum ^ chunk[i]) * 16777619u;
+      }
+    }
+    total += n;
+  }
+  delete str;
+  return total;
+}
+
+int main(int argc, char *argv[]) {
+  Corpus corpus;
+  GooString **fileNames;
+  GooTimer timer;
+  JPXData *jd;
+  unsigned int sum;
+  long encoded, decoded, n;
+  double time;
+  int ret, run, i;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc < 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE...", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  globalParams->setNumThreads(numThreads);
+  corpus.streams = NULL;
+  corpus.nStreams = corpus.size = 0;
+  fileNames = (GooString **)gmallocn(argc, sizeof(GooString *));
+  ret = 0;
+  for (i = 1; i < argc; ++i) {
+    fileNames[i] = new GooString(argv[i]);
+    if (!addDocument(&corpus, fileNames[i])) {
+      ret = 1;
+    }
+  }
+
+  if (verbose) {
+    for (i = 0; i < corpus.nStreams; ++i) {
+      jd = &corpus.streams[i];
+      n = decodeStream(jd, &sum);
+      printf("%s: object %d: %ld bytes, checksum %08x\n",
+	     jd->fileName->getCString(), jd->num, n, sum);
+    }
+  }
+
+  encoded = decoded = 0;
+  time = 0;
+  for (i = 0; i < corpus.nStreams; ++i) {
+    jd = &corpus.streams[i];
+    timer.start();
+    n = 0;
+    for (run = 0; run < numRuns; ++run) {
+      n = decodeStream(jd, NULL);
+    }
+    timer.stop();
+    encoded += jd->length;
+    decoded += n;
+    time += timer.getElapsed();
+  }
+  printf("%d streams, %d runs, scale 1/%d, %d threads\n", corpus.nStreams,
+	 numRuns, decodeScale(), globalParams->getNumThreads());
+  printf("%10s %10s %10s %10s\n", "in MB", "out MB", "ms", "MB/s");
+  printf("%10.2f %10.2f %10.2f %10.1f\n",
+	 encoded / 1e6, decoded / 1e6, time * 1000 / numRuns,
+	 time > 0 ? decoded * numRuns / time / 1e6 : 0.0);
+
+  for (i = 0; i < corpus.nStreams; ++i) {
+    gfree(corpus.streams[i].data);
+  }
+  gfree(corpus.streams);
+  for (i = 1; i < argc; ++i) {
+    delete fileNames[i];
+  }
+  gfree(fileNames);
+  delete globalParams;
+  return ret;
+}
@@ -0,0 +1,341 @@
+//========================================================================
+//
+// splash-aa-bench.cc
+//
+// Compares the two vector anti-aliasing modes of Splash
+// (splashAASupersample and splashAAAnalytic):
+//  - quality: random triangles are filled one at a time, and the
+//    shape of each pixel is compared with the one computed from the
+//    exact area of the pixel covered by the triangle
+//  - speed: the triangles, and, if a PDF file is given, its pages, are
+//    drawn with both modes
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashPattern.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "utils/parseargs.h"
+
+static int numTriangles = 2000;
+static int firstPage = 1;
+static int lastPage = 0;
+static double resolution = 150;
+static int numRuns = 3;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-n",      argInt,      &numTriangles,    0,
+   "number of random triangles (default is 2000)"},
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to draw"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to draw"},
+  {"-r",      argFP,       &resolution,      0,
+   "resolution the pages are drawn at, in DPI (default is 150)"},
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each page is drawn (default is 3)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+#define bitmapSize 64
+
+// the gamma Splash applies to the coverage of anti-aliased pixels
+#define aaGamma 1.5
+
+struct Point {
+  double x, y;
+};
+
+//------------------------------------------------------------------------
+// exact coverage
+//------------------------------------------------------------------------
+
+// Clip the polygon <in> (<n> points) to the half plane where
+// <sign> * (<axis> coordinate - <v>) >= 0, and return the number of
+// points put in <out>.
+static int clipPolygon(Point *in, int n, Point *out,
+		       int axis, double v, double sign) {
+  Point *p, *q;
+  double dp, dq, t;
+  int i, m;
+
+  m = 0;
+  for (i = 0; i < n; ++i) {
+    p = &in[i];
+    q = &in[(i + 1) % n];
+    dp = sign * ((axis ? p->y : p->x) - v);
+    dq = sign * ((axis ? q->y : q->x) - v);
+    if (dp >= 0) {
+      out[m++] = *p;
+    }
+    if ((dp >= 0) != (dq >= 0)) {
+      t = dp / (dp - dq);
+      out[m].x = p->x + t * (q->x - p->x);
+      out[m].y = p->y + t * (q->y - p->y);
+      ++m;
+    }
+  }
+  return m;
+}
+
+// Return the area of pixel (<x>, <y>) covered by the triangle <tri>.
+static double pixelCoverage(Point *tri, int x, int y) {
+  Point buf1[16], buf2[16];
+  double a;
+  int n, i;
+
+  n = clipPolygon(tri, 3, buf1, 0, x, 1);
+  n = clipPolygon(buf1, n, buf2, 0, x + 1, -1);
+  n = clipPolygon(buf2, n, buf1, 1, y, 1);
+  n = clipPolygon(buf1, n, buf2, 1, y + 1, -1);
+  a = 0;
+  for (i = 0; i < n; ++i) {
+    a += buf2[i].x * buf2[(i + 1) % n].y - buf2[(i + 1) % n].x * buf2[i].y;
+  }
+  return fabs(a) / 2;
+}
+
+//------------------------------------------------------------------------
+
+static void randomTriangle(Point *tri) {
+  int i;
+
+  for (i = 0; i < 3; ++i) {
+    tri[i].x = 4 + (bitmapSize - 8) * (rand() / (double)RAND_MAX);
+    tri[i].y = 4 + (bitmapSize - 8) * (rand() / (double)RAND_MAX);
+  }
+}
+
+static void fillTriangle(Splash *splash, Point *tri) {
+  SplashPath path;
+
+  path.moveTo(tri[0].x, tri[0].y);
+  path.lineTo(tri[1].x, tri[1].y);
+  path.lineTo(tri[2].x, tri[2].y);
+  path.close();
+  splash->fill(&path, gFalse);
+}
+
+// Fill the random triangles one at a time, and return the mean and the
+// maximum absolute error of the pixel shapes, over the pixels on the
+// edges of the triangles.
+static double measureQuality(SplashAAMode aaMode, int *maxErr) {
+  SplashBitmap *bitmap;
+  Splash *splash;
+  SplashColor color;
+  Point tri[3];
+  double sum, c;
+  long n;
+  int x, y, shape, exact, err, i;
+
+  bitmap = new SplashBitmap(bitmapSize, bitmapSize, 1, splashModeMono8,
+			    gFalse);
+  splash = new Splash(bitmap, gTrue);
+  splash->setAAMode(aaMode);
+  color[0] = 0;
+  splash->setFillPattern(new SplashSolidColor(color));
+  srand(1);
+  sum = 0;
+  n = 0;
+  *maxErr = 0;
+  for (i = 0; i < numTriangles; ++i) {
+    randomTriangle(tri);
+    color[0] = 0xff;
+    splash->clear(color);
+    fillTriangle(splash, tri);
+    for (y = 0; y < bitmapSize; ++y) {
+      for (x = 0; x < bitmapSize; ++x) {
+	c = pixelCoverage(tri, x, y);
+	if (c == 0 || c == 1) {
+	  continue;
+	}
+	shape = 255 - bitmap->getDataPtr()[y * bitmap->getRowSize() + x];
+	exact = (int)floor(pow(c, aaGamma) * 255 + 0.5);
+	err = abs(shape - exact);
+	sum += err;
+	++n;
+	if (err > *maxErr) {
+	  *maxErr = err;
+	}
+      }
+    }
+  }
+  delete splash;
+  delete bitmap;
+  return n ? sum / n : 0;
+}
+
+// Return the time taken to fill all the random triangles.
+static double measureSpeed(SplashAAMode aaMode) {
+  SplashBitmap *bitmap;
+  Splash *splash;
+  SplashColor color;
+  GooTimer timer;
+  Point tri[3];
+  int i;
+
+  bitmap = new SplashBitmap(bitmapSize, bitmapSize, 1, splashModeMono8,
+			    gFalse);
+  splash = new Splash(bitmap, gTrue);
+  splash->setAAMode(aaMode);
+  color[0] = 0xff;
+  splash->clear(color);
+  srand(1);
+  timer.start();
+  for (i = 0; i < numTriangles; ++i) {
+    randomTriangle(tri);
+    color[0] = (Guchar)i;
+    splash->setFillPattern(new SplashSolidColor(color));
+    fillTriangle(splash, tri);
+  }
+  timer.stop();
+  delete splash;
+  delete bitmap;
+  return timer.getElapsed();
+}
+
+//------------------------------------------------------------------------
+
+static SplashOutputDev *makeOutputDev(PDFDoc *doc, SplashAAMode aaMode) {
+  SplashOutputDev *out;
+  SplashColor paperColor;
+
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  out->setAAMode(aaMode);
+  out->startDoc(doc);
+  return out;
+}
+
+// Draw a page <numRuns> times, and return the average time taken.
+static double drawPage(PDFDoc *doc, SplashOutputDev *out, int page) {
+  GooTimer timer;
+  int run;
+
+  timer.start();
+  for (run = 0; run < numRuns; ++run) {
+    doc->displayPage(out, page, resolution, resolution, 0,
+		     gFalse, gTrue, gFalse);
+  }
+  timer.stop();
+  return timer.getElapsed() / numRuns;
+}
+
+// Return the mean absolute difference between two bitmaps.
+static double compareBitmaps(SplashBitmap *bitmap1, SplashBitmap *bitmap2) {
+  SplashColorPtr p1, p2;
+  double sum;
+  int w, x, y;
+
+  w = bitmap1->getWidth() * 3;
+  sum = 0;
+  for (y = 0; y < bitmap1->getHeight(); ++y) {
+    p1 = bitmap1->getDataPtr() + y * bitmap1->getRowSize();
+    p2 = bitmap2->getDataPtr() + y * bitmap2->getRowSize();
+    for (x = 0; x < w; ++x) {
+      sum += abs(p1[x] - p2[x]);
+    }
+  }
+  return sum / ((double)w * bitmap1->getHeight());
+}
+
+static int drawPages(const char *fileName) {
+  PDFDoc *doc;
+  SplashOutputDev *ssOut, *anOut;
+  double ssTime, anTime, totalSS, totalAn;
+  int page;
+
+  doc = new PDFDoc(new GooString(fileName));
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", fileName);
+    delete doc;
+    return 1;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+
+  ssOut = makeOutputDev(doc, splashAASupersample);
+  anOut = makeOutputDev(doc, splashAAAnalytic);
+  printf("%s: %g DPI, %d runs\n", fileName, resolution, numRuns);
+  printf("%5s %12s %12s %10s\n", "page", "4x4 ms", "analytic ms", "mean diff");
+  totalSS = totalAn = 0;
+  for (page = firstPage; page <= lastPage; ++page) {
+    ssTime = drawPage(doc, ssOut, page);
+    anTime = drawPage(doc, anOut, page);
+    printf("%5d %12.2f %12.2f %10.4f\n", page, ssTime * 1000, anTime * 1000,
+	   compareBitmaps(ssOut->getBitmap(), anOut->getBitmap()));
+    totalSS += ssTime;
+    totalAn += anTime;
+  }
+  printf("total %12.2f %12.2f\n", totalSS * 1000, totalAn * 1000);
+
+  delete anOut;
+  delete ssOut;
+  delete doc;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  double ssErr, anErr;
+  int ssMax, anMax, ret;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc > 2 || printHelp) {
+    printUsage(argv[0], "[PDF-FILE]", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numTriangles < 1) {
+    numTriangles = 1;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+
+  ssErr = measureQuality(splashAASupersample, &ssMax);
+  anErr = measureQuality(splashAAAnalytic, &anMax);
+  printf("%d random triangles, %dx%d pixels\n", numTriangles,
+	 bitmapSize, bitmapSize);
+  printf("%-12s %10s %14s %10s\n", "mode", "fill ms", "edge shape err", "max err");
+  printf("%-12s %10.2f %14.4f %10d\n", "4x4",
+	 measureSpeed(splashAASupersample) * 1000, ssErr, ssMax);
+  printf("%-12s %10.2f %14.4f %10d\n", "analytic",
+	 measureSpeed(splashAAAnalytic) * 1000, anErr, anMax);
+
+  ret = 0;
+  if (argc == 2) {
+    ret = drawPages(argv[1]);
+  }
+
+  delete globalParams;
+  return ret;
+}
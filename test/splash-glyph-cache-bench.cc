@@ -0,0 +1,214 @@
+//========================================================================
+//
+// splash-glyph-cache-bench.cc
+//
+// Draws the pages of a document with several SplashOutputDevs at once,
+// as parallel workers do: first with each device rasterizing its own
+// glyphs, then with the glyph bitmaps shared through the process-wide
+// SplashGlyphCache.  Prints the times, the statistics of the shared
+// cache, and checks that the bitmaps are identical.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "goo/GooThread.h"
+#include "goo/GooTimer.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashGlyphCache.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "utils/parseargs.h"
+
+static int numThreads = 0;
+static int numDevs = 4;
+static int numBands = 1;
+static int cacheSize = 16384;
+static int firstPage = 1;
+static int lastPage = 0;
+static double resolution = 150;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-j",      argInt,      &numThreads,      0,
+   "number of threads (default is the number of processors)"},
+  {"-devs",   argInt,      &numDevs,         0,
+   "number of output devices drawing the pages (default is 4)"},
+  {"-bands",  argInt,      &numBands,        0,
+   "number of bands each device draws the pages in (default is 1)"},
+  {"-cache",  argInt,      &cacheSize,       0,
+   "size of the shared glyph cache, in kB (default is 16384)"},
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to draw"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to draw"},
+  {"-r",      argFP,       &resolution,      0,
+   "resolution the pages are drawn at, in DPI (default is 150)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+struct Bench {
+  PDFDoc *doc;
+  SplashOutputDev **devs;
+  unsigned int *sums;		// checksum of each page drawn by each
+				//   device
+  int nPages;
+};
+
+static unsigned int checksumBitmap(SplashBitmap *bitmap) {
+  SplashColorPtr p;
+  unsigned int h;
+  int w, x, y;
+
+  h = 2166136261u;
+  w = bitmap->getWidth() * 3;
+  for (y = 0; y < bitmap->getHeight(); ++y) {
+    p = bitmap->getDataPtr() + y * bitmap->getRowSize();
+    for (x = 0; x < w; ++x) {
+      h = (h ^ p[x]) * 16777619u;
+    }
+  }
+  return h;
+}
+
+// Draw all the pages with device <job>.
+static void drawJob(int job, void *data) {
+  Bench *bench = (Bench *)data;
+  SplashOutputDev *out;
+  int page;
+
+  out = bench->devs[job];
+  for (page = 0; page < bench->nPages; ++page) {
+    bench->doc->displayPage(out, firstPage + page, resolution, resolution, 0,
+			    gFalse, gTrue, gFalse);
+    bench->sums[job * bench->nPages + page] =
+        checksumBitmap(out->getBitmap());
+  }
+}
+
+// Draw the pages with <numDevs> devices, with glyph bitmaps shared if
+// <cacheBytes> is not 0, and return the time taken.
+static double drawPages(Bench *bench, long cacheBytes) {
+  SplashColor paperColor;
+  GooTimer timer;
+  int i;
+
+  globalParams->setGlyphCacheSize(cacheBytes);
+  SplashGlyphCache::getGlobal()->clear();
+  SplashGlyphCache::getGlobal()->resetStats();
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  for (i = 0; i < numDevs; ++i) {
+    bench->devs[i] = new SplashOutputDev(splashModeRGB8, 4, gFalse,
+					 paperColor);
+    bench->devs[i]->setNumBands(numBands);
+    bench->devs[i]->startDoc(bench->doc);
+  }
+  timer.start();
+  gRunJobs(numDevs, numThreads, &drawJob, bench);
+  timer.stop();
+  for (i = 0; i < numDevs; ++i) {
+    delete bench->devs[i];
+  }
+  return timer.getElapsed();
+}
+
+int main(int argc, char *argv[]) {
+  Bench bench;
+  SplashGlyphCacheStats stats;
+  unsigned int *privateSums;
+  double privateTime, sharedTime;
+  int n, i, ret;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numThreads < 1) {
+    numThreads = gGetNumProcessors();
+  }
+  if (numDevs < 1) {
+    numDevs = 1;
+  }
+  if (cacheSize < 1) {
+    cacheSize = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  globalParams->setNumThreads(numThreads);
+  bench.doc = new PDFDoc(new GooString(argv[1]));
+  if (!bench.doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    delete bench.doc;
+    delete globalParams;
+    return 1;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > bench.doc->getNumPages()) {
+    lastPage = bench.doc->getNumPages();
+  }
+  if (lastPage < firstPage) {
+    lastPage = firstPage;
+  }
+  bench.nPages = lastPage - firstPage + 1;
+  n = numDevs * bench.nPages;
+  bench.devs = (SplashOutputDev **)gmallocn(numDevs,
+					    sizeof(SplashOutputDev *));
+  bench.sums = (unsigned int *)gmallocn(n, sizeof(unsigned int));
+  privateSums = (unsigned int *)gmallocn(n, sizeof(unsigned int));
+
+  printf("%s: pages %d-%d at %g DPI, %d devices, %d threads, %d bands\n",
+	 argv[1], firstPage, lastPage, resolution, numDevs, numThreads,
+	 numBands);
+
+  privateTime = drawPages(&bench, 0);
+  for (i = 0; i < n; ++i) {
+    privateSums[i] = bench.sums[i];
+  }
+  sharedTime = drawPages(&bench, (long)cacheSize * 1024);
+  SplashGlyphCache::getGlobal()->getStats(&stats);
+
+  ret = 0;
+  for (i = 0; i < n; ++i) {
+    if (bench.sums[i] != privateSums[i]) {
+      ret = 2;
+    }
+  }
+
+  printf("%-8s %10s\n", "glyphs", "ms");
+  printf("%-8s %10.2f\n", "private", privateTime * 1000);
+  printf("%-8s %10.2f\n", "shared", sharedTime * 1000);
+  printf("shared cache: %ld lookups, %.1f%% hits, %ld glyphs added, "
+	 "%ld evicted, %ld glyphs (%ld of %ld kB)\n",
+	 stats.lookups,
+	 stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0,
+	 stats.insertions, stats.evictions, stats.glyphs,
+	 stats.size / 1024, stats.maxSize / 1024);
+  printf("bitmaps %s\n", ret ? "DIFFER" : "identical");
+
+  gfree(privateSums);
+  gfree(bench.sums);
+  gfree(bench.devs);
+  delete bench.doc;
+  delete globalParams;
+  return ret;
+}
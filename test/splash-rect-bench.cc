@@ -0,0 +1,247 @@
+//========================================================================
+//
+// splash-rect-bench.cc
+//
+// Times the filling of axis-aligned rectangles by Splash, on synthetic
+// pages of the kinds that are made of them (a spreadsheet, rows of
+// barcodes, and small rectangles under a clip rectangle), with and
+// without anti-aliasing.  Each page is drawn with its rectangles as
+// rectangle paths, which Splash fills directly, and again as five-point
+// paths (with an extra point in the middle of the top edge), which go
+// through the scanner, and the bitmaps are checked to be identical.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooTimer.h"
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashPattern.h"
+#include "utils/parseargs.h"
+
+static double resolution = 150;
+static int numRuns = 3;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-r",      argFP,       &resolution,      0,
+   "resolution the pages are drawn at, in DPI (default is 150)"},
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each page is drawn (default is 3)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+struct Rect {
+  double x0, y0, x1, y1;	// in points
+  Guchar gray;
+};
+
+struct Page {
+  const char *name;
+  Rect *rects;
+  int nRects, size;
+  GBool clip;			// clip to the middle of the page
+};
+
+static void addRect(Page *page, double x0, double y0, double x1, double y1,
+		    Guchar gray) {
+  if (page->nRects == page->size) {
+    page->size = page->size ? 2 * page->size : 256;
+    page->rects = (Rect *)greallocn(page->rects, page->size, sizeof(Rect));
+  }
+  page->rects[page->nRects].x0 = x0;
+  page->rects[page->nRects].y0 = y0;
+  page->rects[page->nRects].x1 = x1;
+  page->rects[page->nRects].y1 = y1;
+  page->rects[page->nRects].gray = gray;
+  ++page->nRects;
+}
+
+static double randomCoord(double max) {
+  return (double)rand() / RAND_MAX * max;
+}
+
+// A spreadsheet: shaded cells, with thin rules between them.
+static void makeTable(Page *page) {
+  double x, y;
+  int row, col;
+
+  for (row = 0; row < 60; ++row) {
+    y = 36 + row * 12;
+    for (col = 0; col < 12; ++col) {
+      x = 36 + col * 45;
+      if ((row + col) & 1) {
+	addRect(page, x, y, x + 45, y + 12, 0xe0);
+      }
+      addRect(page, x, y, x + 45, y + 0.5, 0x40);
+      addRect(page, x, y, x + 0.5, y + 12, 0x40);
+    }
+  }
+}
+
+// Rows of barcodes: bars of random widths.
+static void makeBarcodes(Page *page) {
+  double x, y, w;
+  int row;
+
+  srand(1);
+  for (row = 0; row < 12; ++row) {
+    y = 36 + row * 60;
+    for (x = 36; x < 560; x += w) {
+      w = 0.75 + randomCoord(2.25);
+      if (rand() & 1) {
+	addRect(page, x, y, x + w, y + 48, 0x00);
+      }
+    }
+  }
+}
+
+// Small random rectangles, with a clip rectangle.
+static void makeClipped(Page *page) {
+  double x, y;
+  int i;
+
+  srand(2);
+  for (i = 0; i < 5000; ++i) {
+    x = randomCoord(612);
+    y = randomCoord(792);
+    addRect(page, x, y, x + 2 + randomCoord(30), y + 2 + randomCoord(10),
+	    (Guchar)(rand() & 0xff));
+  }
+  page->clip = gTrue;
+}
+
+// Draw the page, with the rectangles as rectangle paths, or as
+// five-point paths if <scanner> is true.
+static void drawPage(Splash *splash, Page *page, GBool scanner) {
+  SplashPath *path;
+  SplashColor color;
+  double scale;
+  Rect *r;
+  int i;
+
+  scale = resolution / 72;
+  color[0] = color[1] = color[2] = 0xff;
+  splash->clear(color);
+  splash->clipResetToRect(0, 0, splash->getBitmap()->getWidth(),
+			  splash->getBitmap()->getHeight());
+  if (page->clip) {
+    splash->clipToRect(100.25 * scale, 150.25 * scale,
+		       500.75 * scale, 650.75 * scale);
+  }
+  for (i = 0; i < page->nRects; ++i) {
+    r = &page->rects[i];
+    path = new SplashPath();
+    path->moveTo(r->x0 * scale, r->y0 * scale);
+    if (scanner) {
+      path->lineTo((r->x0 + r->x1) * 0.5 * scale, r->y0 * scale);
+    }
+    path->lineTo(r->x1 * scale, r->y0 * scale);
+    path->lineTo(r->x1 * scale, r->y1 * scale);
+    path->lineTo(r->x0 * scale, r->y1 * scale);
+    path->close();
+    color[0] = color[1] = color[2] = r->gray;
+    splash->setFillPattern(new SplashSolidColor(color));
+    splash->fill(path, gFalse);
+    delete path;
+  }
+}
+
+// Draw the page <numRuns> times each way, print the times, and return
+// true if the bitmaps are identical.
+static GBool benchPage(Page *page, GBool aa) {
+  SplashBitmap *rectBitmap, *scanBitmap;
+  Splash *splash;
+  GooTimer timer;
+  double rectTime, scanTime;
+  GBool same;
+  int w, h, run;
+
+  w = (int)(8.5 * resolution);
+  h = (int)(11 * resolution);
+  rectBitmap = new SplashBitmap(w, h, 4, splashModeRGB8, gFalse);
+  scanBitmap = new SplashBitmap(w, h, 4, splashModeRGB8, gFalse);
+
+  splash = new Splash(rectBitmap, aa);
+  timer.start();
+  for (run = 0; run < numRuns; ++run) {
+    drawPage(splash, page, gFalse);
+  }
+  timer.stop();
+  rectTime = timer.getElapsed() / numRuns;
+  delete splash;
+
+  splash = new Splash(scanBitmap, aa);
+  timer.start();
+  for (run = 0; run < numRuns; ++run) {
+    drawPage(splash, page, gTrue);
+  }
+  timer.stop();
+  scanTime = timer.getElapsed() / numRuns;
+  delete splash;
+
+  same = !memcmp(rectBitmap->getDataPtr(), scanBitmap->getDataPtr(),
+		 rectBitmap->getRowSize() * h);
+  printf("%-10s %3s %6d %10.2f %10.2f %8.2fx %s\n",
+	 page->name, aa ? "yes" : "no", page->nRects,
+	 scanTime * 1000, rectTime * 1000,
+	 rectTime > 0 ? scanTime / rectTime : 0.0,
+	 same ? "identical" : "DIFFER");
+
+  delete scanBitmap;
+  delete rectBitmap;
+  return same;
+}
+
+int main(int argc, char *argv[]) {
+  Page pages[3];
+  int ret, i;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 1 || printHelp) {
+    printUsage(argv[0], NULL, argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  memset(pages, 0, sizeof(pages));
+  pages[0].name = "table";
+  makeTable(&pages[0]);
+  pages[1].name = "barcodes";
+  makeBarcodes(&pages[1]);
+  pages[2].name = "clipped";
+  makeClipped(&pages[2]);
+
+  printf("letter pages at %g DPI, %d runs\n", resolution, numRuns);
+  printf("%-10s %3s %6s %10s %10s %9s\n",
+	 "page", "aa", "rects", "scan ms", "rect ms", "speedup");
+  ret = 0;
+  for (i = 0; i < 3; ++i) {
+    if (!benchPage(&pages[i], gFalse)) {
+      ret = 2;
+    }
+    if (!benchPage(&pages[i], gTrue)) {
+      ret = 2;
+    }
+    gfree(pages[i].rects);
+  }
+  return ret;
+}
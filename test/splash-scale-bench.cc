@@ -0,0 +1,402 @@
+//========================================================================
+//
+// splash-scale-bench.cc
+//
+// Times the image and mask scalers of Splash on large synthetic scans
+// (an A4 page at 300 DPI, or 600 DPI for the mask) drawn as thumbnails,
+// and on a few other scalings, with one thread and with several, and
+// checks that the results are identical.  If a PDF file is given, its
+// pages are also drawn as thumbnails both ways.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "goo/GooThread.h"
+#include "goo/GooTimer.h"
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPattern.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "utils/parseargs.h"
+
+static int numThreads = 0;
+static int thumbSize = 200;
+static int firstPage = 1;
+static int lastPage = 0;
+static int numRuns = 3;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-j",      argInt,      &numThreads,      0,
+   "number of threads (default is the number of processors)"},
+  {"-size",   argInt,      &thumbSize,       0,
+   "height of the thumbnails, in pixels (default is 200)"},
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to draw"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to draw"},
+  {"-runs",   argInt,      &numRuns,         0,
+   "number of times each image or page is drawn (default is 3)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+//------------------------------------------------------------------------
+// synthetic images
+//------------------------------------------------------------------------
+
+struct Image {
+  int width, height, nComps;
+  Guchar *data;
+  Guchar *alpha;
+};
+
+// the image being read by imageSrc / maskSrc
+struct ImageReader {
+  Image *img;
+  int y;
+};
+
+// Make a noisy scan-like image: gradients, some text-like stripes, and
+// a bit of noise.
+static Image *makeImage(int width, int height, int nComps, GBool alpha) {
+  Image *img;
+  Guchar *p;
+  unsigned int r;
+  int x, y, c;
+
+  img = new Image;
+  img->width = width;
+  img->height = height;
+  img->nComps = nComps;
+  img->data = (Guchar *)gmallocn3(width, height, nComps);
+  img->alpha = alpha ? (Guchar *)gmallocn(width, height) : NULL;
+  r = 12345;
+  p = img->data;
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      r = r * 1103515245 + 12345;
+      for (c = 0; c < nComps; ++c) {
+	if ((y / 12) % 4 == 1 && ((x / 5) % 7) < 5) {
+	  *p++ = (Guchar)(20 + ((r >> 16) & 15));
+	} else {
+	  *p++ = (Guchar)((x * 255 / width + c * 80 + y * 64 / height +
+			   ((r >> (16 + c)) & 7)) & 0xff);
+	}
+      }
+      if (alpha) {
+	img->alpha[y * width + x] = (Guchar)((x + y) & 0xff);
+      }
+    }
+  }
+  return img;
+}
+
+// Make a 1-bit mask (one byte per pixel, 0 or 1).
+static Image *makeMask(int width, int height) {
+  Image *img;
+  int x, y;
+
+  img = new Image;
+  img->width = width;
+  img->height = height;
+  img->nComps = 1;
+  img->data = (Guchar *)gmallocn(width, height);
+  img->alpha = NULL;
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      img->data[y * width + x] =
+	  ((y / 24) % 3 == 1 && ((x / 10) % 9) < 6 && ((x ^ y) & 3)) ? 1 : 0;
+    }
+  }
+  return img;
+}
+
+static void freeImage(Image *img) {
+  gfree(img->data);
+  gfree(img->alpha);
+  delete img;
+}
+
+static GBool imageSrc(void *data, SplashColorPtr colorLine,
+		      Guchar *alphaLine) {
+  ImageReader *rd = (ImageReader *)data;
+  Image *img = rd->img;
+
+  if (rd->y >= img->height) {
+    return gFalse;
+  }
+  memcpy(colorLine, img->data + (size_t)rd->y * img->width * img->nComps,
+	 img->width * img->nComps);
+  if (alphaLine && img->alpha) {
+    memcpy(alphaLine, img->alpha + (size_t)rd->y * img->width, img->width);
+  }
+  ++rd->y;
+  return gTrue;
+}
+
+static GBool maskSrc(void *data, SplashColorPtr line) {
+  ImageReader *rd = (ImageReader *)data;
+  Image *img = rd->img;
+
+  if (rd->y >= img->height) {
+    return gFalse;
+  }
+  memcpy(line, img->data + (size_t)rd->y * img->width, img->width);
+  ++rd->y;
+  return gTrue;
+}
+
+//------------------------------------------------------------------------
+
+struct TestCase {
+  const char *name;
+  int srcWidth, srcHeight;	// 0 for the thumbnail size
+  int scaledWidth, scaledHeight;
+  SplashColorMode mode;
+  GBool alpha;
+  GBool mask;
+  GBool interpolate;
+};
+
+// Draw <img> into a new <scaledWidth> x <scaledHeight> bitmap, with
+// <nThreads> threads, <numRuns> times, and return the average time
+// taken.
+static double drawImage(TestCase *tc, Image *img, int nThreads,
+			SplashBitmap **bitmapOut) {
+  SplashBitmap *bitmap;
+  Splash *splash;
+  SplashColor color;
+  SplashCoord mat[6];
+  ImageReader rd;
+  GooTimer timer;
+  int run;
+
+  bitmap = new SplashBitmap(tc->scaledWidth, tc->scaledHeight, 1,
+			    tc->mask ? splashModeMono8 : tc->mode, gFalse);
+  splash = new Splash(bitmap, gFalse);
+  splash->setNumThreads(nThreads);
+  mat[0] = tc->scaledWidth;
+  mat[1] = 0;
+  mat[2] = 0;
+  mat[3] = tc->scaledHeight;
+  mat[4] = 0;
+  mat[5] = 0;
+  color[0] = color[1] = color[2] = color[3] = 0;
+  splash->setFillPattern(new SplashSolidColor(color));
+  timer.start();
+  for (run = 0; run < numRuns; ++run) {
+    memset(color, 0xff, sizeof(color));
+    splash->clear(color);
+    rd.img = img;
+    rd.y = 0;
+    if (tc->mask) {
+      splash->fillImageMask(&maskSrc, &rd, img->width, img->height, mat,
+			    gFalse);
+    } else {
+      splash->drawImage(&imageSrc, NULL, &rd, tc->mode, tc->alpha,
+			img->width, img->height, mat, tc->interpolate);
+    }
+  }
+  timer.stop();
+  delete splash;
+  *bitmapOut = bitmap;
+  return timer.getElapsed() / numRuns;
+}
+
+static GBool sameBitmaps(SplashBitmap *bitmap1, SplashBitmap *bitmap2) {
+  int y;
+
+  for (y = 0; y < bitmap1->getHeight(); ++y) {
+    if (memcmp(bitmap1->getDataPtr() + y * bitmap1->getRowSize(),
+	       bitmap2->getDataPtr() + y * bitmap2->getRowSize(),
+	       abs(bitmap1->getRowSize()))) {
+      return gFalse;
+    }
+  }
+  return gTrue;
+}
+
+static int runTests(int nThreads) {
+  // an A4 page at 300 DPI (600 DPI for the mask), and the thumbnail
+  // size which keeps its aspect ratio
+  int tw = thumbSize * 2480 / 3508;
+  TestCase cases[] = {
+    { "RGB scan -> thumbnail",        2480, 3508, tw, thumbSize,
+      splashModeRGB8, gFalse, gFalse, gFalse },
+    { "gray scan -> thumbnail",       2480, 3508, tw, thumbSize,
+      splashModeMono8, gFalse, gFalse, gFalse },
+    { "RGB+alpha scan -> thumbnail",  2480, 3508, tw, thumbSize,
+      splashModeRGB8, gTrue, gFalse, gFalse },
+    { "mask scan -> thumbnail",       4960, 7016, tw, thumbSize,
+      splashModeMono8, gFalse, gTrue, gFalse },
+    { "RGB scan -> 1/2",              2480, 3508, 1240, 1754,
+      splashModeRGB8, gFalse, gFalse, gFalse },
+    { "RGB wide -> narrow/tall",      2480, 900, 1000, 1800,
+      splashModeRGB8, gFalse, gFalse, gFalse },
+    { "RGB -> 8x (replicated)",       310, 438, 2480, 3504,
+      splashModeRGB8, gFalse, gFalse, gFalse },
+    { "RGB -> 2x (bilinear)",         1240, 1754, 2480, 3508,
+      splashModeRGB8, gFalse, gFalse, gTrue },
+    { "mask -> 8x",                   310, 438, 2480, 3504,
+      splashModeMono8, gFalse, gTrue, gFalse },
+  };
+  SplashBitmap *bitmap1, *bitmapN;
+  Image *img;
+  double t1, tN, total1, totalN;
+  GBool same;
+  int ret, i;
+
+  printf("%-30s %11s %11s %10s %8s %6s\n", "image", "size", "scaled",
+	 "1 thr ms", "N thr ms", "same");
+  ret = 0;
+  total1 = totalN = 0;
+  for (i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); ++i) {
+    TestCase *tc = &cases[i];
+    if (tc->mask) {
+      img = makeMask(tc->srcWidth, tc->srcHeight);
+    } else {
+      img = makeImage(tc->srcWidth, tc->srcHeight,
+		      tc->mode == splashModeMono8 ? 1 : 3, tc->alpha);
+    }
+    t1 = drawImage(tc, img, 1, &bitmap1);
+    tN = drawImage(tc, img, nThreads, &bitmapN);
+    same = sameBitmaps(bitmap1, bitmapN);
+    printf("%-30s %5dx%-5d %5dx%-5d %10.2f %8.2f %6s\n", tc->name,
+	   tc->srcWidth, tc->srcHeight, tc->scaledWidth, tc->scaledHeight,
+	   t1 * 1000, tN * 1000, same ? "yes" : "NO");
+    if (!same) {
+      ret = 2;
+    }
+    total1 += t1;
+    totalN += tN;
+    delete bitmap1;
+    delete bitmapN;
+    freeImage(img);
+  }
+  printf("%-54s %10.2f %8.2f\n", "total", total1 * 1000, totalN * 1000);
+  return ret;
+}
+
+//------------------------------------------------------------------------
+
+// Draw a page as a thumbnail <numRuns> times, and return the average
+// time taken.
+static double drawPage(PDFDoc *doc, SplashOutputDev *out, int page) {
+  GooTimer timer;
+  double dpi;
+  int run;
+
+  dpi = 72.0 * thumbSize / doc->getPageCropHeight(page);
+  timer.start();
+  for (run = 0; run < numRuns; ++run) {
+    doc->displayPage(out, page, dpi, dpi, 0, gFalse, gTrue, gFalse);
+  }
+  timer.stop();
+  return timer.getElapsed() / numRuns;
+}
+
+static int drawPages(const char *fileName, int nThreads) {
+  PDFDoc *doc;
+  SplashOutputDev *out1, *outN;
+  SplashColor paperColor;
+  double t1, tN, total1, totalN;
+  GBool same;
+  int page, ret;
+
+  doc = new PDFDoc(new GooString(fileName));
+  if (!doc->isOk()) {
+    fprintf(stderr, "Couldn't open %s\n", fileName);
+    delete doc;
+    return 1;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  out1 = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  out1->startDoc(doc);
+  outN = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  outN->startDoc(doc);
+  printf("\n%s: %d pixel high thumbnails, %d runs\n", fileName, thumbSize,
+	 numRuns);
+  printf("%5s %10s %10s %6s\n", "page", "1 thr ms", "N thr ms", "same");
+  ret = 0;
+  total1 = totalN = 0;
+  for (page = firstPage; page <= lastPage; ++page) {
+    globalParams->setNumThreads(1);
+    t1 = drawPage(doc, out1, page);
+    globalParams->setNumThreads(nThreads);
+    tN = drawPage(doc, outN, page);
+    same = sameBitmaps(out1->getBitmap(), outN->getBitmap());
+    printf("%5d %10.2f %10.2f %6s\n", page, t1 * 1000, tN * 1000,
+	   same ? "yes" : "NO");
+    if (!same) {
+      ret = 2;
+    }
+    total1 += t1;
+    totalN += tN;
+  }
+  printf("total %10.2f %10.2f\n", total1 * 1000, totalN * 1000);
+
+  delete outN;
+  delete out1;
+  delete doc;
+  return ret;
+}
+
+int main(int argc, char *argv[]) {
+  int ret, ret2;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc > 2 || printHelp) {
+    printUsage(argv[0], "[PDF-FILE]", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (numThreads < 1) {
+    numThreads = gGetNumProcessors();
+  }
+  if (thumbSize < 8) {
+    thumbSize = 8;
+  }
+  if (numRuns < 1) {
+    numRuns = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+
+  printf("%d threads\n", numThreads);
+  ret = runTests(numThreads);
+  if (argc == 2) {
+    ret2 = drawPages(argv[1], numThreads);
+    if (!ret) {
+      ret = ret2;
+    }
+  }
+
+  delete globalParams;
+  return ret;
+}
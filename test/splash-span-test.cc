@@ -0,0 +1,468 @@
+//========================================================================
+//
+// splash-span-test.cc
+//
+// Checks that the Splash span kernels give the same pixels as the
+// per-pixel pipe.  Each color mode is rendered with random fills,
+// strokes and composited groups (with and without antialiasing, fill
+// alpha, soft masks, transfer functions, blend functions and
+// clipping), once with the per-pixel pipe and once with each available
+// kernel implementation, and the bitmaps are compared byte for byte.
+// The kernels are also compared with each other on random spans.
+// Prints the rendering time of each implementation.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooTimer.h"
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashPattern.h"
+#include "splash/SplashSpan.h"
+
+#define bitmapWidth 237
+#define bitmapHeight 61
+#define numObjects 200
+
+//------------------------------------------------------------------------
+
+static Guint randState;
+
+static int randInt(int n) {
+  randState = randState * 1103515245u + 12345u;
+  return (int)((randState >> 8) % (Guint)n);
+}
+
+static double randCoord(double max) {
+  return randInt(10000) * max / 10000.0;
+}
+
+static const char *implName(SplashSpanImpl impl) {
+  switch (impl) {
+  case splashSpanImplNone:
+    return "pipe";
+  case splashSpanImplScalar:
+    return "scalar";
+  case splashSpanImplSSE2:
+    return "sse2";
+  case splashSpanImplAVX2:
+    return "avx2";
+  }
+  return "?";
+}
+
+static const char *modeName(SplashColorMode mode) {
+  switch (mode) {
+  case splashModeMono8:
+    return "Mono8";
+  case splashModeRGB8:
+    return "RGB8";
+  case splashModeBGR8:
+    return "BGR8";
+  case splashModeXBGR8:
+    return "XBGR8";
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    return "CMYK8";
+#endif
+  default:
+    return "?";
+  }
+}
+
+static void randColor(SplashColorPtr color) {
+  int i;
+
+  for (i = 0; i < splashMaxColorComps; ++i) {
+    color[i] = (Guchar)randInt(256);
+  }
+}
+
+static SplashPath *makePolygon() {
+  SplashPath *path;
+  int n, i;
+
+  path = new SplashPath();
+  n = 3 + randInt(3);
+  for (i = 0; i < n; ++i) {
+    if (i == 0) {
+      path->moveTo(randCoord(bitmapWidth + 20) - 10,
+		   randCoord(bitmapHeight + 20) - 10);
+    } else {
+      path->lineTo(randCoord(bitmapWidth + 20) - 10,
+		   randCoord(bitmapHeight + 20) - 10);
+    }
+  }
+  path->close();
+  return path;
+}
+
+static SplashPath *makeRect() {
+  SplashPath *path;
+  double x0, y0, x1, y1;
+
+  path = new SplashPath();
+  x0 = randCoord(bitmapWidth);
+  y0 = randCoord(bitmapHeight);
+  x1 = x0 + randCoord(bitmapWidth);
+  y1 = y0 + randCoord(bitmapHeight);
+  path->moveTo(x0, y0);
+  path->lineTo(x1, y0);
+  path->lineTo(x1, y1);
+  path->lineTo(x0, y1);
+  path->close();
+  return path;
+}
+
+static SplashBitmap *makeSoftMask() {
+  SplashBitmap *softMask;
+  SplashColorPtr p;
+  int x, y, v;
+
+  softMask = new SplashBitmap(bitmapWidth, bitmapHeight, 1, splashModeMono8,
+			      gFalse);
+  v = randInt(256);
+  for (y = 0; y < bitmapHeight; ++y) {
+    p = softMask->getDataPtr() + y * softMask->getRowSize();
+    for (x = 0; x < bitmapWidth; ++x) {
+      // mostly smooth, with some 0 and 255 runs
+      if (!randInt(16)) {
+	v = randInt(3) == 0 ? 0 : randInt(3) == 0 ? 255 : randInt(256);
+      }
+      p[x] = (Guchar)v;
+    }
+  }
+  return softMask;
+}
+
+static void setRandomTransfer(Splash *splash) {
+  Guchar red[256], green[256], blue[256], gray[256];
+  int i;
+
+  for (i = 0; i < 256; ++i) {
+    red[i] = (Guchar)(255 - i);
+    green[i] = (Guchar)((i * i) / 255);
+    blue[i] = (Guchar)(i / 2 + 64);
+    gray[i] = (Guchar)(i ^ 0x55);
+  }
+  splash->setTransfer(red, green, blue, gray);
+}
+
+//------------------------------------------------------------------------
+// blend functions
+//------------------------------------------------------------------------
+
+static GBool isSubtractive(SplashColorMode mode) {
+#if SPLASH_CMYK
+  return mode == splashModeCMYK8 || mode == splashModeDeviceN8;
+#else
+  return gFalse;
+#endif
+}
+
+static void blendMultiply(SplashColorPtr src, SplashColorPtr dest,
+			  SplashColorPtr blend, SplashColorMode cm) {
+  int inv, i;
+
+  inv = isSubtractive(cm) ? 0xff : 0;
+  for (i = 0; i < splashColorModeNComps[cm]; ++i) {
+    blend[i] = (Guchar)((((dest[i] ^ inv) * (src[i] ^ inv)) / 255) ^ inv);
+  }
+}
+
+static void blendMultiplyRow(SplashColorPtr src, SplashColorPtr dest,
+			     SplashColorPtr blend, int n,
+			     SplashColorMode cm) {
+  int inv, i;
+
+  inv = isSubtractive(cm) ? 0xff : 0;
+  for (i = 0; i < n * splashColorModeNComps[cm]; ++i) {
+    blend[i] = (Guchar)((((dest[i] ^ inv) * (src[i] ^ inv)) / 255) ^ inv);
+  }
+}
+
+// (no row version)
+static void blendDifference(SplashColorPtr src, SplashColorPtr dest,
+			    SplashColorPtr blend, SplashColorMode cm) {
+  int i;
+
+  for (i = 0; i < splashColorModeNComps[cm]; ++i) {
+    blend[i] = (Guchar)(dest[i] < src[i] ? src[i] - dest[i]
+			                 : dest[i] - src[i]);
+    if (isSubtractive(cm)) {
+      blend[i] = (Guchar)(255 - blend[i]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+// A random group: a bitmap with random colors, whose alpha has runs of
+// 0, 255 and random values.
+static SplashBitmap *makeGroup(SplashColorMode mode, int *w, int *h) {
+  SplashBitmap *group;
+  SplashColorPtr p;
+  Guchar *q;
+  int x, y, a;
+
+  *w = 1 + randInt(bitmapWidth);
+  *h = 1 + randInt(bitmapHeight);
+  group = new SplashBitmap(*w, *h, 1, mode, gTrue);
+  a = 0;
+  for (y = 0; y < *h; ++y) {
+    p = group->getDataPtr() + y * group->getRowSize();
+    for (x = 0; x < group->getRowSize(); ++x) {
+      p[x] = (Guchar)randInt(256);
+    }
+    q = group->getAlphaPtr() + y * *w;
+    for (x = 0; x < *w; ++x) {
+      if (!randInt(8)) {
+	a = randInt(3) == 0 ? 0 : randInt(2) ? 255 : randInt(256);
+      }
+      q[x] = (Guchar)a;
+    }
+  }
+  return group;
+}
+
+// Draw the same random objects, with the span kernel implementation
+// <impl>.
+static SplashBitmap *render(SplashColorMode mode, GBool vectorAntialias,
+			    Guint seed, SplashSpanImpl impl, double *time) {
+  SplashBitmap *bitmap, *group;
+  Splash *splash;
+  SplashPath *path;
+  SplashColor color;
+  GooTimer timer;
+  int i, xSrc, ySrc, w, h;
+
+  splashSpanSetImpl(impl);
+  randState = seed;
+  bitmap = new SplashBitmap(bitmapWidth, bitmapHeight, 1, mode, gTrue);
+  splash = new Splash(bitmap, vectorAntialias);
+  randColor(color);
+  splash->clear(color, 0);
+  timer.start();
+  for (i = 0; i < numObjects; ++i) {
+    splash->saveState();
+    randColor(color);
+    splash->setFillPattern(new SplashSolidColor(color));
+    splash->setStrokePattern(new SplashSolidColor(color));
+    if (randInt(2)) {
+      splash->setFillAlpha(randInt(256) / 255.0);
+      splash->setStrokeAlpha(randInt(256) / 255.0);
+    }
+    if (!randInt(5)) {
+      splash->setSoftMask(makeSoftMask());
+    }
+    if (!randInt(6)) {
+      setRandomTransfer(splash);
+    }
+    switch (randInt(6)) {
+    case 0:
+      splash->setBlendFunc(&blendMultiply, &blendMultiplyRow);
+      break;
+    case 1:
+      splash->setBlendFunc(&blendDifference);
+      break;
+    }
+    if (!randInt(4)) {
+      splash->clipToRect(randCoord(bitmapWidth / 2),
+			 randCoord(bitmapHeight / 2),
+			 bitmapWidth / 2 + randCoord(bitmapWidth / 2),
+			 bitmapHeight / 2 + randCoord(bitmapHeight / 2));
+    }
+    if (!randInt(4)) {
+      path = makePolygon();
+      splash->clipToPath(path, gFalse);
+      delete path;
+    }
+    switch (randInt(5)) {
+    case 0:
+      path = makeRect();
+      splash->fill(path, gFalse);
+      break;
+    case 4:
+      // composite a group, isolated or not
+      path = NULL;
+      group = makeGroup(mode, &w, &h);
+      xSrc = randInt(w);
+      ySrc = randInt(h);
+      w = 1 + randInt(w - xSrc);
+      h = 1 + randInt(h - ySrc);
+      splash->composite(group, xSrc, ySrc,
+			randInt(bitmapWidth - w + 1),
+			randInt(bitmapHeight - h + 1), w, h,
+			randInt(2), randInt(2));
+      delete group;
+      break;
+    case 1:
+      // thin line
+      path = new SplashPath();
+      path->moveTo(randCoord(bitmapWidth), randCoord(bitmapHeight));
+      path->lineTo(randCoord(bitmapWidth), randCoord(bitmapHeight));
+      splash->setLineWidth(randCoord(1.5));
+      splash->setThinLineMode((SplashThinLineMode)randInt(3));
+      splash->stroke(path);
+      break;
+    default:
+      path = makePolygon();
+      splash->fill(path, randInt(2));
+      break;
+    }
+    delete path;
+    splash->restoreState();
+  }
+  timer.stop();
+  *time = timer.getElapsed();
+  delete splash;
+  return bitmap;
+}
+
+static GBool sameBitmaps(SplashBitmap *bitmap1, SplashBitmap *bitmap2) {
+  return !memcmp(bitmap1->getDataPtr(), bitmap2->getDataPtr(),
+		 bitmap1->getRowSize() * bitmap1->getHeight()) &&
+         !memcmp(bitmap1->getAlphaPtr(), bitmap2->getAlphaPtr(),
+		 bitmap1->getWidth() * bitmap1->getHeight());
+}
+
+static int testRendering(SplashColorMode mode, GBool vectorAntialias) {
+  static const SplashSpanImpl impls[] = {
+    splashSpanImplScalar, splashSpanImplSSE2, splashSpanImplAVX2
+  };
+  SplashBitmap *ref, *bitmap;
+  double refTime, time;
+  Guint seed;
+  int errors, i;
+
+  errors = 0;
+  for (seed = 1; seed <= 20; ++seed) {
+    ref = render(mode, vectorAntialias, seed, splashSpanImplNone, &refTime);
+    for (i = 0; i < (int)(sizeof(impls) / sizeof(impls[0])); ++i) {
+      if (!splashSpanImplAvailable(impls[i])) {
+	continue;
+      }
+      bitmap = render(mode, vectorAntialias, seed, impls[i], &time);
+      if (!sameBitmaps(ref, bitmap)) {
+	printf("FAIL: %s %s seed %u: %s differs from the pipe\n",
+	       modeName(mode), vectorAntialias ? "aa" : "no-aa", seed,
+	       implName(impls[i]));
+	++errors;
+      }
+      if (seed == 1) {
+	printf("%-6s %-5s %-6s %8.3f ms  (pipe %8.3f ms)\n",
+	       modeName(mode), vectorAntialias ? "aa" : "no-aa",
+	       implName(impls[i]), time * 1000, refTime * 1000);
+      }
+      delete bitmap;
+    }
+    delete ref;
+  }
+  return errors;
+}
+
+//------------------------------------------------------------------------
+
+// Composite random spans of every length up to 100 with each
+// implementation, and compare them with the scalar one.
+static int testKernels(SplashColorMode mode) {
+  static const SplashSpanImpl impls[] = {
+    splashSpanImplSSE2, splashSpanImplAVX2
+  };
+  Guchar dest[2][400], destAlpha[2][100], shape[100], softMask[100];
+  Guchar transfer[4][256];
+  SplashSpanSrc src;
+  int errors, n, i, j, k;
+
+  for (k = 0; k < 4; ++k) {
+    for (j = 0; j < 256; ++j) {
+      transfer[k][j] = (Guchar)randInt(256);
+    }
+  }
+  errors = 0;
+  for (i = 0; i < (int)(sizeof(impls) / sizeof(impls[0])); ++i) {
+    if (!splashSpanImplAvailable(impls[i])) {
+      continue;
+    }
+    for (n = 0; n <= 100; ++n) {
+      for (j = 0; j < 4 * n; ++j) {
+	dest[0][j] = dest[1][j] = (Guchar)randInt(256);
+      }
+      for (j = 0; j < n; ++j) {
+	destAlpha[0][j] = destAlpha[1][j] = randInt(4) ? randInt(256) : 0;
+	shape[j] = randInt(4) ? randInt(256) : 255;
+	softMask[j] = (Guchar)randInt(256);
+      }
+      for (k = 0; k < 4; ++k) {
+	src.color[k] = (Guchar)randInt(256);
+	src.transfer[k] = (n & 1) ? transfer[k] : NULL;
+      }
+      src.aInput = randInt(2) ? 255 : randInt(256);
+      src.shape = randInt(2) ? shape : NULL;
+      src.shapeVal = (Guchar)randInt(256);
+      src.softMask = randInt(2) ? softMask : NULL;
+
+      splashSpanSetImpl(splashSpanImplScalar);
+      splashSpanComposite(mode, &src, dest[0], destAlpha[0], n);
+      splashSpanSetImpl(impls[i]);
+      splashSpanComposite(mode, &src, dest[1], destAlpha[1], n);
+      if (memcmp(dest[0], dest[1], 4 * n) ||
+	  memcmp(destAlpha[0], destAlpha[1], n)) {
+	printf("FAIL: %s composite, %d pixels: %s differs from scalar\n",
+	       modeName(mode), n, implName(impls[i]));
+	++errors;
+      }
+
+      splashSpanSetImpl(splashSpanImplScalar);
+      splashSpanFill(mode, dest[0], destAlpha[0], src.color, n);
+      splashSpanSetImpl(impls[i]);
+      splashSpanFill(mode, dest[1], destAlpha[1], src.color, n);
+      if (memcmp(dest[0], dest[1], 4 * n) ||
+	  memcmp(destAlpha[0], destAlpha[1], n)) {
+	printf("FAIL: %s fill, %d pixels: %s differs from scalar\n",
+	       modeName(mode), n, implName(impls[i]));
+	++errors;
+      }
+    }
+  }
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+  static const SplashColorMode modes[] = {
+    splashModeMono8, splashModeRGB8, splashModeBGR8, splashModeXBGR8
+#if SPLASH_CMYK
+    , splashModeCMYK8
+#endif
+  };
+  SplashSpanImpl defaultImpl;
+  int errors, i;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  defaultImpl = splashSpanGetImpl();
+  printf("default span kernels: %s\n", implName(defaultImpl));
+  errors = 0;
+  for (i = 0; i < (int)(sizeof(modes) / sizeof(modes[0])); ++i) {
+    randState = 12345 + i;
+    errors += testKernels(modes[i]);
+    errors += testRendering(modes[i], gFalse);
+    errors += testRendering(modes[i], gTrue);
+  }
+  splashSpanSetImpl(defaultImpl);
+  if (errors) {
+    printf("%d failures\n", errors);
+    return 1;
+  }
+  printf("all span kernels match the pipe\n");
+  return 0;
+}
@@ -0,0 +1,166 @@
+//========================================================================
+//
+// stream-cache-bench.cc
+//
+// Draws the pages of a document with a SplashOutputDev twice, once
+// with the decoded stream cache disabled and once with it enabled, and
+// compares the bitmaps, and the time taken.  Documents that draw the
+// same images or forms on every page (logos, letterheads, background
+// images) should be drawn faster with the cache.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "goo/GooString.h"
+#include "goo/GooTimer.h"
+#include "splash/SplashBitmap.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "utils/parseargs.h"
+
+static int firstPage = 1;
+static int lastPage = 0;
+static double resolution = 72;
+static int cacheSize = 16;
+static GBool printHelp = gFalse;
+
+static const ArgDesc argDesc[] = {
+  {"-f",      argInt,      &firstPage,       0,
+   "first page to draw"},
+  {"-l",      argInt,      &lastPage,        0,
+   "last page to draw"},
+  {"-r",      argFP,       &resolution,      0,
+   "resolution the pages are drawn at, in DPI (default is 72)"},
+  {"-cache",  argInt,      &cacheSize,       0,
+   "size of the decoded stream cache, in MB (default is 16)"},
+  {"-h",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-help",   argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"--help",  argFlag,     &printHelp,       0,
+   "print usage information"},
+  {"-?",      argFlag,     &printHelp,       0,
+   "print usage information"},
+  {NULL}
+};
+
+// Draw the pages of <fileName>, with a decoded stream cache of
+// <cacheBytes>.  Returns the time taken, in seconds, and a copy of
+// each page's bitmap data in <pages> (or NULL if the document can't be
+// opened).
+static double drawDocument(char *fileName, size_t cacheBytes,
+			   SplashBitmap ***pages) {
+  PDFDoc *doc;
+  SplashOutputDev *out;
+  SplashColor paperColor;
+  GooTimer timer;
+  int page;
+
+  globalParams->setDecodedStreamCacheBytes(cacheBytes);
+  timer.start();
+  doc = new PDFDoc(new GooString(fileName));
+  if (!doc->isOk()) {
+    delete doc;
+    *pages = NULL;
+    return 0;
+  }
+  if (firstPage < 1) {
+    firstPage = 1;
+  }
+  if (lastPage < 1 || lastPage > doc->getNumPages()) {
+    lastPage = doc->getNumPages();
+  }
+  *pages = (SplashBitmap **)gmallocn(lastPage + 1, sizeof(SplashBitmap *));
+  paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+  out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paperColor);
+  out->startDoc(doc);
+  for (page = firstPage; page <= lastPage; ++page) {
+    doc->displayPage(out, page, resolution, resolution, 0,
+		     gFalse, gTrue, gFalse);
+    (*pages)[page] = out->takeBitmap();
+  }
+  timer.stop();
+  delete out;
+  delete doc;
+  return timer.getElapsed();
+}
+
+// Count the bytes that differ between two bitmaps.
+static long compareBitmaps(SplashBitmap *bitmap1, SplashBitmap *bitmap2) {
+  long n;
+  int w, y, x;
+
+  if (bitmap1->getWidth() != bitmap2->getWidth() ||
+      bitmap1->getHeight() != bitmap2->getHeight()) {
+    return -1;
+  }
+  w = bitmap1->getWidth() * 3;
+  n = 0;
+  for (y = 0; y < bitmap1->getHeight(); ++y) {
+    SplashColorPtr p1 = bitmap1->getDataPtr() + y * bitmap1->getRowSize();
+    SplashColorPtr p2 = bitmap2->getDataPtr() + y * bitmap2->getRowSize();
+    for (x = 0; x < w; ++x) {
+      if (p1[x] != p2[x]) {
+	++n;
+      }
+    }
+  }
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  SplashBitmap **uncached, **cached;
+  double uncachedTime, cachedTime;
+  long diffs;
+  int page, nDiffs;
+
+  GBool ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc != 2 || printHelp) {
+    printUsage(argv[0], "PDF-FILE", argDesc);
+    return printHelp ? 0 : 1;
+  }
+  if (cacheSize < 1) {
+    cacheSize = 1;
+  }
+
+  globalParams = new GlobalParams();
+  globalParams->setErrQuiet(gTrue);
+  uncachedTime = drawDocument(argv[1], 0, &uncached);
+  if (!uncached) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    delete globalParams;
+    return 1;
+  }
+  cachedTime = drawDocument(argv[1], (size_t)cacheSize * 1024 * 1024,
+			    &cached);
+
+  nDiffs = 0;
+  for (page = firstPage; page <= lastPage; ++page) {
+    diffs = compareBitmaps(uncached[page], cached[page]);
+    if (diffs) {
+      printf("page %d: %ld bytes differ\n", page, diffs);
+      ++nDiffs;
+    }
+    delete uncached[page];
+    delete cached[page];
+  }
+  gfree(uncached);
+  gfree(cached);
+
+  printf("%s: pages %d-%d at %g DPI\n", argv[1], firstPage, lastPage,
+	 resolution);
+  printf("no cache     %10.2f ms\n", uncachedTime * 1000);
+  printf("%4d MB cache %10.2f ms\n", cacheSize, cachedTime * 1000);
+  printf("%d pages differ\n", nDiffs);
+
+  delete globalParams;
+  return nDiffs ? 2 : 0;
+}
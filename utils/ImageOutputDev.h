@@ -97,6 +97,10 @@ public:
   // operations.
   virtual GBool useTilingPatternFill() { return gTrue; }
 
+  // Can images be read from the decoded stream cache?  No: images are
+  // listed and dumped with their original encoding.
+  virtual GBool useDecodedStreamCache() { return gFalse; }
+
   // Does this device use beginType3Char/endType3Char?  Otherwise,
   // text in Type 3 fonts will be drawn with drawChar/drawString.
   virtual GBool interpretType3Chars() { return gFalse; }
@@ -95,11 +95,15 @@ static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
 static GBool fontAntialias = gTrue;
 static GBool vectorAntialias = gTrue;
+static char aaModeStr[16] = "";
+static SplashAAMode aaMode = splashAASupersample;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static char TiffCompressionStr[16] = "";
 static char thinLineModeStr[8] = "";
 static SplashThinLineMode thinLineMode = splashThinLineDefault;
+static int numberOfBands = 1;
+static GBool reduceImages = gFalse;
 #ifdef UTILS_USE_PTHREADS
 static int numberOfJobs = 1;
 #endif // UTILS_USE_PTHREADS
@@ -182,6 +186,13 @@ static const ArgDesc argDesc[] = {
    "enable font anti-aliasing: yes, no"},
   {"-aaVector",   argString,      vectorAntialiasStr, sizeof(vectorAntialiasStr),
    "enable vector anti-aliasing: yes, no"},
+  {"-aaMode",     argString,      aaModeStr,      sizeof(aaModeStr),
+   "set vector anti-aliasing mode: supersample, analytic. Default: supersample"},
+  
+  {"-bands",   argInt,      &numberOfBands, 0,
+   "number of horizontal bands each page is rendered in, concurrently"},
+  {"-reduce-images", argFlag, &reduceImages,  0,
+   "decode JPEG and JPEG 2000 images drawn at a reduced size at a reduced resolution"},
   
   {"-opw",    argString,   ownerPassword,  sizeof(ownerPassword),
    "owner password (for encrypted files)"},
@@ -294,6 +305,9 @@ static void processPageJobs() {
 		              splashModeRGB8, 4, gFalse, *pageJob.paperColor, gTrue, thinLineMode);
     splashOut->setFontAntialias(fontAntialias);
     splashOut->setVectorAntialias(vectorAntialias);
+    splashOut->setAAMode(aaMode);
+    splashOut->setNumBands(numberOfBands);
+    splashOut->setReduceImageResolution(reduceImages);
     splashOut->startDoc(pageJob.doc);
     
     savePageSlice(pageJob.doc, splashOut, pageJob.pg, x, y, w, h, pageJob.pg_w, pageJob.pg_h, pageJob.ppmFile);
@@ -371,6 +385,13 @@ int main(int argc, char *argv[]) {
       fprintf(stderr, "Bad '-aaVector' value on command line\n");
     }
   }
+  if (aaModeStr[0]) {
+    if (strcmp(aaModeStr, "analytic") == 0) {
+      aaMode = splashAAAnalytic;
+    } else if (strcmp(aaModeStr, "supersample") != 0) {
+      fprintf(stderr, "Bad '-aaMode' value on command line\n");
+    }
+  }
 
   // read config file
   globalParams = new GlobalParams();
@@ -476,6 +497,9 @@ int main(int argc, char *argv[]) {
 
   splashOut->setFontAntialias(fontAntialias);
   splashOut->setVectorAntialias(vectorAntialias);
+  splashOut->setAAMode(aaMode);
+  splashOut->setNumBands(numberOfBands);
+  splashOut->setReduceImageResolution(reduceImages);
   splashOut->startDoc(doc);
   
 #endif // UTILS_USE_PTHREADS